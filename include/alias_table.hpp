@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <seed_selector.hpp>
+#include <vector>
+
+// Walker/Vose alias table.
+// Built once when the playlist is loaded, then every weighted sample costs one
+// bounded draw and one coin flip regardless of the playlist size.
+class AliasTable {
+public:
+  AliasTable() = default;
+  // weights must be finite, >= 0 and sum to > 0.
+  explicit AliasTable(std::vector<double> const &weights);
+
+  // Draws a column and a coin from seq. Only integer arithmetic is used here
+  // so every client picks the same index for the same sequence.
+  [[nodiscard]] std::size_t sample(SeedSequenceV2 &seq) const noexcept;
+
+  [[nodiscard]] std::size_t size() const noexcept;
+  [[nodiscard]] bool empty() const noexcept;
+
+private:
+  // probability of keeping column i, scaled to 2^32 (2^32 = always keep)
+  std::vector<std::uint64_t> m_thresholds;
+  std::vector<std::uint32_t> m_aliases;
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <miniaudio.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <worker_pool.hpp>
+
+// A whole music file decoded to PCM, in the format ma_decoder outputs by
+// default(what MusicPlayer streams).
+struct DecodedAudio {
+  struct FreeFrames {
+    void operator()(void *frames) const noexcept { ma_free(frames, nullptr); }
+  };
+
+  ma_format format = ma_format_unknown;
+  ma_uint32 channels = 0;
+  ma_uint32 sample_rate = 0;
+  ma_uint64 frame_count = 0;
+  std::unique_ptr<void, FreeFrames> frames;
+
+  [[nodiscard]] std::size_t size_bytes() const noexcept;
+};
+
+// Decoded music files shared by the players of every dolphin instance. A
+// music playing on N instances is decoded once and held once, and a looping
+// music is not decoded again on every loop. Files are decoded on a
+// WorkerPool, a miss never waits for the decoder.
+class DecodedAudioCache {
+public:
+  struct Stats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+  };
+
+  // Least recently used musics are dropped above capacity_bytes, players
+  // keep the ones they are playing alive.
+  DecodedAudioCache(std::size_t const capacity_bytes, WorkerPool &pool);
+  DecodedAudioCache(DecodedAudioCache const &) = delete;
+  DecodedAudioCache &operator=(DecodedAudioCache const &) = delete;
+
+  // nullptr if path is not decoded yet, it is then decoded in the
+  // background for the next call. Files that failed to decode or don't fit
+  // are not tried again.
+  [[nodiscard]] std::shared_ptr<DecodedAudio const>
+  find(std::filesystem::path const &path);
+
+  [[nodiscard]] Stats stats() const;
+  void log_stats() const;
+
+private:
+  // shared with the decode tasks, which may outlive the cache
+  struct State {
+    struct Entry {
+      std::shared_ptr<DecodedAudio const> audio;
+      std::uint64_t last_use = 0;
+    };
+
+    std::size_t capacity_bytes = 0;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    // queued or decoding
+    std::unordered_set<std::string> pending;
+    std::unordered_set<std::string> failed;
+    std::uint64_t use_counter = 0;
+    Stats stats;
+
+    void insert(std::string const &key,
+                std::shared_ptr<DecodedAudio const> audio);
+  };
+
+private:
+  std::shared_ptr<State> m_state;
+  WorkerPool &m_pool;
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <latency_stats.hpp>
+
+// Written from data_callback on the audio thread: only relaxed atomics and
+// LatencyHistogram, no allocation or lock. Read from any thread.
+class AudioCallbackMetrics {
+public:
+  // Call before the device starts, so the gap since the previous music is
+  // not taken as an interval.
+  void begin_stream() noexcept;
+
+  // audio thread only
+  void on_callback(std::int64_t const begin_ns, std::int64_t const end_ns,
+                   std::uint32_t const frames_requested,
+                   std::uint64_t const frames_delivered, bool const read_error,
+                   std::uint32_t const sample_rate) noexcept;
+
+  [[nodiscard]] std::uint64_t callbacks() const noexcept;
+  [[nodiscard]] std::uint64_t frames_requested() const noexcept;
+  [[nodiscard]] std::uint64_t frames_delivered() const noexcept;
+  // delivered less than requested, the rest was filled with silence
+  [[nodiscard]] std::uint64_t short_reads() const noexcept;
+  [[nodiscard]] std::uint64_t read_errors() const noexcept;
+  // interval above 1.5x the period, the device likely ran dry(xrun)
+  [[nodiscard]] std::uint64_t late_callbacks() const noexcept;
+
+  // wall time inside data_callback, ns
+  [[nodiscard]] LatencyHistogram const &duration() const noexcept;
+  // time between two callback starts, ns
+  [[nodiscard]] LatencyHistogram const &interval() const noexcept;
+  // |interval - period of the previous request|, ns
+  [[nodiscard]] LatencyHistogram const &jitter() const noexcept;
+
+  void log() const;
+
+private:
+  std::atomic_uint64_t m_callbacks = 0;
+  std::atomic_uint64_t m_frames_requested = 0;
+  std::atomic_uint64_t m_frames_delivered = 0;
+  std::atomic_uint64_t m_short_reads = 0;
+  std::atomic_uint64_t m_read_errors = 0;
+  std::atomic_uint64_t m_late_callbacks = 0;
+  // audio thread only, reset by begin_stream while the device is stopped
+  std::int64_t m_previous_begin_ns = 0;
+  std::int64_t m_previous_period_ns = 0;
+  LatencyHistogram m_duration;
+  LatencyHistogram m_interval;
+  LatencyHistogram m_jitter;
+};
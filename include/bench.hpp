@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One benchmark case, e.g. name "seed_rand" with params
+// {{"selector", "v2"}, {"range_size", "300"}}.
+struct BenchResult {
+  std::string name;
+  std::vector<std::pair<std::string, std::string>> params;
+  std::uint64_t iterations = 0;
+  double ns_per_op = 0.0;
+};
+
+struct BenchOptions {
+  std::uint32_t iterations = 100000;
+  // mp3/flac samples for the decoder init cases, a generated wav is
+  // always used
+  std::optional<std::filesystem::path> audio_dir;
+  // skipped when dolphin is not running anyway
+  bool dolphin = true;
+};
+
+// Every benchmark logs its cases and returns them.
+[[nodiscard]] std::vector<BenchResult>
+bench_seed_rand(std::uint32_t const iterations);
+[[nodiscard]] std::vector<BenchResult>
+bench_playlist_selection(std::uint32_t const iterations);
+// Playlist(config) with 1k/10k/100k musics and lookups on the result.
+[[nodiscard]] std::vector<BenchResult>
+bench_playlist_construction(std::uint32_t const iterations);
+// dolphinAddrToOffset and formatMemoryToString per MemType.
+[[nodiscard]] std::vector<BenchResult>
+bench_memory_common(std::uint32_t const iterations);
+[[nodiscard]] std::vector<BenchResult>
+bench_decoder_init(std::uint32_t const iterations,
+                   std::optional<std::filesystem::path> const &audio_dir);
+
+// Every supported SIMD backend on synthetic 16 MiB snapshots.
+[[nodiscard]] std::vector<BenchResult>
+bench_snapshot_diff(std::uint32_t const iterations);
+
+// First exact / range scans per MemType on a synthetic 16 MiB snapshot.
+[[nodiscard]] std::vector<BenchResult>
+bench_value_scan(std::uint32_t const iterations);
+
+// swap_elements per backend and width on a synthetic 16 MiB array.
+[[nodiscard]] std::vector<BenchResult>
+bench_byte_swap(std::uint32_t const iterations);
+
+// Poll latency and RAM cache throughput per Linux memory backend. Needs a
+// running dolphin(or tools/fake_dolphin), skipped otherwise.
+[[nodiscard]] std::vector<BenchResult>
+bench_dolphin_read(std::uint32_t const iterations);
+
+[[nodiscard]] std::vector<BenchResult>
+run_benchmarks(BenchOptions const &options);
+
+// {"version": 1, "results": [{"name", "params", "iterations", "ns_per_op"}]}
+void write_bench_json(std::ostream &os,
+                      std::vector<BenchResult> const &results);
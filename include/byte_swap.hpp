@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Byte order conversion of whole arrays, e.g. big endian console values in a
+// RAM cache copy to host byte order. The SIMD kernels reverse 16 or 32 bytes
+// per instruction instead of one bSwap per element and are picked at runtime
+// like the snapshot diff backends.
+
+enum class SwapBackend : std::uint8_t {
+  scalar,
+  // pshufb
+  ssse3,
+  avx2,
+  // vrev16 / vrev32 / vrev64
+  neon,
+};
+
+[[nodiscard]] std::string_view swap_backend_name(SwapBackend const backend);
+
+// Fastest backend the CPU supports.
+[[nodiscard]] SwapBackend best_swap_backend();
+
+[[nodiscard]] bool is_swap_backend_supported(SwapBackend const backend);
+
+// Reverses the bytes of count elements of width(1, 2, 4 or 8) bytes in
+// place. Throws std::invalid_argument for another width or a backend the CPU
+// doesn't support.
+void swap_elements(char *data, std::size_t const count,
+                   std::uint32_t const width, SwapBackend const backend);
+
+// Same with best_swap_backend().
+void swap_elements(char *data, std::size_t const count,
+                   std::uint32_t const width);
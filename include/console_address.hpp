@@ -0,0 +1,270 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <byte_swap.hpp>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <dme/Common/MemoryCommon.h>
+#include <dme/DolphinProcess/DolphinAccessor.h>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+// Console addresses checked at compile time. A ConsoleAddress knows its
+// memory region, its offset in the region and whether the value needs a byte
+// swap, so a read is one copy from the region and a bswap, without the region
+// lookup readFromRAM does per call.
+//
+//   constexpr ConsoleAddress<0x805a00bc, std::uint32_t> SEED{};
+//   std::optional<std::uint32_t> seed = read_console(dolphin, SEED);
+//
+// A value that isn't inside one of MEM1, MEM2 or ARAM doesn't compile.
+
+// Region of [address, address + size), nullopt when the range isn't inside
+// a single region.
+[[nodiscard]] constexpr std::optional<Common::MemRegion>
+console_region_of(std::uint64_t const address, std::uint64_t const size) {
+  auto const inside = [&](std::uint64_t const begin, std::uint64_t const end) {
+    return address >= begin && address + size <= end;
+  };
+  if (size == 0) {
+    return std::nullopt;
+  }
+  if (inside(Common::MEM1_START, Common::MEM1_END)) {
+    return Common::MemRegion::region_mem1;
+  }
+  if (inside(Common::MEM2_START, Common::MEM2_END)) {
+    return Common::MemRegion::region_mem2;
+  }
+  if (inside(Common::ARAM_START, Common::ARAM_END)) {
+    return Common::MemRegion::region_aram;
+  }
+  return std::nullopt;
+}
+
+[[nodiscard]] constexpr std::uint32_t
+console_region_start(Common::MemRegion const region) {
+  switch (region) {
+  case Common::MemRegion::region_mem1:
+    return Common::MEM1_START;
+  case Common::MemRegion::region_mem2:
+    return Common::MEM2_START;
+  case Common::MemRegion::region_aram:
+    return Common::ARAM_START;
+  }
+  return 0;
+}
+
+// integers, floats and enums, stored big endian on the console
+template <typename T>
+concept ConsoleScalar = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+// value in console byte order to host byte order and back
+template <ConsoleScalar T> [[nodiscard]] constexpr T console_byteswap(T value) {
+  if constexpr (sizeof(T) == 1 || std::endian::native == std::endian::big) {
+    return value;
+  } else {
+    using U = std::conditional_t<
+        sizeof(T) == 2, std::uint16_t,
+        std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>>;
+    static_assert(sizeof(T) == sizeof(U));
+    return std::bit_cast<T>(std::byteswap(std::bit_cast<U>(value)));
+  }
+}
+
+template <std::uint32_t Address, ConsoleScalar T> struct ConsoleAddress {
+  static_assert(console_region_of(Address, sizeof(T)).has_value(),
+                "ConsoleAddress must be inside one of MEM1, MEM2 or ARAM.");
+
+  using value_type = T;
+  static constexpr std::uint32_t address = Address;
+  static constexpr Common::MemRegion region =
+      *console_region_of(Address, sizeof(T));
+  static constexpr std::uint32_t region_offset =
+      Address - console_region_start(region);
+  // readFromRAM offset when ARAM isn't accessible(Wii)
+  static constexpr std::uint32_t offset =
+      region == Common::MemRegion::region_mem2
+          ? region_offset + (Common::MEM2_START - Common::MEM1_START)
+          : region_offset;
+  static constexpr bool needs_bswap =
+      sizeof(T) > 1 && std::endian::native == std::endian::little;
+};
+
+template <typename A>
+concept ConsoleAddressType = requires {
+  typename A::value_type;
+  { A::address } -> std::convertible_to<std::uint32_t>;
+  { A::region } -> std::convertible_to<Common::MemRegion>;
+  { A::region_offset } -> std::convertible_to<std::uint32_t>;
+};
+
+// A structure of Size bytes at a fixed console address. field<Offset, T> is
+// the address of a member and must be inside the structure.
+//
+//   using GMtRand = ConsoleLayout<0x805a00b8, 8>;
+//   constexpr GMtRand::field<0x4, std::uint32_t> SEED{};
+template <std::uint32_t Address, std::uint32_t Size> struct ConsoleLayout {
+  static_assert(console_region_of(Address, Size).has_value(),
+                "ConsoleLayout must be inside one of MEM1, MEM2 or ARAM.");
+
+  static constexpr std::uint32_t address = Address;
+  static constexpr std::uint32_t size = Size;
+  static constexpr Common::MemRegion region = *console_region_of(Address, Size);
+  static constexpr std::uint32_t region_offset =
+      Address - console_region_start(region);
+
+  template <std::uint32_t Offset, ConsoleScalar T>
+    requires(Offset + sizeof(T) <= Size)
+  using field = ConsoleAddress<Address + Offset, T>;
+};
+
+// Value at address in host byte order, nullopt when the read failed.
+template <ConsoleAddressType A>
+[[nodiscard]] std::optional<typename A::value_type>
+read_console(DolphinComm::DolphinAccessor const &dolphin, A const &) {
+  using T = typename A::value_type;
+  T value;
+  if (!dolphin.readFromRegion(A::region, A::region_offset,
+                              reinterpret_cast<char *>(&value),
+                              sizeof(value))) {
+    return std::nullopt;
+  }
+  if constexpr (A::needs_bswap) {
+    value = console_byteswap(value);
+  }
+  return value;
+}
+
+// T at a readFromRAM offset known at runtime(e.g. from a game profile), in
+// host byte order.
+template <ConsoleScalar T>
+[[nodiscard]] std::optional<T>
+read_console(DolphinComm::DolphinAccessor const &dolphin,
+             std::uint32_t const offset) {
+  T value;
+  if (!dolphin.readFromRAM(offset, reinterpret_cast<char *>(&value),
+                           sizeof(value), false)) {
+    return std::nullopt;
+  }
+  return console_byteswap(value);
+}
+
+// T at the end of a pointer path(DolphinAccessor::readPointerPath) in host
+// byte order, nullopt when a pointer on the way is invalid or the read
+// failed.
+//
+//   DolphinComm::PointerPath volume(0x805a0000, {0x10, 0x2c});
+//   std::optional<float> value = read_console<float>(dolphin, volume);
+template <ConsoleScalar T>
+[[nodiscard]] std::optional<T>
+read_console(DolphinComm::DolphinAccessor const &dolphin,
+             DolphinComm::PointerPath &path) {
+  T value;
+  if (!dolphin.readPointerPath(path, reinterpret_cast<char *>(&value),
+                               sizeof(value), false)) {
+    return std::nullopt;
+  }
+  return console_byteswap(value);
+}
+
+// Writes value(host byte order) at a readFromRAM offset, false when the
+// write failed.
+template <ConsoleScalar T>
+[[nodiscard]] bool write_console(DolphinComm::DolphinAccessor const &dolphin,
+                                 std::uint32_t const offset, T const value) {
+  auto const raw = console_byteswap(value);
+  return dolphin.writeToRAM(offset, reinterpret_cast<char const *>(&raw),
+                            sizeof(raw), false);
+}
+
+// Up to Capacity values written together, one process_vm_writev on Linux.
+// The values are kept in console byte order inside the plan, so a plan
+// built every frame(e.g. to hold the game's music volume at 0) doesn't
+// allocate.
+//
+//   ConsoleWritePlan<2> plan;
+//   plan.add(volume_offset, 0.0f);
+//   plan.add(fade_offset, std::uint16_t{0});
+//   bool const ok = plan.submit(dolphin);
+template <std::size_t Capacity> class ConsoleWritePlan {
+public:
+  ConsoleWritePlan() = default;
+  // the writes point into the plan
+  ConsoleWritePlan(ConsoleWritePlan const &) = delete;
+  ConsoleWritePlan &operator=(ConsoleWritePlan const &) = delete;
+
+  // value in host byte order at a readFromRAM offset. Throws
+  // std::length_error when the plan is full.
+  template <ConsoleScalar T>
+  void add(std::uint32_t const offset, T const value) {
+    if (m_count == Capacity) {
+      throw std::length_error("ConsoleWritePlan is full.");
+    }
+    auto const raw = console_byteswap(value);
+    auto &slot = m_values[m_count];
+    std::memcpy(slot.data(), &raw, sizeof(raw));
+    m_writes[m_count] = {offset, slot.data(), sizeof(raw)};
+    ++m_count;
+  }
+
+  // false if one of the writes failed
+  [[nodiscard]] bool submit(DolphinComm::DolphinAccessor const &dolphin) const {
+    return m_count == 0 || dolphin.writeBatchToRAM(m_writes.data(), m_count);
+  }
+
+  void clear() noexcept { m_count = 0; }
+  [[nodiscard]] std::size_t size() const noexcept { return m_count; }
+
+private:
+  std::array<std::array<char, 8>, Capacity> m_values{};
+  std::array<DolphinComm::RAMWrite, Capacity> m_writes{};
+  std::size_t m_count = 0;
+};
+
+// values.size() elements at a readFromRAM offset in one read, converted to
+// host byte order with swap_elements. false when the read failed.
+template <ConsoleScalar T>
+[[nodiscard]] bool read_console_array(DolphinComm::DolphinAccessor const &dolphin,
+                                      std::uint32_t const offset,
+                                      std::span<T> const values) {
+  auto *data = reinterpret_cast<char *>(values.data());
+  if (!dolphin.readFromRAM(offset, data, values.size_bytes(), false)) {
+    return false;
+  }
+  if constexpr (sizeof(T) > 1 && std::endian::native == std::endian::little) {
+    swap_elements(data, values.size(), sizeof(T));
+  }
+  return true;
+}
+
+// Same from the RAM cache(DolphinAccessor::updateRAMCache), console_address
+// is a MEM1 / MEM2 address. false, and values untouched, when the range is
+// not in the cache.
+template <ConsoleScalar T>
+[[nodiscard]] bool
+copy_console_array_from_cache(DolphinComm::DolphinAccessor const &dolphin,
+                              std::uint32_t const console_address,
+                              std::span<T> const values) {
+  auto *data = reinterpret_cast<char *>(values.data());
+  if (!dolphin.copyRawMemoryFromCache(data, console_address,
+                                      values.size_bytes())) {
+    return false;
+  }
+  if constexpr (sizeof(T) > 1 && std::endian::native == std::endian::little) {
+    swap_elements(data, values.size(), sizeof(T));
+  }
+  return true;
+}
+
+// Copies Size bytes of the structure, still in console byte order.
+template <std::uint32_t Address, std::uint32_t Size>
+[[nodiscard]] bool read_console_raw(DolphinComm::DolphinAccessor const &dolphin,
+                                    ConsoleLayout<Address, Size> const &,
+                                    char *buffer) {
+  using L = ConsoleLayout<Address, Size>;
+  return dolphin.readFromRegion(L::region, L::region_offset, buffer, Size);
+}
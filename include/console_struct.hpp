@@ -0,0 +1,133 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <byte_swap.hpp>
+#include <console_address.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <dme/DolphinProcess/DolphinAccessor.h>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+
+// Game structures read in one call. A ConsoleStruct specialization says
+// where every member of a host struct is in the console structure, and
+// read_struct copies the whole structure once and fixes the byte order of
+// every field:
+//
+//   struct DiscHeader {
+//     std::array<char, 6> game_id;
+//     std::uint8_t disc;
+//     std::uint8_t revision;
+//   };
+//   template <> struct ConsoleStruct<DiscHeader> {
+//     static constexpr std::uint32_t size = 0x8;
+//     static constexpr auto fields =
+//         std::tuple{console_field(0x0, &DiscHeader::game_id),
+//                    console_field(0x6, &DiscHeader::disc),
+//                    console_field(0x7, &DiscHeader::revision)};
+//   };
+//
+//   auto const header = read_struct<DiscHeader>(dolphin, 0x0);
+//
+// Members are ConsoleScalar or std::array of ConsoleScalar. Members that
+// are not described stay value initialized.
+
+template <typename T> struct ConsoleStruct;
+
+template <typename T>
+concept ConsoleStructType = requires {
+  { ConsoleStruct<T>::size } -> std::convertible_to<std::uint32_t>;
+  ConsoleStruct<T>::fields;
+} && std::is_default_constructible_v<T>;
+
+template <typename T> struct is_console_array : std::false_type {};
+template <ConsoleScalar T, std::size_t N>
+struct is_console_array<std::array<T, N>> : std::true_type {};
+
+template <typename M>
+concept ConsoleMember = ConsoleScalar<M> || is_console_array<M>::value;
+
+// member of S at offset bytes from the start of the console structure
+template <typename S, ConsoleMember M> struct ConsoleField {
+  using member_type = M;
+  std::uint32_t offset;
+  M S::*member;
+};
+
+template <typename S, ConsoleMember M>
+[[nodiscard]] constexpr ConsoleField<S, M>
+console_field(std::uint32_t const offset, M S::*const member) {
+  return {offset, member};
+}
+
+// every field inside the structure
+template <ConsoleStructType T>
+[[nodiscard]] consteval bool console_fields_fit() {
+  return std::apply(
+      [](auto const &...field) {
+        return ((field.offset +
+                     sizeof(typename std::remove_cvref_t<
+                            decltype(field)>::member_type) <=
+                 ConsoleStruct<T>::size) &&
+                ...);
+      },
+      ConsoleStruct<T>::fields);
+}
+
+// Decodes a structure in console byte order, raw holds
+// ConsoleStruct<T>::size bytes.
+template <ConsoleStructType T>
+[[nodiscard]] T decode_console_struct(char const *raw) {
+  static_assert(console_fields_fit<T>(),
+                "ConsoleStruct field outside of the structure.");
+  T value{};
+  std::apply(
+      [&](auto const &...field) {
+        (
+            [&] {
+              auto &member = value.*(field.member);
+              std::memcpy(&member, raw + field.offset, sizeof(member));
+              using M = typename std::remove_cvref_t<
+                  decltype(field)>::member_type;
+              if constexpr (is_console_array<M>::value) {
+                using E = typename M::value_type;
+                if constexpr (sizeof(E) > 1 &&
+                              std::endian::native == std::endian::little) {
+                  swap_elements(reinterpret_cast<char *>(member.data()),
+                                member.size(), sizeof(E));
+                }
+              } else {
+                member = console_byteswap(member);
+              }
+            }(),
+            ...);
+      },
+      ConsoleStruct<T>::fields);
+  return value;
+}
+
+// T at a readFromRAM offset, one read for the whole structure.
+template <ConsoleStructType T>
+[[nodiscard]] std::optional<T>
+read_struct(DolphinComm::DolphinAccessor const &dolphin,
+            std::uint32_t const offset) {
+  std::array<char, ConsoleStruct<T>::size> raw;
+  if (!dolphin.readFromRAM(offset, raw.data(), raw.size(), false)) {
+    return std::nullopt;
+  }
+  return decode_console_struct<T>(raw.data());
+}
+
+// T at a compile time address, see ConsoleLayout.
+template <ConsoleStructType T, std::uint32_t Address>
+[[nodiscard]] std::optional<T>
+read_struct(DolphinComm::DolphinAccessor const &dolphin,
+            ConsoleLayout<Address, ConsoleStruct<T>::size> const &layout) {
+  std::array<char, ConsoleStruct<T>::size> raw;
+  if (!read_console_raw(dolphin, layout, raw.data())) {
+    return std::nullopt;
+  }
+  return decode_console_struct<T>(raw.data());
+}
@@ -1,6 +1,18 @@
 #pragma once
+#include <console_address.hpp>
+#include <cstdint>
 
 namespace xtool::constants {
-auto static constexpr CURRENT_MUSIC_ID_ADDRESS = 0x90e60f06 - 0x80000000;
-auto static constexpr G_MTRAND_SEED_ADDRESS = 0x805a00b8 + 0x4 - 0x80000000;
-} // namespace xtool::constants
\ No newline at end of file
+// game id(6), disc number, revision
+inline constexpr ConsoleLayout<0x80000000, 0x8> DISC_HEADER{};
+
+// g_mtRand, the random generator of the game
+using GMtRand = ConsoleLayout<0x805a00b8, 0x8>;
+
+inline constexpr ConsoleAddress<0x90e60f06, std::uint16_t> CURRENT_MUSIC_ID{};
+inline constexpr GMtRand::field<0x4, std::uint32_t> G_MTRAND_SEED{};
+
+// readFromRAM offsets
+auto static constexpr CURRENT_MUSIC_ID_ADDRESS = CURRENT_MUSIC_ID.offset;
+auto static constexpr G_MTRAND_SEED_ADDRESS = G_MTRAND_SEED.offset;
+} // namespace xtool::constants
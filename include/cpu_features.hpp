@@ -0,0 +1,34 @@
+#pragma once
+
+// Runtime dispatch of the SIMD kernels(snapshot diff, value scanner, byte
+// swap). SSSE3 / AVX2 kernels are compiled for the function only with
+// XTOOL_TARGET_* and picked at runtime with cpu_has_*.
+#if defined(__GNUC__) || defined(__clang__)
+#define XTOOL_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define XTOOL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define XTOOL_TARGET_SSSE3
+#define XTOOL_TARGET_AVX2
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+[[nodiscard]] inline bool cpu_has_ssse3() {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_cpu_supports("ssse3");
+#elif defined(__SSSE3__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+[[nodiscard]] inline bool cpu_has_avx2() {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_cpu_supports("avx2");
+#elif defined(__AVX2__)
+  return true;
+#else
+  return false;
+#endif
+}
+#endif
@@ -8,6 +8,9 @@
 #include <libkern/OSByteOrder.h>
 #endif
 
+#include <cstddef>
+#include <cstring>
+
 #include "CommonTypes.h"
 #include "MemoryCommon.h"
 
@@ -55,6 +58,38 @@ inline u64 bSwap64(u64 data)
 }
 #endif
 
+// Swaps a 2, 4 or 8 byte value in place, other sizes are left as they are
+inline void bSwapInPlace(char* buffer, const size_t size)
+{
+  switch (size)
+  {
+  case 2:
+  {
+    u16 halfword = 0;
+    std::memcpy(&halfword, buffer, sizeof(u16));
+    halfword = bSwap16(halfword);
+    std::memcpy(buffer, &halfword, sizeof(u16));
+    break;
+  }
+  case 4:
+  {
+    u32 word = 0;
+    std::memcpy(&word, buffer, sizeof(u32));
+    word = bSwap32(word);
+    std::memcpy(buffer, &word, sizeof(u32));
+    break;
+  }
+  case 8:
+  {
+    u64 doubleword = 0;
+    std::memcpy(&doubleword, buffer, sizeof(u64));
+    doubleword = bSwap64(doubleword);
+    std::memcpy(buffer, &doubleword, sizeof(u64));
+    break;
+  }
+  }
+}
+
 inline u32 dolphinAddrToOffset(u32 addr, bool considerAram)
 {
   // ARAM address
@@ -144,4 +179,10 @@ inline u32 cacheIndexToOffset(u32 cacheIndex, bool considerAram)
   }
   return cacheIndex;
 }
+
+// Console address of a byte of the RAM cache(DolphinAccessor::getRAMCache)
+inline u32 cacheIndexToDolphinAddr(u32 cacheIndex, bool considerAram)
+{
+  return offsetToDolphinAddr(cacheIndexToOffset(cacheIndex, considerAram), considerAram);
+}
 } // namespace Common
@@ -22,6 +22,14 @@ const u32 MEM2_SIZE = 0x4000000;
 const u32 MEM2_START = 0x90000000;
 const u32 MEM2_END = 0x94000000;
 
+// The memory regions of the console, see MEM1_START, MEM2_START and ARAM_START
+enum class MemRegion
+{
+  region_mem1 = 0,
+  region_mem2,
+  region_aram
+};
+
 enum class MemType
 {
   type_byte = 0,
@@ -1,37 +1,123 @@
 #include "DolphinAccessor.h"
 #ifdef __linux__
 #include "Linux/LinuxDolphinProcess.h"
+#include "Linux/ProcMemDolphinProcess.h"
 #elif _WIN32
 #include "Windows/WindowsDolphinProcess.h"
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
 
 #include "../Common/CommonUtils.h"
 #include "../Common/MemoryCommon.h"
 
 namespace DolphinComm {
-IDolphinProcess *DolphinAccessor::m_instance = nullptr;
-DolphinStatus DolphinAccessor::m_status = DolphinStatus::unHooked;
-char *DolphinAccessor::m_updatedRAMCache = nullptr;
+namespace {
+// large enough for either cache layout(MEM1 + MEM2 or ARAM + MEM1)
+constexpr size_t RAM_CACHE_CAPACITY = Common::MEM1_SIZE + Common::MEM2_SIZE;
+static_assert(RAM_CACHE_CAPACITY >= Common::ARAM_SIZE + Common::MEM1_SIZE);
+// one read per chunk, 2 MiB is also the huge page size on x86-64
+constexpr size_t REFRESH_CHUNK_SIZE = 0x200000;
+
+char *allocateRAMCache(const bool hugePages) {
+#ifdef _WIN32
+  (void)hugePages;
+  auto *p = VirtualAlloc(nullptr, RAM_CACHE_CAPACITY, MEM_RESERVE | MEM_COMMIT,
+                         PAGE_READWRITE);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return static_cast<char *>(p);
+#else
+  auto *p = mmap(nullptr, RAM_CACHE_CAPACITY, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+  if (hugePages)
+    madvise(p, RAM_CACHE_CAPACITY, MADV_HUGEPAGE);
+#else
+  (void)hugePages;
+#endif
+  return static_cast<char *>(p);
+#endif
+}
+
+void releaseRAMCache(char *cache) {
+  if (cache == nullptr)
+    return;
+#ifdef _WIN32
+  VirtualFree(cache, 0, MEM_RELEASE);
+#else
+  munmap(cache, RAM_CACHE_CAPACITY);
+#endif
+}
+
+struct RefreshChunk {
+  u32 cacheIndex;
+  u32 offset;
+  size_t size;
+};
+} // namespace
+
+DolphinAccessor::~DolphinAccessor() { free(); }
+
+std::vector<int> DolphinAccessor::findPIDs() {
+#ifdef __linux__
+  return LinuxDolphinProcess::findPIDs();
+#elif _WIN32
+  return WindowsDolphinProcess::findPIDs();
+#else
+  return {};
+#endif
+}
 
 void DolphinAccessor::init() {
   if (m_instance == nullptr) {
 #ifdef __linux__
-    m_instance = new LinuxDolphinProcess();
+    if (m_memoryBackend == MemoryBackend::procMem)
+      m_instance = new ProcMemDolphinProcess();
+    else
+      m_instance = new LinuxDolphinProcess();
+    m_probeMemoryBackend = m_memoryBackend == MemoryBackend::automatic;
 #elif _WIN32
     m_instance = new WindowsDolphinProcess();
 #endif
+    if (m_instance != nullptr)
+      m_instance->setTargetPID(m_targetPID);
   }
 }
 
+void DolphinAccessor::init(IDolphinProcess *instance) {
+  delete m_instance;
+  m_instance = instance;
+  m_probeMemoryBackend = false;
+  m_trackingDirtyPages = false;
+  m_status = DolphinStatus::unHooked;
+}
+
 void DolphinAccessor::free() {
   delete m_instance;
-  delete[] m_updatedRAMCache;
+  m_instance = nullptr;
+  releaseRAMCache(m_updatedRAMCache);
+  m_updatedRAMCache = nullptr;
+  m_trackingDirtyPages = false;
 }
 
 void DolphinAccessor::hook() {
   init();
+  m_trackingDirtyPages = false;
   if (m_instance == nullptr) {
     return;
   }
@@ -41,45 +127,99 @@ void DolphinAccessor::hook() {
     m_status = DolphinStatus::noEmu;
   } else {
     m_status = DolphinStatus::hooked;
+    ++m_hookGeneration;
+#ifdef __linux__
+    // process_vm_readv is often blocked by the seccomp profile of containers
+    // while /proc/<pid>/mem can still be read
+    char probe = 0;
+    if (m_probeMemoryBackend &&
+        !m_instance->readFromRAM(0, &probe, sizeof(probe), false)) {
+      auto *procMem = new ProcMemDolphinProcess();
+      procMem->setTargetPID(m_instance->getPID());
+      if (procMem->findPID() && procMem->obtainEmuRAMInformations() &&
+          procMem->readFromRAM(0, &probe, sizeof(probe), false)) {
+        delete m_instance;
+        m_instance = procMem;
+      } else {
+        delete procMem;
+      }
+    }
+    m_probeMemoryBackend = false;
+#endif
     updateRAMCache();
   }
 }
 
+void DolphinAccessor::setMemoryBackend(const MemoryBackend backend) {
+  m_memoryBackend = backend;
+}
+
+MemoryBackend DolphinAccessor::getMemoryBackend() const {
+  return m_memoryBackend;
+}
+
+const char *DolphinAccessor::getMemoryBackendName() const {
+  return m_instance == nullptr ? "none" : m_instance->getMemoryBackendName();
+}
+
+void DolphinAccessor::setTargetPID(const int pid) { m_targetPID = pid; }
+
 void DolphinAccessor::unHook() {
   delete m_instance;
   m_instance = nullptr;
+  m_trackingDirtyPages = false;
   m_status = DolphinStatus::unHooked;
 }
 
-DolphinStatus DolphinAccessor::getStatus() { return m_status; }
+DolphinStatus DolphinAccessor::getStatus() const { return m_status; }
 
 bool DolphinAccessor::readFromRAM(const u32 offset, char *buffer,
-                                  const size_t size, const bool withBSwap) {
+                                  const size_t size,
+                                  const bool withBSwap) const {
   return m_instance->readFromRAM(offset, buffer, size, withBSwap);
 }
 
 bool DolphinAccessor::writeToRAM(const u32 offset, const char *buffer,
-                                 const size_t size, const bool withBSwap) {
+                                 const size_t size,
+                                 const bool withBSwap) const {
   return m_instance->writeToRAM(offset, buffer, size, withBSwap);
 }
 
-int DolphinAccessor::getPID() { return m_instance->getPID(); }
+bool DolphinAccessor::readFromRegion(const Common::MemRegion region,
+                                     const u32 regionOffset, char *buffer,
+                                     const size_t size) const {
+  return m_instance->readFromRegion(region, regionOffset, buffer, size);
+}
+
+bool DolphinAccessor::readBatchFromRAM(const RAMRead *reads,
+                                       const size_t count) const {
+  return m_instance->readBatchFromRAM(reads, count);
+}
+
+bool DolphinAccessor::writeBatchToRAM(const RAMWrite *writes,
+                                      const size_t count) const {
+  return m_instance->writeBatchToRAM(writes, count);
+}
+
+int DolphinAccessor::getPID() const { return m_instance->getPID(); }
 
-u64 DolphinAccessor::getEmuRAMAddressStart() {
+u64 DolphinAccessor::getEmuRAMAddressStart() const {
   return m_instance->getEmuRAMAddressStart();
 }
 
-bool DolphinAccessor::isARAMAccessible() {
+bool DolphinAccessor::isARAMAccessible() const {
   return m_instance->isARAMAccessible();
 }
 
-u64 DolphinAccessor::getARAMAddressStart() {
+u64 DolphinAccessor::getARAMAddressStart() const {
   return m_instance->getARAMAddressStart();
 }
 
-bool DolphinAccessor::isMEM2Present() { return m_instance->isMEM2Present(); }
+bool DolphinAccessor::isMEM2Present() const {
+  return m_instance->isMEM2Present();
+}
 
-bool DolphinAccessor::isValidConsoleAddress(const u32 address) {
+bool DolphinAccessor::isValidConsoleAddress(const u32 address) const {
   if (getStatus() != DolphinStatus::hooked)
     return false;
 
@@ -90,16 +230,16 @@ bool DolphinAccessor::isValidConsoleAddress(const u32 address) {
       (address >= Common::MEM2_START && address < Common::MEM2_END))
     return true;
 
-  if (isARAMAccessible &&
+  if (isARAMAccessible() &&
       (address >= Common::ARAM_START && address < Common::ARAM_END))
     return true;
 
   return false;
 }
 
-char *DolphinAccessor::getRAMCache() { return m_updatedRAMCache; }
+char *DolphinAccessor::getRAMCache() const { return m_updatedRAMCache; }
 
-size_t DolphinAccessor::getRAMCacheSize() {
+size_t DolphinAccessor::getRAMCacheSize() const {
   if (isMEM2Present()) {
     return Common::MEM1_SIZE + Common::MEM2_SIZE;
   } else if (isARAMAccessible()) {
@@ -110,69 +250,293 @@ size_t DolphinAccessor::getRAMCacheSize() {
 }
 
 Common::MemOperationReturnCode DolphinAccessor::updateRAMCache() {
-  delete[] m_updatedRAMCache;
-  m_updatedRAMCache = nullptr;
-
   // MEM2, if enabled, is read right after MEM1 in the cache so both regions are
-  // contigous
-  if (isMEM2Present()) {
-    m_updatedRAMCache = new char[Common::MEM1_SIZE + Common::MEM2_SIZE];
-
-    if (!DolphinComm::DolphinAccessor::readFromRAM(
-            Common::dolphinAddrToOffset(Common::MEM1_START, false),
-            m_updatedRAMCache, Common::MEM1_SIZE, false))
-      return Common::MemOperationReturnCode::operationFailed;
-
-    // Read Wii extra RAM
-    if (!DolphinComm::DolphinAccessor::readFromRAM(
-            Common::dolphinAddrToOffset(Common::MEM2_START, false),
-            m_updatedRAMCache + Common::MEM1_SIZE, Common::MEM2_SIZE, false))
-      return Common::MemOperationReturnCode::operationFailed;
-  } else if (isARAMAccessible()) {
-    m_updatedRAMCache = new char[Common::ARAM_SIZE + Common::MEM1_SIZE];
-    // read ARAM
-    if (!DolphinComm::DolphinAccessor::readFromRAM(
-            Common::dolphinAddrToOffset(Common::ARAM_START, true),
-            m_updatedRAMCache, Common::ARAM_SIZE, false))
-      return Common::MemOperationReturnCode::operationFailed;
-
-    // Read GameCube and Wii basic RAM
-    if (!DolphinComm::DolphinAccessor::readFromRAM(
-            Common::dolphinAddrToOffset(Common::MEM1_START, true),
-            m_updatedRAMCache + Common::ARAM_SIZE, Common::MEM1_SIZE, false))
-      return Common::MemOperationReturnCode::operationFailed;
+  // contigous. With ARAM the cache holds ARAM then MEM1.
+  return refreshRAMCache({{0, getRAMCacheSize()}});
+}
+
+Common::MemOperationReturnCode
+DolphinAccessor::updateRAMCacheRange(const u32 consoleAddress,
+                                     const size_t byteCount) {
+  if (byteCount == 0)
+    return Common::MemOperationReturnCode::OK;
+  if (!isValidConsoleAddress(consoleAddress) ||
+      !isValidConsoleAddress(
+          static_cast<u32>(consoleAddress + byteCount - 1)) ||
+      byteCount > getRAMCacheSize())
+    return Common::MemOperationReturnCode::invalidPointer;
+
+  const bool aram = isARAMAccessible();
+  const u32 begin = Common::offsetToCacheIndex(
+      Common::dolphinAddrToOffset(consoleAddress, aram), aram);
+  const u32 last = Common::offsetToCacheIndex(
+      Common::dolphinAddrToOffset(
+          static_cast<u32>(consoleAddress + byteCount - 1), aram),
+      aram);
+  // e.g. from MEM1 into MEM2, not contiguous on the console
+  if (last - begin + 1 != byteCount)
+    return Common::MemOperationReturnCode::invalidPointer;
+  return refreshRAMCache({{begin, begin + byteCount}});
+}
+
+Common::MemOperationReturnCode DolphinAccessor::updateRAMCacheDirtyPages(
+    std::vector<RAMCacheRange> &refreshed) {
+  refreshed.clear();
+  if (m_instance == nullptr)
+    return Common::MemOperationReturnCode::operationFailed;
+
+  std::vector<RAMRange> dirty;
+  bool cleared = false;
+  if (m_trackingDirtyPages && m_instance->readDirtyPages(dirty)) {
+    // cleared before the pages are read so that later writes are in the next
+    // call. A page written between readDirtyPages and the clear is only seen
+    // on its next write.
+    cleared = m_instance->clearDirtyPages();
+  }
+  if (cleared) {
+    const bool aram = isARAMAccessible();
+    for (const auto &range : dirty) {
+      const size_t begin = Common::offsetToCacheIndex(range.offset, aram);
+      refreshed.push_back({begin, begin + range.size});
+    }
   } else {
-    m_updatedRAMCache = new char[Common::MEM1_SIZE];
-    if (!DolphinComm::DolphinAccessor::readFromRAM(
-            Common::dolphinAddrToOffset(Common::MEM1_START, false),
-            m_updatedRAMCache, Common::MEM1_SIZE, false))
-      return Common::MemOperationReturnCode::operationFailed;
+    // the whole cache, after the clear so that nothing written meanwhile is
+    // missed
+    m_trackingDirtyPages = m_instance->clearDirtyPages();
+    refreshed.push_back({0, getRAMCacheSize()});
   }
 
+  const auto result = refreshRAMCache(refreshed);
+  // The bits of the pages that were not read are gone, the next call must read
+  // everything again.
+  if (result != Common::MemOperationReturnCode::OK)
+    m_trackingDirtyPages = false;
+  return result;
+}
+
+Common::MemOperationReturnCode
+DolphinAccessor::refreshRAMCache(const std::vector<RAMCacheRange> &ranges) {
+  if (m_instance == nullptr)
+    return Common::MemOperationReturnCode::operationFailed;
+  if (m_updatedRAMCache == nullptr)
+    m_updatedRAMCache = allocateRAMCache(m_useHugePages);
+
+  const bool aram = isARAMAccessible();
+  // The cache is made of at most two regions(MEM1|MEM2 or ARAM|MEM1), each
+  // contiguous in RAM offsets. Chunks never cross a region boundary.
+  const size_t split = aram ? Common::ARAM_SIZE : Common::MEM1_SIZE;
+  std::vector<RefreshChunk> chunks;
+  size_t bytes = 0;
+  for (const auto &range : ranges) {
+    for (size_t index = range.begin; index < range.end;) {
+      const size_t regionEnd = index < split ? split : getRAMCacheSize();
+      const size_t next =
+          std::min({index + REFRESH_CHUNK_SIZE, regionEnd, range.end});
+      chunks.push_back(
+          {static_cast<u32>(index),
+           Common::cacheIndexToOffset(static_cast<u32>(index), aram),
+           next - index});
+      index = next;
+    }
+    bytes += range.end - range.begin;
+  }
+
+  unsigned threads = m_refreshThreads;
+  if (threads == 0)
+    threads = std::clamp(std::thread::hardware_concurrency(), 1u, 4u);
+  threads = std::clamp<unsigned>(threads, 1u,
+                                 std::max<unsigned>(chunks.size(), 1u));
+
+  const auto started = std::chrono::steady_clock::now();
+  std::atomic_size_t nextChunk = 0;
+  std::atomic_bool failed = false;
+  if (m_instance->batchesReads()) {
+    // one submission, the kernel reads the chunks in parallel
+    std::vector<RAMRead> reads;
+    reads.reserve(chunks.size());
+    for (const auto &chunk : chunks)
+      reads.push_back(
+          {chunk.offset, m_updatedRAMCache + chunk.cacheIndex, chunk.size});
+    failed = !m_instance->readBatchFromRAM(reads.data(), reads.size());
+    threads = 1;
+  } else {
+    const auto worker = [&]() {
+      for (size_t i = nextChunk++; i < chunks.size() && !failed;
+           i = nextChunk++) {
+        const auto &chunk = chunks[i];
+        if (!readFromRAM(chunk.offset, m_updatedRAMCache + chunk.cacheIndex,
+                         chunk.size, false))
+          failed = true;
+      }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+      pool.emplace_back(worker);
+    worker();
+    for (auto &thread : pool)
+      thread.join();
+  }
+
+  m_lastRefreshStats.bytes = bytes;
+  m_lastRefreshStats.nanoseconds = static_cast<u64>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - started)
+          .count());
+  m_lastRefreshStats.threads = threads;
+
+  if (failed)
+    return Common::MemOperationReturnCode::operationFailed;
   return Common::MemOperationReturnCode::OK;
 }
 
-std::string DolphinAccessor::getFormattedValueFromCache(const u32 ramIndex,
-                                                        Common::MemType memType,
-                                                        size_t memSize,
-                                                        Common::MemBase memBase,
-                                                        bool memIsUnsigned) {
+void DolphinAccessor::setRAMCacheRefreshThreads(const unsigned threads) {
+  m_refreshThreads = threads;
+}
+
+void DolphinAccessor::setRAMCacheHugePages(const bool enable) {
+  m_useHugePages = enable;
+}
+
+RAMCacheRefreshStats DolphinAccessor::getLastRAMCacheRefreshStats() const {
+  return m_lastRefreshStats;
+}
+
+std::string DolphinAccessor::getFormattedValueFromCache(
+    const u32 ramIndex, Common::MemType memType, size_t memSize,
+    Common::MemBase memBase, bool memIsUnsigned) const {
   return Common::formatMemoryToString(&m_updatedRAMCache[ramIndex], memType,
                                       memSize, memBase, memIsUnsigned,
                                       Common::shouldBeBSwappedForType(memType));
 }
 
-void DolphinAccessor::copyRawMemoryFromCache(char *dest,
+bool DolphinAccessor::copyRawMemoryFromCache(char *dest,
                                              const u32 consoleAddress,
-                                             const size_t byteCount) {
-  if (isValidConsoleAddress(consoleAddress) &&
-      isValidConsoleAddress((consoleAddress + static_cast<u32>(byteCount)) -
-                            1)) {
-    bool aramAccessible = isARAMAccessible();
-    u32 offset =
-        Common::dolphinAddrToOffset(consoleAddress, isARAMAccessible());
-    u32 cacheIndex = Common::offsetToCacheIndex(offset, aramAccessible);
-    std::memcpy(dest, m_updatedRAMCache + cacheIndex, byteCount);
+                                             const size_t byteCount) const {
+  if (byteCount == 0)
+    return true;
+  if (m_updatedRAMCache == nullptr || byteCount > getRAMCacheSize() ||
+      !isValidConsoleAddress(consoleAddress) ||
+      !isValidConsoleAddress(
+          static_cast<u32>(consoleAddress + byteCount - 1)))
+    return false;
+
+  bool aramAccessible = isARAMAccessible();
+  u32 offset = Common::dolphinAddrToOffset(consoleAddress, aramAccessible);
+  u32 cacheIndex = Common::offsetToCacheIndex(offset, aramAccessible);
+  const u32 last = Common::offsetToCacheIndex(
+      Common::dolphinAddrToOffset(
+          static_cast<u32>(consoleAddress + byteCount - 1), aramAccessible),
+      aramAccessible);
+  // e.g. from MEM1 into MEM2, not contiguous in the cache
+  if (last < cacheIndex || last - cacheIndex + 1 != byteCount)
+    return false;
+  std::memcpy(dest, m_updatedRAMCache + cacheIndex, byteCount);
+  return true;
+}
+
+PointerPath::PointerPath(const u32 base, std::vector<s32> offsets,
+                         const size_t watchedLevels)
+    : m_base(base), m_offsets(std::move(offsets)),
+      m_watchedLevels(std::min(watchedLevels, m_offsets.size())),
+      m_pointers(m_offsets.size(), 0), m_watchedScratch(m_watchedLevels, 0),
+      m_reads(m_watchedLevels + 1) {}
+
+void PointerPath::invalidate() { m_resolved = false; }
+
+u32 PointerPath::getBase() const { return m_base; }
+
+const std::vector<s32> &PointerPath::getOffsets() const { return m_offsets; }
+
+u64 PointerPath::getWalkCount() const { return m_walks; }
+
+u64 PointerPath::getHitCount() const { return m_hits; }
+
+u32 PointerPath::getLevelAddress(const size_t level) const {
+  if (level == 0)
+    return m_base;
+  return m_pointers[level - 1] + static_cast<u32>(m_offsets[level - 1]);
+}
+
+bool DolphinAccessor::walkPointerPath(PointerPath &path,
+                                      const size_t level) const {
+  path.m_resolved = false;
+  const bool aram = isARAMAccessible();
+  for (size_t i = level; i < path.m_pointers.size(); ++i) {
+    const u32 address = path.getLevelAddress(i);
+    // e.g. a null pointer while the game loads
+    if (!isValidConsoleAddress(address) || !isValidConsoleAddress(address + 3))
+      return false;
+    if (!readFromRAM(Common::dolphinAddrToOffset(address, aram),
+                     reinterpret_cast<char *>(&path.m_pointers[i]), sizeof(u32),
+                     true))
+      return false;
+  }
+  path.m_address = path.getLevelAddress(path.m_pointers.size());
+  if (!isValidConsoleAddress(path.m_address))
+    return false;
+  path.m_resolved = true;
+  path.m_hookGeneration = m_hookGeneration;
+  ++path.m_walks;
+  return true;
+}
+
+bool DolphinAccessor::checkPointerPath(PointerPath &path, char *buffer,
+                                       const size_t size, size_t &level) const {
+  level = 0;
+  if (!path.m_resolved || path.m_hookGeneration != m_hookGeneration)
+    return false;
+  if (buffer != nullptr &&
+      !isValidConsoleAddress(static_cast<u32>(path.m_address + size - 1)))
+    return false;
+
+  const bool aram = isARAMAccessible();
+  size_t count = 0;
+  for (size_t i = 0; i < path.m_watchedLevels; ++i) {
+    const u32 address = path.getLevelAddress(i);
+    path.m_reads[count++] = {
+        Common::dolphinAddrToOffset(address, aram),
+        reinterpret_cast<char *>(&path.m_watchedScratch[i]), sizeof(u32)};
+  }
+  if (buffer != nullptr)
+    path.m_reads[count++] = {Common::dolphinAddrToOffset(path.m_address, aram),
+                             buffer, size};
+  if (count != 0 && !readBatchFromRAM(path.m_reads.data(), count))
+    return false;
+
+  for (; level < path.m_watchedLevels; ++level) {
+    if (Common::bSwap32(path.m_watchedScratch[level]) != path.m_pointers[level])
+      return false;
+  }
+  ++path.m_hits;
+  return true;
+}
+
+u32 DolphinAccessor::resolvePointerPath(PointerPath &path) const {
+  if (getStatus() != DolphinStatus::hooked)
+    return 0;
+  size_t level = 0;
+  if (!checkPointerPath(path, nullptr, 0, level) &&
+      !walkPointerPath(path, level))
+    return 0;
+  return path.m_address;
+}
+
+bool DolphinAccessor::readPointerPath(PointerPath &path, char *buffer,
+                                      const size_t size,
+                                      const bool withBSwap) const {
+  if (getStatus() != DolphinStatus::hooked)
+    return false;
+  size_t level = 0;
+  if (!checkPointerPath(path, buffer, size, level)) {
+    if (!walkPointerPath(path, level) ||
+        !isValidConsoleAddress(static_cast<u32>(path.m_address + size - 1)))
+      return false;
+    return readFromRAM(
+        Common::dolphinAddrToOffset(path.m_address, isARAMAccessible()), buffer,
+        size, withBSwap);
   }
+  if (withBSwap)
+    Common::bSwapInPlace(buffer, size);
+  return true;
 }
 } // namespace DolphinComm
@@ -5,8 +5,18 @@
 #include "../Common/MemoryCommon.h"
 #include "IDolphinProcess.h"
 
+#include <string>
+#include <vector>
+
 namespace DolphinComm
 {
+struct RAMCacheRefreshStats
+{
+  size_t bytes = 0;
+  u64 nanoseconds = 0;
+  unsigned threads = 0;
+};
+
 enum class DolphinStatus
 {
   hooked,
@@ -15,34 +25,167 @@ enum class DolphinStatus
   unHooked
 };
 
+// How the Linux process memory is accessed, other platforms have one way
+enum class MemoryBackend
+{
+  // process_vm_readv, /proc/<pid>/mem when it can't read after hooking
+  automatic,
+  processVmReadv,
+  procMem
+};
+
+// [begin, end) in RAM cache indices
+struct RAMCacheRange
+{
+  size_t begin;
+  size_t end;
+};
+
+// A value behind pointers, Cheat Engine's [[base] + offsets[0]] + offsets[1]: the u32 console
+// pointer at base, offsets[0] added to it and dereferenced again and so on, the last offset is
+// added to the last pointer. No offsets is base itself.
+//
+// DolphinAccessor keeps the pointers it read in the path. Later reads only check the first
+// watchedLevels pointers, in the same batch as the value, and follow the deeper ones again only
+// when a watched one changed or after a hook. Watch every pointer the game may change while it
+// runs, e.g. a scene pointer, and leave objects that live as long as their parent unwatched. A
+// path is used with one accessor.
+class PointerPath
+{
+public:
+  PointerPath(const u32 base, std::vector<s32> offsets, const size_t watchedLevels = 1);
+
+  // Follow the whole path on the next read.
+  void invalidate();
+  u32 getBase() const;
+  const std::vector<s32>& getOffsets() const;
+  // reads that followed the path / reused the kept pointers
+  u64 getWalkCount() const;
+  u64 getHitCount() const;
+
+private:
+  friend class DolphinAccessor;
+
+  // where the pointer of level is(the path's address past the last level), from the kept
+  // pointer of the level before
+  u32 getLevelAddress(const size_t level) const;
+
+  u32 m_base;
+  std::vector<s32> m_offsets;
+  size_t m_watchedLevels;
+  // pointer read at each level, host byte order
+  std::vector<u32> m_pointers;
+  // watched pointers in console byte order and the batch reading them, sized once
+  std::vector<u32> m_watchedScratch;
+  std::vector<RAMRead> m_reads;
+  u32 m_address = 0;
+  bool m_resolved = false;
+  // DolphinAccessor hook the pointers were read in
+  u64 m_hookGeneration = 0;
+  u64 m_walks = 0;
+  u64 m_hits = 0;
+};
+
+// One Dolphin process and its RAM cache. Accessors are independent, each one can hook another
+// Dolphin instance(setTargetPID).
 class DolphinAccessor
 {
 public:
-  static void init();
-  static void free();
-  static void hook();
-  static void unHook();
-  static bool readFromRAM(const u32 offset, char* buffer, const size_t size, const bool withBSwap);
-  static bool writeToRAM(const u32 offset, const char* buffer, const size_t size,
-                         const bool withBSwap);
-  static int getPID();
-  static u64 getEmuRAMAddressStart();
-  static DolphinStatus getStatus();
-  static bool isARAMAccessible();
-  static u64 getARAMAddressStart();
-  static bool isMEM2Present();
-  static char* getRAMCache();
-  static size_t getRAMCacheSize();
-  static Common::MemOperationReturnCode updateRAMCache();
-  static std::string getFormattedValueFromCache(const u32 ramIndex, Common::MemType memType,
-                                                size_t memSize, Common::MemBase memBase,
-                                                bool memIsUnsigned);
-  static void copyRawMemoryFromCache(char* dest, const u32 consoleAddress, const size_t byteCount);
-  static bool isValidConsoleAddress(const u32 address);
+  DolphinAccessor() = default;
+  ~DolphinAccessor();
+  DolphinAccessor(const DolphinAccessor&) = delete;
+  DolphinAccessor& operator=(const DolphinAccessor&) = delete;
+
+  // Every running Dolphin, ascending
+  static std::vector<int> findPIDs();
+
+  void init();
+  // Used by the next init(), e.g. before the first hook.
+  void setMemoryBackend(const MemoryBackend backend);
+  MemoryBackend getMemoryBackend() const;
+  // IDolphinProcess::getMemoryBackendName of the hooked process
+  const char* getMemoryBackendName() const;
+  // Dolphin the next init() hooks, -1 = the first one found
+  void setTargetPID(const int pid);
+  // Takes ownership, replaces the platform process(e.g. a trace replay).
+  void init(IDolphinProcess* instance);
+  void free();
+  void hook();
+  void unHook();
+  bool readFromRAM(const u32 offset, char* buffer, const size_t size, const bool withBSwap) const;
+  bool writeToRAM(const u32 offset, const char* buffer, const size_t size,
+                  const bool withBSwap) const;
+  // See IDolphinProcess::readFromRegion, used by console_address.hpp
+  bool readFromRegion(const Common::MemRegion region, const u32 regionOffset, char* buffer,
+                      const size_t size) const;
+  // See IDolphinProcess::readBatchFromRAM
+  bool readBatchFromRAM(const RAMRead* reads, const size_t count) const;
+  // See IDolphinProcess::writeBatchToRAM
+  bool writeBatchToRAM(const RAMWrite* writes, const size_t count) const;
+  int getPID() const;
+  u64 getEmuRAMAddressStart() const;
+  DolphinStatus getStatus() const;
+  bool isARAMAccessible() const;
+  u64 getARAMAddressStart() const;
+  bool isMEM2Present() const;
+  char* getRAMCache() const;
+  size_t getRAMCacheSize() const;
+  // The cache is one page aligned buffer allocated on first use and kept until free(). Refreshes
+  // read it in chunks on worker threads, or in one batch when the process batches reads.
+  Common::MemOperationReturnCode updateRAMCache();
+  // Refreshes only [consoleAddress, consoleAddress + byteCount).
+  Common::MemOperationReturnCode updateRAMCacheRange(const u32 consoleAddress,
+                                                     const size_t byteCount);
+  // Refreshes only the pages written since the previous call, see
+  // IDolphinProcess::readDirtyPages. The first call after a hook or a failed call, and every call
+  // when the process can't track writes, refreshes the whole cache. refreshed receives what was read, in
+  // ascending order. Writes are tracked for the whole Dolphin process, two accessors tracking
+  // the same Dolphin take each other's pages.
+  Common::MemOperationReturnCode updateRAMCacheDirtyPages(std::vector<RAMCacheRange>& refreshed);
+  // 0 = min(hardware threads, 4)
+  void setRAMCacheRefreshThreads(const unsigned threads);
+  // Ask for transparent huge pages when the cache is allocated(Linux only).
+  void setRAMCacheHugePages(const bool enable);
+  RAMCacheRefreshStats getLastRAMCacheRefreshStats() const;
+  std::string getFormattedValueFromCache(const u32 ramIndex, Common::MemType memType,
+                                         size_t memSize, Common::MemBase memBase,
+                                         bool memIsUnsigned) const;
+  // false, and dest untouched, when the range is not in the cache(no refresh yet, invalid
+  // address, or from MEM1 into MEM2).
+  bool copyRawMemoryFromCache(char* dest, const u32 consoleAddress, const size_t byteCount) const;
+  bool isValidConsoleAddress(const u32 address) const;
+  // Console address path leads to, 0 when a pointer on the way isn't a valid console address.
+  // Reads the watched pointers, and the others when one of them changed.
+  u32 resolvePointerPath(PointerPath& path) const;
+  // size bytes at the end of path. The watched pointers and the value are read in one batch
+  // while the pointers stay the same, a changed one costs a walk from its level.
+  bool readPointerPath(PointerPath& path, char* buffer, const size_t size,
+                       const bool withBSwap) const;
 
 private:
-  static IDolphinProcess* m_instance;
-  static DolphinStatus m_status;
-  static char* m_updatedRAMCache;
+  // Reads the pointers of path from level on, the ones before are kept. Sets the address of path.
+  bool walkPointerPath(PointerPath& path, const size_t level) const;
+  // Reads the watched pointers of path and, when buffer isn't null, the value in one batch. true
+  // when the pointers are the ones kept, otherwise level is where the path has to be followed
+  // again from.
+  bool checkPointerPath(PointerPath& path, char* buffer, const size_t size, size_t& level) const;
+
+  // ascending, non overlapping
+  Common::MemOperationReturnCode refreshRAMCache(const std::vector<RAMCacheRange>& ranges);
+
+  IDolphinProcess* m_instance = nullptr;
+  MemoryBackend m_memoryBackend = MemoryBackend::automatic;
+  int m_targetPID = -1;
+  // init() made the process_vm_readv process in automatic mode
+  bool m_probeMemoryBackend = false;
+  // clearDirtyPages succeeded since the hook, see updateRAMCacheDirtyPages
+  bool m_trackingDirtyPages = false;
+  DolphinStatus m_status = DolphinStatus::unHooked;
+  // incremented by every hook, see PointerPath
+  u64 m_hookGeneration = 0;
+  char* m_updatedRAMCache = nullptr;
+  unsigned m_refreshThreads = 0;
+  bool m_useHugePages = false;
+  RAMCacheRefreshStats m_lastRefreshStats{};
 };
 } // namespace DolphinComm
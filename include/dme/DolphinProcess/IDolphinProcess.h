@@ -2,11 +2,38 @@
 #pragma once
 
 #include <cstddef>
+#include <cstring>
+#include <vector>
 
 #include "../Common/CommonTypes.h"
+#include "../Common/CommonUtils.h"
+#include "../Common/MemoryCommon.h"
 
 namespace DolphinComm
 {
+// One read of readBatchFromRAM, offset like readFromRAM
+struct RAMRead
+{
+  u32 offset;
+  char* buffer;
+  size_t size;
+};
+
+// One write of writeBatchToRAM, offset like readFromRAM, buffer in console byte order
+struct RAMWrite
+{
+  u32 offset;
+  const char* buffer;
+  size_t size;
+};
+
+// [offset, offset + size) in readFromRAM offsets
+struct RAMRange
+{
+  u32 offset;
+  size_t size;
+};
+
 class IDolphinProcess
 {
 public:
@@ -19,6 +46,73 @@ public:
                            const bool withBSwap) = 0;
   virtual bool writeToRAM(const u32 offset, const char* buffer, const size_t size,
                           const bool withBSwap) = 0;
+  // Reads size bytes at regionOffset in region without the offset translation of readFromRAM,
+  // the caller checked that the range is inside the region (see console_address.hpp). The
+  // default goes through readFromRAM.
+  virtual bool readFromRegion(const Common::MemRegion region, const u32 regionOffset,
+                              char* buffer, const size_t size)
+  {
+    u32 offset = regionOffset;
+    switch (region)
+    {
+    case Common::MemRegion::region_mem1:
+      if (m_ARAMAccessible)
+        offset += Common::ARAM_FAKESIZE;
+      break;
+    case Common::MemRegion::region_mem2:
+      offset += Common::MEM2_START - Common::MEM1_START;
+      break;
+    case Common::MemRegion::region_aram:
+      break;
+    }
+    return readFromRAM(offset, buffer, size, false);
+  }
+  // Reads every entry without byte swapping, false if one of them failed. The default reads them
+  // one after the other.
+  virtual bool readBatchFromRAM(const RAMRead* reads, const size_t count)
+  {
+    bool ok = true;
+    for (size_t i = 0; i < count; ++i)
+      ok = readFromRAM(reads[i].offset, reads[i].buffer, reads[i].size, false) && ok;
+    return ok;
+  }
+  // Writes every entry without byte swapping, false if one of them failed. The default writes
+  // them one after the other.
+  virtual bool writeBatchToRAM(const RAMWrite* writes, const size_t count)
+  {
+    bool ok = true;
+    for (size_t i = 0; i < count; ++i)
+      ok = writeToRAM(writes[i].offset, writes[i].buffer, writes[i].size, false) && ok;
+    return ok;
+  }
+  // true when one readBatchFromRAM is faster than reading from several threads
+  virtual bool batchesReads() const
+  {
+    return false;
+  }
+  // How the memory is accessed, e.g. "process_vm_readv"
+  virtual const char* getMemoryBackendName() const
+  {
+    return "native";
+  }
+  // Write tracking: clearDirtyPages starts a new interval and readDirtyPages lists the pages of
+  // MEM1 / MEM2 / ARAM written since, adjacent pages merged. Both return false when the platform
+  // or the kernel can't track writes, the caller then has to compare the whole memory.
+  virtual bool clearDirtyPages()
+  {
+    return false;
+  }
+  virtual bool readDirtyPages(std::vector<RAMRange>& ranges)
+  {
+    (void)ranges;
+    return false;
+  }
+
+  // Process findPID hooks, -1 = the first Dolphin it sees
+  void setTargetPID(const int pid)
+  {
+    m_targetPID = pid;
+  }
 
   int getPID() const
   {
@@ -44,6 +138,20 @@ public:
   {
     return m_MEM2AddressStart;
   };
+  // Start of region in Dolphin's address space, 0 when the region isn't mapped
+  u64 getRegionAddressStart(const Common::MemRegion region) const
+  {
+    switch (region)
+    {
+    case Common::MemRegion::region_mem1:
+      return m_emuRAMAddressStart;
+    case Common::MemRegion::region_mem2:
+      return m_MEM2Present ? m_MEM2AddressStart : 0;
+    case Common::MemRegion::region_aram:
+      return m_ARAMAccessible ? m_emuARAMAdressStart : 0;
+    }
+    return 0;
+  };
   u32 getMEM1ToMEM2Distance() const
   {
     if (!m_MEM2Present)
@@ -52,7 +160,35 @@ public:
   };
 
 protected:
+  // Address in Dolphin's address space of a readFromRAM offset
+  u64 getRAMAddressForOffset(const u32 offset) const
+  {
+    if (m_ARAMAccessible)
+    {
+      if (offset >= Common::ARAM_FAKESIZE)
+        return m_emuRAMAddressStart + offset - Common::ARAM_FAKESIZE;
+      return m_emuARAMAdressStart + offset;
+    }
+    if (offset >= (Common::MEM2_START - Common::MEM1_START))
+      return m_MEM2AddressStart + offset - (Common::MEM2_START - Common::MEM1_START);
+    return m_emuRAMAddressStart + offset;
+  }
+
+  // Bytes writeToRAM sends: buffer itself, or with withBSwap a 2 / 4 / 8 byte value swapped into
+  // scratch, so a write never copies to the heap. Other sizes aren't swapped, like readFromRAM.
+  static const char* getWriteData(const char* buffer, const size_t size, const bool withBSwap,
+                                  u64& scratch)
+  {
+    if (!withBSwap || (size != 2 && size != 4 && size != 8))
+      return buffer;
+    char* data = reinterpret_cast<char*>(&scratch);
+    std::memcpy(data, buffer, size);
+    Common::bSwapInPlace(data, size);
+    return data;
+  }
+
   int m_PID = -1;
+  int m_targetPID = -1;
   u64 m_emuRAMAddressStart = 0;
   u64 m_emuARAMAdressStart = 0;
   u64 m_MEM2AddressStart = 0;
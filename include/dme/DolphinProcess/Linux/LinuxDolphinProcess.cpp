@@ -3,18 +3,98 @@
 #include "LinuxDolphinProcess.h"
 #include "../../Common/CommonUtils.h"
 
+#include <algorithm>
+#include <array>
 #include <cstring>
 #include <dirent.h>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
 
+#include <sys/mman.h>
 #include <sys/uio.h>
+#include <unistd.h>
 #include <vector>
 
 namespace DolphinComm
 {
+namespace
+{
+bool isDolphinProcess(const std::string& PID)
+{
+  std::ifstream aCmdLineFile("/proc/" + PID + "/comm");
+  std::string line;
+  getline(aCmdLineFile, line);
+  return line == "dolphin-emu" || line == "dolphin-emu-qt2" || line == "dolphin-emu-wx";
+}
+
+// iovecs per process_vm_readv / process_vm_writev of a batch, far below IOV_MAX
+constexpr size_t BATCH_IOVECS = 64;
+
+// Soft-dirty flag of a /proc/<pid>/pagemap entry, see Documentation/admin-guide/mm/soft-dirty.rst
+constexpr u64 PAGEMAP_SOFT_DIRTY = u64(1) << 55;
+
+// One mapping of Dolphin's shared memory file. Dolphin maps it several times(its own pointer
+// to the RAM and the fastmem views), the soft-dirty bits are per mapping.
+struct SharedMemoryMapping
+{
+  u64 start;
+  u64 end;
+  u64 fileOffset;
+  std::string path;
+};
+
+std::vector<SharedMemoryMapping> readSharedMemoryMappings(const int PID)
+{
+  std::vector<SharedMemoryMapping> mappings;
+  std::ifstream theMapsFile("/proc/" + std::to_string(PID) + "/maps");
+  std::string line;
+  while (getline(theMapsFile, line))
+  {
+    // start-end perms offset dev inode path
+    std::istringstream ss(line);
+    std::string range, perms, offset, device, inode, path;
+    if (!(ss >> range >> perms >> offset >> device >> inode >> path))
+      continue;
+    if (path.rfind("/dev/shm/dolphinmem", 0) != 0 && path.rfind("/dev/shm/dolphin-emu", 0) != 0)
+      continue;
+    const size_t indexDash = range.find('-');
+    mappings.push_back({std::stoull(range.substr(0, indexDash), nullptr, 16),
+                        std::stoull(range.substr(indexDash + 1), nullptr, 16),
+                        std::stoull(offset, nullptr, 16), path});
+  }
+  return mappings;
+}
+
+// Without CONFIG_MEM_SOFT_DIRTY clear_refs still accepts "4" but pagemap never reports the flag,
+// so check that a page this process just wrote has it.
+bool isSoftDirtySupported()
+{
+  static const bool supported = []() {
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    void* page =
+        mmap(nullptr, pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED)
+      return false;
+    *static_cast<volatile char*>(page) = 1;
+    u64 entry = 0;
+    const int pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    if (pagemap >= 0)
+    {
+      const off_t index = reinterpret_cast<uintptr_t>(page) / pageSize;
+      if (pread(pagemap, &entry, sizeof(entry), index * sizeof(entry)) != sizeof(entry))
+        entry = 0;
+      close(pagemap);
+    }
+    munmap(page, pageSize);
+    return (entry & PAGEMAP_SOFT_DIRTY) != 0;
+  }();
+  return supported;
+}
+} // namespace
+
 bool LinuxDolphinProcess::obtainEmuRAMInformations()
 {
   std::ifstream theMapsFile("/proc/" + std::to_string(m_PID) + "/maps");
@@ -99,8 +179,37 @@ bool LinuxDolphinProcess::obtainEmuRAMInformations()
   return false;
 }
 
+std::vector<int> LinuxDolphinProcess::findPIDs()
+{
+  std::vector<int> PIDs;
+  DIR* directoryPointer = opendir("/proc/");
+  if (directoryPointer == nullptr)
+    return PIDs;
+
+  struct dirent* directoryEntry = nullptr;
+  while ((directoryEntry = readdir(directoryPointer)))
+  {
+    std::istringstream conversionStream(directoryEntry->d_name);
+    int aPID = 0;
+    if (!(conversionStream >> aPID))
+      continue;
+    if (isDolphinProcess(directoryEntry->d_name))
+      PIDs.push_back(aPID);
+  }
+  closedir(directoryPointer);
+  std::sort(PIDs.begin(), PIDs.end());
+  return PIDs;
+}
+
 bool LinuxDolphinProcess::findPID()
 {
+  if (m_targetPID != -1)
+  {
+    if (isDolphinProcess(std::to_string(m_targetPID)))
+      m_PID = m_targetPID;
+    return m_PID != -1;
+  }
+
   DIR* directoryPointer = opendir("/proc/");
   if (directoryPointer == nullptr)
     return false;
@@ -112,14 +221,8 @@ bool LinuxDolphinProcess::findPID()
     int aPID = 0;
     if (!(conversionStream >> aPID))
       continue;
-    std::ifstream aCmdLineFile;
-    std::string line;
-    aCmdLineFile.open("/proc/" + std::string(directoryEntry->d_name) + "/comm");
-    getline(aCmdLineFile, line);
-    if (line == "dolphin-emu" || line == "dolphin-emu-qt2" || line == "dolphin-emu-wx")
+    if (isDolphinProcess(directoryEntry->d_name))
       m_PID = aPID;
-
-    aCmdLineFile.close();
   }
   closedir(directoryPointer);
 
@@ -129,6 +232,126 @@ bool LinuxDolphinProcess::findPID()
   return true;
 }
 
+bool LinuxDolphinProcess::clearDirtyPages()
+{
+  if (m_PID == -1 || !isSoftDirtySupported())
+    return false;
+
+  // 4 clears the soft-dirty bits of every page of the process, the next write to a page faults
+  // once and sets it again
+  const int clearRefs =
+      open(("/proc/" + std::to_string(m_PID) + "/clear_refs").c_str(), O_WRONLY | O_CLOEXEC);
+  if (clearRefs < 0)
+    return false;
+  const bool cleared = write(clearRefs, "4", 1) == 1;
+  close(clearRefs);
+  return cleared;
+}
+
+bool LinuxDolphinProcess::readDirtyPages(std::vector<RAMRange>& ranges)
+{
+  ranges.clear();
+  if (m_PID == -1 || !isSoftDirtySupported())
+    return false;
+
+  const auto mappings = readSharedMemoryMappings(m_PID);
+  const auto MEM1Mapping = std::find_if(mappings.begin(), mappings.end(), [this](const auto& m) {
+    return m.start == m_emuRAMAddressStart;
+  });
+  if (MEM1Mapping == mappings.end())
+    return false;
+  const int pagemap =
+      open(("/proc/" + std::to_string(m_PID) + "/pagemap").c_str(), O_RDONLY | O_CLOEXEC);
+  if (pagemap < 0)
+    return false;
+  const u64 pageSize = sysconf(_SC_PAGESIZE);
+
+  // in readFromRAM offset order
+  struct Region
+  {
+    Common::MemRegion region;
+    u32 offset;
+    size_t size;
+  };
+  std::vector<Region> regions;
+  if (m_ARAMAccessible)
+  {
+    regions.push_back({Common::MemRegion::region_aram, 0, Common::ARAM_SIZE});
+    regions.push_back({Common::MemRegion::region_mem1, Common::ARAM_FAKESIZE, Common::MEM1_SIZE});
+  }
+  else
+  {
+    regions.push_back({Common::MemRegion::region_mem1, 0, Common::MEM1_SIZE});
+    if (m_MEM2Present)
+      regions.push_back({Common::MemRegion::region_mem2, Common::MEM2_START - Common::MEM1_START,
+                         Common::MEM2_SIZE});
+  }
+
+  bool ok = true;
+  std::vector<u8> dirty;
+  std::vector<u64> entries;
+  for (const auto& region : regions)
+  {
+    const u64 regionStart = getRegionAddressStart(region.region);
+    const auto regionMapping =
+        std::find_if(mappings.begin(), mappings.end(),
+                     [regionStart](const auto& m) { return m.start == regionStart; });
+    if (regionMapping == mappings.end())
+    {
+      ok = false;
+      break;
+    }
+    const u64 fileBegin = regionMapping->fileOffset;
+    const u64 fileEnd = fileBegin + region.size;
+
+    // a page is dirty when it was written through any mapping of the file
+    dirty.assign(region.size / pageSize, 0);
+    for (const auto& m : mappings)
+    {
+      if (m.path != MEM1Mapping->path)
+        continue;
+      const u64 begin = std::max(m.fileOffset, fileBegin);
+      const u64 end = std::min(m.fileOffset + (m.end - m.start), fileEnd);
+      if (begin >= end)
+        continue;
+      const u64 address = m.start + (begin - m.fileOffset);
+      entries.resize((end - begin) / pageSize);
+      const size_t bytes = entries.size() * sizeof(u64);
+      if (pread(pagemap, entries.data(), bytes, address / pageSize * sizeof(u64)) !=
+          static_cast<ssize_t>(bytes))
+      {
+        ok = false;
+        break;
+      }
+      const size_t firstPage = (begin - fileBegin) / pageSize;
+      for (size_t i = 0; i < entries.size(); ++i)
+      {
+        if (entries[i] & PAGEMAP_SOFT_DIRTY)
+          dirty[firstPage + i] = 1;
+      }
+    }
+    if (!ok)
+      break;
+
+    for (size_t page = 0; page < dirty.size();)
+    {
+      if (!dirty[page])
+      {
+        ++page;
+        continue;
+      }
+      size_t last = page;
+      while (last < dirty.size() && dirty[last])
+        ++last;
+      ranges.push_back(
+          {static_cast<u32>(region.offset + page * pageSize), (last - page) * pageSize});
+      page = last;
+    }
+  }
+  close(pagemap);
+  return ok;
+}
+
 bool LinuxDolphinProcess::readFromRAM(const u32 offset, char* buffer, const size_t size,
                                       const bool withBSwap)
 {
@@ -162,107 +385,94 @@ bool LinuxDolphinProcess::readFromRAM(const u32 offset, char* buffer, const size
     return false;
 
   if (withBSwap)
-  {
-    switch (size)
-    {
-    case 2:
-    {
-      u16 halfword = 0;
-      std::memcpy(&halfword, buffer, sizeof(u16));
-      halfword = Common::bSwap16(halfword);
-      std::memcpy(buffer, &halfword, sizeof(u16));
-      break;
-    }
-    case 4:
-    {
-      u32 word = 0;
-      std::memcpy(&word, buffer, sizeof(u32));
-      word = Common::bSwap32(word);
-      std::memcpy(buffer, &word, sizeof(u32));
-      break;
-    }
-    case 8:
-    {
-      u64 doubleword = 0;
-      std::memcpy(&doubleword, buffer, sizeof(u64));
-      doubleword = Common::bSwap64(doubleword);
-      std::memcpy(buffer, &doubleword, sizeof(u64));
-      break;
-    }
-    }
-  }
+    Common::bSwapInPlace(buffer, size);
 
   return true;
 }
 
-bool LinuxDolphinProcess::writeToRAM(const u32 offset, const char* buffer, const size_t size,
-                                     const bool withBSwap)
+bool LinuxDolphinProcess::readFromRegion(const Common::MemRegion region, const u32 regionOffset,
+                                         char* buffer, const size_t size)
 {
+  const u64 regionStart = getRegionAddressStart(region);
+  if (regionStart == 0)
+    return false;
+
   struct iovec local;
   struct iovec remote;
-  size_t nwrote;
-  u64 RAMAddress = 0;
-  if (m_ARAMAccessible)
-  {
-    if (offset >= Common::ARAM_FAKESIZE)
-      RAMAddress = m_emuRAMAddressStart + offset - Common::ARAM_FAKESIZE;
-    else
-      RAMAddress = m_emuARAMAdressStart + offset;
-  }
-  else if (offset >= (Common::MEM2_START - Common::MEM1_START))
-  {
-    RAMAddress = m_MEM2AddressStart + offset - (Common::MEM2_START - Common::MEM1_START);
-  }
-  else
+  local.iov_base = buffer;
+  local.iov_len = size;
+  remote.iov_base = (void*)(regionStart + regionOffset);
+  remote.iov_len = size;
+  return process_vm_readv(m_PID, &local, 1, &remote, 1, 0) == static_cast<ssize_t>(size);
+}
+
+bool LinuxDolphinProcess::readBatchFromRAM(const RAMRead* reads, const size_t count)
+{
+  // on the stack, a bigger batch takes a few calls
+  std::array<iovec, BATCH_IOVECS> local;
+  std::array<iovec, BATCH_IOVECS> remote;
+  bool ok = true;
+  for (size_t first = 0; first < count; first += BATCH_IOVECS)
   {
-    RAMAddress = m_emuRAMAddressStart + offset;
+    const size_t n = std::min(count - first, BATCH_IOVECS);
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      const RAMRead& read = reads[first + i];
+      local[i].iov_base = read.buffer;
+      local[i].iov_len = read.size;
+      remote[i].iov_base = (void*)getRAMAddressForOffset(read.offset);
+      remote[i].iov_len = read.size;
+      bytes += read.size;
+    }
+    // stops at the first range that can't be read
+    ok = process_vm_readv(m_PID, local.data(), n, remote.data(), n, 0) ==
+             static_cast<ssize_t>(bytes) &&
+         ok;
   }
+  return ok;
+}
 
-  char* bufferCopy = new char[size];
-  std::memcpy(bufferCopy, buffer, size);
+bool LinuxDolphinProcess::writeToRAM(const u32 offset, const char* buffer, const size_t size,
+                                     const bool withBSwap)
+{
+  u64 scratch = 0;
+  const char* data = getWriteData(buffer, size, withBSwap, scratch);
 
-  local.iov_base = bufferCopy;
+  struct iovec local;
+  struct iovec remote;
+  local.iov_base = const_cast<char*>(data);
   local.iov_len = size;
-  remote.iov_base = (void*)RAMAddress;
+  remote.iov_base = (void*)getRAMAddressForOffset(offset);
   remote.iov_len = size;
+  return process_vm_writev(m_PID, &local, 1, &remote, 1, 0) == static_cast<ssize_t>(size);
+}
 
-  if (withBSwap)
+bool LinuxDolphinProcess::writeBatchToRAM(const RAMWrite* writes, const size_t count)
+{
+  // on the stack, a bigger batch takes a few calls
+  std::array<iovec, BATCH_IOVECS> local;
+  std::array<iovec, BATCH_IOVECS> remote;
+  bool ok = true;
+  for (size_t first = 0; first < count; first += BATCH_IOVECS)
   {
-    switch (size)
-    {
-    case 2:
-    {
-      u16 halfword = 0;
-      std::memcpy(&halfword, bufferCopy, sizeof(u16));
-      halfword = Common::bSwap16(halfword);
-      std::memcpy(bufferCopy, &halfword, sizeof(u16));
-      break;
-    }
-    case 4:
+    const size_t n = std::min(count - first, BATCH_IOVECS);
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; ++i)
     {
-      u32 word = 0;
-      std::memcpy(&word, bufferCopy, sizeof(u32));
-      word = Common::bSwap32(word);
-      std::memcpy(bufferCopy, &word, sizeof(u32));
-      break;
-    }
-    case 8:
-    {
-      u64 doubleword = 0;
-      std::memcpy(&doubleword, bufferCopy, sizeof(u64));
-      doubleword = Common::bSwap64(doubleword);
-      std::memcpy(bufferCopy, &doubleword, sizeof(u64));
-      break;
-    }
+      const RAMWrite& write = writes[first + i];
+      local[i].iov_base = const_cast<char*>(write.buffer);
+      local[i].iov_len = write.size;
+      remote[i].iov_base = (void*)getRAMAddressForOffset(write.offset);
+      remote[i].iov_len = write.size;
+      bytes += write.size;
     }
+    // stops at the first range that can't be written
+    ok = process_vm_writev(m_PID, local.data(), n, remote.data(), n, 0) ==
+             static_cast<ssize_t>(bytes) &&
+         ok;
   }
-
-  nwrote = process_vm_writev(m_PID, &local, 1, &remote, 1, 0);
-  delete[] bufferCopy;
-  if (nwrote != size)
-    return false;
-
-  return true;
+  return ok;
 }
 } // namespace DolphinComm
 #endif
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "../IDolphinProcess.h"
 
@@ -16,11 +17,25 @@ public:
   LinuxDolphinProcess()
   {
   }
+  // Every running Dolphin, ascending
+  static std::vector<int> findPIDs();
   bool findPID() override;
   bool obtainEmuRAMInformations() override;
   bool readFromRAM(const u32 offset, char* buffer, size_t size, const bool withBSwap) override;
   bool writeToRAM(const u32 offset, const char* buffer, const size_t size,
                   const bool withBSwap) override;
+  bool readFromRegion(const Common::MemRegion region, const u32 regionOffset, char* buffer,
+                      const size_t size) override;
+  // Up to 64 reads / writes per process_vm_readv / process_vm_writev
+  bool readBatchFromRAM(const RAMRead* reads, const size_t count) override;
+  bool writeBatchToRAM(const RAMWrite* writes, const size_t count) override;
+  // Soft-dirty bits of the pages mapping Dolphin's shared memory, see clearDirtyPages
+  bool clearDirtyPages() override;
+  bool readDirtyPages(std::vector<RAMRange>& ranges) override;
+  const char* getMemoryBackendName() const override
+  {
+    return "process_vm_readv";
+  }
 };
 } // namespace DolphinComm
 #endif
@@ -0,0 +1,359 @@
+#ifdef __linux__
+
+#include "ProcMemDolphinProcess.h"
+#include "../../Common/CommonUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define DME_HAS_IO_URING
+#endif
+
+namespace DolphinComm
+{
+namespace
+{
+// /proc/<pid>/mem reads can't complete inline, io_uring hands them to kernel workers which costs
+// a few microseconds per batch. Smaller batches are faster as plain preads.
+constexpr size_t IO_URING_MIN_BATCH_BYTES = 0x40000;
+
+// pread until size bytes are read, /proc/<pid>/mem may return less at once
+bool preadFully(const int fd, char* buffer, const size_t size, const u64 address)
+{
+  size_t done = 0;
+  while (done < size)
+  {
+    const ssize_t n = pread(fd, buffer + done, size - done, static_cast<off_t>(address + done));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    done += static_cast<size_t>(n);
+  }
+  return true;
+}
+} // namespace
+
+// A minimal io_uring on the raw syscalls(no liburing): submits up to ENTRIES preads and waits
+// for all of them with a single io_uring_enter.
+class IoUringReader
+{
+public:
+  struct Read
+  {
+    u64 address;
+    char* buffer;
+    size_t size;
+  };
+
+#ifdef DME_HAS_IO_URING
+  static constexpr unsigned ENTRIES = 64;
+
+  ~IoUringReader()
+  {
+    if (m_sqes != nullptr)
+      munmap(m_sqes, m_sqesSize);
+    if (m_cqRing != nullptr && m_cqRing != m_sqRing)
+      munmap(m_cqRing, m_cqRingSize);
+    if (m_sqRing != nullptr)
+      munmap(m_sqRing, m_sqRingSize);
+    if (m_ringFd >= 0)
+      close(m_ringFd);
+  }
+
+  // false when io_uring is missing or blocked(e.g. seccomp), preads are used then
+  bool init()
+  {
+    io_uring_params params{};
+    m_ringFd = static_cast<int>(syscall(__NR_io_uring_setup, ENTRIES, &params));
+    if (m_ringFd < 0)
+      return false;
+
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap)
+      m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+
+    m_sqRing = mapRing(m_sqRingSize, IORING_OFF_SQ_RING);
+    if (m_sqRing == nullptr)
+      return false;
+    m_cqRing = singleMmap ? m_sqRing : mapRing(m_cqRingSize, IORING_OFF_CQ_RING);
+    if (m_cqRing == nullptr)
+      return false;
+    m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = static_cast<io_uring_sqe*>(mapRing(m_sqesSize, IORING_OFF_SQES));
+    if (m_sqes == nullptr)
+      return false;
+
+    auto* sq = static_cast<char*>(m_sqRing);
+    auto* cq = static_cast<char*>(m_cqRing);
+    m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    m_entries = std::min(ENTRIES, params.sq_entries);
+    return true;
+  }
+
+  // false if a read failed or the ring broke, see broken()
+  bool readBatch(const int fd, const Read* reads, const size_t count)
+  {
+    bool ok = true;
+    for (size_t first = 0; first < count && !m_broken; first += m_entries)
+    {
+      const unsigned n = static_cast<unsigned>(std::min<size_t>(m_entries, count - first));
+      ok = submitAndWait(fd, reads + first, n) && ok;
+    }
+    return ok && !m_broken;
+  }
+
+  // io_uring_enter failed with reads in flight, the ring must not be used again
+  bool broken() const
+  {
+    return m_broken;
+  }
+
+private:
+  void* mapRing(const size_t size, const off_t offset) const
+  {
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd,
+                   offset);
+    return p == MAP_FAILED ? nullptr : p;
+  }
+
+  bool submitAndWait(const int fd, const Read* reads, const unsigned n)
+  {
+    // only this thread produces, the kernel consumes the tail with acquire
+    const unsigned tail = std::atomic_ref<unsigned>(*m_sqTail).load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < n; ++i)
+    {
+      const unsigned index = (tail + i) & m_sqMask;
+      io_uring_sqe& sqe = m_sqes[index];
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_READ;
+      sqe.fd = fd;
+      sqe.addr = reinterpret_cast<u64>(reads[i].buffer);
+      sqe.len = static_cast<u32>(reads[i].size);
+      sqe.off = reads[i].address;
+      sqe.user_data = i;
+      m_sqArray[index] = index;
+    }
+    std::atomic_ref<unsigned>(*m_sqTail).store(tail + n, std::memory_order_release);
+
+    unsigned submitted = 0;
+    while (submitted < n)
+    {
+      const long ret = syscall(__NR_io_uring_enter, m_ringFd, n - submitted, n - submitted,
+                               IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (ret < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        m_broken = true;
+        return false;
+      }
+      submitted += static_cast<unsigned>(ret);
+    }
+
+    bool ok = true;
+    unsigned completed = 0;
+    while (completed < n)
+    {
+      unsigned head = std::atomic_ref<unsigned>(*m_cqHead).load(std::memory_order_relaxed);
+      const unsigned cqTail = std::atomic_ref<unsigned>(*m_cqTail).load(std::memory_order_acquire);
+      if (head == cqTail)
+      {
+        // every entry is submitted, wait for the remaining completions
+        if (syscall(__NR_io_uring_enter, m_ringFd, 0, n - completed, IORING_ENTER_GETEVENTS,
+                    nullptr, 0) < 0 &&
+            errno != EINTR)
+        {
+          m_broken = true;
+          return false;
+        }
+        continue;
+      }
+      for (; head != cqTail; ++head)
+      {
+        const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+        // not one of this batch's reads
+        if (cqe.user_data >= n)
+          continue;
+        ++completed;
+        const Read& read = reads[cqe.user_data];
+        const size_t done = cqe.res > 0 ? static_cast<size_t>(cqe.res) : 0;
+        // short read or an old kernel without IORING_OP_READ, finish with pread
+        if (done < read.size &&
+            !preadFully(fd, read.buffer + done, read.size - done, read.address + done))
+          ok = false;
+      }
+      std::atomic_ref<unsigned>(*m_cqHead).store(head, std::memory_order_release);
+    }
+    return ok;
+  }
+
+  int m_ringFd = -1;
+  void* m_sqRing = nullptr;
+  size_t m_sqRingSize = 0;
+  void* m_cqRing = nullptr;
+  size_t m_cqRingSize = 0;
+  io_uring_sqe* m_sqes = nullptr;
+  size_t m_sqesSize = 0;
+  unsigned* m_sqTail = nullptr;
+  unsigned m_sqMask = 0;
+  unsigned* m_sqArray = nullptr;
+  unsigned* m_cqHead = nullptr;
+  unsigned* m_cqTail = nullptr;
+  unsigned m_cqMask = 0;
+  io_uring_cqe* m_cqes = nullptr;
+  unsigned m_entries = 0;
+  bool m_broken = false;
+#else
+  bool init()
+  {
+    return false;
+  }
+
+  bool readBatch(const int, const Read*, const size_t)
+  {
+    return false;
+  }
+
+  bool broken() const
+  {
+    return false;
+  }
+#endif
+};
+
+ProcMemDolphinProcess::ProcMemDolphinProcess() = default;
+
+ProcMemDolphinProcess::~ProcMemDolphinProcess()
+{
+  if (m_memFd >= 0)
+    close(m_memFd);
+}
+
+bool ProcMemDolphinProcess::obtainEmuRAMInformations()
+{
+  if (!LinuxDolphinProcess::obtainEmuRAMInformations())
+    return false;
+
+  if (m_memFd >= 0)
+    close(m_memFd);
+  const std::string path = "/proc/" + std::to_string(m_PID) + "/mem";
+  m_memFd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (m_memFd < 0)
+    m_memFd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (m_memFd < 0)
+    return false;
+
+  auto ioUring = std::make_unique<IoUringReader>();
+  if (ioUring->init())
+    m_ioUring = std::move(ioUring);
+  else
+    m_ioUring.reset();
+  return true;
+}
+
+bool ProcMemDolphinProcess::readAt(const u64 address, char* buffer, const size_t size) const
+{
+  return m_memFd >= 0 && preadFully(m_memFd, buffer, size, address);
+}
+
+bool ProcMemDolphinProcess::readFromRAM(const u32 offset, char* buffer, const size_t size,
+                                        const bool withBSwap)
+{
+  if (!readAt(getRAMAddressForOffset(offset), buffer, size))
+    return false;
+  if (withBSwap)
+    Common::bSwapInPlace(buffer, size);
+  return true;
+}
+
+bool ProcMemDolphinProcess::writeToRAM(const u32 offset, const char* buffer, const size_t size,
+                                       const bool withBSwap)
+{
+  if (m_memFd < 0)
+    return false;
+
+  u64 scratch = 0;
+  const char* data = getWriteData(buffer, size, withBSwap, scratch);
+
+  const u64 RAMAddress = getRAMAddressForOffset(offset);
+  size_t done = 0;
+  while (done < size)
+  {
+    const ssize_t n = pwrite(m_memFd, data + done, size - done,
+                             static_cast<off_t>(RAMAddress + done));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    done += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool ProcMemDolphinProcess::writeBatchToRAM(const RAMWrite* writes, const size_t count)
+{
+  return IDolphinProcess::writeBatchToRAM(writes, count);
+}
+
+bool ProcMemDolphinProcess::readFromRegion(const Common::MemRegion region, const u32 regionOffset,
+                                           char* buffer, const size_t size)
+{
+  const u64 regionStart = getRegionAddressStart(region);
+  if (regionStart == 0)
+    return false;
+  return readAt(regionStart + regionOffset, buffer, size);
+}
+
+bool ProcMemDolphinProcess::readBatchFromRAM(const RAMRead* reads, const size_t count)
+{
+  if (m_memFd < 0)
+    return false;
+  size_t bytes = 0;
+  for (size_t i = 0; i < count; ++i)
+    bytes += reads[i].size;
+  if (!m_ioUring || count == 1 || bytes < IO_URING_MIN_BATCH_BYTES)
+    return IDolphinProcess::readBatchFromRAM(reads, count);
+
+  std::vector<IoUringReader::Read> ringReads(count);
+  for (size_t i = 0; i < count; ++i)
+    ringReads[i] = {getRAMAddressForOffset(reads[i].offset), reads[i].buffer, reads[i].size};
+  if (m_ioUring->readBatch(m_memFd, ringReads.data(), count))
+    return true;
+  if (!m_ioUring->broken())
+    return false;
+  // Reads may still be in flight into the caller's buffers, drop the ring so they can't complete
+  // into a later batch and finish this one with preads.
+  m_ioUring.reset();
+  return IDolphinProcess::readBatchFromRAM(reads, count);
+}
+
+bool ProcMemDolphinProcess::batchesReads() const
+{
+  return m_ioUring != nullptr;
+}
+
+const char* ProcMemDolphinProcess::getMemoryBackendName() const
+{
+  return m_ioUring ? "/proc/pid/mem+io_uring" : "/proc/pid/mem";
+}
+} // namespace DolphinComm
+#endif
@@ -0,0 +1,44 @@
+#ifdef __linux__
+
+#pragma once
+
+#include <memory>
+
+#include "LinuxDolphinProcess.h"
+
+namespace DolphinComm
+{
+class IoUringReader;
+
+// Reads and writes Dolphin's memory through /proc/<pid>/mem with pread / pwrite instead of
+// process_vm_readv / process_vm_writev, which container seccomp profiles often block. Batches go
+// through one io_uring submission when the kernel allows it.
+class ProcMemDolphinProcess : public LinuxDolphinProcess
+{
+public:
+  ProcMemDolphinProcess();
+  ~ProcMemDolphinProcess() override;
+  ProcMemDolphinProcess(const ProcMemDolphinProcess&) = delete;
+  ProcMemDolphinProcess& operator=(const ProcMemDolphinProcess&) = delete;
+
+  bool obtainEmuRAMInformations() override;
+  bool readFromRAM(const u32 offset, char* buffer, size_t size, const bool withBSwap) override;
+  bool writeToRAM(const u32 offset, const char* buffer, const size_t size,
+                  const bool withBSwap) override;
+  bool readFromRegion(const Common::MemRegion region, const u32 regionOffset, char* buffer,
+                      const size_t size) override;
+  bool readBatchFromRAM(const RAMRead* reads, const size_t count) override;
+  // One pwrite per range through writeToRAM, never process_vm_writev: the backend was chosen
+  // because process_vm_* may be blocked.
+  bool writeBatchToRAM(const RAMWrite* writes, const size_t count) override;
+  bool batchesReads() const override;
+  const char* getMemoryBackendName() const override;
+
+private:
+  bool readAt(const u64 address, char* buffer, const size_t size) const;
+
+  int m_memFd = -1;
+  std::unique_ptr<IoUringReader> m_ioUring;
+};
+} // namespace DolphinComm
+#endif
@@ -0,0 +1,83 @@
+#include "ReplayDolphinProcess.h"
+#include "../../Common/CommonUtils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace DolphinComm
+{
+ReplayDolphinProcess::ReplayDolphinProcess(GameTrace trace, const double speed)
+    : m_trace(std::move(trace)), m_speed(speed)
+{
+  if (m_trace.frames.empty())
+    throw std::invalid_argument("Game trace has no frames.");
+  if (!(m_speed > 0.0))
+    throw std::invalid_argument("Replay speed must be greater than 0.");
+}
+
+bool ReplayDolphinProcess::findPID()
+{
+  m_PID = 0;
+  return true;
+}
+
+bool ReplayDolphinProcess::obtainEmuRAMInformations()
+{
+  // the traces are taken from Wii games
+  m_MEM2Present = true;
+  m_ARAMAccessible = false;
+  // the replay clock starts when xtool hooks
+  if (!m_start)
+    m_start = std::chrono::steady_clock::now();
+  return true;
+}
+
+const GameTraceFrame& ReplayDolphinProcess::currentFrame() const
+{
+  if (!m_start)
+    return m_trace.frames.front();
+  const auto elapsed = std::chrono::duration<double, std::micro>(
+                           std::chrono::steady_clock::now() - m_start.value())
+                           .count();
+  const auto time_us =
+      m_trace.frames.front().time_us + static_cast<u64>(elapsed * m_speed);
+  const auto it = std::upper_bound(
+      m_trace.frames.begin(), m_trace.frames.end(), time_us,
+      [](const u64 t, const GameTraceFrame& frame) { return t < frame.time_us; });
+  return *std::prev(it);
+}
+
+bool ReplayDolphinProcess::isFinished() const
+{
+  return &currentFrame() == &m_trace.frames.back();
+}
+
+bool ReplayDolphinProcess::readFromRAM(const u32 offset, char* buffer, const size_t size,
+                                       const bool withBSwap)
+{
+  const auto& frame = currentFrame();
+  for (size_t i = 0; i < m_trace.addresses.size(); ++i)
+  {
+    const auto& address = m_trace.addresses[i];
+    if (offset < address.offset ||
+        static_cast<u64>(offset) + size > static_cast<u64>(address.offset) + address.size)
+      continue;
+
+    char value[8];
+    unpack_trace_value(frame.values[i], value, address.size);
+    std::memcpy(buffer, value + (offset - address.offset), size);
+
+    if (withBSwap)
+      Common::bSwapInPlace(buffer, size);
+    return true;
+  }
+  return false;
+}
+
+bool ReplayDolphinProcess::writeToRAM(const u32, const char*, const size_t, const bool)
+{
+  // a recording is read only
+  return false;
+}
+} // namespace DolphinComm
@@ -0,0 +1,41 @@
+// Serves the values of a recorded game trace(see game_trace.hpp) instead of
+// reading a running Dolphin, at the recorded timing multiplied by a speed.
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+#include <game_trace.hpp>
+
+#include "../IDolphinProcess.h"
+
+namespace DolphinComm
+{
+class ReplayDolphinProcess : public IDolphinProcess
+{
+public:
+  // speed > 0, 1.0 is the recorded timing
+  ReplayDolphinProcess(GameTrace trace, const double speed);
+  bool findPID() override;
+  bool obtainEmuRAMInformations() override;
+  // Only reads inside a watched address succeed. After the last frame the
+  // last recorded values are served.
+  bool readFromRAM(const u32 offset, char* buffer, size_t size, const bool withBSwap) override;
+  bool writeToRAM(const u32 offset, const char* buffer, const size_t size,
+                  const bool withBSwap) override;
+  const char* getMemoryBackendName() const override
+  {
+    return "replay";
+  }
+
+  // The last frame is due, xtool --replay stops after serving it.
+  bool isFinished() const;
+
+private:
+  const GameTraceFrame& currentFrame() const;
+
+  GameTrace m_trace;
+  double m_speed;
+  std::optional<std::chrono::steady_clock::time_point> m_start;
+};
+} // namespace DolphinComm
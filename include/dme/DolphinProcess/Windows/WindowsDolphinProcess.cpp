@@ -4,11 +4,41 @@
 #include "../../Common/CommonUtils.h"
 
 #include <Psapi.h>
+#include <algorithm>
 #include <string>
 #include <tlhelp32.h>
 
 namespace DolphinComm
 {
+namespace
+{
+bool isDolphinExecutable(const std::string& exeFile)
+{
+  return exeFile == "Dolphin.exe" || exeFile == "DolphinQt2.exe" || exeFile == "DolphinWx.exe";
+}
+} // namespace
+
+std::vector<int> WindowsDolphinProcess::findPIDs()
+{
+  std::vector<int> PIDs;
+  PROCESSENTRY32 entry;
+  entry.dwSize = sizeof(PROCESSENTRY32);
+
+  HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, NULL);
+
+  if (Process32First(snapshot, &entry) == TRUE)
+  {
+    do
+    {
+      if (isDolphinExecutable(entry.szExeFile))
+        PIDs.push_back(entry.th32ProcessID);
+    } while (Process32Next(snapshot, &entry) == TRUE);
+  }
+
+  CloseHandle(snapshot);
+  std::sort(PIDs.begin(), PIDs.end());
+  return PIDs;
+}
 
 bool WindowsDolphinProcess::findPID()
 {
@@ -21,9 +51,8 @@ bool WindowsDolphinProcess::findPID()
   {
     do
     {
-      if (std::string(entry.szExeFile) == "Dolphin.exe" ||
-          std::string(entry.szExeFile) == "DolphinQt2.exe" ||
-          std::string(entry.szExeFile) == "DolphinWx.exe")
+      if (isDolphinExecutable(entry.szExeFile) &&
+          (m_targetPID == -1 || static_cast<int>(entry.th32ProcessID) == m_targetPID))
       {
         m_PID = entry.th32ProcessID;
         break;
@@ -146,97 +175,35 @@ bool WindowsDolphinProcess::readFromRAM(const u32 offset, char* buffer, const si
   if (bResult && nread == size)
   {
     if (withBSwap)
-    {
-      switch (size)
-      {
-      case 2:
-      {
-        u16 halfword = 0;
-        std::memcpy(&halfword, buffer, sizeof(u16));
-        halfword = Common::bSwap16(halfword);
-        std::memcpy(buffer, &halfword, sizeof(u16));
-        break;
-      }
-      case 4:
-      {
-        u32 word = 0;
-        std::memcpy(&word, buffer, sizeof(u32));
-        word = Common::bSwap32(word);
-        std::memcpy(buffer, &word, sizeof(u32));
-        break;
-      }
-      case 8:
-      {
-        u64 doubleword = 0;
-        std::memcpy(&doubleword, buffer, sizeof(u64));
-        doubleword = Common::bSwap64(doubleword);
-        std::memcpy(buffer, &doubleword, sizeof(u64));
-        break;
-      }
-      }
-    }
+      Common::bSwapInPlace(buffer, size);
     return true;
   }
   return false;
 }
 
-bool WindowsDolphinProcess::writeToRAM(const u32 offset, const char* buffer, const size_t size,
-                                       const bool withBSwap)
+bool WindowsDolphinProcess::readFromRegion(const Common::MemRegion region,
+                                           const u32 regionOffset, char* buffer, const size_t size)
 {
-  u64 RAMAddress = 0;
-  if (m_ARAMAccessible)
-  {
-    if (offset >= Common::ARAM_FAKESIZE)
-      RAMAddress = m_emuRAMAddressStart + offset - Common::ARAM_FAKESIZE;
-    else
-      RAMAddress = m_emuARAMAdressStart + offset;
-  }
-  else if (offset >= (Common::MEM2_START - Common::MEM1_START))
-  {
-    RAMAddress = m_MEM2AddressStart + offset - (Common::MEM2_START - Common::MEM1_START);
-  }
-  else
-  {
-    RAMAddress = m_emuRAMAddressStart + offset;
-  }
+  const u64 regionStart = getRegionAddressStart(region);
+  if (regionStart == 0)
+    return false;
 
   SIZE_T nread = 0;
-  char* bufferCopy = new char[size];
-  std::memcpy(bufferCopy, buffer, size);
-  if (withBSwap)
-  {
-    switch (size)
-    {
-    case 2:
-    {
-      u16 halfword = 0;
-      std::memcpy(&halfword, bufferCopy, sizeof(u16));
-      halfword = Common::bSwap16(halfword);
-      std::memcpy(bufferCopy, &halfword, sizeof(u16));
-      break;
-    }
-    case 4:
-    {
-      u32 word = 0;
-      std::memcpy(&word, bufferCopy, sizeof(u32));
-      word = Common::bSwap32(word);
-      std::memcpy(bufferCopy, &word, sizeof(u32));
-      break;
-    }
-    case 8:
-    {
-      u64 doubleword = 0;
-      std::memcpy(&doubleword, bufferCopy, sizeof(u64));
-      doubleword = Common::bSwap64(doubleword);
-      std::memcpy(bufferCopy, &doubleword, sizeof(u64));
-      break;
-    }
-    }
-  }
+  return ReadProcessMemory(m_hDolphin, (void*)(regionStart + regionOffset), buffer, size,
+                           &nread) &&
+         nread == size;
+}
+
+bool WindowsDolphinProcess::writeToRAM(const u32 offset, const char* buffer, const size_t size,
+                                       const bool withBSwap)
+{
+  u64 scratch = 0;
+  const char* data = getWriteData(buffer, size, withBSwap, scratch);
 
-  bool bResult = WriteProcessMemory(m_hDolphin, (void*)RAMAddress, bufferCopy, size, &nread);
-  delete[] bufferCopy;
-  return (bResult && nread == size);
+  SIZE_T nwrote = 0;
+  bool bResult = WriteProcessMemory(m_hDolphin, (void*)getRAMAddressForOffset(offset), data, size,
+                                    &nwrote);
+  return (bResult && nwrote == size);
 }
 } // namespace DolphinComm
 #endif
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <vector>
 #include <windows.h>
 
 #include "../IDolphinProcess.h"
@@ -14,12 +15,20 @@ public:
   WindowsDolphinProcess()
   {
   }
+  // Every running Dolphin, ascending
+  static std::vector<int> findPIDs();
   bool findPID() override;
   bool obtainEmuRAMInformations() override;
   bool readFromRAM(const u32 offset, char* buffer, const size_t size,
                    const bool withBSwap) override;
   bool writeToRAM(const u32 offset, const char* buffer, const size_t size,
                   const bool withBSwap) override;
+  bool readFromRegion(const Common::MemRegion region, const u32 regionOffset, char* buffer,
+                      const size_t size) override;
+  const char* getMemoryBackendName() const override
+  {
+    return "ReadProcessMemory";
+  }
 
 private:
   HANDLE m_hDolphin;
@@ -1,15 +1,38 @@
 #pragma once
 #include <dme/DolphinProcess/DolphinAccessor.h>
+#include <optional>
+#include <string_view>
 
+// "auto", "process_vm_readv" or "proc_mem"
+[[nodiscard]] std::optional<DolphinComm::MemoryBackend>
+parse_memory_backend(std::string_view const name);
+
+[[nodiscard]] std::string_view
+memory_backend_name(DolphinComm::MemoryBackend const backend);
+
+// Backend of the DolphinManagers constructed afterwards(--memory-backend).
+void set_default_memory_backend(DolphinComm::MemoryBackend const backend);
+[[nodiscard]] DolphinComm::MemoryBackend default_memory_backend();
+
+// One dolphin instance, hooked on demand.
 class DolphinManager {
 public:
-  DolphinManager();
+  // pid -1 hooks the first dolphin found
+  explicit DolphinManager(int const pid = -1);
+  DolphinManager(int const pid, DolphinComm::MemoryBackend const backend);
+
+  // Hooks first if not hooked.
+  DolphinComm::DolphinAccessor &dolphin();
+
+  // Takes ownership, reads process instead of dolphin(e.g. a trace replay).
+  void set_process(DolphinComm::IDolphinProcess *process);
 
-  DolphinComm::DolphinAccessor const &dolphin() const;
+  // e.g. the process exited, the next dolphin() hooks again
+  void unhook();
 
 private:
-  void hook_dolphin_if_not_hooked() const;
+  void hook_dolphin_if_not_hooked();
 
 private:
   DolphinComm::DolphinAccessor m_dolphin;
-};
\ No newline at end of file
+};
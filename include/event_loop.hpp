@@ -0,0 +1,74 @@
+#pragma once
+#ifdef __linux__
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Owns a file descriptor, closes it on destruction.
+class UniqueFd {
+public:
+  UniqueFd() = default;
+  explicit UniqueFd(int const fd) noexcept : m_fd(fd) {}
+  ~UniqueFd();
+  UniqueFd(UniqueFd &&other) noexcept;
+  UniqueFd &operator=(UniqueFd &&other) noexcept;
+  UniqueFd(UniqueFd const &) = delete;
+  UniqueFd &operator=(UniqueFd const &) = delete;
+
+  [[nodiscard]] int get() const noexcept { return m_fd; }
+  [[nodiscard]] bool valid() const noexcept { return m_fd >= 0; }
+  void reset() noexcept;
+
+private:
+  int m_fd = -1;
+};
+
+// Single threaded epoll loop, one handler per readable fd.
+class EventLoop {
+public:
+  using Handler = std::function<void()>;
+
+  EventLoop();
+  EventLoop(EventLoop const &) = delete;
+  EventLoop &operator=(EventLoop const &) = delete;
+
+  // fd must stay open until removed
+  void add(int const fd, Handler handler);
+  // safe to call from a handler, even for its own fd
+  void remove(int const fd);
+
+  // Dispatches until stop() is called.
+  void run();
+  void stop() noexcept;
+
+private:
+  UniqueFd m_epoll_fd;
+  // on the heap so a handler that removes itself keeps running from the
+  // same address
+  std::unordered_map<int, std::unique_ptr<Handler>> m_handlers;
+  // removed while dispatching, destroyed after the handler returned
+  std::vector<std::unique_ptr<Handler>> m_removed_handlers;
+  bool m_running = false;
+};
+
+// periodic CLOCK_MONOTONIC timer, read() it to rearm the readiness
+[[nodiscard]] UniqueFd make_timerfd(std::chrono::milliseconds const interval);
+void set_timerfd_interval(UniqueFd const &timer,
+                          std::chrono::milliseconds const interval);
+// Number of expirations since the last call.
+std::uint64_t consume_timerfd(UniqueFd const &timer);
+
+// Blocks the signals in the calling thread(threads started afterwards
+// inherit the mask) and returns a signalfd that receives them.
+[[nodiscard]] UniqueFd make_signalfd(std::initializer_list<int> const signals);
+// -1 if nothing is pending
+int consume_signalfd(UniqueFd const &signals);
+
+// Readable once the process exits. Invalid fd if the kernel lacks
+// pidfd_open(Linux < 5.3) or pid does not exist.
+[[nodiscard]] UniqueFd open_pidfd(int const pid);
+#endif
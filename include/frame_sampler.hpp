@@ -0,0 +1,67 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+// When the reader samples the game memory. With a frame counter in the game
+// profile(GameAddresses::frame_counter) a sample is due every
+// frames_per_sample emulated frames, so at 50% speed the reader polls half
+// as often and at turbo speed more often, and a paused game is barely
+// polled. Without one it is due every clock_interval like before.
+//
+// Not thread safe, owned by the reader loop.
+class FrameSampler {
+public:
+  FrameSampler(std::uint32_t const frames_per_sample,
+               std::chrono::milliseconds const clock_interval);
+
+  // Frame counter read at now_ns(steady_now_ns). true when frames_per_sample
+  // frames passed since the last due sample, or the counter went back(e.g.
+  // the game was reset).
+  [[nodiscard]] bool on_frame(std::uint32_t const frame,
+                              std::int64_t const now_ns);
+  // No frame counter: true every clock_interval.
+  [[nodiscard]] bool on_clock(std::int64_t const now_ns);
+
+  // Until the next sample is due: the frames left at the measured frame
+  // rate, the rest of clock_interval without a frame counter. At least 1 ms,
+  // at most max_delay.
+  [[nodiscard]] std::chrono::milliseconds
+  next_delay(std::int64_t const now_ns,
+             std::chrono::milliseconds const max_delay) const;
+
+  // The frame counter is gone(unhooked, another game), forget the rate.
+  void reset() noexcept;
+
+  // Emulated frames per second of the last readings, 0 while paused(the
+  // counter didn't move between two readings), nullopt before two frame
+  // counter readings.
+  [[nodiscard]] std::optional<double> frames_per_second() const noexcept;
+
+  struct Stats {
+    std::uint64_t samples = 0;
+    // woken up before frames_per_sample frames passed
+    std::uint64_t early = 0;
+  };
+  [[nodiscard]] Stats stats() const noexcept;
+
+private:
+  // whether the sample of frame is due, on_frame after the rate update
+  [[nodiscard]] bool on_due(std::uint32_t const frame,
+                            std::int64_t const now_ns);
+
+private:
+  std::uint32_t m_frames_per_sample;
+  std::int64_t m_clock_interval_ns;
+
+  // last due sample
+  std::optional<std::uint32_t> m_sample_frame;
+  std::int64_t m_sample_ns = 0;
+  // last reading, for the rate
+  std::optional<std::uint32_t> m_last_frame;
+  std::int64_t m_last_ns = 0;
+  // exponential moving average, frames per ns, nullopt while paused
+  std::optional<double> m_rate;
+  bool m_paused = false;
+  Stats m_stats;
+};
@@ -0,0 +1,169 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <console_struct.hpp>
+#include <constants.hpp>
+#include <cstdint>
+#include <dme/DolphinProcess/DolphinAccessor.h>
+#include <filesystem>
+#include <game_trace.hpp>
+#include <memory>
+#include <optional>
+#include <signature_scan.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Game memory addresses xtool polls, ram offsets(console address -
+// MEM1_START) like xtool::constants.
+struct GameAddresses {
+  std::uint32_t current_music_id = xtool::constants::CURRENT_MUSIC_ID_ADDRESS;
+  std::uint32_t g_mtrand_seed = xtool::constants::G_MTRAND_SEED_ADDRESS;
+  // u32 the game increments once per frame, the reader samples on emulated
+  // frames with it(see FrameSampler) and on the wall clock without it
+  std::optional<std::uint32_t> frame_counter;
+  // frames per second at 100% emulation speed
+  double frame_rate = 60.0;
+};
+
+// "current_music_id" or "g_mtrand_seed", nullptr for other names.
+[[nodiscard]] std::uint32_t *game_address_field(GameAddresses &addresses,
+                                                std::string_view const name);
+
+// Names a signature can resolve, the game_address_field names and the
+// optional "frame_counter".
+[[nodiscard]] bool is_game_address_name(std::string_view const name);
+
+// The disc header at the start of MEM1(xtool::constants::DISC_HEADER).
+struct DiscHeader {
+  std::array<char, 6> game_id{};
+  std::uint8_t disc = 0;
+  std::uint8_t revision = 0;
+};
+
+template <> struct ConsoleStruct<DiscHeader> {
+  static constexpr std::uint32_t size = 0x8;
+  static constexpr auto fields =
+      std::tuple{console_field(0x0, &DiscHeader::game_id),
+                 console_field(0x6, &DiscHeader::disc),
+                 console_field(0x7, &DiscHeader::revision)};
+};
+
+struct GameId {
+  // e.g. "RSBE01"
+  std::string id;
+  std::uint8_t revision = 0;
+
+  friend bool operator==(GameId const &, GameId const &) = default;
+};
+
+struct GameProfile {
+  std::string_view game_id;
+  // nullopt matches every revision
+  std::optional<std::uint8_t> revision;
+  std::string_view title;
+  GameAddresses addresses;
+};
+
+// Games xtool knows, a game not listed here(or in the config) is not polled
+// so a wrong address can't produce bogus music switches.
+inline constexpr std::array<GameProfile, 2> GAME_PROFILES{{
+    {"RSBE01", std::nullopt, "Super Smash Bros. Brawl (NTSC-U)", {}},
+    {"RSBJ01", std::nullopt, "Dairantou Smash Brothers X (NTSC-J)", {}},
+}};
+
+// Profile from the config file, replaces a GAME_PROFILES entry of the same
+// game id and revision or adds a game.
+struct ConfiguredGameProfile {
+  std::string game_id;
+  std::optional<std::uint8_t> revision;
+  GameAddresses addresses;
+};
+
+// The matching profile's addresses, configured profiles first, an exact
+// revision before "every revision". nullopt for an unknown game.
+[[nodiscard]] std::optional<GameAddresses>
+find_game_addresses(GameId const &game_id,
+                    std::vector<ConfiguredGameProfile> const &configured);
+
+struct SignatureConfig {
+  // resolved in order, a later signature of the same name wins
+  std::vector<Signature> signatures;
+  // [code_begin, code_end) console addresses, hashed into the cache key.
+  // Wii games load the main executable's code at 0x80004000.
+  std::uint32_t code_begin = 0x80004000;
+  std::uint32_t code_end = 0x80400000;
+  std::optional<std::filesystem::path> cache_path;
+};
+
+// nullopt when the header is not a game id(no game running).
+[[nodiscard]] std::optional<GameId> game_id_of(DiscHeader const &header);
+
+// The addresses a game trace was recorded at, nullopt without the music id
+// or the seed. frame_rate is not recorded and left at its default.
+[[nodiscard]] std::optional<GameAddresses>
+recorded_game_addresses(GameTrace const &trace);
+
+// The watch list of xtool record: the polled addresses, the disc header and
+// extra_addresses that are not one of them.
+[[nodiscard]] std::vector<WatchedAddress>
+game_trace_addresses(GameAddresses const &addresses,
+                     std::vector<WatchedAddress> const &extra_addresses);
+
+// Selects the game profile and resolves the signatures once per hooked
+// dolphin process. A hit in the signature cache costs one read of the code
+// region instead of a RAM cache refresh and a pattern search per signature.
+class GameAddressResolver {
+public:
+  // assume_first_profile: a disc header that can't be read means
+  // GAME_PROFILES.front(), for game traces recorded before the header was
+  // watched. Otherwise nothing is polled until the header can be read.
+  // recorded: the addresses of a replayed game trace(see
+  // recorded_game_addresses), they replace the profile's and no signature is
+  // resolved since the code is not in the trace. A recorded profile without
+  // a frame counter keeps the profile's.
+  GameAddressResolver(std::vector<ConfiguredGameProfile> profiles,
+                      SignatureConfig signature,
+                      bool const assume_first_profile = false,
+                      std::optional<GameAddresses> recorded = std::nullopt);
+
+  // Addresses for the hooked game, resolved on the first call after a hook.
+  // Signatures override the profile, unresolved ones keep the profile
+  // address. nullptr for an unknown game, its id is read again on the next
+  // call in case another game was started. The id of a known game is read
+  // again every GAME_ID_CHECK_INTERVAL, so a game started in the same dolphin
+  // gets its own profile.
+  [[nodiscard]] GameAddresses const *
+  addresses(DolphinComm::DolphinAccessor &dolphin);
+
+  // Resolve again on the next call, e.g. after the game memory became
+  // unreadable because the game was stopped.
+  void invalidate() noexcept;
+
+  static constexpr std::chrono::seconds GAME_ID_CHECK_INTERVAL{1};
+
+private:
+  void resolve(DolphinComm::DolphinAccessor &dolphin);
+  // replaces m_addresses with m_recorded's
+  void apply_recorded();
+  // nullopt when the header can't be read or holds no game id
+  [[nodiscard]] static std::optional<GameId>
+  read_game_id(DolphinComm::DolphinAccessor &dolphin, bool &readable);
+  void resolve_signatures(DolphinComm::DolphinAccessor &dolphin,
+                          GameId const &game_id);
+
+private:
+  std::vector<ConfiguredGameProfile> m_profiles;
+  SignatureConfig m_config;
+  // shared by the copies of the resolver(one per dolphin instance)
+  std::shared_ptr<SignatureCache> m_cache;
+  bool m_assume_first_profile = false;
+  std::optional<GameAddresses> m_recorded;
+  int m_pid = -1;
+  // the game m_addresses belongs to, and when its id was last read
+  std::optional<GameId> m_game_id;
+  std::chrono::steady_clock::time_point m_game_id_checked;
+  // last unknown("" = unreadable) game id, not warned about twice
+  std::optional<std::string> m_warned_game_id;
+  std::optional<GameAddresses> m_addresses;
+};
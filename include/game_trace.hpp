@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <vector>
+
+// Compact binary timeline of watched game memory.
+//
+// Layout(little endian):
+//   "XTRC", u16 version, u16 address count,
+//   address count * (u32 ram offset, u32 size, u8 TraceAddressKind),
+//   frames...
+// Every frame is
+//   varint time delta in us(steady clock) since the previous frame,
+//   varint bit mask of the changed addresses,
+//   one varint per changed address: value XOR previous value.
+// A frame is only written when a value changed.
+// Values are the raw(big endian) bytes as read with withBSwap=false, packed
+// as sum(byte[i] << 8i) so the file does not depend on the host.
+// Version 1 has no kinds, they are taken from the xtool::constants addresses
+// it always recorded.
+
+// What a watched address holds, so a replay polls the addresses the
+// recording polled.
+enum class TraceAddressKind : std::uint8_t {
+  // xtool record --watch
+  watched,
+  current_music_id,
+  g_mtrand_seed,
+  disc_header,
+  frame_counter,
+};
+
+struct WatchedAddress {
+  // same offset readFromRAM takes
+  std::uint32_t offset;
+  // 1 to 8 bytes
+  std::uint32_t size;
+  TraceAddressKind kind = TraceAddressKind::watched;
+
+  friend bool operator==(WatchedAddress const &,
+                         WatchedAddress const &) = default;
+};
+
+struct GameTraceFrame {
+  std::uint64_t time_us;
+  // one per watched address
+  std::vector<std::uint64_t> values;
+};
+
+struct GameTrace {
+  std::vector<WatchedAddress> addresses;
+  std::vector<GameTraceFrame> frames;
+};
+
+class GameTraceWriter {
+public:
+  GameTraceWriter(std::filesystem::path const &path,
+                  std::vector<WatchedAddress> addresses);
+
+  // Appends a frame if a value changed. time_us must not decrease.
+  void write(std::uint64_t const time_us,
+             std::vector<std::uint64_t> const &values);
+
+  [[nodiscard]] std::uint64_t written_frames() const noexcept;
+
+private:
+  std::ofstream m_file;
+  std::vector<WatchedAddress> m_addresses;
+  std::vector<std::uint64_t> m_previous_values;
+  std::uint64_t m_previous_time_us = 0;
+  std::uint64_t m_written_frames = 0;
+};
+
+[[nodiscard]] GameTrace load_game_trace(std::filesystem::path const &path);
+
+[[nodiscard]] bool is_game_trace_file(std::filesystem::path const &path);
+
+// Index of the first address of kind, nullopt if the trace has none.
+[[nodiscard]] std::optional<std::size_t>
+find_trace_address(GameTrace const &trace, TraceAddressKind const kind);
+
+[[nodiscard]] std::uint64_t pack_trace_value(char const *bytes,
+                                             std::uint32_t const size);
+
+void unpack_trace_value(std::uint64_t const value, char *bytes,
+                        std::uint32_t const size);
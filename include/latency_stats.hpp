@@ -0,0 +1,89 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// steady clock, ns. Safe to call from the audio thread.
+[[nodiscard]] std::int64_t steady_now_ns() noexcept;
+
+// HDR style histogram: values below 32 are exact, larger values fall into
+// 32 linear sub buckets per power of two(~3% relative error).
+// record() is lock free and never allocates.
+class LatencyHistogram {
+public:
+  void record(std::uint64_t const value) noexcept;
+
+  [[nodiscard]] std::uint64_t count() const noexcept;
+  [[nodiscard]] std::uint64_t min() const noexcept;
+  [[nodiscard]] std::uint64_t max() const noexcept;
+  [[nodiscard]] double mean() const noexcept;
+  // p in [0, 100], highest value equivalent to the bucket
+  [[nodiscard]] std::uint64_t percentile(double const p) const noexcept;
+
+  void reset() noexcept;
+
+  [[nodiscard]] static std::size_t bucket_index(std::uint64_t const value);
+  [[nodiscard]] static std::uint64_t
+  bucket_highest_value(std::size_t const index);
+
+  static constexpr unsigned SUB_BUCKET_BITS = 5;
+  static constexpr std::size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1)
+                                              << SUB_BUCKET_BITS;
+
+private:
+  std::array<std::atomic_uint64_t, BUCKET_COUNT> m_counts{};
+  std::atomic_uint64_t m_count = 0;
+  std::atomic_uint64_t m_sum = 0;
+  std::atomic_uint64_t m_min = UINT64_MAX;
+  std::atomic_uint64_t m_max = 0;
+};
+
+// Stages of a music switch. The game write itself is not observable, the
+// memory sample happens up to one reader interval after it.
+enum class SwitchStage : std::uint8_t {
+  // reader loop sampled the new id -> player loop noticed it
+  detection,
+  // -> playlist selection done
+  selection,
+  // -> previous music stopped and ma_decoder_init_file done
+  decoder_init,
+  // -> ma_device_init / ma_device_start done
+  device_start,
+  // -> first data_callback of the new music
+  first_callback,
+  // player loop noticed the new id -> ma_device_start done, the part
+  // xtool controls
+  detection_to_device_start,
+  // memory sample -> first data_callback
+  total,
+  count_
+};
+
+[[nodiscard]] std::string_view switch_stage_name(SwitchStage const stage);
+
+struct SwitchTimestamps {
+  std::int64_t sampled_ns = 0;
+  std::int64_t detected_ns = 0;
+  std::int64_t selected_ns = 0;
+  std::int64_t decoder_ready_ns = 0;
+  std::int64_t device_started_ns = 0;
+  std::int64_t first_callback_ns = 0;
+};
+
+class SwitchLatencyStats {
+public:
+  // every timestamp must be set
+  void record(SwitchTimestamps const &t) noexcept;
+
+  [[nodiscard]] LatencyHistogram const &
+  histogram(SwitchStage const stage) const;
+
+  // one line per stage, in ms
+  void log() const;
+
+private:
+  std::array<LatencyHistogram, static_cast<std::size_t>(SwitchStage::count_)>
+      m_histograms;
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <spdlog/async_logger.h>
+#include <string_view>
+
+// Console logger setup.
+// By default log lines are formatted on the calling thread and handed to a
+// background thread through a bounded queue preallocated at startup, so
+// console I/O never runs on the reader, player or selection paths.
+struct LoggerConfig {
+  // synchronous logger, like before(for comparison)
+  bool synchronous = false;
+  std::size_t queue_size = 8192;
+  // what a full queue does to a new log line
+  spdlog::async_overflow_policy overflow_policy =
+      spdlog::async_overflow_policy::overrun_oldest;
+};
+
+// "block" or "overrun-oldest"
+[[nodiscard]] std::optional<spdlog::async_overflow_policy>
+parse_log_overflow_policy(std::string_view const name);
+
+// Creates xtool-logger and makes it the default logger.
+void setup_logger(LoggerConfig const &config);
+
+// Flushes the queue and joins the logging thread on destruction.
+class LoggerShutdownGuard {
+public:
+  LoggerShutdownGuard() = default;
+  ~LoggerShutdownGuard();
+  LoggerShutdownGuard(LoggerShutdownGuard const &) = delete;
+  LoggerShutdownGuard &operator=(LoggerShutdownGuard const &) = delete;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <snapshot_diff.hpp>
+#include <vector>
+
+// xtool diff: narrows the whole MEM1(+MEM2) down to the addresses that
+// follow a sequence of changed / unchanged / increased / decreased steps,
+// e.g. to find CURRENT_MUSIC_ID_ADDRESS in another game revision.
+struct MemoryDiffConfig {
+  // element size in bytes, 1, 2 or 4
+  std::uint32_t width = 1;
+  // one snapshot every interval_ms per predicate, empty = interactive(stdin
+  // commands)
+  std::vector<DiffPredicate> predicates;
+  std::uint32_t interval_ms = 1000;
+  // "<console address> <size>" lines of the final ranges
+  std::optional<std::filesystem::path> out_path;
+  // ranges logged after every step
+  std::size_t print_limit = 20;
+};
+
+void memory_diff(MemoryDiffConfig const &config);
+
+// "<console address> <size>" per range, ranges are RAM cache indices.
+void write_diff_ranges(std::ostream &os, DiffRanges const &ranges,
+                       bool const aram);
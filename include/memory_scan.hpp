@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+#include <value_scanner.hpp>
+
+// xtool scan: dolphin-memory-engine style first scan / next scan over the
+// whole MEM1(+MEM2), commands are read from stdin.
+struct MemoryScanConfig {
+  ScanOptions options;
+  // results logged after every scan
+  std::size_t print_limit = 20;
+};
+
+void memory_scan(MemoryScanConfig const &config);
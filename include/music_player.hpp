@@ -1,15 +1,50 @@
 #pragma once
 
+#include <atomic>
+#include <audio_cache.hpp>
+#include <audio_metrics.hpp>
+#include <cstdint>
+#include <memory>
 #include <miniaudio.h>
 
 #include <playlist.hpp>
 
+enum class PlayResult : std::uint8_t {
+  ok,
+  // the music itself can not be decoded, selecting it again fails again
+  source_error,
+  // the audio device or the music's ranges, the music may play on a retry
+  device_error,
+};
+
 class MusicPlayer {
 public:
+  // steady_now_ns() values of the last play() call, 0 = not reached
+  struct PlayTimestamps {
+    std::int64_t decoder_ready_ns = 0;
+    std::int64_t device_started_ns = 0;
+  };
+
+  // shared with data_callback on the audio thread
+  struct CallbackState {
+    // the decoder or the cached PCM
+    ma_data_source *source = nullptr;
+    std::atomic_int64_t first_callback_ns = 0;
+    AudioCallbackMetrics metrics;
+  };
+
   // MusicPlayer() = delete;
-  MusicPlayer();
+  // Plays musics found in audio_cache from memory, others are streamed from
+  // the file. nullptr always streams.
+  explicit MusicPlayer(DecodedAudioCache *audio_cache = nullptr);
   ~MusicPlayer();
-  [[nodiscard]] bool play(MusicEntry const &music_entry);
+  [[nodiscard]] PlayResult play(MusicEntry const &music_entry);
+
+  [[nodiscard]] PlayTimestamps const &last_play_timestamps() const noexcept;
+  // 0 until the audio thread pulled the first frames of the current music
+  [[nodiscard]] std::int64_t first_callback_ns() const noexcept;
+  // over every music played so far
+  [[nodiscard]] AudioCallbackMetrics const &callback_metrics() const noexcept;
 
 private:
   [[nodiscard]] bool stop();
@@ -17,5 +52,11 @@ private:
 private:
   ma_device m_ma_device;
   ma_decoder m_ma_decoder;
+  ma_audio_buffer_ref m_ma_audio_buffer;
+  DecodedAudioCache *m_audio_cache = nullptr;
+  // what m_ma_audio_buffer plays, nullptr when streaming
+  std::shared_ptr<DecodedAudio const> m_decoded_audio;
+  CallbackState m_callback_state;
+  PlayTimestamps m_play_timestamps;
   bool m_is_playing = false;
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Recursive, multithreaded directory scanner for folder based playlists.
+// Directory listings are cached in a file keyed by directory mtime, so a
+// directory whose mtime did not change is not listed again on the next
+// startup (only stat'ed).
+class MusicScanner {
+public:
+  struct DirListing {
+    std::int64_t mtime = 0;
+    std::vector<std::string> files;
+    std::vector<std::string> subdirs;
+  };
+
+  struct Stats {
+    std::size_t listed_dirs = 0;
+    std::size_t cached_dirs = 0;
+  };
+
+  explicit MusicScanner(std::filesystem::path cache_file_path);
+
+  // All regular files under root(recursive, no symlinks), sorted. With
+  // max_depth only directories at most max_depth levels below root(root = 0)
+  // are listed.
+  [[nodiscard]] std::vector<std::filesystem::path>
+  scan(std::filesystem::path const &root,
+       std::optional<std::size_t> const max_depth = std::nullopt);
+
+  // A directory(audio files under it), a regular file, or a glob pattern
+  // like "musics/**/*.flac". "*" and "?" match inside one path component,
+  // "**" matches any number of components. Results are sorted.
+  [[nodiscard]] std::vector<std::filesystem::path>
+  expand(std::string const &source);
+
+  // Writes the cache file if something changed.
+  void save() const;
+
+  [[nodiscard]] Stats const &stats() const noexcept;
+
+private:
+  void load();
+
+private:
+  std::filesystem::path m_cache_file_path;
+  // generic directory path -> listing
+  std::unordered_map<std::string, DirListing> m_listings;
+  bool m_dirty = false;
+  Stats m_stats;
+};
+
+// Audio formats miniaudio decodes out of the box.
+[[nodiscard]] bool is_audio_file_path(std::filesystem::path const &path);
+
+[[nodiscard]] bool glob_match(std::string_view const pattern,
+                              std::string_view const path);
+
+// Stable id for a music found by a folder scan.
+// FNV-1a 64 of the generic path with the top bit set, so it does not collide
+// with hand written ids in musics.musics.
+[[nodiscard]] std::uint64_t
+stable_music_id_for_path(std::filesystem::path const &path);
@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Validates music files off the startup path.
+// A low priority background thread walks every music once, and a music
+// that is selected before the thread reached it is checked just in time.
+// Invalid musics are quarantined, they are never selected again.
+class MusicValidator {
+public:
+  enum class State : std::uint8_t { unchecked, valid, quarantined };
+
+  explicit MusicValidator(
+      std::vector<std::pair<std::uint64_t, std::filesystem::path>> const
+          &musics);
+
+  MusicValidator(MusicValidator const &) = delete;
+  MusicValidator &operator=(MusicValidator const &) = delete;
+
+  void start_background_validation();
+
+  // Validates now if the background thread did not reach it yet.
+  // Unknown ids are reported as not usable.
+  [[nodiscard]] bool ensure_valid(std::uint64_t const unique_music_id);
+
+  // e.g. the decoder failed to open it
+  void quarantine(std::uint64_t const unique_music_id);
+  // checked by the caller, e.g. while loading the playlist
+  void mark_valid(std::uint64_t const unique_music_id);
+
+  [[nodiscard]] State state(std::uint64_t const unique_music_id) const;
+
+  [[nodiscard]] std::size_t checked_count() const noexcept;
+  [[nodiscard]] std::size_t quarantined_count() const noexcept;
+  [[nodiscard]] std::size_t size() const noexcept;
+
+private:
+  struct Item {
+    std::uint64_t unique_music_id = 0;
+    std::filesystem::path path;
+    std::atomic<State> state = State::unchecked;
+  };
+
+  bool validate(Item &item);
+
+private:
+  // fixed after construction, so lookups need no lock
+  std::vector<Item> m_items;
+  std::unordered_map<std::uint64_t, std::size_t> m_index;
+
+  std::atomic_size_t m_checked_count = 0;
+  std::atomic_size_t m_quarantined_count = 0;
+  // declared last, stopped and joined before m_items is destroyed
+  std::jthread m_thread;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <seed_selector.hpp>
+#include <utility>
+#include <vector>
+
+// Netplay desync simulation.
+// Replays a g_mtRand.seed timeline to N virtual clients which run the same
+// reader loop / player loop as xtool_play_music_main, each with its own poll
+// phase, sleep jitter and emulation offset, and counts how often they pick
+// different musics for the same music change.
+struct NetplaySimConfig {
+  std::size_t clients = 2;
+  std::uint32_t trials = 10000;
+  // reader loop (memory poll) interval
+  double reader_interval_ms = 200.0;
+  // nullopt: the player is woken by the reader publishing a change, like
+  // xtool now. A value models older clients whose player loop polled the
+  // published music id at this interval.
+  std::optional<double> player_interval_ms;
+  // every sleep overshoots by uniform [0, poll_jitter_ms)
+  double poll_jitter_ms = 2.0;
+  // every client's emulation lags by uniform [0, emu_offset_ms)
+  double emu_offset_ms = 0.0;
+  // synthetic timeline: mean time between seed updates(exponential)
+  double seed_interval_ms = 100.0;
+  // recorded timeline: "<time ms> <seed>" lines or a game trace(xtool
+  // record), used instead of synthetic
+  std::optional<std::filesystem::path> timeline_path;
+  std::size_t playlist_size = 10;
+  SeedSelectorVersion selector_version = SeedSelectorVersion::v2;
+  std::uint64_t sim_seed = 0;
+};
+
+struct NetplaySimResult {
+  std::uint32_t trials = 0;
+  // at least one client used a different seed / picked a different music
+  std::uint32_t seed_mismatches = 0;
+  std::uint32_t pick_mismatches = 0;
+  // music change in game -> player loop detection, over every client
+  double mean_detection_latency_ms = 0.0;
+  double max_detection_latency_ms = 0.0;
+};
+
+// (time ms, seed) sorted by time
+using SeedTimeline = std::vector<std::pair<double, std::uint32_t>>;
+
+// Text timeline or game trace, detected by the file magic.
+[[nodiscard]] SeedTimeline
+load_seed_timeline(std::filesystem::path const &path);
+
+[[nodiscard]] SeedTimeline
+load_seed_timeline_from_game_trace(std::filesystem::path const &path);
+
+[[nodiscard]] NetplaySimResult simulate_netplay(NetplaySimConfig const &config);
+
+// Runs simulate_netplay for every reader interval and logs a table.
+void netplay_sim(NetplaySimConfig const &config,
+                 std::vector<double> const &reader_intervals_ms);
@@ -1,12 +1,16 @@
 #pragma once
+#include <alias_table.hpp>
 #include <cstdint>
+#include <deque>
 #include <filesystem>
 #include <fmt/core.h>
 #include <fmt/format.h>
 #include <fmt/std.h> // std::optional formatter
 #include <iostream>
 #include <memory>
+#include <music_validator.hpp>
 #include <random>
+#include <seed_selector.hpp>
 #include <spdlog/spdlog.h>
 #include <syncstream>
 #include <toml++/toml.hpp>
@@ -36,23 +40,70 @@ template <> struct fmt::formatter<MusicEntry> : formatter<fmt::string_view> {
               format_context &ctx) const -> format_context::iterator;
 };
 
+// The last musics picked from a playlist entry, oldest first.
+struct MusicHistory {
+  std::size_t capacity = 0;
+  std::deque<UniqueMusicID> ids;
+  std::unordered_map<UniqueMusicID, std::size_t> counts;
+
+  [[nodiscard]] bool contains(UniqueMusicID const id) const noexcept;
+  void push(UniqueMusicID const id);
+};
+
 struct PlaylistEntry {
   std::string name;
   std::vector<BrawlMusicID> target_music_ids;
   std::vector<UniqueMusicID> music_entries;
+  // Optional per music weights, same length as music_entries.
+  std::vector<double> weights;
+  // Built from weights on load, empty if no weights.
+  AliasTable alias_table;
+  // "Don't repeat the last K musics", capacity 0 = disabled.
+  MusicHistory history;
+};
+
+// Throws if the music file can not be used.
+void validate_music_file_path(std::filesystem::path const &music_file_path);
+
+// Picks an index into playlist_entry.music_entries.
+// Plain playlists use seed_rand with the given selector version.
+// Weighted / no repeat playlists always draw from SeedSequenceV2{seed}, so
+// clients stay in sync as long as they share the same history.
+[[nodiscard]] std::size_t
+select_music_index(PlaylistEntry const &playlist_entry,
+                   std::uint32_t const seed, SeedSelectorVersion const version);
+
+enum class PlaylistValidation {
+  // check every music file while loading the config
+  eager,
+  // check music files on a background thread / just in time when selected
+  lazy,
 };
 
 struct Playlist {
 public:
-  Playlist(std::filesystem::path const &playlist_config_toml_file_path);
+  Playlist(std::filesystem::path const &playlist_config_toml_file_path,
+           PlaylistValidation const validation);
+
+  // No-op for PlaylistValidation::eager, every music is checked already.
+  void start_background_validation();
 
+  // Copy for another dolphin instance. The playlist entries and their no
+  // repeat history are its own, the lazy validator(and its quarantine) is
+  // shared, so the music files are only checked once.
+  [[nodiscard]] Playlist fork() const;
+
+  // Never select the music again, e.g. the decoder failed to open it.
+  void quarantine(UniqueMusicID const unique_music_id);
+
+  // Not const, picked musics are recorded to the playlist entry history.
   [[nodiscard]] std::optional<MusicEntry>
   random_music_for_with_g_mtRand_seed(BrawlMusicID const brawl_music_id,
-                                      std::uint32_t const seed) const;
+                                      std::uint32_t const seed,
+                                      SeedSelectorVersion const version);
 
   [[nodiscard]] std::optional<MusicEntry>
-  random_music_for_with_std_random_device(
-      BrawlMusicID const brawl_music_id) const;
+  random_music_for_with_std_random_device(BrawlMusicID const brawl_music_id);
 
 public:
   [[nodiscard]] std::unordered_map<UniqueMusicID, MusicEntry> const &
@@ -65,6 +116,15 @@ public:
   [[nodiscard]] std::vector<std::shared_ptr<PlaylistEntry>> const &
   playlist_entries() const noexcept;
 
+private:
+  Playlist() = default;
+
+  // Returns index if usable, otherwise the next usable index after it
+  // (wrapping), or std::nullopt if no music of the entry is usable.
+  [[nodiscard]] std::optional<std::size_t>
+  usable_music_index(PlaylistEntry const &playlist_entry,
+                     std::size_t const index) const;
+
 private:
   // unique music id to music entry
   std::unordered_map<UniqueMusicID, MusicEntry> m_music_map;
@@ -72,7 +132,8 @@ private:
   std::vector<std::shared_ptr<PlaylistEntry>> m_playlist_entries;
   std::unordered_map<BrawlMusicID, std::shared_ptr<PlaylistEntry>>
       m_brawl_music_id_to_playlist_entry_map;
-};
 
-std::size_t seed_rand(std::size_t const l, std::size_t const r,
-                      std::uint32_t const additional_seed);
\ No newline at end of file
+  // which musics are usable, checked while loading for
+  // PlaylistValidation::eager, shared with fork()s
+  std::shared_ptr<MusicValidator> m_validator;
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <game_addresses.hpp>
+#include <game_trace.hpp>
+#include <string_view>
+#include <vector>
+
+// "<console address>:<size>", e.g. "0x805a00bc:4".
+// Addresses below 0x80000000 are taken as ram offsets.
+[[nodiscard]] WatchedAddress parse_watched_address(std::string_view const arg);
+
+// Polls the addresses resolver picks for the game(music id, g_mtRand.seed
+// and the frame counter), the game id and extra_addresses every interval_ms
+// and writes them to a game trace until duration_s(0 = until killed). The
+// trace starts once a known game runs and ends when another game with other
+// addresses is started. Throws std::invalid_argument for interval_ms 0.
+void record_game_trace(std::filesystem::path const &out_path,
+                       GameAddressResolver resolver,
+                       std::vector<WatchedAddress> const &extra_addresses,
+                       std::uint32_t const interval_ms,
+                       std::uint32_t const duration_s);
@@ -0,0 +1,86 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// Versioned "seed -> index" selectors.
+// Every client in a netplay session must use the same version, otherwise they
+// pick different musics for the same g_mtRand.seed.
+enum class SeedSelectorVersion : std::uint8_t {
+  // std::mt19937 + std::uniform_int_distribution.
+  // The range reduction of std::uniform_int_distribution is implementation
+  // defined, so libstdc++ and MSVC STL may disagree.
+  v1 = 1,
+  // SeedSequenceV2 + exactly specified range reduction.
+  // Same result on every compiler / standard library.
+  v2 = 2,
+};
+
+[[nodiscard]] std::optional<SeedSelectorVersion>
+parse_seed_selector_version(std::string_view const s) noexcept;
+
+[[nodiscard]] std::string_view
+seed_selector_version_name(SeedSelectorVersion const version) noexcept;
+
+// Counter based PRNG used by SeedSelectorVersion::v2.
+// n-th output = high 32 bits of splitmix64 finalizer((seed << 32) | n).
+// No state besides the counter, so creating one per call is free.
+struct SeedSequenceV2 {
+  std::uint32_t seed;
+  std::uint32_t counter = 0;
+
+  [[nodiscard]] static constexpr std::uint64_t
+  mix64(std::uint64_t z) noexcept {
+    z += 0x9e3779b97f4a7c15;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  [[nodiscard]] constexpr std::uint32_t next() noexcept {
+    auto const x =
+        mix64((static_cast<std::uint64_t>(seed) << 32) | counter++);
+    return static_cast<std::uint32_t>(x >> 32);
+  }
+
+  // Uniform integer in [0, n), n in [1, 2^32].
+  // Lemire's multiply-shift with rejection, only uses 32/64 bit unsigned
+  // arithmetic so the result is fully specified.
+  [[nodiscard]] constexpr std::uint32_t
+  bounded(std::uint64_t const n) noexcept {
+    assert(n >= 1 && n <= (std::uint64_t{1} << 32));
+    if (n == (std::uint64_t{1} << 32)) {
+      return next();
+    }
+    auto const n32 = static_cast<std::uint32_t>(n);
+    std::uint64_t m = std::uint64_t{next()} * n32;
+    auto low = static_cast<std::uint32_t>(m);
+    if (low < n32) {
+      std::uint32_t const threshold = (0u - n32) % n32;
+      while (low < threshold) {
+        m = std::uint64_t{next()} * n32;
+        low = static_cast<std::uint32_t>(m);
+      }
+    }
+    return static_cast<std::uint32_t>(m >> 32);
+  }
+};
+
+// Returns a value in [l, r] (r - l < 2^32).
+[[nodiscard]] constexpr std::size_t
+seed_rand_v2(std::size_t const l, std::size_t const r,
+             std::uint32_t const seed) noexcept {
+  assert(l <= r);
+  SeedSequenceV2 seq{seed};
+  return l + seq.bounded(static_cast<std::uint64_t>(r - l) + 1);
+}
+
+// SeedSelectorVersion::v1, kept as is for old clients.
+std::size_t seed_rand(std::size_t const l, std::size_t const r,
+                      std::uint32_t const additional_seed);
+
+std::size_t seed_rand(std::size_t const l, std::size_t const r,
+                      std::uint32_t const seed,
+                      SeedSelectorVersion const version);
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Finds addresses by signature, byte patterns of the code around an access
+// or of the data itself, so other game revisions and mods that move
+// CURRENT_MUSIC_ID_ADDRESS / G_MTRAND_SEED_ADDRESS still work.
+
+struct BytePattern {
+  std::vector<std::uint8_t> bytes;
+  // 0xff = must match, 0x00 = wildcard
+  std::vector<std::uint8_t> mask;
+};
+
+// Hex bytes separated by spaces, "??" or "?" matches any byte, e.g.
+// "3c 60 ?? ?? 80 63 ?? ?? 2c 03 00 00". Throws std::invalid_argument.
+[[nodiscard]] BytePattern parse_byte_pattern(std::string_view const text);
+
+// Offsets of the first limit matches in memory, ascending.
+[[nodiscard]] std::vector<std::size_t>
+find_pattern(std::span<char const> const memory, BytePattern const &pattern,
+             std::size_t const limit);
+
+enum class SignatureTarget : std::uint8_t {
+  // the matched bytes are the data, address = match + offset + addend
+  match,
+  // lis rX, hi at match + offset and a D-form instruction using lo(rX) at
+  // match + lo_offset, address = (hi << 16) + lo + addend
+  hi_lo,
+};
+
+struct Signature {
+  // what the signature resolves, e.g. "g_mtrand_seed"
+  std::string name;
+  BytePattern pattern;
+  SignatureTarget target = SignatureTarget::match;
+  std::int32_t offset = 0;
+  std::int32_t lo_offset = 4;
+  std::int32_t addend = 0;
+};
+
+// "match" or "hi_lo"
+[[nodiscard]] std::optional<SignatureTarget>
+parse_signature_target(std::string_view const name);
+
+// Console address of signature in a RAM cache(DolphinAccessor::getRAMCache).
+// nullopt when the pattern is not found exactly once or the instructions
+// don't decode.
+[[nodiscard]] std::optional<std::uint32_t>
+resolve_signature(std::span<char const> const ram, bool const aram,
+                  Signature const &signature);
+
+// FNV-1a 64.
+[[nodiscard]] std::uint64_t hash_memory(std::span<char const> const memory);
+
+// FNV-1a 64 of everything that decides where signature resolves(pattern,
+// target, offsets, addend), so an edited signature is not served an address
+// cached for the old one.
+[[nodiscard]] std::uint64_t hash_signature(Signature const &signature);
+
+// Resolved console addresses per game id and hash of the code region, so a
+// later hook of the same game skips the scan. Thread safe, one cache is
+// shared by the dolphin instances of xtool so they don't overwrite each
+// other's entries.
+class SignatureCache {
+public:
+  explicit SignatureCache(std::filesystem::path cache_file_path);
+  SignatureCache(SignatureCache const &) = delete;
+  SignatureCache &operator=(SignatureCache const &) = delete;
+
+  // nullopt when not cached or cached for another definition of signature
+  [[nodiscard]] std::optional<std::uint32_t>
+  find(std::string_view const game_id, std::uint64_t const code_hash,
+       Signature const &signature) const;
+  void store(std::string_view const game_id, std::uint64_t const code_hash,
+             Signature const &signature, std::uint32_t const address);
+
+  // Writes the cache file if something changed since the last save.
+  void save();
+
+private:
+  void load();
+
+private:
+  struct Entry {
+    std::uint32_t address = 0;
+    // hash_signature of the definition that resolved address
+    std::uint64_t signature_hash = 0;
+  };
+
+  std::filesystem::path m_cache_file_path;
+  mutable std::mutex m_mutex;
+  // "<game id> <hash>" -> name -> entry
+  std::map<std::string, std::map<std::string, Entry>, std::less<>> m_entries;
+  bool m_dirty = false;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Compares two RAM snapshots(DolphinAccessor RAM cache copies) and lists the
+// ranges where a predicate holds, e.g. to find the address of a value that
+// changes when the music changes.
+//
+// Snapshots are compared in elements of 1, 2 or 4 bytes. Elements start at
+// multiples of the width and are read as big endian unsigned integers like
+// the console stores them. Equality is computed with SIMD compares, the
+// increased / decreased order is only evaluated for changed elements.
+
+enum class DiffPredicate : std::uint8_t {
+  changed,
+  unchanged,
+  increased,
+  decreased,
+};
+
+enum class DiffBackend : std::uint8_t {
+  scalar,
+  sse2,
+  avx2,
+  neon,
+};
+
+// offset and size in snapshot bytes(RAM cache indices)
+struct DiffRange {
+  std::uint32_t offset;
+  std::uint32_t size;
+};
+
+using DiffRanges = std::vector<DiffRange>;
+
+// "changed", "unchanged", "increased" or "decreased"
+[[nodiscard]] std::optional<DiffPredicate>
+parse_diff_predicate(std::string_view const name);
+
+[[nodiscard]] std::string_view diff_predicate_name(DiffPredicate const p);
+
+[[nodiscard]] std::string_view diff_backend_name(DiffBackend const backend);
+
+// Fastest backend the CPU supports.
+[[nodiscard]] DiffBackend best_diff_backend();
+
+[[nodiscard]] bool is_diff_backend_supported(DiffBackend const backend);
+
+// Ranges of [0, before.size()) where predicate holds between before and
+// after. before and after must have the same size.
+[[nodiscard]] DiffRanges diff_snapshots(std::span<char const> const before,
+                                        std::span<char const> const after,
+                                        DiffPredicate const predicate,
+                                        std::uint32_t const width,
+                                        DiffBackend const backend);
+
+// Same, restricted to candidates(e.g. the result of the previous diff).
+// Ranges never extend over a candidate boundary, candidates not aligned to
+// width are shrunk to whole elements.
+[[nodiscard]] DiffRanges diff_snapshots(std::span<char const> const before,
+                                        std::span<char const> const after,
+                                        DiffPredicate const predicate,
+                                        std::uint32_t const width,
+                                        DiffBackend const backend,
+                                        DiffRanges const &candidates);
+
+// Bit i set when element i of 64 contiguous elements of width(1, 2 or 4)
+// bytes differs between a and b, both 64 * width bytes. Building block for
+// other scanners over the RAM cache.
+[[nodiscard]] std::uint64_t diff_elements64(char const *a, char const *b,
+                                            std::uint32_t const width,
+                                            DiffBackend const backend);
+
+// sum of the range sizes
+[[nodiscard]] std::size_t diff_ranges_bytes(DiffRanges const &ranges);
@@ -1,4 +1,18 @@
 #pragma once
 #include <cstdint>
+#include <optional>
+#include <seed_selector.hpp>
+#include <string>
+#include <vector>
 void test_seed(std::uint32_t const dist_l, std::uint32_t const dist_r,
-               std::uint32_t const try_count);
\ No newline at end of file
+               std::uint32_t const try_count,
+               SeedSelectorVersion const selector_version);
+
+// Offline: evaluates seed_rand over every 2^32 seed(full) or a stratified
+// sample of the seed space on all cores, no dolphin needed.
+// Sizes are the playlist sizes found in config plus extra_sizes.
+void analyze_seed_distribution(std::optional<std::string> const &config_path,
+                               std::vector<std::size_t> const &extra_sizes,
+                               bool const full, std::uint64_t const samples,
+                               std::size_t const print_bucket_limit,
+                               SeedSelectorVersion const selector_version);
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <latency_stats.hpp>
+
+// Chrome trace event recorder, the output opens in ui.perfetto.dev and
+// chrome://tracing.
+// Events go to a preallocated ring buffer(the oldest are overwritten), so
+// recording never allocates or locks and is safe on the audio thread.
+// While disabled a span costs one relaxed atomic load.
+namespace xtool::trace {
+namespace detail {
+inline std::atomic_bool enabled(false);
+}
+
+[[nodiscard]] inline bool is_enabled() noexcept {
+  return detail::enabled.load(std::memory_order_relaxed);
+}
+
+// capacity is rounded up to a power of two. Call once, before the threads
+// that record start.
+void enable(std::size_t const capacity);
+
+// names must be string literals(only the pointer is stored)
+void record_complete(char const *name, std::int64_t const begin_ns,
+                     std::int64_t const end_ns) noexcept;
+void record_counter(char const *name, double const value) noexcept;
+void set_thread_name(char const *name) noexcept;
+
+// Events recorded while it copies the ring buffer may be left out.
+void write_json(std::filesystem::path const &path);
+
+class ScopedSpan {
+public:
+  explicit ScopedSpan(char const *name) noexcept
+      : m_name(name), m_begin_ns(is_enabled() ? steady_now_ns() : 0) {}
+  ~ScopedSpan() {
+    if (m_begin_ns != 0) {
+      record_complete(m_name, m_begin_ns, steady_now_ns());
+    }
+  }
+  ScopedSpan(ScopedSpan const &) = delete;
+  ScopedSpan &operator=(ScopedSpan const &) = delete;
+
+private:
+  char const *m_name;
+  std::int64_t m_begin_ns;
+};
+} // namespace xtool::trace
+
+#define XTOOL_TRACE_CONCAT_IMPL(a, b) a##b
+#define XTOOL_TRACE_CONCAT(a, b) XTOOL_TRACE_CONCAT_IMPL(a, b)
+// span from here to the end of the enclosing scope
+#define XTOOL_TRACE_SCOPE(name)                                                \
+  ::xtool::trace::ScopedSpan XTOOL_TRACE_CONCAT(xtool_trace_span_,             \
+                                                __LINE__)(name)
+#define XTOOL_TRACE_COUNTER(name, value)                                       \
+  do {                                                                         \
+    if (::xtool::trace::is_enabled()) {                                        \
+      ::xtool::trace::record_counter(name, static_cast<double>(value));        \
+    }                                                                          \
+  } while (0)
@@ -0,0 +1,158 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <dme/Common/MemoryCommon.h>
+#include <memory>
+#include <optional>
+#include <snapshot_diff.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// First scan / next scan value search over the RAM cache, like the scanner
+// of dolphin-memory-engine.
+//
+// A scan position is a RAM cache index at a multiple of the type alignment
+// (getNbrBytesAlignementForType) or of 1 for unaligned scans. Values are
+// read big endian like the console stores them.
+
+enum class ScanFilter : std::uint8_t {
+  // keep every position, e.g. the first scan of a value we can't see
+  unknown,
+  exact,
+  // min <= value <= max, numeric types only
+  range,
+  // compared with the value at the previous scan
+  changed,
+  unchanged,
+  increased,
+  decreased,
+};
+
+[[nodiscard]] std::optional<ScanFilter>
+parse_scan_filter(std::string_view const name);
+
+[[nodiscard]] std::string_view scan_filter_name(ScanFilter const filter);
+
+// byte, halfword, word, float, double, string, bytearray
+[[nodiscard]] std::optional<Common::MemType>
+parse_mem_type(std::string_view const name);
+
+// Scan positions that survived, Roaring bitmap style. The positions are
+// split in chunks of 65536 and every chunk is stored as nothing, "every
+// position", a sorted array(sparse) or a bitmap(dense), so 88 MB of
+// candidates after an unknown first scan take a few bytes and a late scan
+// with a handful of results only touches those.
+class CandidateSet {
+public:
+  static constexpr std::uint32_t CHUNK_POSITIONS = 65536;
+  static constexpr std::uint32_t CHUNK_WORDS = CHUNK_POSITIONS / 64;
+  // an array chunk never takes more memory than a bitmap
+  static constexpr std::uint32_t ARRAY_MAX = 4096;
+
+  struct Chunk {
+    enum class Kind : std::uint8_t { empty, full, array, bitmap };
+    Kind kind = Kind::empty;
+    std::uint32_t count = 0;
+    // sorted positions relative to the chunk start
+    std::vector<std::uint16_t> array;
+    // CHUNK_WORDS words, bit i of word w = position 64w + i
+    std::vector<std::uint64_t> bitmap;
+
+    // smallest representation of the matches in bitmap, size is the number
+    // of positions of the chunk(less than CHUNK_POSITIONS for the last one)
+    [[nodiscard]] static Chunk from_bitmap(std::vector<std::uint64_t> bitmap,
+                                           std::uint32_t const size);
+  };
+
+  CandidateSet() = default;
+
+  // every position in [0, positions)
+  [[nodiscard]] static CandidateSet all(std::uint32_t const positions);
+
+  [[nodiscard]] std::uint32_t positions() const noexcept;
+  [[nodiscard]] std::size_t count() const noexcept;
+  [[nodiscard]] std::size_t memory_bytes() const noexcept;
+  [[nodiscard]] bool contains(std::uint32_t const position) const;
+
+  // first limit positions in ascending order
+  [[nodiscard]] std::vector<std::uint32_t>
+  first(std::size_t const limit) const;
+
+  [[nodiscard]] std::vector<Chunk> const &chunks() const noexcept;
+  [[nodiscard]] std::vector<Chunk> &chunks() noexcept;
+
+  // positions in chunk index
+  [[nodiscard]] std::uint32_t
+  chunk_size(std::size_t const index) const noexcept;
+
+private:
+  std::uint32_t m_positions = 0;
+  std::vector<Chunk> m_chunks;
+};
+
+struct ScanOptions {
+  Common::MemType type = Common::MemType::type_word;
+  // string / byteArray size in bytes
+  std::size_t length = 1;
+  // integer ranges and increased / decreased
+  bool is_unsigned = true;
+  // positions at multiples of the type alignment, otherwise every byte
+  bool aligned = true;
+  // exact / range input format
+  Common::MemBase base = Common::MemBase::base_decimal;
+  // 0 = hardware threads
+  unsigned threads = 0;
+  DiffBackend backend = best_diff_backend();
+};
+
+struct ScanStats {
+  std::size_t candidates = 0;
+  std::size_t memory_bytes = 0;
+  std::uint64_t nanoseconds = 0;
+  unsigned threads = 0;
+};
+
+class ValueScanner {
+public:
+  explicit ValueScanner(ScanOptions const &options);
+
+  // First scan over the whole snapshot(every position is a candidate), or a
+  // next scan over the surviving candidates. value / max_value are parsed
+  // with formatStringToMemory for exact and range. Throws
+  // std::invalid_argument for a bad value or a filter that needs a previous
+  // scan / a numeric type.
+  ScanStats scan(std::span<char const> const ram, ScanFilter const filter,
+                 std::string_view const value = {},
+                 std::string_view const max_value = {});
+
+  // back to before the first scan, the previous values buffer is kept for
+  // the next first scan
+  void reset();
+
+  [[nodiscard]] bool has_scanned() const noexcept;
+  [[nodiscard]] ScanOptions const &options() const noexcept;
+  [[nodiscard]] CandidateSet const &candidates() const noexcept;
+  // size in bytes of one value
+  [[nodiscard]] std::size_t value_size() const noexcept;
+
+  // RAM cache indices of the first limit candidates
+  [[nodiscard]] std::vector<std::uint32_t>
+  results(std::size_t const limit) const;
+
+  // value at the previous scan, formatted like formatMemoryToString, empty
+  // when cache_index is not a candidate
+  [[nodiscard]] std::string
+  previous_value(std::uint32_t const cache_index) const;
+
+private:
+  ScanOptions m_options;
+  std::size_t m_size;
+  std::uint32_t m_stride;
+  bool m_scanned = false;
+  CandidateSet m_candidates;
+  // ram at the previous scan, only up to date around the candidates
+  std::unique_ptr<char[]> m_previous;
+  std::size_t m_previous_size = 0;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads running submitted tasks in order. Shared by the
+// dolphin instances of xtool so that background work(e.g. decoding music
+// files) does not start threads per instance.
+class WorkerPool {
+public:
+  using Task = std::function<void()>;
+
+  // 0 = hardware threads
+  explicit WorkerPool(unsigned const threads);
+  // Running tasks finish, queued ones are dropped.
+  ~WorkerPool();
+  WorkerPool(WorkerPool const &) = delete;
+  WorkerPool &operator=(WorkerPool const &) = delete;
+
+  void submit(Task task);
+
+  [[nodiscard]] unsigned size() const noexcept;
+  // submitted, not started yet
+  [[nodiscard]] std::size_t queued() const;
+
+private:
+  void run(std::stop_token const stop_token);
+
+private:
+  mutable std::mutex m_mutex;
+  std::condition_variable_any m_cv;
+  std::deque<Task> m_tasks;
+  // declared last, joined before the queue is destroyed
+  std::vector<std::jthread> m_threads;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <filesystem>
+#include <game_addresses.hpp>
+#include <vector>
+
+// The [xtool] table of the config file, every other table is a playlist.
+//
+//   [xtool]
+//   code_region = [0x80004000, 0x80400000]
+//
+//   [[xtool.profiles]]
+//   game_id = "RSBP01"
+//   revision = 0               # optional, every revision by default
+//   current_music_id = 0x90e60f06
+//   g_mtrand_seed = 0x805a00bc # console addresses, taken from GAME_PROFILES
+//                              # when missing
+//   frame_counter = 0x80001234 # optional, example address of a u32 the
+//                              # game increments every frame
+//   frame_rate = 60.0          # optional, 50.0 for PAL games
+//
+//   [[xtool.signatures]]
+//   name = "g_mtrand_seed"
+//   pattern = "3c 60 ?? ?? 80 63 ?? ?? 2c 03 00 00"
+//   target = "hi_lo"  # or "match", default
+//   offset = 0        # lis, or the data for "match"
+//   lo_offset = 4     # the @l instruction
+//   addend = 4
+//
+//   [[xtool.signatures]]
+//   name = "frame_counter" # e.g. the retrace count VIGetRetraceCount loads,
+//   # lis r3 / lwz r3 then blr, with enough of the code around it to match
+//   # once
+//   pattern = "3c 60 ?? ?? 80 63 ?? ?? 4e 80 00 20"
+//   target = "hi_lo"
+struct XtoolConfig {
+  std::vector<ConfiguredGameProfile> profiles;
+  SignatureConfig signature;
+};
+
+// Default XtoolConfig when the file has no [xtool] table. Throws
+// std::runtime_error for an invalid table.
+[[nodiscard]] XtoolConfig
+load_xtool_config(std::filesystem::path const &config_toml_file_path);
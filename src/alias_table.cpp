@@ -0,0 +1,80 @@
+#include <alias_table.hpp>
+#include <cassert>
+#include <cmath>
+#include <fmt/format.h>
+#include <stdexcept>
+
+AliasTable::AliasTable(std::vector<double> const &weights) {
+  auto const n = weights.size();
+  if (n == 0) {
+    return;
+  }
+  if (n > 0xffffffff) {
+    throw std::runtime_error("Too many weights for an alias table.");
+  }
+
+  double sum = 0.0;
+  for (auto const w : weights) {
+    if (!std::isfinite(w) || w < 0.0) {
+      throw std::runtime_error(fmt::format("Invalid weight {}.", w));
+    }
+    sum += w;
+  }
+  if (!(sum > 0.0)) {
+    throw std::runtime_error("Sum of weights must be greater than 0.");
+  }
+
+  // Vose's algorithm
+  std::vector<double> scaled(n);
+  std::vector<std::uint32_t> small;
+  std::vector<std::uint32_t> large;
+  small.reserve(n);
+  large.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    scaled[i] = weights[i] * static_cast<double>(n) / sum;
+    if (scaled[i] < 1.0) {
+      small.push_back(static_cast<std::uint32_t>(i));
+    } else {
+      large.push_back(static_cast<std::uint32_t>(i));
+    }
+  }
+
+  constexpr auto ONE = std::uint64_t{1} << 32;
+  m_thresholds.assign(n, ONE);
+  m_aliases.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    m_aliases[i] = static_cast<std::uint32_t>(i);
+  }
+
+  while (!small.empty() && !large.empty()) {
+    auto const s = small.back();
+    small.pop_back();
+    auto const l = large.back();
+    large.pop_back();
+
+    m_thresholds[s] = static_cast<std::uint64_t>(std::ldexp(scaled[s], 32));
+    m_aliases[s] = l;
+
+    scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+    if (scaled[l] < 1.0) {
+      small.push_back(l);
+    } else {
+      large.push_back(l);
+    }
+  }
+  // Leftovers are 1.0 up to rounding errors, keep them as "always keep".
+}
+
+std::size_t AliasTable::sample(SeedSequenceV2 &seq) const noexcept {
+  assert(!m_thresholds.empty());
+  auto const column = seq.bounded(m_thresholds.size());
+  auto const coin = std::uint64_t{seq.next()};
+  if (coin < m_thresholds[column]) {
+    return column;
+  }
+  return m_aliases[column];
+}
+
+std::size_t AliasTable::size() const noexcept { return m_thresholds.size(); }
+
+bool AliasTable::empty() const noexcept { return m_thresholds.empty(); }
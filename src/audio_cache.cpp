@@ -0,0 +1,104 @@
+#include <audio_cache.hpp>
+#include <chrono>
+#include <spdlog/spdlog.h>
+#include <trace_events.hpp>
+
+std::size_t DecodedAudio::size_bytes() const noexcept {
+  return static_cast<std::size_t>(frame_count) *
+         ma_get_bytes_per_frame(format, channels);
+}
+
+DecodedAudioCache::DecodedAudioCache(std::size_t const capacity_bytes,
+                                     WorkerPool &pool)
+    : m_state(std::make_shared<State>()), m_pool(pool) {
+  m_state->capacity_bytes = capacity_bytes;
+}
+
+std::shared_ptr<DecodedAudio const>
+DecodedAudioCache::find(std::filesystem::path const &path) {
+  auto key = path.string();
+  {
+    std::lock_guard lock(m_state->mutex);
+    if (auto const it = m_state->entries.find(key);
+        it != m_state->entries.end()) {
+      ++m_state->stats.hits;
+      it->second.last_use = ++m_state->use_counter;
+      return it->second.audio;
+    }
+    ++m_state->stats.misses;
+    if (m_state->failed.contains(key) || !m_state->pending.insert(key).second) {
+      return nullptr;
+    }
+  }
+
+  m_pool.submit([state = m_state, key = std::move(key)]() {
+    XTOOL_TRACE_SCOPE("decode music");
+    auto const begin = std::chrono::steady_clock::now();
+    auto config = ma_decoder_config_init_default();
+    ma_uint64 frame_count = 0;
+    void *frames = nullptr;
+    std::shared_ptr<DecodedAudio> audio;
+    if (ma_decode_file(key.c_str(), &config, &frame_count, &frames) ==
+        MA_SUCCESS) {
+      audio = std::make_shared<DecodedAudio>();
+      audio->format = config.format;
+      audio->channels = config.channels;
+      audio->sample_rate = config.sampleRate;
+      audio->frame_count = frame_count;
+      audio->frames.reset(frames);
+    }
+
+    if (audio == nullptr || audio->size_bytes() > state->capacity_bytes) {
+      spdlog::warn("Music {} is not cached: {}.", key,
+                   audio == nullptr ? "failed to decode"
+                                    : "larger than the audio cache");
+      std::lock_guard lock(state->mutex);
+      state->pending.erase(key);
+      state->failed.insert(key);
+      return;
+    }
+    spdlog::debug(
+        "Decoded {} into the audio cache, {} bytes, {} ms.", key,
+        audio->size_bytes(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - begin)
+            .count());
+    state->insert(key, std::move(audio));
+  });
+  return nullptr;
+}
+
+void DecodedAudioCache::State::insert(
+    std::string const &key, std::shared_ptr<DecodedAudio const> audio) {
+  std::lock_guard lock(mutex);
+  pending.erase(key);
+  auto const size = audio->size_bytes();
+  while (!entries.empty() && stats.bytes + size > capacity_bytes) {
+    auto oldest = entries.begin();
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (it->second.last_use < oldest->second.last_use) {
+        oldest = it;
+      }
+    }
+    stats.bytes -= oldest->second.audio->size_bytes();
+    ++stats.evictions;
+    entries.erase(oldest);
+  }
+  stats.bytes += size;
+  entries.emplace(key, Entry{std::move(audio), ++use_counter});
+}
+
+DecodedAudioCache::Stats DecodedAudioCache::stats() const {
+  std::lock_guard lock(m_state->mutex);
+  auto stats = m_state->stats;
+  stats.entries = m_state->entries.size();
+  return stats;
+}
+
+void DecodedAudioCache::log_stats() const {
+  auto const s = this->stats();
+  spdlog::info("Audio cache: {} musics, {:.1f} MiB, {} hits, {} misses, {} "
+               "evictions.",
+               s.entries, static_cast<double>(s.bytes) / (1024.0 * 1024.0),
+               s.hits, s.misses, s.evictions);
+}
@@ -0,0 +1,99 @@
+#include <audio_metrics.hpp>
+#include <cstdlib>
+#include <spdlog/spdlog.h>
+
+void AudioCallbackMetrics::begin_stream() noexcept {
+  m_previous_begin_ns = 0;
+  m_previous_period_ns = 0;
+}
+
+void AudioCallbackMetrics::on_callback(
+    std::int64_t const begin_ns, std::int64_t const end_ns,
+    std::uint32_t const frames_requested,
+    std::uint64_t const frames_delivered, bool const read_error,
+    std::uint32_t const sample_rate) noexcept {
+  constexpr auto relaxed = std::memory_order_relaxed;
+  m_callbacks.fetch_add(1, relaxed);
+  m_frames_requested.fetch_add(frames_requested, relaxed);
+  m_frames_delivered.fetch_add(frames_delivered, relaxed);
+  if (frames_delivered < frames_requested) {
+    m_short_reads.fetch_add(1, relaxed);
+  }
+  if (read_error) {
+    m_read_errors.fetch_add(1, relaxed);
+  }
+  m_duration.record(static_cast<std::uint64_t>(end_ns - begin_ns));
+
+  if (m_previous_begin_ns != 0) {
+    auto const interval = begin_ns - m_previous_begin_ns;
+    m_interval.record(static_cast<std::uint64_t>(interval));
+    m_jitter.record(static_cast<std::uint64_t>(
+        std::llabs(interval - m_previous_period_ns)));
+    if (2 * interval > 3 * m_previous_period_ns) {
+      m_late_callbacks.fetch_add(1, relaxed);
+    }
+  }
+  m_previous_begin_ns = begin_ns;
+  m_previous_period_ns =
+      sample_rate == 0
+          ? 0
+          : static_cast<std::int64_t>(frames_requested) * 1'000'000'000 /
+                sample_rate;
+}
+
+std::uint64_t AudioCallbackMetrics::callbacks() const noexcept {
+  return m_callbacks.load(std::memory_order_relaxed);
+}
+
+std::uint64_t AudioCallbackMetrics::frames_requested() const noexcept {
+  return m_frames_requested.load(std::memory_order_relaxed);
+}
+
+std::uint64_t AudioCallbackMetrics::frames_delivered() const noexcept {
+  return m_frames_delivered.load(std::memory_order_relaxed);
+}
+
+std::uint64_t AudioCallbackMetrics::short_reads() const noexcept {
+  return m_short_reads.load(std::memory_order_relaxed);
+}
+
+std::uint64_t AudioCallbackMetrics::read_errors() const noexcept {
+  return m_read_errors.load(std::memory_order_relaxed);
+}
+
+std::uint64_t AudioCallbackMetrics::late_callbacks() const noexcept {
+  return m_late_callbacks.load(std::memory_order_relaxed);
+}
+
+LatencyHistogram const &AudioCallbackMetrics::duration() const noexcept {
+  return m_duration;
+}
+
+LatencyHistogram const &AudioCallbackMetrics::interval() const noexcept {
+  return m_interval;
+}
+
+LatencyHistogram const &AudioCallbackMetrics::jitter() const noexcept {
+  return m_jitter;
+}
+
+void AudioCallbackMetrics::log() const {
+  spdlog::info("Audio callbacks: n={}, frames requested={}, delivered={}, "
+               "short reads={}, read errors={}, late(xrun)={}",
+               this->callbacks(), this->frames_requested(),
+               this->frames_delivered(), this->short_reads(),
+               this->read_errors(), this->late_callbacks());
+  auto const log_histogram = [](std::string_view const name,
+                                LatencyHistogram const &h) {
+    constexpr auto us = [](auto const ns) {
+      return static_cast<double>(ns) / 1e3;
+    };
+    spdlog::info("{:>18}(us): n={} p50={:.1f} p99={:.1f} p99.9={:.1f} "
+                 "max={:.1f}",
+                 name, h.count(), us(h.percentile(50.0)),
+                 us(h.percentile(99.0)), us(h.percentile(99.9)), us(h.max()));
+  };
+  log_histogram("callback duration", m_duration);
+  log_histogram("callback interval", m_interval);
+  log_histogram("callback jitter", m_jitter);
+}
@@ -0,0 +1,772 @@
+#include <algorithm>
+#include <alias_table.hpp>
+#include <array>
+#include <bench.hpp>
+#include <byte_swap.hpp>
+#include <cctype>
+#include <chrono>
+#include <console_address.hpp>
+#include <constants.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <dme/Common/CommonUtils.h>
+#include <dme/Common/MemoryCommon.h>
+#include <dolphin_manager.hpp>
+#include <fmt/format.h>
+#include <fstream>
+#include <iterator>
+#include <miniaudio.h>
+#include <playlist.hpp>
+#include <random>
+#include <seed_selector.hpp>
+#include <snapshot_diff.hpp>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <value_scanner.hpp>
+
+namespace {
+template <typename F>
+double measure_ns_per_call(std::uint32_t const iterations, F &&f) {
+  auto const begin = std::chrono::steady_clock::now();
+  for (std::uint32_t i = 0; i < iterations; ++i) {
+    f(i);
+  }
+  auto const end = std::chrono::steady_clock::now();
+  auto const ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+          .count();
+  return static_cast<double>(ns) / iterations;
+}
+
+// Playlist and selection log every step at info level.
+class ScopedLogLevel {
+public:
+  explicit ScopedLogLevel(spdlog::level::level_enum const level)
+      : m_previous(spdlog::get_level()) {
+    spdlog::set_level(level);
+  }
+  ~ScopedLogLevel() { spdlog::set_level(m_previous); }
+  ScopedLogLevel(ScopedLogLevel const &) = delete;
+  ScopedLogLevel &operator=(ScopedLogLevel const &) = delete;
+
+private:
+  spdlog::level::level_enum m_previous;
+};
+
+// Removed with everything in it on scope exit.
+class TemporaryDirectory {
+public:
+  TemporaryDirectory() {
+    std::random_device rd;
+    m_path = std::filesystem::temp_directory_path() /
+             fmt::format("xtool-bench-{:08x}", rd());
+    std::filesystem::create_directories(m_path);
+  }
+  ~TemporaryDirectory() {
+    std::error_code ec;
+    std::filesystem::remove_all(m_path, ec);
+  }
+  TemporaryDirectory(TemporaryDirectory const &) = delete;
+  TemporaryDirectory &operator=(TemporaryDirectory const &) = delete;
+
+  [[nodiscard]] std::filesystem::path const &path() const noexcept {
+    return m_path;
+  }
+
+private:
+  std::filesystem::path m_path;
+};
+
+template <typename T> void write_le(std::ostream &os, T const value) {
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    os.put(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+// 1 second of 16 bit stereo silence at 48 kHz
+void write_silent_wav(std::filesystem::path const &path) {
+  constexpr std::uint32_t sample_rate = 48000;
+  constexpr std::uint16_t channels = 2;
+  constexpr std::uint16_t bits = 16;
+  constexpr std::uint32_t data_size = sample_rate * channels * (bits / 8);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write("RIFF", 4);
+  write_le<std::uint32_t>(file, 36 + data_size);
+  file.write("WAVEfmt ", 8);
+  write_le<std::uint32_t>(file, 16);
+  write_le<std::uint16_t>(file, 1); // PCM
+  write_le<std::uint16_t>(file, channels);
+  write_le<std::uint32_t>(file, sample_rate);
+  write_le<std::uint32_t>(file, sample_rate * channels * (bits / 8));
+  write_le<std::uint16_t>(file, channels * (bits / 8));
+  write_le<std::uint16_t>(file, bits);
+  file.write("data", 4);
+  write_le<std::uint32_t>(file, data_size);
+  std::vector<char> const silence(data_size, 0);
+  file.write(silence.data(), static_cast<std::streamsize>(silence.size()));
+  if (!file) {
+    throw std::runtime_error(
+        fmt::format("Failed to write {}.", path.string()));
+  }
+}
+
+// [musics] with size entries all pointing to music_file_path, and one
+// playlist with every music for brawl music id 1.
+void write_playlist_config(std::filesystem::path const &path,
+                           std::size_t const size,
+                           std::filesystem::path const &music_file_path) {
+  std::ofstream file(path, std::ios::trunc);
+  auto const music = music_file_path.generic_string();
+  file << "[musics]\nmusics = [\n";
+  for (std::size_t i = 0; i < size; ++i) {
+    file << fmt::format("  [{}, \"{}\", -1, -1],\n", i, music);
+  }
+  file << "]\n\n[bench]\ntarget_ids = [1]\nmusics = [";
+  for (std::size_t i = 0; i < size; ++i) {
+    file << (i == 0 ? "" : ", ") << i;
+  }
+  file << "]\n";
+  if (!file) {
+    throw std::runtime_error(
+        fmt::format("Failed to write {}.", path.string()));
+  }
+}
+
+std::string json_escape(std::string_view const s) {
+  std::string out;
+  out.reserve(s.size());
+  for (auto const c : s) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+      } else {
+        out += c;
+      }
+    }
+  }
+  return out;
+}
+} // namespace
+
+std::vector<BenchResult> bench_seed_rand(std::uint32_t const iterations) {
+  spdlog::info("Benchmark seed_rand, {} iterations per case.", iterations);
+
+  std::vector<BenchResult> results;
+  for (std::size_t const range_size : {2, 10, 300, 5000}) {
+    for (auto const version :
+         {SeedSelectorVersion::v1, SeedSelectorVersion::v2}) {
+      // accumulate results so the calls can not be optimized away
+      std::size_t sink = 0;
+      auto const ns = measure_ns_per_call(iterations, [&](std::uint32_t i) {
+        // spread seeds like g_mtRand.seed does
+        sink += seed_rand(0, range_size - 1, i * 0x9e3779b9u, version);
+      });
+      spdlog::info("selector={}, range size={}, {:.2f} ns/call (sink={})",
+                   seed_selector_version_name(version), range_size, ns, sink);
+      results.push_back(
+          {"seed_rand",
+           {{"selector", std::string(seed_selector_version_name(version))},
+            {"range_size", std::to_string(range_size)}},
+           iterations,
+           ns});
+    }
+  }
+  return results;
+}
+
+std::vector<BenchResult>
+bench_playlist_selection(std::uint32_t const iterations) {
+  spdlog::info("Benchmark playlist selection, {} iterations per case.",
+               iterations);
+
+  std::vector<BenchResult> results;
+  for (std::size_t const size : {1000, 10000, 100000}) {
+    // synthetic playlist with pseudo random weights in [1, 100]
+    PlaylistEntry pe;
+    pe.name = fmt::format("bench{}", size);
+    SeedSequenceV2 weight_seq{0x5eed};
+    for (std::size_t i = 0; i < size; ++i) {
+      pe.music_entries.push_back(i);
+      pe.weights.push_back(1.0 + weight_seq.bounded(100));
+    }
+
+    auto const build_begin = std::chrono::steady_clock::now();
+    pe.alias_table = AliasTable(pe.weights);
+    auto const build_end = std::chrono::steady_clock::now();
+    auto const build_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(build_end -
+                                                             build_begin)
+            .count();
+    spdlog::info("size={}, alias table build {} us", size, build_ns / 1000);
+    results.push_back({"alias_table_build",
+                       {{"size", std::to_string(size)}},
+                       1,
+                       static_cast<double>(build_ns)});
+
+    for (std::size_t const no_repeat : {0, 32, 512}) {
+      pe.history = MusicHistory{};
+      pe.history.capacity = no_repeat;
+      std::size_t sink = 0;
+      auto const ns = measure_ns_per_call(iterations, [&](std::uint32_t i) {
+        auto const index =
+            select_music_index(pe, i * 0x9e3779b9u, SeedSelectorVersion::v2);
+        pe.history.push(pe.music_entries[index]);
+        sink += index;
+      });
+      spdlog::info("size={}, weighted, no_repeat={}, {:.2f} ns/call (sink={})",
+                   size, no_repeat, ns, sink);
+      results.push_back({"select_music_index",
+                         {{"size", std::to_string(size)},
+                          {"weighted", "true"},
+                          {"no_repeat", std::to_string(no_repeat)}},
+                         iterations,
+                         ns});
+    }
+  }
+  return results;
+}
+
+std::vector<BenchResult>
+bench_playlist_construction(std::uint32_t const iterations) {
+  // parsing 100k musics takes a while, a few runs are enough
+  auto const build_iterations = std::max<std::uint32_t>(1, iterations / 50000);
+  spdlog::info("Benchmark playlist construction, {} builds / {} lookups per "
+               "case.",
+               build_iterations, iterations);
+
+  TemporaryDirectory const directory;
+  auto const music_file_path = directory.path() / "bench.wav";
+  write_silent_wav(music_file_path);
+
+  std::vector<BenchResult> results;
+  for (std::size_t const size : {1000, 10000, 100000}) {
+    auto const config_path =
+        directory.path() / fmt::format("playlist{}.toml", size);
+    write_playlist_config(config_path, size, music_file_path);
+
+    std::optional<Playlist> playlist;
+    double build_ns = 0.0;
+    double lookup_ns = 0.0;
+    std::size_t sink = 0;
+    {
+      ScopedLogLevel const quiet(spdlog::level::warn);
+      build_ns = measure_ns_per_call(build_iterations, [&](std::uint32_t) {
+        playlist.reset();
+        // lazy: measure the config, not the file system
+        playlist.emplace(config_path, PlaylistValidation::lazy);
+      });
+      lookup_ns = measure_ns_per_call(iterations, [&](std::uint32_t i) {
+        auto const music = playlist->random_music_for_with_g_mtRand_seed(
+            1, i * 0x9e3779b9u, SeedSelectorVersion::v2);
+        sink += music.has_value() ? music->unique_music_id : 0;
+      });
+    }
+    spdlog::info("size={}, construction {:.3f} ms, lookup {:.2f} ns/call "
+                 "(sink={})",
+                 size, build_ns / 1e6, lookup_ns, sink);
+    results.push_back({"playlist_construction",
+                       {{"size", std::to_string(size)}},
+                       build_iterations,
+                       build_ns});
+    results.push_back({"playlist_lookup",
+                       {{"size", std::to_string(size)}},
+                       iterations,
+                       lookup_ns});
+  }
+  return results;
+}
+
+std::vector<BenchResult> bench_memory_common(std::uint32_t const iterations) {
+  spdlog::info("Benchmark memory helpers, {} iterations per case.",
+               iterations);
+
+  std::vector<BenchResult> results;
+  for (bool const aram : {false, true}) {
+    std::uint64_t sink = 0;
+    auto const ns = measure_ns_per_call(iterations, [&](std::uint32_t i) {
+      // cycle through MEM1, MEM2 and ARAM addresses
+      constexpr std::array<std::uint32_t, 3> bases = {
+          Common::MEM1_START, Common::MEM2_START, Common::ARAM_START};
+      sink += Common::dolphinAddrToOffset(bases[i % 3] + (i & 0xfffc), aram);
+    });
+    spdlog::info("dolphinAddrToOffset, aram={}, {:.2f} ns/call (sink={})",
+                 aram, ns, sink);
+    results.push_back({"dolphinAddrToOffset",
+                       {{"aram", aram ? "true" : "false"}},
+                       iterations,
+                       ns});
+  }
+
+  struct TypeCase {
+    char const *name;
+    Common::MemType type;
+    Common::MemBase base;
+  };
+  constexpr std::array<TypeCase, 7> type_cases = {{
+      {"byte", Common::MemType::type_byte, Common::MemBase::base_decimal},
+      {"halfword", Common::MemType::type_halfword,
+       Common::MemBase::base_decimal},
+      {"word", Common::MemType::type_word, Common::MemBase::base_hexadecimal},
+      {"float", Common::MemType::type_float, Common::MemBase::base_none},
+      {"double", Common::MemType::type_double, Common::MemBase::base_none},
+      {"string", Common::MemType::type_string, Common::MemBase::base_none},
+      {"byteArray", Common::MemType::type_byteArray,
+       Common::MemBase::base_hexadecimal},
+  }};
+  // big endian bytes as read from the console, readable as a string too
+  constexpr std::array<char, 16> memory = {'x', 't', 'o', 'o', 'l', ' ',
+                                           'b', 'e', 'n', 'c', 'h', '!',
+                                           '?', '@', '#', '$'};
+  for (auto const &c : type_cases) {
+    auto const length = Common::getSizeForType(c.type, memory.size());
+    std::size_t sink = 0;
+    auto const ns = measure_ns_per_call(iterations, [&](std::uint32_t) {
+      sink += Common::formatMemoryToString(memory.data(), c.type, length,
+                                           c.base, false, true)
+                  .size();
+    });
+    spdlog::info("formatMemoryToString, type={}, {:.2f} ns/call (sink={})",
+                 c.name, ns, sink);
+    results.push_back(
+        {"formatMemoryToString", {{"type", c.name}}, iterations, ns});
+  }
+  return results;
+}
+
+std::vector<BenchResult>
+bench_decoder_init(std::uint32_t const iterations,
+                   std::optional<std::filesystem::path> const &audio_dir) {
+  // every init opens and probes the file
+  auto const decoder_iterations = std::max<std::uint32_t>(1, iterations / 1000);
+  spdlog::info("Benchmark decoder init, {} iterations per codec.",
+               decoder_iterations);
+
+  TemporaryDirectory const directory;
+  std::vector<std::pair<std::string, std::filesystem::path>> samples;
+  samples.emplace_back("wav", directory.path() / "bench.wav");
+  write_silent_wav(samples.back().second);
+
+  // first file of every other codec found in audio_dir
+  if (audio_dir.has_value()) {
+    for (std::string const codec : {"mp3", "flac"}) {
+      std::error_code ec;
+      for (auto const &entry :
+           std::filesystem::recursive_directory_iterator(*audio_dir, ec)) {
+        auto extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char const c) { return std::tolower(c); });
+        if (entry.is_regular_file() && extension == "." + codec) {
+          samples.emplace_back(codec, entry.path());
+          break;
+        }
+      }
+    }
+  }
+
+  std::vector<BenchResult> results;
+  for (auto const &[codec, path] : samples) {
+    std::size_t failures = 0;
+    auto const ns = measure_ns_per_call(decoder_iterations, [&](std::uint32_t) {
+      ma_decoder decoder;
+      if (ma_decoder_init_file(path.string().c_str(), NULL, &decoder) !=
+          MA_SUCCESS) {
+        ++failures;
+        return;
+      }
+      ma_decoder_uninit(&decoder);
+    });
+    if (failures > 0) {
+      spdlog::warn("Failed to open {}, skip {} decoder benchmark.",
+                   path.string(), codec);
+      continue;
+    }
+    spdlog::info("decoder init, codec={}, {:.3f} us/init ({})", codec,
+                 ns / 1e3, path.string());
+    results.push_back(
+        {"decoder_init", {{"codec", codec}}, decoder_iterations, ns});
+  }
+  return results;
+}
+
+std::vector<BenchResult> bench_snapshot_diff(std::uint32_t const iterations) {
+  auto const diff_iterations = std::max<std::uint32_t>(1, iterations / 10000);
+  constexpr std::size_t size = 16 * 1024 * 1024;
+  spdlog::info("Benchmark snapshot diff, {} bytes, {} iterations per case.",
+               size, diff_iterations);
+
+  // random memory with a sparse set of changes, like two frames of a game
+  std::vector<char> before(size);
+  SeedSequenceV2 seq{0xd1ff};
+  for (auto &c : before) {
+    c = static_cast<char>(seq.bounded(256));
+  }
+  auto after = before;
+  for (std::size_t i = 0; i < size / 1024; ++i) {
+    after[seq.bounded(size)] ^= 1;
+  }
+
+  std::vector<BenchResult> results;
+  for (auto const backend : {DiffBackend::scalar, DiffBackend::sse2,
+                             DiffBackend::avx2, DiffBackend::neon}) {
+    if (!is_diff_backend_supported(backend)) {
+      continue;
+    }
+    for (auto const predicate :
+         {DiffPredicate::changed, DiffPredicate::unchanged}) {
+      std::size_t sink = 0;
+      auto const ns = measure_ns_per_call(diff_iterations, [&](std::uint32_t) {
+        sink += diff_snapshots(before, after, predicate, 4, backend).size();
+      });
+      spdlog::info("backend={}, {}, {:.3f} ms/diff, {:.2f} GB/s (sink={})",
+                   diff_backend_name(backend), diff_predicate_name(predicate),
+                   ns / 1e6, static_cast<double>(size) / ns, sink);
+      results.push_back(
+          {"snapshot_diff",
+           {{"backend", std::string(diff_backend_name(backend))},
+            {"predicate", std::string(diff_predicate_name(predicate))},
+            {"bytes", std::to_string(size)}},
+           diff_iterations,
+           ns});
+    }
+  }
+  return results;
+}
+
+std::vector<BenchResult> bench_value_scan(std::uint32_t const iterations) {
+  auto const scan_iterations = std::max<std::uint32_t>(1, iterations / 10000);
+  constexpr std::size_t size = 16 * 1024 * 1024;
+  spdlog::info("Benchmark value scan, {} bytes, {} iterations per case.", size,
+               scan_iterations);
+
+  std::vector<char> ram(size);
+  SeedSequenceV2 seq{0x5ca9};
+  for (auto &c : ram) {
+    c = static_cast<char>(seq.bounded(256));
+  }
+
+  std::vector<BenchResult> results;
+  for (std::string const type_name : {"byte", "halfword", "word", "float"}) {
+    for (auto const filter : {ScanFilter::exact, ScanFilter::range}) {
+      ScanOptions options;
+      options.type = parse_mem_type(type_name).value();
+      options.threads = 1;
+      ValueScanner scanner(options);
+      std::size_t sink = 0;
+      // first scans, every position is a candidate
+      auto const ns = measure_ns_per_call(scan_iterations, [&](std::uint32_t) {
+        scanner.reset();
+        sink += scanner.scan(ram, filter, "42", "100").candidates;
+      });
+      spdlog::info("type={}, {}, {:.3f} ms/scan, {:.2f} GB/s (sink={})",
+                   type_name, scan_filter_name(filter), ns / 1e6,
+                   static_cast<double>(size) / ns, sink);
+      results.push_back({"value_scan",
+                         {{"type", type_name},
+                          {"filter", std::string(scan_filter_name(filter))},
+                          {"bytes", std::to_string(size)}},
+                         scan_iterations,
+                         ns});
+    }
+  }
+  return results;
+}
+
+std::vector<BenchResult> bench_byte_swap(std::uint32_t const iterations) {
+  auto const swap_iterations = std::max<std::uint32_t>(1, iterations / 10000);
+  constexpr std::size_t size = 16 * 1024 * 1024;
+  spdlog::info("Benchmark byte swap, {} bytes, {} iterations per case.", size,
+               swap_iterations);
+
+  std::vector<char> data(size);
+  SeedSequenceV2 seq{0xb5a9};
+  for (auto &c : data) {
+    c = static_cast<char>(seq.bounded(256));
+  }
+
+  std::vector<BenchResult> results;
+  for (auto const backend : {SwapBackend::scalar, SwapBackend::ssse3,
+                             SwapBackend::avx2, SwapBackend::neon}) {
+    if (!is_swap_backend_supported(backend)) {
+      continue;
+    }
+    for (std::uint32_t const width : {2, 4, 8}) {
+      auto const ns = measure_ns_per_call(swap_iterations, [&](std::uint32_t) {
+        swap_elements(data.data(), size / width, width, backend);
+      });
+      spdlog::info("backend={}, width={}, {:.3f} ms/swap, {:.2f} GB/s",
+                   swap_backend_name(backend), width, ns / 1e6,
+                   static_cast<double>(size) / ns);
+      results.push_back(
+          {"byte_swap",
+           {{"backend", std::string(swap_backend_name(backend))},
+            {"width", std::to_string(width)},
+            {"bytes", std::to_string(size)}},
+           swap_iterations,
+           ns});
+    }
+  }
+  return results;
+}
+
+namespace {
+// bench_dolphin_read cases with one memory backend
+std::vector<BenchResult>
+bench_dolphin_read_backend(std::uint32_t const iterations,
+                           DolphinComm::MemoryBackend const memory_backend) {
+  auto const backend = std::string(memory_backend_name(memory_backend));
+  DolphinManager dm(-1, memory_backend);
+  auto &dolphin = dm.dolphin();
+  if (dolphin.getStatus() != DolphinComm::DolphinStatus::hooked) {
+    spdlog::warn("Dolphin is not readable with {}, skip dolphin read "
+                 "benchmark.",
+                 backend);
+    return {};
+  }
+  spdlog::info("Benchmark dolphin reads, pid={}, backend {}({}), {} "
+               "iterations per case.",
+               dolphin.getPID(), backend, dolphin.getMemoryBackendName(),
+               iterations);
+
+  std::vector<BenchResult> results;
+  std::uint16_t music_id = 0;
+  std::uint32_t seed = 0;
+  std::size_t failures = 0;
+  auto const ns = measure_ns_per_call(iterations, [&](std::uint32_t) {
+    failures += !dolphin.readFromRAM(xtool::constants::CURRENT_MUSIC_ID_ADDRESS,
+                                     reinterpret_cast<char *>(&music_id),
+                                     sizeof(music_id), false);
+    failures += !dolphin.readFromRAM(xtool::constants::G_MTRAND_SEED_ADDRESS,
+                                     reinterpret_cast<char *>(&seed),
+                                     sizeof(seed), false);
+  });
+  spdlog::info("music id + seed read, {:.2f} ns/poll ({} failures)", ns,
+               failures);
+  results.push_back({"dolphin_poll", {{"backend", backend}}, iterations, ns});
+
+  // same values through the compile time addresses, no offset translation
+  failures = 0;
+  auto const typed_ns = measure_ns_per_call(iterations, [&](std::uint32_t) {
+    auto const typed_music_id =
+        read_console(dolphin, xtool::constants::CURRENT_MUSIC_ID);
+    auto const typed_seed =
+        read_console(dolphin, xtool::constants::G_MTRAND_SEED);
+    failures += !typed_music_id.has_value() + !typed_seed.has_value();
+    music_id = typed_music_id.value_or(0);
+    seed = typed_seed.value_or(0);
+  });
+  spdlog::info("typed music id + seed read, {:.2f} ns/poll ({} failures)",
+               typed_ns, failures);
+  results.push_back(
+      {"dolphin_poll_typed", {{"backend", backend}}, iterations, typed_ns});
+
+  // both values in one batch(one io_uring submission with proc_mem)
+  failures = 0;
+  std::array<DolphinComm::RAMRead, 2> const reads{{
+      {xtool::constants::CURRENT_MUSIC_ID_ADDRESS,
+       reinterpret_cast<char *>(&music_id), sizeof(music_id)},
+      {xtool::constants::G_MTRAND_SEED_ADDRESS, reinterpret_cast<char *>(&seed),
+       sizeof(seed)},
+  }};
+  auto const batch_ns = measure_ns_per_call(iterations, [&](std::uint32_t) {
+    failures += !dolphin.readBatchFromRAM(reads.data(), reads.size());
+  });
+  spdlog::info("batched music id + seed read, {:.2f} ns/poll ({} failures)",
+               batch_ns, failures);
+  results.push_back(
+      {"dolphin_poll_batch", {{"backend", backend}}, iterations, batch_ns});
+
+  // 64 u32 writes one by one and as one ConsoleWritePlan. They write the
+  // first 0x20 bytes of the disc header(never written by the game) back
+  // unchanged, so running the bench against a game is harmless.
+  constexpr std::size_t write_count = 64;
+  constexpr std::size_t header_words = 8;
+  auto const header_offset = Common::dolphinAddrToOffset(
+      xtool::constants::DISC_HEADER.address, false);
+  std::array<std::uint32_t, header_words> header{};
+  if (read_console_array(dolphin, header_offset,
+                         std::span<std::uint32_t>(header))) {
+    auto const offset_of = [&](std::size_t const i) {
+      return static_cast<std::uint32_t>(
+          header_offset + (i % header_words) * sizeof(std::uint32_t));
+    };
+    failures = 0;
+    auto const write_ns = measure_ns_per_call(iterations, [&](std::uint32_t) {
+      for (std::size_t i = 0; i < write_count; ++i) {
+        failures +=
+            !write_console(dolphin, offset_of(i), header[i % header_words]);
+      }
+    });
+    spdlog::info("{} writes one by one, {:.2f} us/batch ({} failures)",
+                 write_count, write_ns / 1e3, failures);
+    results.push_back({"dolphin_write",
+                       {{"backend", backend},
+                        {"writes", std::to_string(write_count)}},
+                       iterations,
+                       write_ns});
+
+    failures = 0;
+    ConsoleWritePlan<write_count> plan;
+    auto const plan_ns = measure_ns_per_call(iterations, [&](std::uint32_t) {
+      plan.clear();
+      for (std::size_t i = 0; i < write_count; ++i) {
+        plan.add(offset_of(i), header[i % header_words]);
+      }
+      failures += !plan.submit(dolphin);
+    });
+    spdlog::info("{} writes in one plan, {:.2f} us/batch ({} failures)",
+                 write_count, plan_ns / 1e3, failures);
+    results.push_back({"dolphin_write_batch",
+                       {{"backend", backend},
+                        {"writes", std::to_string(write_count)}},
+                       iterations,
+                       plan_ns});
+  }
+
+  // [0x80000038] + 8, the apploader keeps the FST location there, +8 is its
+  // entry count. Kept PointerPath against following the pointer every read.
+  constexpr std::uint32_t fst_pointer = 0x80000038;
+  constexpr std::int32_t fst_entries = 0x8;
+  DolphinComm::PointerPath path(fst_pointer, {fst_entries});
+  if (read_console<std::uint32_t>(dolphin, path).has_value()) {
+    failures = 0;
+    auto const path_ns = measure_ns_per_call(iterations, [&](std::uint32_t) {
+      auto const entries = read_console<std::uint32_t>(dolphin, path);
+      failures += !entries.has_value();
+      seed = entries.value_or(0);
+    });
+    spdlog::info("pointer path read, {:.2f} ns/read, {} walks ({} failures)",
+                 path_ns, path.getWalkCount(), failures);
+    results.push_back({"dolphin_pointer_path",
+                       {{"backend", backend}, {"levels", "1"}},
+                       iterations,
+                       path_ns});
+
+    failures = 0;
+    auto const walk_ns = measure_ns_per_call(iterations, [&](std::uint32_t) {
+      std::uint32_t fst = 0;
+      failures += !dolphin.readFromRAM(
+          Common::dolphinAddrToOffset(fst_pointer, false),
+          reinterpret_cast<char *>(&fst), sizeof(fst), true);
+      failures += !dolphin.readFromRAM(
+          Common::dolphinAddrToOffset(fst + fst_entries, false),
+          reinterpret_cast<char *>(&seed), sizeof(seed), true);
+    });
+    spdlog::info("pointer followed by hand, {:.2f} ns/read ({} failures)",
+                 walk_ns, failures);
+    results.push_back({"dolphin_pointer_walk",
+                       {{"backend", backend}, {"levels", "1"}},
+                       iterations,
+                       walk_ns});
+  } else {
+    spdlog::info("No FST pointer at {:#x}, skip pointer path benchmark.",
+                 fst_pointer);
+  }
+
+  // whole MEM1(+MEM2) snapshot
+  auto const cache_iterations = std::max<std::uint32_t>(1, iterations / 1000);
+  auto const cache_ns = measure_ns_per_call(
+      cache_iterations, [&](std::uint32_t) { dolphin.updateRAMCache(); });
+  auto const stats = dolphin.getLastRAMCacheRefreshStats();
+  spdlog::info("RAM cache refresh, {} bytes, {} threads, {:.3f} ms/refresh, "
+               "{:.2f} GB/s",
+               stats.bytes, stats.threads, cache_ns / 1e6,
+               static_cast<double>(stats.bytes) / cache_ns);
+  results.push_back({"ram_cache_refresh",
+                     {{"backend", backend},
+                      {"bytes", std::to_string(stats.bytes)},
+                      {"threads", std::to_string(stats.threads)}},
+                     cache_iterations,
+                     cache_ns});
+
+  // what a per frame analysis of a few structures refreshes
+  constexpr std::uint32_t range_size = 64 * 1024;
+  auto const range_ns = measure_ns_per_call(iterations, [&](std::uint32_t) {
+    dolphin.updateRAMCacheRange(Common::MEM1_START, range_size);
+  });
+  spdlog::info("RAM cache range refresh, {} bytes, {:.2f} us/refresh",
+               range_size, range_ns / 1e3);
+  results.push_back({"ram_cache_range_refresh",
+                     {{"backend", backend},
+                      {"bytes", std::to_string(range_size)}},
+                     iterations,
+                     range_ns});
+
+  // pages written since the previous refresh, the whole cache when the
+  // kernel can't track writes
+  std::vector<DolphinComm::RAMCacheRange> refreshed;
+  dolphin.updateRAMCacheDirtyPages(refreshed);
+  std::size_t dirty_bytes = 0;
+  auto const dirty_ns =
+      measure_ns_per_call(cache_iterations, [&](std::uint32_t) {
+        dolphin.updateRAMCacheDirtyPages(refreshed);
+        for (auto const &r : refreshed) {
+          dirty_bytes += r.end - r.begin;
+        }
+      });
+  dirty_bytes /= cache_iterations;
+  spdlog::info("RAM cache dirty page refresh, {} bytes, {:.3f} ms/refresh",
+               dirty_bytes, dirty_ns / 1e6);
+  results.push_back({"ram_cache_dirty_refresh",
+                     {{"backend", backend},
+                      {"bytes", std::to_string(dirty_bytes)}},
+                     cache_iterations,
+                     dirty_ns});
+  return results;
+}
+} // namespace
+
+std::vector<BenchResult> bench_dolphin_read(std::uint32_t const iterations) {
+  std::vector<BenchResult> results;
+  for (auto const backend : {DolphinComm::MemoryBackend::processVmReadv,
+                             DolphinComm::MemoryBackend::procMem}) {
+    auto backend_results = bench_dolphin_read_backend(iterations, backend);
+    results.insert(results.end(),
+                   std::make_move_iterator(backend_results.begin()),
+                   std::make_move_iterator(backend_results.end()));
+  }
+  return results;
+}
+
+std::vector<BenchResult> run_benchmarks(BenchOptions const &options) {
+  std::vector<BenchResult> results;
+  auto const append = [&](std::vector<BenchResult> r) {
+    std::move(r.begin(), r.end(), std::back_inserter(results));
+  };
+  append(bench_seed_rand(options.iterations));
+  append(bench_playlist_selection(options.iterations));
+  append(bench_playlist_construction(options.iterations));
+  append(bench_memory_common(options.iterations));
+  append(bench_decoder_init(options.iterations, options.audio_dir));
+  append(bench_snapshot_diff(options.iterations));
+  append(bench_value_scan(options.iterations));
+  append(bench_byte_swap(options.iterations));
+  if (options.dolphin) {
+    append(bench_dolphin_read(options.iterations));
+  }
+  return results;
+}
+
+void write_bench_json(std::ostream &os,
+                      std::vector<BenchResult> const &results) {
+  os << "{\n  \"version\": 1,\n  \"results\": [";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    auto const &r = results[i];
+    os << (i == 0 ? "\n" : ",\n") << "    {\"name\": \""
+       << json_escape(r.name) << "\", \"params\": {";
+    for (std::size_t p = 0; p < r.params.size(); ++p) {
+      os << (p == 0 ? "" : ", ") << '"' << json_escape(r.params[p].first)
+         << "\": \"" << json_escape(r.params[p].second) << '"';
+    }
+    os << fmt::format("}}, \"iterations\": {}, \"ns_per_op\": {:.3f}}}",
+                      r.iterations, r.ns_per_op);
+  }
+  os << "\n  ]\n}\n";
+}
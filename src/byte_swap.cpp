@@ -0,0 +1,187 @@
+#include <array>
+#include <bit>
+#include <byte_swap.hpp>
+#include <cpu_features.hpp>
+#include <cstring>
+#include <fmt/format.h>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define XTOOL_SWAP_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define XTOOL_SWAP_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+// swaps size bytes, a multiple of the element width
+using SwapFunction = void (*)(char *, std::size_t);
+
+template <typename U> void swap_scalar(char *data, std::size_t const size) {
+  for (std::size_t i = 0; i + sizeof(U) <= size; i += sizeof(U)) {
+    U value;
+    std::memcpy(&value, data + i, sizeof(U));
+    value = std::byteswap(value);
+    std::memcpy(data + i, &value, sizeof(U));
+  }
+}
+
+#ifdef XTOOL_SWAP_X86
+// pshufb indices reversing every width bytes of a 16 byte lane
+template <std::uint32_t Width> constexpr std::array<char, 16> shuffle_mask() {
+  std::array<char, 16> mask{};
+  for (std::uint32_t i = 0; i < 16; ++i) {
+    mask[i] = static_cast<char>(i / Width * Width + (Width - 1 - i % Width));
+  }
+  return mask;
+}
+
+template <typename U>
+XTOOL_TARGET_SSSE3 void swap_ssse3(char *data, std::size_t const size) {
+  static constexpr auto mask_bytes = shuffle_mask<sizeof(U)>();
+  auto const mask =
+      _mm_loadu_si128(reinterpret_cast<__m128i const *>(mask_bytes.data()));
+  std::size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    auto *p = reinterpret_cast<__m128i *>(data + i);
+    _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), mask));
+  }
+  swap_scalar<U>(data + i, size - i);
+}
+
+template <typename U>
+XTOOL_TARGET_AVX2 void swap_avx2(char *data, std::size_t const size) {
+  static constexpr auto mask_bytes = shuffle_mask<sizeof(U)>();
+  // vpshufb shuffles the two 128 bit lanes independently
+  auto const lane =
+      _mm_loadu_si128(reinterpret_cast<__m128i const *>(mask_bytes.data()));
+  auto const mask = _mm256_broadcastsi128_si256(lane);
+  std::size_t i = 0;
+  for (; i + 64 <= size; i += 64) {
+    auto *p0 = reinterpret_cast<__m256i *>(data + i);
+    auto *p1 = reinterpret_cast<__m256i *>(data + i + 32);
+    auto const v0 = _mm256_loadu_si256(p0);
+    auto const v1 = _mm256_loadu_si256(p1);
+    _mm256_storeu_si256(p0, _mm256_shuffle_epi8(v0, mask));
+    _mm256_storeu_si256(p1, _mm256_shuffle_epi8(v1, mask));
+  }
+  for (; i + 16 <= size; i += 16) {
+    auto *p = reinterpret_cast<__m128i *>(data + i);
+    _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), lane));
+  }
+  swap_scalar<U>(data + i, size - i);
+}
+#endif
+
+#ifdef XTOOL_SWAP_NEON
+template <typename U> void swap_neon(char *data, std::size_t const size) {
+  auto *p = reinterpret_cast<std::uint8_t *>(data);
+  std::size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    auto const v = vld1q_u8(p + i);
+    if constexpr (sizeof(U) == 2) {
+      vst1q_u8(p + i, vrev16q_u8(v));
+    } else if constexpr (sizeof(U) == 4) {
+      vst1q_u8(p + i, vrev32q_u8(v));
+    } else {
+      vst1q_u8(p + i, vrev64q_u8(v));
+    }
+  }
+  swap_scalar<U>(data + i, size - i);
+}
+#endif
+
+template <typename U> SwapFunction swap_function(SwapBackend const backend) {
+  switch (backend) {
+#ifdef XTOOL_SWAP_X86
+  case SwapBackend::ssse3:
+    return swap_ssse3<U>;
+  case SwapBackend::avx2:
+    return swap_avx2<U>;
+#endif
+#ifdef XTOOL_SWAP_NEON
+  case SwapBackend::neon:
+    return swap_neon<U>;
+#endif
+  default:
+    return swap_scalar<U>;
+  }
+}
+} // namespace
+
+std::string_view swap_backend_name(SwapBackend const backend) {
+  switch (backend) {
+  case SwapBackend::scalar:
+    return "scalar";
+  case SwapBackend::ssse3:
+    return "ssse3";
+  case SwapBackend::avx2:
+    return "avx2";
+  case SwapBackend::neon:
+    return "neon";
+  }
+  return "unknown";
+}
+
+bool is_swap_backend_supported(SwapBackend const backend) {
+  switch (backend) {
+  case SwapBackend::scalar:
+    return true;
+#ifdef XTOOL_SWAP_X86
+  case SwapBackend::ssse3:
+    return cpu_has_ssse3();
+  case SwapBackend::avx2:
+    return cpu_has_avx2();
+#endif
+#ifdef XTOOL_SWAP_NEON
+  case SwapBackend::neon:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+SwapBackend best_swap_backend() {
+  static SwapBackend const best = []() {
+    for (auto const backend :
+         {SwapBackend::avx2, SwapBackend::neon, SwapBackend::ssse3}) {
+      if (is_swap_backend_supported(backend)) {
+        return backend;
+      }
+    }
+    return SwapBackend::scalar;
+  }();
+  return best;
+}
+
+void swap_elements(char *data, std::size_t const count,
+                   std::uint32_t const width, SwapBackend const backend) {
+  if (!is_swap_backend_supported(backend)) {
+    throw std::invalid_argument(
+        fmt::format("Swap backend {} is not supported by this CPU.",
+                    swap_backend_name(backend)));
+  }
+  auto const size = count * width;
+  switch (width) {
+  case 1:
+    return;
+  case 2:
+    return swap_function<std::uint16_t>(backend)(data, size);
+  case 4:
+    return swap_function<std::uint32_t>(backend)(data, size);
+  case 8:
+    return swap_function<std::uint64_t>(backend)(data, size);
+  default:
+    throw std::invalid_argument(
+        fmt::format("Invalid element width {}, expected 1, 2, 4 or 8.", width));
+  }
+}
+
+void swap_elements(char *data, std::size_t const count,
+                   std::uint32_t const width) {
+  swap_elements(data, count, width, best_swap_backend());
+}
@@ -2,19 +2,74 @@
 #include <dolphin_manager.hpp>
 #include <spdlog/spdlog.h>
 
-DolphinManager::DolphinManager() { m_dolphin.init(); }
+namespace {
+DolphinComm::MemoryBackend DEFAULT_MEMORY_BACKEND =
+    DolphinComm::MemoryBackend::automatic;
+} // namespace
 
-DolphinComm::DolphinAccessor const &DolphinManager::dolphin() const {
+std::optional<DolphinComm::MemoryBackend>
+parse_memory_backend(std::string_view const name) {
+  if (name == "auto") {
+    return DolphinComm::MemoryBackend::automatic;
+  }
+  if (name == "process_vm_readv") {
+    return DolphinComm::MemoryBackend::processVmReadv;
+  }
+  if (name == "proc_mem") {
+    return DolphinComm::MemoryBackend::procMem;
+  }
+  return std::nullopt;
+}
+
+std::string_view
+memory_backend_name(DolphinComm::MemoryBackend const backend) {
+  switch (backend) {
+  case DolphinComm::MemoryBackend::automatic:
+    return "auto";
+  case DolphinComm::MemoryBackend::processVmReadv:
+    return "process_vm_readv";
+  case DolphinComm::MemoryBackend::procMem:
+    return "proc_mem";
+  }
+  return "unknown";
+}
+
+void set_default_memory_backend(DolphinComm::MemoryBackend const backend) {
+  DEFAULT_MEMORY_BACKEND = backend;
+}
+
+DolphinComm::MemoryBackend default_memory_backend() {
+  return DEFAULT_MEMORY_BACKEND;
+}
+
+DolphinManager::DolphinManager(int const pid)
+    : DolphinManager(pid, default_memory_backend()) {}
+
+DolphinManager::DolphinManager(int const pid,
+                               DolphinComm::MemoryBackend const backend) {
+  m_dolphin.setTargetPID(pid);
+  m_dolphin.setMemoryBackend(backend);
+  m_dolphin.init();
+}
+
+DolphinComm::DolphinAccessor &DolphinManager::dolphin() {
   this->hook_dolphin_if_not_hooked();
   return m_dolphin;
 }
 
-void DolphinManager::hook_dolphin_if_not_hooked() const {
+void DolphinManager::set_process(DolphinComm::IDolphinProcess *process) {
+  m_dolphin.init(process);
+}
+
+void DolphinManager::unhook() { m_dolphin.unHook(); }
+
+void DolphinManager::hook_dolphin_if_not_hooked() {
   auto const status = m_dolphin.getStatus();
   if (status != DolphinComm::DolphinStatus::hooked) {
     m_dolphin.hook();
-    if (status == DolphinComm::DolphinStatus::hooked) {
-      spdlog::info("dolphin process hooked, pid={:#x}.", m_dolphin.getPID());
+    if (m_dolphin.getStatus() == DolphinComm::DolphinStatus::hooked) {
+      spdlog::info("dolphin process hooked, pid={:#x}, memory backend {}.",
+                   m_dolphin.getPID(), m_dolphin.getMemoryBackendName());
       return;
     }
     spdlog::debug("Failed to hook dolphin.");
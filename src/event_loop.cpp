@@ -0,0 +1,163 @@
+#ifdef __linux__
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <event_loop.hpp>
+#include <fmt/format.h>
+#include <pthread.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace {
+[[noreturn]] void throw_errno(char const *what) {
+  throw std::runtime_error(fmt::format("{} failed: {}", what,
+                                       std::strerror(errno)));
+}
+} // namespace
+
+UniqueFd::~UniqueFd() { this->reset(); }
+
+UniqueFd::UniqueFd(UniqueFd &&other) noexcept : m_fd(other.m_fd) {
+  other.m_fd = -1;
+}
+
+UniqueFd &UniqueFd::operator=(UniqueFd &&other) noexcept {
+  if (this != &other) {
+    this->reset();
+    m_fd = other.m_fd;
+    other.m_fd = -1;
+  }
+  return *this;
+}
+
+void UniqueFd::reset() noexcept {
+  if (m_fd >= 0) {
+    close(m_fd);
+    m_fd = -1;
+  }
+}
+
+EventLoop::EventLoop() : m_epoll_fd(epoll_create1(EPOLL_CLOEXEC)) {
+  if (!m_epoll_fd.valid()) {
+    throw_errno("epoll_create1");
+  }
+}
+
+void EventLoop::add(int const fd, Handler handler) {
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  if (epoll_ctl(m_epoll_fd.get(), EPOLL_CTL_ADD, fd, &event) != 0) {
+    throw_errno("epoll_ctl(EPOLL_CTL_ADD)");
+  }
+  m_handlers.insert_or_assign(fd,
+                              std::make_unique<Handler>(std::move(handler)));
+}
+
+void EventLoop::remove(int const fd) {
+  auto const it = m_handlers.find(fd);
+  if (it == m_handlers.end()) {
+    return;
+  }
+  epoll_ctl(m_epoll_fd.get(), EPOLL_CTL_DEL, fd, nullptr);
+  // the handler may be the one running, park it until it returned
+  m_removed_handlers.push_back(std::move(it->second));
+  m_handlers.erase(it);
+}
+
+void EventLoop::run() {
+  m_running = true;
+  std::array<epoll_event, 16> events{};
+  while (m_running) {
+    auto const n = epoll_wait(m_epoll_fd.get(), events.data(),
+                              static_cast<int>(events.size()), -1);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw_errno("epoll_wait");
+    }
+    for (int i = 0; i < n && m_running; ++i) {
+      // an earlier handler of this batch may have removed it
+      auto const it = m_handlers.find(events[i].data.fd);
+      if (it != m_handlers.end()) {
+        (*it->second)();
+      }
+    }
+    m_removed_handlers.clear();
+  }
+}
+
+void EventLoop::stop() noexcept { m_running = false; }
+
+UniqueFd make_timerfd(std::chrono::milliseconds const interval) {
+  UniqueFd timer(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+  if (!timer.valid()) {
+    throw_errno("timerfd_create");
+  }
+  set_timerfd_interval(timer, interval);
+  return timer;
+}
+
+void set_timerfd_interval(UniqueFd const &timer,
+                          std::chrono::milliseconds const interval) {
+  auto const seconds =
+      std::chrono::duration_cast<std::chrono::seconds>(interval);
+  itimerspec spec{};
+  spec.it_interval.tv_sec = seconds.count();
+  spec.it_interval.tv_nsec =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(interval - seconds)
+          .count();
+  spec.it_value = spec.it_interval;
+  if (timerfd_settime(timer.get(), 0, &spec, nullptr) != 0) {
+    throw_errno("timerfd_settime");
+  }
+}
+
+std::uint64_t consume_timerfd(UniqueFd const &timer) {
+  std::uint64_t expirations = 0;
+  if (read(timer.get(), &expirations, sizeof(expirations)) !=
+      sizeof(expirations)) {
+    return 0;
+  }
+  return expirations;
+}
+
+UniqueFd make_signalfd(std::initializer_list<int> const signals) {
+  sigset_t mask;
+  sigemptyset(&mask);
+  for (auto const s : signals) {
+    sigaddset(&mask, s);
+  }
+  if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+    throw_errno("pthread_sigmask");
+  }
+  UniqueFd fd(signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC));
+  if (!fd.valid()) {
+    throw_errno("signalfd");
+  }
+  return fd;
+}
+
+int consume_signalfd(UniqueFd const &signals) {
+  signalfd_siginfo info{};
+  if (read(signals.get(), &info, sizeof(info)) != sizeof(info)) {
+    return -1;
+  }
+  return static_cast<int>(info.ssi_signo);
+}
+
+UniqueFd open_pidfd(int const pid) {
+#ifdef SYS_pidfd_open
+  if (pid > 0) {
+    return UniqueFd(static_cast<int>(syscall(SYS_pidfd_open, pid, 0)));
+  }
+#endif
+  return UniqueFd();
+}
+#endif
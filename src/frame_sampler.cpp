@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cmath>
+#include <frame_sampler.hpp>
+#include <stdexcept>
+
+namespace {
+// weight of the newest reading, about the last 4 readings count
+constexpr double RATE_SMOOTHING = 0.25;
+} // namespace
+
+FrameSampler::FrameSampler(std::uint32_t const frames_per_sample,
+                           std::chrono::milliseconds const clock_interval)
+    : m_frames_per_sample(frames_per_sample),
+      m_clock_interval_ns(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(clock_interval)
+              .count()) {
+  if (frames_per_sample == 0) {
+    throw std::invalid_argument("frames_per_sample must be at least 1.");
+  }
+}
+
+bool FrameSampler::on_frame(std::uint32_t const frame,
+                            std::int64_t const now_ns) {
+  if (!m_last_frame.has_value()) {
+    // first reading, no rate yet
+  } else if (frame == *m_last_frame) {
+    // Read again before a frame could pass at the last rate: keep the rate
+    // and the older reading it is measured from. Otherwise paused, the
+    // average would only decay towards 0.
+    auto const elapsed_ns = static_cast<double>(now_ns - m_last_ns);
+    if (m_rate.has_value() && elapsed_ns * *m_rate < 1.0) {
+      return this->on_due(frame, now_ns);
+    }
+    m_rate.reset();
+    m_paused = true;
+  } else if (frame < *m_last_frame || m_paused) {
+    // reset or another game, or resumed(the pause is not part of the rate),
+    // the old rate says nothing
+    m_rate.reset();
+    m_paused = false;
+  } else if (now_ns > m_last_ns) {
+    auto const rate = static_cast<double>(frame - *m_last_frame) /
+                      static_cast<double>(now_ns - m_last_ns);
+    m_rate = m_rate.has_value()
+                 ? *m_rate + RATE_SMOOTHING * (rate - *m_rate)
+                 : rate;
+  }
+  m_last_frame = frame;
+  m_last_ns = now_ns;
+  return this->on_due(frame, now_ns);
+}
+
+bool FrameSampler::on_due(std::uint32_t const frame,
+                          std::int64_t const now_ns) {
+  if (m_sample_frame.has_value() && frame >= *m_sample_frame &&
+      frame - *m_sample_frame < m_frames_per_sample) {
+    ++m_stats.early;
+    return false;
+  }
+  m_sample_frame = frame;
+  m_sample_ns = now_ns;
+  ++m_stats.samples;
+  return true;
+}
+
+bool FrameSampler::on_clock(std::int64_t const now_ns) {
+  // a timer firing a little early still counts
+  constexpr std::int64_t SLACK_NS = 1'000'000;
+  if (m_sample_frame.has_value() || m_stats.samples == 0 ||
+      now_ns - m_sample_ns + SLACK_NS >= m_clock_interval_ns) {
+    m_sample_frame.reset();
+    m_sample_ns = now_ns;
+    ++m_stats.samples;
+    return true;
+  }
+  ++m_stats.early;
+  return false;
+}
+
+std::chrono::milliseconds
+FrameSampler::next_delay(std::int64_t const now_ns,
+                         std::chrono::milliseconds const max_delay) const {
+  double delay_ns = 0.0;
+  if (!m_sample_frame.has_value()) {
+    delay_ns = static_cast<double>(m_sample_ns + m_clock_interval_ns - now_ns);
+  } else if (m_paused) {
+    delay_ns = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(max_delay)
+            .count());
+  } else if (!m_rate.has_value()) {
+    // one reading so far, assume the clock interval
+    delay_ns = static_cast<double>(m_clock_interval_ns);
+  } else {
+    // frames left since the last reading, half a frame late so the timer
+    // lands after the frame changed
+    auto const frames_done =
+        static_cast<double>(*m_last_frame - *m_sample_frame);
+    auto const frames_left =
+        std::max(0.0, m_frames_per_sample - frames_done) + 0.5;
+    delay_ns = frames_left / *m_rate -
+               static_cast<double>(now_ns - m_last_ns);
+  }
+  auto const delay_ms = static_cast<std::int64_t>(std::ceil(delay_ns / 1e6));
+  return std::clamp(std::chrono::milliseconds(delay_ms),
+                    std::chrono::milliseconds(1), max_delay);
+}
+
+void FrameSampler::reset() noexcept {
+  m_sample_frame.reset();
+  m_last_frame.reset();
+  m_rate.reset();
+  m_paused = false;
+}
+
+std::optional<double> FrameSampler::frames_per_second() const noexcept {
+  if (m_paused) {
+    return 0.0;
+  }
+  if (!m_rate.has_value()) {
+    return std::nullopt;
+  }
+  return *m_rate * 1e9;
+}
+
+FrameSampler::Stats FrameSampler::stats() const noexcept { return m_stats; }
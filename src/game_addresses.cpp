@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <dme/Common/CommonUtils.h>
+#include <game_addresses.hpp>
+#include <span>
+#include <spdlog/spdlog.h>
+
+std::uint32_t *game_address_field(GameAddresses &addresses,
+                                  std::string_view const name) {
+  if (name == "current_music_id") {
+    return &addresses.current_music_id;
+  }
+  if (name == "g_mtrand_seed") {
+    return &addresses.g_mtrand_seed;
+  }
+  return nullptr;
+}
+
+bool is_game_address_name(std::string_view const name) {
+  GameAddresses addresses;
+  return game_address_field(addresses, name) != nullptr ||
+         name == "frame_counter";
+}
+
+std::optional<GameAddresses>
+find_game_addresses(GameId const &game_id,
+                    std::vector<ConfiguredGameProfile> const &configured) {
+  auto const find = [&](auto const &profiles) -> GameAddresses const * {
+    GameAddresses const *any_revision = nullptr;
+    for (auto const &profile : profiles) {
+      if (profile.game_id != game_id.id) {
+        continue;
+      }
+      if (profile.revision == game_id.revision) {
+        return &profile.addresses;
+      }
+      if (!profile.revision.has_value() && any_revision == nullptr) {
+        any_revision = &profile.addresses;
+      }
+    }
+    return any_revision;
+  };
+  if (auto const *addresses = find(configured)) {
+    return *addresses;
+  }
+  if (auto const *addresses = find(GAME_PROFILES)) {
+    return *addresses;
+  }
+  return std::nullopt;
+}
+
+std::optional<GameId> game_id_of(DiscHeader const &header) {
+  GameId game_id{std::string(header.game_id.data(), header.game_id.size()),
+                 header.revision};
+  auto const is_valid =
+      std::all_of(game_id.id.begin(), game_id.id.end(), [](char const c) {
+        return std::isupper(static_cast<unsigned char>(c)) ||
+               std::isdigit(static_cast<unsigned char>(c));
+      });
+  if (!is_valid) {
+    return std::nullopt;
+  }
+  return game_id;
+}
+
+std::optional<GameAddresses> recorded_game_addresses(GameTrace const &trace) {
+  auto const music_id =
+      find_trace_address(trace, TraceAddressKind::current_music_id);
+  auto const seed = find_trace_address(trace, TraceAddressKind::g_mtrand_seed);
+  if (!music_id.has_value() || !seed.has_value()) {
+    return std::nullopt;
+  }
+  GameAddresses addresses;
+  addresses.current_music_id = trace.addresses[*music_id].offset;
+  addresses.g_mtrand_seed = trace.addresses[*seed].offset;
+  if (auto const frame_counter =
+          find_trace_address(trace, TraceAddressKind::frame_counter)) {
+    addresses.frame_counter = trace.addresses[*frame_counter].offset;
+  }
+  return addresses;
+}
+
+std::vector<WatchedAddress>
+game_trace_addresses(GameAddresses const &addresses,
+                     std::vector<WatchedAddress> const &extra_addresses) {
+  std::vector<WatchedAddress> result = {
+      {addresses.current_music_id, 2, TraceAddressKind::current_music_id},
+      {addresses.g_mtrand_seed, 4, TraceAddressKind::g_mtrand_seed},
+      // lets a replay pick the same game profile
+      {xtool::constants::DISC_HEADER.region_offset,
+       xtool::constants::DISC_HEADER.size, TraceAddressKind::disc_header}};
+  if (addresses.frame_counter.has_value()) {
+    result.push_back(
+        {*addresses.frame_counter, 4, TraceAddressKind::frame_counter});
+  }
+  for (auto const &extra : extra_addresses) {
+    if (std::ranges::none_of(result, [&](WatchedAddress const &a) {
+          return a.offset == extra.offset && a.size == extra.size;
+        })) {
+      result.push_back(extra);
+    }
+  }
+  return result;
+}
+
+GameAddressResolver::GameAddressResolver(
+    std::vector<ConfiguredGameProfile> profiles, SignatureConfig signature,
+    bool const assume_first_profile, std::optional<GameAddresses> recorded)
+    : m_profiles(std::move(profiles)), m_config(std::move(signature)),
+      m_assume_first_profile(assume_first_profile),
+      m_recorded(std::move(recorded)) {
+  if (!m_config.signatures.empty() && m_config.cache_path.has_value()) {
+    m_cache = std::make_shared<SignatureCache>(m_config.cache_path.value());
+  }
+}
+
+GameAddresses const *
+GameAddressResolver::addresses(DolphinComm::DolphinAccessor &dolphin) {
+  if (dolphin.getStatus() != DolphinComm::DolphinStatus::hooked) {
+    m_pid = -1;
+    return nullptr;
+  }
+  if (dolphin.getPID() != m_pid || !m_addresses.has_value()) {
+    m_pid = dolphin.getPID();
+    this->resolve(dolphin);
+  } else if (auto const now = std::chrono::steady_clock::now();
+             now - m_game_id_checked >= GAME_ID_CHECK_INTERVAL) {
+    // another game started in the same dolphin
+    m_game_id_checked = now;
+    bool readable = false;
+    auto const game_id = read_game_id(dolphin, readable);
+    if (game_id != m_game_id && (readable || !m_assume_first_profile)) {
+      this->resolve(dolphin);
+    }
+  }
+  return m_addresses.has_value() ? &m_addresses.value() : nullptr;
+}
+
+std::optional<GameId>
+GameAddressResolver::read_game_id(DolphinComm::DolphinAccessor &dolphin,
+                                  bool &readable) {
+  auto const header =
+      read_struct<DiscHeader>(dolphin, xtool::constants::DISC_HEADER);
+  readable = header.has_value();
+  return readable ? game_id_of(header.value()) : std::nullopt;
+}
+
+void GameAddressResolver::invalidate() noexcept { m_pid = -1; }
+
+void GameAddressResolver::resolve(DolphinComm::DolphinAccessor &dolphin) {
+  m_addresses.reset();
+  m_game_id_checked = std::chrono::steady_clock::now();
+  bool readable = false;
+  auto const game_id = read_game_id(dolphin, readable);
+  m_game_id = game_id;
+  if (!readable) {
+    if (m_assume_first_profile) {
+      // a game trace recorded before the header was watched
+      if (m_warned_game_id != "") {
+        spdlog::warn("Failed to read the game id, assume {}.",
+                     GAME_PROFILES.front().game_id);
+        m_warned_game_id = "";
+      }
+      m_addresses = GAME_PROFILES.front().addresses;
+      this->apply_recorded();
+    } else if (m_warned_game_id != "") {
+      spdlog::warn("Failed to read the game id, don't poll the game.");
+      m_warned_game_id = "";
+    }
+    return;
+  }
+
+  auto const name = game_id.has_value() ? game_id->id : "(no game id)";
+  auto const addresses = game_id.has_value()
+                             ? find_game_addresses(*game_id, m_profiles)
+                             : std::nullopt;
+  if (!addresses.has_value()) {
+    if (m_warned_game_id != name) {
+      spdlog::warn("Unknown game {}, xtool only polls the games of "
+                   "GAME_PROFILES and [xtool.profiles].",
+                   name);
+      m_warned_game_id = name;
+    }
+    return;
+  }
+  m_warned_game_id.reset();
+  m_addresses = addresses;
+  this->apply_recorded();
+  spdlog::info(
+      "Game {} revision {}, music id at {:#010x}, g_mtRand.seed at {:#010x}.",
+      game_id->id, game_id->revision,
+      Common::offsetToDolphinAddr(m_addresses->current_music_id, false),
+      Common::offsetToDolphinAddr(m_addresses->g_mtrand_seed, false));
+  if (m_addresses->frame_counter.has_value()) {
+    spdlog::info(
+        "Frame counter at {:#010x}, {} frames per second.",
+        Common::offsetToDolphinAddr(*m_addresses->frame_counter, false),
+        m_addresses->frame_rate);
+  }
+  if (!m_config.signatures.empty() && !m_recorded.has_value()) {
+    this->resolve_signatures(dolphin, *game_id);
+  }
+}
+
+void GameAddressResolver::apply_recorded() {
+  if (!m_recorded.has_value()) {
+    return;
+  }
+  m_addresses->current_music_id = m_recorded->current_music_id;
+  m_addresses->g_mtrand_seed = m_recorded->g_mtrand_seed;
+  if (m_recorded->frame_counter.has_value()) {
+    m_addresses->frame_counter = m_recorded->frame_counter;
+  }
+}
+
+void GameAddressResolver::resolve_signatures(
+    DolphinComm::DolphinAccessor &dolphin, GameId const &game_id) {
+  auto const begin = std::chrono::steady_clock::now();
+  std::vector<char> code(m_config.code_end - m_config.code_begin);
+  if (!dolphin.readFromRAM(
+          Common::dolphinAddrToOffset(m_config.code_begin, false), code.data(),
+          code.size(), false)) {
+    spdlog::warn("Failed to read the code region {:#010x}-{:#010x}.",
+                 m_config.code_begin, m_config.code_end);
+    m_pid = -1;
+    return;
+  }
+  auto const code_hash = hash_memory(code);
+
+  auto ram_cache_updated = false;
+  std::size_t scanned = 0;
+  for (auto const &signature : m_config.signatures) {
+    // frame_counter is optional, a profile without one has no address to
+    // keep when the signature is not resolved
+    auto *field = game_address_field(*m_addresses, signature.name);
+    auto const frame_counter = signature.name == "frame_counter";
+    if (field == nullptr && !frame_counter) {
+      continue;
+    }
+    auto address = m_cache ? m_cache->find(game_id.id, code_hash, signature)
+                           : std::nullopt;
+    if (!address.has_value()) {
+      if (!ram_cache_updated) {
+        if (dolphin.updateRAMCache() != Common::MemOperationReturnCode::OK) {
+          spdlog::warn("Failed to read the game memory for signatures.");
+          m_pid = -1;
+          return;
+        }
+        ram_cache_updated = true;
+      }
+      address = resolve_signature(
+          {dolphin.getRAMCache(), dolphin.getRAMCacheSize()},
+          dolphin.isARAMAccessible(), signature);
+      ++scanned;
+      if (address.has_value() && m_cache) {
+        m_cache->store(game_id.id, code_hash, signature, address.value());
+      }
+    }
+    if (!address.has_value() || !dolphin.isValidConsoleAddress(*address)) {
+      auto const kept =
+          frame_counter ? m_addresses->frame_counter : std::optional(*field);
+      if (kept.has_value()) {
+        spdlog::warn("Signature {} not resolved, keep {:#010x}.",
+                     signature.name,
+                     Common::offsetToDolphinAddr(*kept, false));
+      } else {
+        spdlog::warn("Signature {} not resolved, poll every 200 ms.",
+                     signature.name);
+      }
+      continue;
+    }
+    auto const offset = Common::dolphinAddrToOffset(*address, false);
+    if (frame_counter) {
+      m_addresses->frame_counter = offset;
+    } else {
+      *field = offset;
+    }
+    spdlog::info("{}: {} = {:#010x}.", game_id.id, signature.name, *address);
+  }
+  if (m_cache) {
+    m_cache->save();
+  }
+  auto const end = std::chrono::steady_clock::now();
+  spdlog::info(
+      "Resolved {} signatures for {}, {} scanned ({:.2f} ms).",
+      m_config.signatures.size(), game_id.id, scanned,
+      std::chrono::duration<double, std::milli>(end - begin).count());
+}
@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <constants.hpp>
+#include <cstring>
+#include <fmt/format.h>
+#include <game_trace.hpp>
+#include <stdexcept>
+
+namespace {
+constexpr std::array<char, 4> TRACE_MAGIC = {'X', 'T', 'R', 'C'};
+constexpr std::uint16_t TRACE_VERSION = 2;
+// the changed mask is one u64
+constexpr std::size_t MAX_WATCHED_ADDRESSES = 64;
+
+template <typename T> void write_le(std::ostream &os, T const value) {
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    os.put(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+template <typename T> T read_le(std::istream &is) {
+  T value = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    auto const c = is.get();
+    if (c == std::char_traits<char>::eof()) {
+      throw std::runtime_error("Unexpected end of game trace header.");
+    }
+    value |= static_cast<T>(static_cast<std::uint8_t>(c)) << (8 * i);
+  }
+  return value;
+}
+
+void write_varint(std::ostream &os, std::uint64_t value) {
+  while (value >= 0x80) {
+    os.put(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  os.put(static_cast<char>(value));
+}
+
+// false on a clean end of file before the first byte
+bool read_varint(std::istream &is, std::uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    auto const c = is.get();
+    if (c == std::char_traits<char>::eof()) {
+      if (shift == 0) {
+        return false;
+      }
+      throw std::runtime_error("Truncated game trace frame.");
+    }
+    value |= static_cast<std::uint64_t>(c & 0x7f) << shift;
+    if ((c & 0x80) == 0) {
+      return true;
+    }
+  }
+  throw std::runtime_error("Invalid varint in game trace.");
+}
+
+void validate_addresses(std::vector<WatchedAddress> const &addresses) {
+  if (addresses.empty() || addresses.size() > MAX_WATCHED_ADDRESSES) {
+    throw std::invalid_argument(fmt::format(
+        "Game trace needs 1 to {} watched addresses, got {}.",
+        MAX_WATCHED_ADDRESSES, addresses.size()));
+  }
+  for (auto const &a : addresses) {
+    if (a.size == 0 || a.size > 8) {
+      throw std::invalid_argument(fmt::format(
+          "Invalid watched address size {} at offset {:#x}.", a.size,
+          a.offset));
+    }
+    if (a.kind > TraceAddressKind::frame_counter) {
+      throw std::invalid_argument(fmt::format(
+          "Invalid watched address kind {} at offset {:#x}.",
+          static_cast<unsigned>(a.kind), a.offset));
+    }
+  }
+}
+
+// version 1 always recorded these at the xtool::constants addresses
+TraceAddressKind infer_v1_kind(WatchedAddress const &a) {
+  if (a.offset == xtool::constants::CURRENT_MUSIC_ID_ADDRESS && a.size == 2) {
+    return TraceAddressKind::current_music_id;
+  }
+  if (a.offset == xtool::constants::G_MTRAND_SEED_ADDRESS && a.size == 4) {
+    return TraceAddressKind::g_mtrand_seed;
+  }
+  if (a.offset == 0 && a.size == 8) {
+    return TraceAddressKind::disc_header;
+  }
+  return TraceAddressKind::watched;
+}
+} // namespace
+
+std::uint64_t pack_trace_value(char const *bytes, std::uint32_t const size) {
+  std::uint64_t value = 0;
+  for (std::uint32_t i = 0; i < size; ++i) {
+    value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(bytes[i]))
+             << (8 * i);
+  }
+  return value;
+}
+
+void unpack_trace_value(std::uint64_t const value, char *bytes,
+                        std::uint32_t const size) {
+  for (std::uint32_t i = 0; i < size; ++i) {
+    bytes[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+}
+
+GameTraceWriter::GameTraceWriter(std::filesystem::path const &path,
+                                 std::vector<WatchedAddress> addresses)
+    : m_file(path, std::ios::binary | std::ios::trunc),
+      m_addresses(std::move(addresses)),
+      m_previous_values(m_addresses.size(), 0) {
+  validate_addresses(m_addresses);
+  if (!m_file) {
+    throw std::runtime_error(
+        fmt::format("Failed to open {} for writing.", path.string()));
+  }
+  m_file.write(TRACE_MAGIC.data(), TRACE_MAGIC.size());
+  write_le<std::uint16_t>(m_file, TRACE_VERSION);
+  write_le<std::uint16_t>(m_file,
+                          static_cast<std::uint16_t>(m_addresses.size()));
+  for (auto const &a : m_addresses) {
+    write_le<std::uint32_t>(m_file, a.offset);
+    write_le<std::uint32_t>(m_file, a.size);
+    write_le<std::uint8_t>(m_file, static_cast<std::uint8_t>(a.kind));
+  }
+  m_file.flush();
+}
+
+void GameTraceWriter::write(std::uint64_t const time_us,
+                            std::vector<std::uint64_t> const &values) {
+  if (values.size() != m_addresses.size()) {
+    throw std::invalid_argument(
+        fmt::format("Expected {} values, got {}.", m_addresses.size(),
+                    values.size()));
+  }
+  if (time_us < m_previous_time_us) {
+    throw std::invalid_argument("Game trace time went backwards.");
+  }
+
+  std::uint64_t changed_mask = 0;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (values[i] != m_previous_values[i]) {
+      changed_mask |= std::uint64_t{1} << i;
+    }
+  }
+  // the first frame is always written so the replay knows the start values
+  if (changed_mask == 0 && m_written_frames != 0) {
+    return;
+  }
+
+  write_varint(m_file, time_us - m_previous_time_us);
+  write_varint(m_file, changed_mask);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (changed_mask & (std::uint64_t{1} << i)) {
+      write_varint(m_file, values[i] ^ m_previous_values[i]);
+    }
+  }
+  // keep the file valid if xtool is killed while recording
+  m_file.flush();
+  if (!m_file) {
+    throw std::runtime_error("Failed to write game trace.");
+  }
+
+  m_previous_values = values;
+  m_previous_time_us = time_us;
+  ++m_written_frames;
+}
+
+std::uint64_t GameTraceWriter::written_frames() const noexcept {
+  return m_written_frames;
+}
+
+GameTrace load_game_trace(std::filesystem::path const &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error(
+        fmt::format("Failed to open game trace {}.", path.string()));
+  }
+  std::array<char, 4> magic{};
+  file.read(magic.data(), magic.size());
+  if (!file || magic != TRACE_MAGIC) {
+    throw std::runtime_error(
+        fmt::format("{} is not a game trace.", path.string()));
+  }
+  auto const version = read_le<std::uint16_t>(file);
+  if (version != 1 && version != TRACE_VERSION) {
+    throw std::runtime_error(
+        fmt::format("Unsupported game trace version {}.", version));
+  }
+
+  GameTrace trace;
+  auto const count = read_le<std::uint16_t>(file);
+  trace.addresses.reserve(count);
+  for (std::uint16_t i = 0; i < count; ++i) {
+    WatchedAddress a{};
+    a.offset = read_le<std::uint32_t>(file);
+    a.size = read_le<std::uint32_t>(file);
+    a.kind = version == 1
+                 ? infer_v1_kind(a)
+                 : static_cast<TraceAddressKind>(read_le<std::uint8_t>(file));
+    trace.addresses.push_back(a);
+  }
+  validate_addresses(trace.addresses);
+
+  std::vector<std::uint64_t> values(count, 0);
+  std::uint64_t time_us = 0;
+  std::uint64_t delta_us = 0;
+  while (read_varint(file, delta_us)) {
+    std::uint64_t changed_mask = 0;
+    if (!read_varint(file, changed_mask)) {
+      throw std::runtime_error("Truncated game trace frame.");
+    }
+    if (std::bit_width(changed_mask) > count) {
+      throw std::runtime_error("Invalid changed mask in game trace.");
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      if (changed_mask & (std::uint64_t{1} << i)) {
+        std::uint64_t x = 0;
+        if (!read_varint(file, x)) {
+          throw std::runtime_error("Truncated game trace frame.");
+        }
+        values[i] ^= x;
+      }
+    }
+    time_us += delta_us;
+    trace.frames.push_back({time_us, values});
+  }
+  return trace;
+}
+
+bool is_game_trace_file(std::filesystem::path const &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::array<char, 4> magic{};
+  file.read(magic.data(), magic.size());
+  return file && magic == TRACE_MAGIC;
+}
+
+std::optional<std::size_t> find_trace_address(GameTrace const &trace,
+                                              TraceAddressKind const kind) {
+  auto const it = std::ranges::find(trace.addresses, kind,
+                                    &WatchedAddress::kind);
+  if (it == trace.addresses.end()) {
+    return std::nullopt;
+  }
+  return static_cast<std::size_t>(it - trace.addresses.begin());
+}
@@ -6,7 +6,7 @@
 void inspect_config(std::string_view const config_file_path) {
 
   spdlog::info("Inspect config");
-  Playlist playlist(config_file_path);
+  Playlist playlist(config_file_path, PlaylistValidation::eager);
 
   auto const &music_map = playlist.music_map();
   auto const &brawl_music_id_to_playlist_entry_map =
@@ -19,11 +19,19 @@ void inspect_config(std::string_view const config_file_path) {
   spdlog::info("Playlists");
   // print all playlist entries
   for (auto const &pe : playlist_entries) {
-    spdlog::info("Playlist {}, {} target ids, {} musics.", pe->name,
-                 pe->target_music_ids.size(), pe->music_entries.size());
-    for (auto const unique_music_id : pe->music_entries) {
-      auto const &music = music_map.at(unique_music_id);
-      spdlog::info(fmt::format("Music: {}", music));
+    spdlog::info("Playlist {}, {} target ids, {} musics, weighted: {}, no "
+                 "repeat: {}.",
+                 pe->name, pe->target_music_ids.size(),
+                 pe->music_entries.size(), !pe->weights.empty(),
+                 pe->history.capacity);
+    for (std::size_t i = 0; i < pe->music_entries.size(); ++i) {
+      auto const &music = music_map.at(pe->music_entries[i]);
+      if (pe->weights.empty()) {
+        spdlog::info(fmt::format("Music: {}", music));
+      } else {
+        spdlog::info(
+            fmt::format("Music: {}, weight={}", music, pe->weights[i]));
+      }
     }
   }
 
@@ -50,7 +58,7 @@ void inspect_config(std::string_view const config_file_path) {
 void inspect_musics(std::string_view const config_file_path,
                     std::vector<UniqueMusicID> const &unique_music_ids) {
   spdlog::info("Inspect registered musics");
-  Playlist pl(config_file_path);
+  Playlist pl(config_file_path, PlaylistValidation::eager);
 
   auto const &playlist_entries = pl.playlist_entries();
 
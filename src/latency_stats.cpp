@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <latency_stats.hpp>
+#include <spdlog/spdlog.h>
+
+static_assert(std::atomic_uint64_t::is_always_lock_free);
+
+std::int64_t steady_now_ns() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::size_t LatencyHistogram::bucket_index(std::uint64_t const value) {
+  constexpr std::uint64_t sub_bucket_count = 1u << SUB_BUCKET_BITS;
+  if (value < sub_bucket_count) {
+    return static_cast<std::size_t>(value);
+  }
+  // value >> shift is in [32, 64)
+  auto const shift =
+      static_cast<unsigned>(std::bit_width(value)) - (SUB_BUCKET_BITS + 1);
+  return ((shift + 1) << SUB_BUCKET_BITS) +
+         static_cast<std::size_t>((value >> shift) - sub_bucket_count);
+}
+
+std::uint64_t LatencyHistogram::bucket_highest_value(std::size_t const index) {
+  constexpr std::uint64_t sub_bucket_count = 1u << SUB_BUCKET_BITS;
+  if (index < sub_bucket_count) {
+    return index;
+  }
+  auto const shift = (index >> SUB_BUCKET_BITS) - 1;
+  auto const sub = (index & (sub_bucket_count - 1)) + sub_bucket_count;
+  // the last bucket ends at UINT64_MAX, (sub + 1) << shift wraps to 0
+  return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(std::uint64_t const value) noexcept {
+  m_counts[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_sum.fetch_add(value, std::memory_order_relaxed);
+
+  auto current_min = m_min.load(std::memory_order_relaxed);
+  while (value < current_min &&
+         !m_min.compare_exchange_weak(current_min, value,
+                                      std::memory_order_relaxed)) {
+  }
+  auto current_max = m_max.load(std::memory_order_relaxed);
+  while (value > current_max &&
+         !m_max.compare_exchange_weak(current_max, value,
+                                      std::memory_order_relaxed)) {
+  }
+}
+
+std::uint64_t LatencyHistogram::count() const noexcept {
+  return m_count.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::min() const noexcept {
+  return this->count() == 0 ? 0 : m_min.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::max() const noexcept {
+  return m_max.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const noexcept {
+  auto const n = this->count();
+  if (n == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(m_sum.load(std::memory_order_relaxed)) /
+         static_cast<double>(n);
+}
+
+std::uint64_t LatencyHistogram::percentile(double const p) const noexcept {
+  auto const n = this->count();
+  if (n == 0) {
+    return 0;
+  }
+  auto const rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::clamp(p, 0.0, 100.0) / 100.0 *
+                                        static_cast<double>(n) +
+                                    0.5));
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+    seen += m_counts[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return std::min(bucket_highest_value(i), this->max());
+    }
+  }
+  return this->max();
+}
+
+void LatencyHistogram::reset() noexcept {
+  for (auto &c : m_counts) {
+    c.store(0, std::memory_order_relaxed);
+  }
+  m_count.store(0, std::memory_order_relaxed);
+  m_sum.store(0, std::memory_order_relaxed);
+  m_min.store(UINT64_MAX, std::memory_order_relaxed);
+  m_max.store(0, std::memory_order_relaxed);
+}
+
+std::string_view switch_stage_name(SwitchStage const stage) {
+  switch (stage) {
+  case SwitchStage::detection:
+    return "detection";
+  case SwitchStage::selection:
+    return "selection";
+  case SwitchStage::decoder_init:
+    return "decoder init";
+  case SwitchStage::device_start:
+    return "device start";
+  case SwitchStage::first_callback:
+    return "first callback";
+  case SwitchStage::detection_to_device_start:
+    return "to device start";
+  case SwitchStage::total:
+    return "total";
+  case SwitchStage::count_:
+    break;
+  }
+  return "unknown";
+}
+
+void SwitchLatencyStats::record(SwitchTimestamps const &t) noexcept {
+  auto const add = [this](SwitchStage const stage, std::int64_t const from,
+                          std::int64_t const to) {
+    m_histograms[static_cast<std::size_t>(stage)].record(
+        static_cast<std::uint64_t>(std::max<std::int64_t>(0, to - from)));
+  };
+  add(SwitchStage::detection, t.sampled_ns, t.detected_ns);
+  add(SwitchStage::selection, t.detected_ns, t.selected_ns);
+  add(SwitchStage::decoder_init, t.selected_ns, t.decoder_ready_ns);
+  add(SwitchStage::device_start, t.decoder_ready_ns, t.device_started_ns);
+  add(SwitchStage::first_callback, t.device_started_ns, t.first_callback_ns);
+  add(SwitchStage::detection_to_device_start, t.detected_ns,
+      t.device_started_ns);
+  add(SwitchStage::total, t.sampled_ns, t.first_callback_ns);
+}
+
+LatencyHistogram const &
+SwitchLatencyStats::histogram(SwitchStage const stage) const {
+  return m_histograms.at(static_cast<std::size_t>(stage));
+}
+
+void SwitchLatencyStats::log() const {
+  constexpr auto ms = [](auto const ns) {
+    return static_cast<double>(ns) / 1e6;
+  };
+  spdlog::info("Music switch latency(ms), memory sample -> first audio "
+               "callback:");
+  for (std::size_t i = 0; i < m_histograms.size(); ++i) {
+    auto const &h = m_histograms[i];
+    spdlog::info("{:>15}: n={} min={:.3f} p50={:.3f} p90={:.3f} p99={:.3f} "
+                 "p99.9={:.3f} max={:.3f} mean={:.3f}",
+                 switch_stage_name(static_cast<SwitchStage>(i)), h.count(),
+                 ms(h.min()), ms(h.percentile(50.0)), ms(h.percentile(90.0)),
+                 ms(h.percentile(99.0)), ms(h.percentile(99.9)), ms(h.max()),
+                 h.mean() / 1e6);
+  }
+}
@@ -0,0 +1,57 @@
+#include <logging.hpp>
+#include <memory>
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#ifndef _WIN32
+#include <csignal>
+#include <pthread.h>
+#endif
+
+std::optional<spdlog::async_overflow_policy>
+parse_log_overflow_policy(std::string_view const name) {
+  if (name == "block") {
+    return spdlog::async_overflow_policy::block;
+  }
+  if (name == "overrun-oldest") {
+    return spdlog::async_overflow_policy::overrun_oldest;
+  }
+  return std::nullopt;
+}
+
+void setup_logger(LoggerConfig const &config) {
+  std::shared_ptr<spdlog::logger> logger;
+  if (config.synchronous) {
+    logger = spdlog::stdout_color_mt("xtool-logger");
+  } else {
+#ifndef _WIN32
+    // the logging thread must never take process signals, the play loop
+    // reads them from a signalfd
+    sigset_t all;
+    sigset_t previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+#endif
+    // one worker keeps the output in order
+    spdlog::init_thread_pool(config.queue_size, 1);
+#ifndef _WIN32
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+#endif
+    logger = std::make_shared<spdlog::async_logger>(
+        "xtool-logger",
+        std::make_shared<spdlog::sinks::stdout_color_sink_mt>(),
+        spdlog::thread_pool(), config.overflow_policy);
+    spdlog::register_logger(logger);
+  }
+  spdlog::set_default_logger(logger);
+}
+
+LoggerShutdownGuard::~LoggerShutdownGuard() {
+  if (auto const pool = spdlog::thread_pool();
+      pool != nullptr && pool->overrun_counter() > 0) {
+    spdlog::warn("{} log lines were dropped, the log queue was full.",
+                 pool->overrun_counter());
+  }
+  spdlog::shutdown();
+}
@@ -1,41 +1,91 @@
 #include "dolphin_manager.hpp"
 #include "playlist.hpp"
 #include <algorithm>
+#include <array>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <spdlog/common.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <stdexcept>
 #include <string_view>
 
-#define MINIAUDIO_IMPLEMENTATION
-#include <miniaudio.h>
-
 #include <argparse/argparse.hpp>
 #include <atomic>
+#include <audio_cache.hpp>
+#include <bench.hpp>
 #include <cassert>
+#include <console_address.hpp>
+#include <csignal>
 #include <constants.hpp>
+#include <event_loop.hpp>
+#include <frame_sampler.hpp>
+#include <game_addresses.hpp>
+#include <dme/DolphinProcess/Replay/ReplayDolphinProcess.h>
+#include <game_trace.hpp>
 #include <inspection.hpp>
 #include <iostream>
+#include <latency_stats.hpp>
+#include <logging.hpp>
+#include <memory_diff.hpp>
+#include <memory_scan.hpp>
 #include <music_player.hpp>
+#include <netplay_sim.hpp>
+#include <record.hpp>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 #include <test_seed.hpp>
 #include <thread>
+#include <trace_events.hpp>
 #include <unordered_set>
+#include <vector>
+#include <worker_pool.hpp>
 #include <xtool.hpp>
+#include <xtool_config.hpp>
 
-#ifdef _WIN32
-#include <winsock.h>
-#else
-#include <endian.h>
+#ifndef _WIN32
+#include <unistd.h>
 #endif
 
-std::atomic_uint16_t CURRENT_MUSIC_ID(0xffff); // 0xffff = no music
-std::atomic_uint32_t CURRENT_G_MTRAND_SEED(0x0);
+SwitchLatencyStats SWITCH_LATENCY_STATS;
+
+// set from signal handlers
+std::atomic_bool EXIT_REQUESTED(false);
+std::atomic_bool PRINT_STATS_REQUESTED(false);
+static_assert(std::atomic_bool::is_always_lock_free);
+
+extern "C" void on_exit_signal(int) { EXIT_REQUESTED.store(true); }
+extern "C" void on_print_stats_signal(int) {
+  PRINT_STATS_REQUESTED.store(true);
+}
+
+// What the reader of one dolphin instance publishes to its player.
+struct GameState {
+  // host byte order
+  std::atomic_uint16_t music_id{0xffff}; // 0xffff = no music
+  std::atomic_uint32_t g_mtrand_seed{0x0};
+  // steady_now_ns() when the reader loop first saw music_id
+  std::atomic_int64_t music_id_sample_ns{0};
+  std::atomic_bool print_stats_requested{false};
+  // the dolphin instance is gone
+  std::atomic_bool stop_requested{false};
+
+  // the player thread sleeps on this until the reader publishes a new id
+  std::mutex wake_mutex;
+  std::condition_variable wake_cv;
+
+  void wake_player() {
+    // empty critical section, so the update can not slip in between the
+    // player's predicate check and its wait
+    { std::lock_guard lock(wake_mutex); }
+    wake_cv.notify_one();
+  }
+};
 
 static const std::unordered_set<std::uint16_t> IGNORE_MUSIC_ID_SET{0xffff,
                                                                    0xcccc, 0x0};
@@ -58,28 +108,72 @@ void print_dolphin_status(DolphinComm::DolphinAccessor const &dolphin) {
 }
 */
 
-void music_player_thread_main(Playlist &&playlist,
-                              bool const is_use_std_random_device) {
+// wait after the audio device failed to play a music
+constexpr auto PLAY_RETRY_INTERVAL = std::chrono::milliseconds(500);
+
+void music_player_thread_main(GameState &state, Playlist &&playlist,
+                              bool const is_use_std_random_device,
+                              SeedSelectorVersion const selector_version,
+                              DecodedAudioCache *audio_cache) {
+  xtool::trace::set_thread_name("player");
   try {
     // initialize system
 
     spdlog::info("Initialize music player.");
-    auto music_player = MusicPlayer();
+    auto music_player = MusicPlayer(audio_cache);
     spdlog::info("Initialized music player successfully.");
 
     std::uint16_t current_music_id{0xffff};
     std::optional<MusicEntry> current_music_entry = std::nullopt;
+    // switch waiting for its first audio callback
+    std::optional<SwitchTimestamps> pending_switch = std::nullopt;
+    // Selected music the audio device failed to play. It is played again at
+    // retry_at without selecting again, so the playlist history and the
+    // seed stay the same as the netplay peers'.
+    std::optional<MusicEntry> retry_music_entry = std::nullopt;
+    std::chrono::steady_clock::time_point retry_at;
+
+    // false if music_entry did not start
+    auto const play = [&](MusicEntry const &music_entry) {
+      auto const play_result = music_player.play(music_entry);
+      if (play_result == PlayResult::source_error) {
+        spdlog::error("Failed to play music.");
+        playlist.quarantine(music_entry.unique_music_id);
+        retry_music_entry = std::nullopt;
+        return false;
+      }
+      if (play_result == PlayResult::device_error) {
+        // the music is fine, the device may be back later
+        spdlog::error("Failed to play music, retry in {} ms.",
+                      PLAY_RETRY_INTERVAL.count());
+        retry_music_entry = music_entry;
+        retry_at = std::chrono::steady_clock::now() + PLAY_RETRY_INTERVAL;
+        return false;
+      }
+      retry_music_entry = std::nullopt;
+      return true;
+    };
 
-    while (true) {
-      std::uint16_t const music_id =
-#ifdef _WIN32
-          // use winsock function
-          ntohs(CURRENT_MUSIC_ID.load());
-#else
-          be16toh(CURRENT_MUSIC_ID.load());
-#endif
+    while (!EXIT_REQUESTED.load() && !state.stop_requested.load()) {
+      if (pending_switch.has_value() && music_player.first_callback_ns() != 0) {
+        pending_switch->first_callback_ns = music_player.first_callback_ns();
+        SWITCH_LATENCY_STATS.record(pending_switch.value());
+        pending_switch = std::nullopt;
+      }
+      if (state.print_stats_requested.exchange(false)) {
+        music_player.callback_metrics().log();
+      }
+
+      std::uint16_t const music_id = state.music_id.load();
 
       if (music_id != current_music_id) {
+        XTOOL_TRACE_SCOPE("music switch");
+        SwitchTimestamps timestamps;
+        timestamps.detected_ns = steady_now_ns();
+        timestamps.sampled_ns = state.music_id_sample_ns.load();
+        pending_switch = std::nullopt;
+        retry_music_entry = std::nullopt;
+
         spdlog::info("Music change detected: {:#x} -> {:#x}", current_music_id,
                      music_id);
         current_music_id = music_id;
@@ -92,14 +186,17 @@ void music_player_thread_main(Playlist &&playlist,
         // music changed in game, play
 
         // retrieve g_mtRand.seed value
-        std::uint32_t const seed = CURRENT_G_MTRAND_SEED.load();
+        std::uint32_t const seed = state.g_mtrand_seed.load();
         std::optional<MusicEntry> music_entry_opt;
-        if (is_use_std_random_device) {
-          music_entry_opt =
-              playlist.random_music_for_with_std_random_device(music_id);
-        } else {
-          music_entry_opt =
-              playlist.random_music_for_with_g_mtRand_seed(music_id, seed);
+        {
+          XTOOL_TRACE_SCOPE("selection");
+          if (is_use_std_random_device) {
+            music_entry_opt =
+                playlist.random_music_for_with_std_random_device(music_id);
+          } else {
+            music_entry_opt = playlist.random_music_for_with_g_mtRand_seed(
+                music_id, seed, selector_version);
+          }
         }
 
         if (!music_entry_opt.has_value()) {
@@ -108,86 +205,545 @@ void music_player_thread_main(Playlist &&playlist,
           continue;
         }
 
+        timestamps.selected_ns = steady_now_ns();
+
         auto const music_entry = music_entry_opt.value();
         current_music_entry = music_entry;
 
-        if (!music_player.play(music_entry)) {
-          spdlog::error("Failed to play music.");
+        if (!play(music_entry)) {
           std::this_thread::sleep_for(std::chrono::milliseconds(1));
           continue;
         }
+        timestamps.decoder_ready_ns =
+            music_player.last_play_timestamps().decoder_ready_ns;
+        timestamps.device_started_ns =
+            music_player.last_play_timestamps().device_started_ns;
+        pending_switch = timestamps;
+      } else if (retry_music_entry.has_value() &&
+                 std::chrono::steady_clock::now() >= retry_at) {
+        // not a switch of the game, its latency is not recorded
+        auto const music_entry = retry_music_entry.value();
+        play(music_entry);
       }
 
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      // Sleep until the reader publishes a new id or stats / exit are
+      // requested. A switch waiting for its first audio callback is
+      // checked every few ms.
+      std::unique_lock lock(state.wake_mutex);
+      auto const woken = [&]() {
+        return EXIT_REQUESTED.load() || state.stop_requested.load() ||
+               state.print_stats_requested.load() ||
+               state.music_id.load() != current_music_id;
+      };
+      if (pending_switch.has_value()) {
+        state.wake_cv.wait_for(lock, std::chrono::milliseconds(5), woken);
+      } else if (retry_music_entry.has_value()) {
+        state.wake_cv.wait_until(lock, retry_at, woken);
+      } else {
+        state.wake_cv.wait(lock, woken);
+      }
     }
+    music_player.callback_metrics().log();
   } catch (std::exception const &e) {
     spdlog::error("Exception: {}", e.what());
   }
 }
 
-void xtool_play_music_main(std::string_view const config_file_path,
-                           bool const is_use_std_random_device) {
+// sampling without a frame counter in the game profile
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds(200);
+// dolphin not running or not in game, every hook attempt scans /proc. Also
+// the longest wait for a sample of a paused game.
+constexpr auto IDLE_INTERVAL = std::chrono::milliseconds(1000);
+
+// One dolphin instance: its own accessor, game addresses and player(and so
+// its own audio device).
+struct DolphinSession {
+  DolphinSession(int const pid, GameAddressResolver resolver,
+                 std::uint32_t const frames_per_sample)
+      : pid(pid), dm(pid), resolver(std::move(resolver)),
+        sampler(frames_per_sample, POLL_INTERVAL) {}
+
+  // -1 = the first dolphin found
+  int pid;
   DolphinManager dm;
+  GameAddressResolver resolver;
+  GameState state;
+  std::uint16_t previous_music_id = 0xffff;
+  FrameSampler sampler;
+  // GameAddresses::frame_rate while sampling on frames
+  std::optional<double> frame_rate;
+  // the process of dm with --replay, owned by dm
+  DolphinComm::ReplayDolphinProcess const *replay = nullptr;
+  // the last frame of the replay was published, the next tick ends it
+  bool replay_finished = false;
+  std::thread player_thread;
+#ifdef __linux__
+  // watches the hooked process so its exit is noticed without failed reads
+  UniqueFd pidfd;
+  int watched_pid = -1;
+#endif
+};
+
+void log_sampling_stats(DolphinSession const &session) {
+  auto const name = session.pid == -1
+                        ? std::string("dolphin")
+                        : fmt::format("dolphin(pid={})", session.pid);
+  auto const stats = session.sampler.stats();
+  auto const fps = session.sampler.frames_per_second();
+  if (session.frame_rate.has_value() && fps.has_value()) {
+    spdlog::info("{}: emulation speed {:.1f}%({:.2f} fps), {} samples, {} "
+                 "early wakeups.",
+                 name, *fps / *session.frame_rate * 100.0, *fps,
+                 stats.samples, stats.early);
+  } else {
+    spdlog::info("{}: no frame counter, {} samples every {} ms.", name,
+                 stats.samples, POLL_INTERVAL.count());
+  }
+}
 
-  spdlog::info("Load config file '{}'.", config_file_path);
-  Playlist pl(config_file_path);
-  spdlog::info("Loaded config file successfully.");
+// Reads the music id and the seed and publishes them to the player when a
+// sample is due(see FrameSampler). false if the game memory could not be
+// read.
+bool poll_game_memory(DolphinSession &session) {
+  auto &dm = session.dm;
+  // read emulator memory
+  std::uint16_t music_id = 0;
+  std::uint32_t seed;
+  static_assert(sizeof(std::uint32_t) == 0x4);
+  bool read1 = false;
+  bool read2 = false;
+  {
+    XTOOL_TRACE_SCOPE("poll");
+    auto const *addresses = session.resolver.addresses(dm.dolphin());
+    if (addresses == nullptr) {
+      // not a game xtool knows, don't read anything
+      session.sampler.reset();
+      return false;
+    }
+    if (addresses->frame_counter.has_value()) {
+      auto const frame = [&]() {
+        XTOOL_TRACE_SCOPE("read frame counter");
+        return read_console<std::uint32_t>(dm.dolphin(),
+                                           *addresses->frame_counter);
+      }();
+      if (!frame.has_value()) {
+        session.resolver.invalidate();
+        session.sampler.reset();
+        spdlog::error("Failed to read the frame counter from the game memory.");
+        return false;
+      }
+      session.frame_rate = addresses->frame_rate;
+      if (!session.sampler.on_frame(*frame, steady_now_ns())) {
+        // frames_per_sample frames have not passed yet
+        return true;
+      }
+      if (auto const fps = session.sampler.frames_per_second()) {
+        XTOOL_TRACE_COUNTER("emulation speed %",
+                            *fps / addresses->frame_rate * 100.0);
+      }
+    } else {
+      session.frame_rate.reset();
+      if (!session.sampler.on_clock(steady_now_ns())) {
+        return true;
+      }
+    }
+    read1 = [&]() {
+      XTOOL_TRACE_SCOPE("read music id");
+      auto const value = read_console<std::uint16_t>(
+          dm.dolphin(), addresses->current_music_id);
+      music_id = value.value_or(0);
+      return value.has_value();
+    }();
+    read2 = [&]() {
+      XTOOL_TRACE_SCOPE("read seed");
+      // kept in console byte order, the seed selectors take the raw value
+      return dm.dolphin().readFromRAM(addresses->g_mtrand_seed,
+                                      (char *)(&seed), 0x4, false);
+    }();
+  }
+
+  if (!read1 || !read2) {
+    // the game may have been stopped, look at the next one again
+    session.resolver.invalidate();
+  }
+  if (!read1) {
+    spdlog::error("Failed to read current music id from the game memory.");
+    return false;
+  }
+  if (!read2) {
+    spdlog::error("Failed to read g_mtRand.seed from the game memory.");
+    return false;
+  }
+
+  // spdlog::info("Current music id:
+  //  {:#x}", music_id);
+
+  auto &state = session.state;
+  auto const changed = music_id != session.previous_music_id;
+  if (changed) {
+    // published before the id so the player never sees a stale time
+    state.music_id_sample_ns.store(steady_now_ns());
+    session.previous_music_id = music_id;
+    XTOOL_TRACE_COUNTER("music id", music_id);
+  }
+  state.music_id.store(music_id);
+  state.g_mtrand_seed.store(seed);
+  if (changed) {
+    state.wake_player();
+  }
+  if (session.replay != nullptr && session.replay->isFinished()) {
+    session.replay_finished = true;
+  }
+  return true;
+}
+
+struct PlayMusicOptions {
+  bool is_use_std_random_device = false;
+  SeedSelectorVersion selector_version = SeedSelectorVersion::v2;
+  PlaylistValidation validation = PlaylistValidation::eager;
+  // emulated frames between samples with a frame counter
+  std::uint32_t frames_per_sample = 12;
+  // a session per running dolphin instead of the first one found
+  bool all_instances = false;
+  // decoded audio shared by the sessions of all_instances, 0 = none
+  std::size_t audio_cache_bytes = 0;
+  // read instead of dolphin(--replay), single session only. xtool exits
+  // after its last frame.
+  std::unique_ptr<DolphinComm::ReplayDolphinProcess> replay;
+  // the addresses replay was recorded at(see recorded_game_addresses)
+  std::optional<GameAddresses> replay_addresses;
+};
+
+// The dolphin instances the reader serves. Every session plays a fork of
+// the playlist, so each instance keeps its own history.
+class DolphinSessions {
+public:
+  DolphinSessions(Playlist const &playlist, GameAddressResolver resolver,
+                  PlayMusicOptions const &options,
+                  DecodedAudioCache *audio_cache)
+      : m_playlist(playlist), m_resolver(std::move(resolver)),
+        m_options(options), m_audio_cache(audio_cache) {}
+  DolphinSessions(DolphinSessions const &) = delete;
+  DolphinSessions &operator=(DolphinSessions const &) = delete;
+  ~DolphinSessions() {
+    while (!m_sessions.empty()) {
+      remove(*m_sessions.back());
+    }
+  }
 
-  auto music_player_thread = std::thread(
-      music_player_thread_main, std::move(pl), is_use_std_random_device);
+  // Starts the player of dolphin pid(-1 = the first dolphin found).
+  DolphinSession &add(int const pid, Playlist &&playlist) {
+    auto &session = *m_sessions.emplace_back(std::make_unique<DolphinSession>(
+        pid, m_resolver, m_options.frames_per_sample));
+    if (pid != -1) {
+      spdlog::info("Serve dolphin(pid={}).", pid);
+    }
+    session.player_thread = std::thread(
+        music_player_thread_main, std::ref(session.state), std::move(playlist),
+        m_options.is_use_std_random_device, m_options.selector_version,
+        m_audio_cache);
+    return session;
+  }
 
-  while (true) {
+  // Stops the player of session and drops it.
+  void remove(DolphinSession &session) {
+    if (session.pid != -1) {
+      spdlog::info("Stop serving dolphin(pid={}).", session.pid);
+    }
+    log_sampling_stats(session);
+    session.state.stop_requested.store(true);
+    session.state.wake_player();
+    session.player_thread.join();
+    std::erase_if(m_sessions,
+                  [&](auto const &other) { return other.get() == &session; });
+  }
 
-    // read emulator memory
-    std::uint16_t music_id;
-    // assert(dolphin.isValidConsoleAddress(CURRENT_MUSIC_ID_ADDRESS));
-    auto const read1 = dm.dolphin().readFromRAM(
-        xtool::constants::CURRENT_MUSIC_ID_ADDRESS, (char *)(&music_id),
-        sizeof(std::uint16_t), false);
+  // Sessions for the pids without one.
+  void add_missing(std::vector<int> const &pids) {
+    for (auto const pid : pids) {
+      if (std::ranges::none_of(m_sessions, [&](auto const &session) {
+            return session->pid == pid;
+          })) {
+        add(pid, m_playlist.fork());
+      }
+    }
+  }
 
-    std::uint32_t seed;
-    static_assert(sizeof(std::uint32_t) == 0x4);
-    auto const read2 = dm.dolphin().readFromRAM(
-        xtool::constants::G_MTRAND_SEED_ADDRESS, (char *)(&seed), 0x4, false);
+  // Sessions whose dolphin is not in pids any more.
+  [[nodiscard]] std::vector<DolphinSession *>
+  gone(std::vector<int> const &pids) const {
+    std::vector<DolphinSession *> result;
+    for (auto const &session : m_sessions) {
+      if (std::ranges::find(pids, session->pid) == pids.end()) {
+        result.push_back(session.get());
+      }
+    }
+    return result;
+  }
 
-    if (!read1) {
-      spdlog::error("Failed to read current music id from the game memory.");
+  void request_stats() {
+    SWITCH_LATENCY_STATS.log();
+    if (m_audio_cache != nullptr) {
+      m_audio_cache->log_stats();
+    }
+    for (auto const &session : m_sessions) {
+      log_sampling_stats(*session);
+      session->state.print_stats_requested.store(true);
+      session->state.wake_player();
+    }
+  }
 
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
-      continue;
+  void wake_all() {
+    for (auto const &session : m_sessions) {
+      session->state.wake_player();
     }
-    if (!read2) {
-      spdlog::error("Failed to read g_mtRand.seed from the game memory.");
+  }
+
+  [[nodiscard]] std::vector<std::unique_ptr<DolphinSession>> const &
+  sessions() const noexcept {
+    return m_sessions;
+  }
 
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
-      continue;
+private:
+  Playlist const &m_playlist;
+  GameAddressResolver m_resolver;
+  PlayMusicOptions const &m_options;
+  DecodedAudioCache *m_audio_cache;
+  std::vector<std::unique_ptr<DolphinSession>> m_sessions;
+};
+
+#ifdef __linux__
+// Polls the game memory on a timerfd and handles signals, dolphin exit and
+// stdin commands until exit is requested. With all_instances, dolphins are
+// looked for every IDLE_INTERVAL and a session ends with its process.
+void run_reader_event_loop(DolphinSessions &sessions, bool const all_instances,
+                           UniqueFd const &signals) {
+  EventLoop loop;
+  auto const timer = make_timerfd(POLL_INTERVAL);
+  auto timer_interval = POLL_INTERVAL;
+  std::string stdin_buffer;
+
+  auto const request_exit = [&]() {
+    EXIT_REQUESTED.store(true);
+    sessions.wake_all();
+    loop.stop();
+  };
+  auto const request_stats = [&]() { sessions.request_stats(); };
+  auto const drop_session = [&](DolphinSession &session) {
+    if (session.pidfd.valid()) {
+      loop.remove(session.pidfd.get());
     }
+    sessions.remove(session);
+  };
 
-    // spdlog::info("Current music id:
-    //  {:#x}", music_id);
+  loop.add(signals.get(), [&]() {
+    for (auto signo = consume_signalfd(signals); signo != -1;
+         signo = consume_signalfd(signals)) {
+      if (signo == SIGUSR1) {
+        request_stats();
+      } else {
+        request_exit();
+      }
+    }
+  });
 
-    CURRENT_MUSIC_ID.store(music_id);
-    CURRENT_G_MTRAND_SEED.store(seed);
+  auto const watch = [&](DolphinSession &session) {
+    auto const pid = session.dm.dolphin().getPID();
+    if (session.pidfd.valid() || pid == session.watched_pid) {
+      return;
+    }
+    session.watched_pid = pid;
+    session.pidfd = open_pidfd(pid);
+    if (!session.pidfd.valid()) {
+      return;
+    }
+    loop.add(session.pidfd.get(), [&, session = &session]() {
+      spdlog::warn("Dolphin(pid={}) exited.", session->watched_pid);
+      if (all_instances) {
+        drop_session(*session);
+        return;
+      }
+      loop.remove(session->pidfd.get());
+      session->pidfd.reset();
+      session->watched_pid = -1;
+      session->dm.unhook();
+    });
+  };
+
+  loop.add(timer.get(), [&]() {
+    consume_timerfd(timer);
+    // wake up for the next due sample of the readable sessions
+    auto interval = IDLE_INTERVAL;
+    for (auto const &session : sessions.sessions()) {
+      if (session->replay_finished) {
+        spdlog::info("Replay finished.");
+        request_exit();
+        return;
+      }
+      if (poll_game_memory(*session)) {
+        watch(*session);
+        interval = std::min(interval, session->sampler.next_delay(
+                                          steady_now_ns(), IDLE_INTERVAL));
+      }
+    }
+    if (interval != timer_interval) {
+      timer_interval = interval;
+      set_timerfd_interval(timer, interval);
+    }
+  });
+
+  std::optional<UniqueFd> discovery_timer;
+  if (all_instances) {
+    auto const discover = [&]() {
+      auto const pids = DolphinComm::DolphinAccessor::findPIDs();
+      // e.g. a process that never started a game, no pidfd was opened
+      for (auto *session : sessions.gone(pids)) {
+        drop_session(*session);
+      }
+      sessions.add_missing(pids);
+    };
+    discover();
+    discovery_timer = make_timerfd(IDLE_INTERVAL);
+    loop.add(discovery_timer->get(), [&, discover]() {
+      consume_timerfd(*discovery_timer);
+      discover();
+    });
+  }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  if (isatty(STDIN_FILENO)) {
+    spdlog::info("Type 'stats' to print latency stats, 'quit' to exit.");
+    loop.add(STDIN_FILENO, [&]() {
+      std::array<char, 256> buffer;
+      auto const n = read(STDIN_FILENO, buffer.data(), buffer.size());
+      if (n <= 0) {
+        loop.remove(STDIN_FILENO);
+        return;
+      }
+      stdin_buffer.append(buffer.data(), static_cast<std::size_t>(n));
+      for (auto pos = stdin_buffer.find('\n'); pos != std::string::npos;
+           pos = stdin_buffer.find('\n')) {
+        auto const command = stdin_buffer.substr(0, pos);
+        stdin_buffer.erase(0, pos + 1);
+        if (command == "stats") {
+          request_stats();
+        } else if (command == "quit" || command == "exit") {
+          request_exit();
+        } else if (!command.empty()) {
+          spdlog::warn("Unknown command '{}'.", command);
+        }
+      }
+    });
   }
 
-  // TODO: maybe handle signals?
-  music_player_thread.join();
+  loop.run();
 }
+#endif
+
+void xtool_play_music_main(std::string_view const config_file_path,
+                           PlayMusicOptions options) {
+  // Ctrl+C stops both loops and prints the switch latency stats,
+  // SIGUSR1 prints them without stopping.
+#ifdef __linux__
+  // before any thread starts, so every thread inherits the blocked mask
+  auto const signals = make_signalfd({SIGINT, SIGTERM, SIGUSR1});
+#else
+  std::signal(SIGINT, on_exit_signal);
+  std::signal(SIGTERM, on_exit_signal);
+#ifndef _WIN32
+  std::signal(SIGUSR1, on_print_stats_signal);
+#endif
+#endif
+
+  spdlog::info("Load config file '{}'.", config_file_path);
+  Playlist pl(config_file_path, options.validation);
+  auto xtool_config = load_xtool_config(config_file_path);
+  // old game traces don't have the disc header
+  GameAddressResolver resolver(
+      std::move(xtool_config.profiles), std::move(xtool_config.signature),
+      options.replay != nullptr, std::move(options.replay_addresses));
+  spdlog::info("Loaded config file successfully.");
+  pl.start_background_validation();
+
+  // decodes for the cache, a few threads are enough for any number of
+  // instances
+  std::optional<WorkerPool> decode_pool;
+  std::optional<DecodedAudioCache> audio_cache;
+  if (options.all_instances && options.audio_cache_bytes != 0) {
+    decode_pool.emplace(2);
+    audio_cache.emplace(options.audio_cache_bytes, decode_pool.value());
+  }
+
+  {
+    DolphinSessions sessions(pl, std::move(resolver), options,
+                             audio_cache.has_value() ? &audio_cache.value()
+                                                     : nullptr);
+    if (!options.all_instances) {
+      auto &session = sessions.add(-1, std::move(pl));
+      if (options.replay) {
+        session.replay = options.replay.get();
+        session.dm.set_process(options.replay.release());
+      }
+    }
 
-void wait_for_input() {
-  std::thread th([]() { std::cin.get(); });
-  th.join();
+    xtool::trace::set_thread_name("reader");
+#ifdef __linux__
+    run_reader_event_loop(sessions, options.all_instances, signals);
+#else
+    auto next_discovery = std::chrono::steady_clock::now();
+    while (!EXIT_REQUESTED.load()) {
+      if (PRINT_STATS_REQUESTED.exchange(false)) {
+        sessions.request_stats();
+      }
+      if (options.all_instances &&
+          std::chrono::steady_clock::now() >= next_discovery) {
+        auto const pids = DolphinComm::DolphinAccessor::findPIDs();
+        for (auto *session : sessions.gone(pids)) {
+          sessions.remove(*session);
+        }
+        sessions.add_missing(pids);
+        next_discovery += IDLE_INTERVAL;
+      }
+      if (std::ranges::any_of(sessions.sessions(), [](auto const &session) {
+            return session->replay_finished;
+          })) {
+        spdlog::info("Replay finished.");
+        EXIT_REQUESTED.store(true);
+        break;
+      }
+      bool any_ok = false;
+      auto interval = IDLE_INTERVAL;
+      for (auto const &session : sessions.sessions()) {
+        if (poll_game_memory(*session)) {
+          any_ok = true;
+          interval = std::min(interval, session->sampler.next_delay(
+                                            steady_now_ns(), IDLE_INTERVAL));
+        }
+      }
+      if (!any_ok) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
+      }
+      std::this_thread::sleep_for(interval);
+    }
+    sessions.wake_all();
+#endif
+  }
+
+  SWITCH_LATENCY_STATS.log();
+  if (audio_cache.has_value()) {
+    audio_cache->log_stats();
+  }
 }
 
+void wait_for_input() { std::cin.get(); }
+
 void xtool_play(std::string_view const config_file_path,
                 std::optional<std::string> playlist,
                 std::optional<UniqueMusicID> music_id) {
   assert(!(playlist.has_value() && music_id.has_value()));
 
   spdlog::info("Load config file '{}'.", config_file_path);
-  Playlist pl(config_file_path);
+  Playlist pl(config_file_path, PlaylistValidation::eager);
   spdlog::info("Loaded config file successfully.");
 
   spdlog::info("Initialize music player.");
@@ -225,7 +781,7 @@ void xtool_play(std::string_view const config_file_path,
       auto const &music = pl.music_map().at(music_id);
 
       spdlog::info("[{}/{}]", count, music_entries.size());
-      if (!music_player.play(music)) {
+      if (music_player.play(music) != PlayResult::ok) {
         spdlog::error("Failed to play music.");
         continue;
       };
@@ -245,7 +801,7 @@ void xtool_play(std::string_view const config_file_path,
           fmt::format("Music with id {} not found.", music_id.value()));
     }
     auto const &music = pl.music_map().at(music_id.value());
-    if (!music_player.play(music)) {
+    if (music_player.play(music) != PlayResult::ok) {
       spdlog::error("Failed to play music.");
     };
     spdlog::info("Press enter to finish.");
@@ -264,7 +820,7 @@ void xtool_play(std::string_view const config_file_path,
   std::advance(map_iter, n);
   auto const &music_entry = map_iter->second;
 
-  if (!music_player.play(music_entry)) {
+  if (music_player.play(music_entry) != PlayResult::ok) {
     spdlog::error("Failed to play music.");
   };
 
@@ -274,6 +830,15 @@ void xtool_play(std::string_view const config_file_path,
   spdlog::info("Finished.");
 }
 
+SeedSelectorVersion parse_selector_version_arg(std::string const &arg) {
+  auto const version = parse_seed_selector_version(arg);
+  if (!version.has_value()) {
+    throw std::invalid_argument(
+        fmt::format("Unknown seed selector version {}.", arg));
+  }
+  return version.value();
+}
+
 int main(int argc, char **argv) {
 
   argparse::ArgumentParser program("xtool");
@@ -284,6 +849,60 @@ int main(int argc, char **argv) {
       .help("Use std::random_device instead of in game g_mtRand.seed for "
             "random function seeds.")
       .flag();
+  program.add_argument("--selector")
+      .help("Seed selector version(v1 or v2). Every netplay client must use "
+            "the same version.")
+      .default_value(std::string("v2"));
+  program.add_argument("--lazy-validation")
+      .help("Check music files on a background thread instead of before "
+            "starting.")
+      .flag();
+  program.add_argument("--sync-log")
+      .help("Write log lines on the calling thread instead of a background "
+            "logging thread.")
+      .flag();
+  program.add_argument("--log-queue-size")
+      .scan<'u', std::size_t>()
+      .default_value(std::size_t{8192})
+      .help("Background logging queue size in lines.");
+  program.add_argument("--log-overflow")
+      .help("What a full logging queue does: block or overrun-oldest.")
+      .default_value(std::string("overrun-oldest"));
+  program.add_argument("--trace")
+      .help("Record reader/player/audio thread spans and write them as "
+            "Chrome trace JSON(ui.perfetto.dev) to this path on exit.");
+  program.add_argument("--trace-capacity")
+      .scan<'u', std::size_t>()
+      .default_value(std::size_t{1} << 18)
+      .help("Trace ring buffer size in events, the oldest are dropped.");
+  program.add_argument("--memory-backend")
+      .help("How dolphin's memory is read on Linux: auto, process_vm_readv "
+            "or proc_mem(/proc/<pid>/mem, batched with io_uring). auto "
+            "switches to proc_mem when process_vm_readv is not allowed.")
+      .default_value(std::string("auto"));
+  program.add_argument("--replay")
+      .help("Read the game memory from a trace recorded by xtool record "
+            "instead of dolphin, exit after its last frame.");
+  program.add_argument("--replay-speed")
+      .scan<'g', double>()
+      .default_value(1.0)
+      .help("Replay speed multiplier.");
+  program.add_argument("--poll-frames")
+      .scan<'u', std::uint32_t>()
+      .default_value(std::uint32_t{12})
+      .help("Sample the game every this many emulated frames when its "
+            "profile has a frame_counter, every 200 ms otherwise. The "
+            "built-in profiles have none, set it in [[xtool.profiles]] or "
+            "find it with a frame_counter [[xtool.signatures]] entry.");
+  program.add_argument("--all-instances")
+      .help("Serve every running dolphin instead of the first one found, "
+            "each with its own audio output and music history.")
+      .flag();
+  program.add_argument("--audio-cache-size")
+      .scan<'u', std::size_t>()
+      .default_value(std::size_t{256})
+      .help("Decoded music shared by the instances of --all-instances in "
+            "MiB, 0 decodes every play separately.");
 
   argparse::ArgumentParser sub_command_inspect_config("inspect-config");
   sub_command_inspect_config.add_description(
@@ -318,6 +937,165 @@ int main(int argc, char **argv) {
       .scan<'u', std::uint32_t>()
       .default_value(std::uint32_t{3000})
       .help("");
+  sub_command_seedtest.add_argument("--selector")
+      .help("Seed selector version(v1 or v2).")
+      .default_value(std::string("v2"));
+
+  argparse::ArgumentParser sub_command_seedanalyze("seedanalyze");
+  sub_command_seedanalyze.add_description(
+      "Offline seed distribution analysis of the random function.(No need "
+      "to run dolphin.)");
+  sub_command_seedanalyze.add_argument("--config")
+      .help("xtool config toml file path to take playlist sizes from.");
+  sub_command_seedanalyze.add_argument("--sizes")
+      .nargs(argparse::nargs_pattern::at_least_one)
+      .scan<'u', std::size_t>()
+      .help("Additional playlist sizes to analyze.");
+  sub_command_seedanalyze.add_argument("--full")
+      .help("Evaluate every 2^32 seed instead of a stratified sample.")
+      .flag();
+  sub_command_seedanalyze.add_argument("--samples")
+      .scan<'u', std::uint64_t>()
+      .default_value(std::uint64_t{1} << 24)
+      .help("Stratified sample size.");
+  sub_command_seedanalyze.add_argument("--print-buckets")
+      .scan<'u', std::size_t>()
+      .default_value(std::size_t{32})
+      .help("Print per bucket counts for sizes up to this value.");
+  sub_command_seedanalyze.add_argument("--selector")
+      .help("Seed selector version(v1 or v2).")
+      .default_value(std::string("v2"));
+
+  argparse::ArgumentParser sub_command_netplaysim("netplaysim");
+  sub_command_netplaysim.add_description(
+      "Simulate netplay clients and report how often they pick different "
+      "musics.(No need to run dolphin.)");
+  sub_command_netplaysim.add_argument("--clients")
+      .scan<'u', std::size_t>()
+      .default_value(std::size_t{2})
+      .help("Number of virtual clients.");
+  sub_command_netplaysim.add_argument("--trials")
+      .scan<'u', std::uint32_t>()
+      .default_value(std::uint32_t{10000})
+      .help("Number of simulated music changes.");
+  sub_command_netplaysim.add_argument("--reader-intervals")
+      .nargs(argparse::nargs_pattern::at_least_one)
+      .scan<'g', double>()
+      .help("Memory poll intervals in ms to compare.(default 200)");
+  sub_command_netplaysim.add_argument("--player-interval")
+      .scan<'g', double>()
+      .help("Model older clients whose player loop polls every this many ms, "
+            "instead of a player woken by the reader.");
+  sub_command_netplaysim.add_argument("--jitter")
+      .scan<'g', double>()
+      .default_value(2.0)
+      .help("Max sleep overshoot per loop iteration in ms.");
+  sub_command_netplaysim.add_argument("--emu-offset")
+      .scan<'g', double>()
+      .default_value(0.0)
+      .help("Max emulation time offset between clients in ms.");
+  sub_command_netplaysim.add_argument("--seed-interval")
+      .scan<'g', double>()
+      .default_value(100.0)
+      .help("Synthetic timeline, mean time between seed updates in ms.");
+  sub_command_netplaysim.add_argument("--timeline")
+      .help("Recorded seed timeline file(\"<time ms> <seed>\" lines).");
+  sub_command_netplaysim.add_argument("--playlist-size")
+      .scan<'u', std::size_t>()
+      .default_value(std::size_t{10})
+      .help("Number of musics in the simulated playlist.");
+  sub_command_netplaysim.add_argument("--sim-seed")
+      .scan<'u', std::uint64_t>()
+      .default_value(std::uint64_t{0})
+      .help("Seed of the simulation itself.");
+  sub_command_netplaysim.add_argument("--selector")
+      .help("Seed selector version(v1 or v2).")
+      .default_value(std::string("v2"));
+
+  argparse::ArgumentParser sub_command_bench("bench");
+  sub_command_bench.add_description("Run xtool micro benchmarks.");
+  sub_command_bench.add_argument("--iterations")
+      .scan<'u', std::uint32_t>()
+      .default_value(std::uint32_t{100000})
+      .help("Iterations per benchmark case.");
+  sub_command_bench.add_argument("--json").help(
+      "Also write the results as JSON to this file.");
+  sub_command_bench.add_argument("--audio-dir")
+      .help("Directory with mp3/flac files for the decoder benchmark.");
+
+  argparse::ArgumentParser sub_command_record("record");
+  sub_command_record.add_description(
+      "Record the music id, g_mtRand.seed, the frame counter and extra "
+      "addresses to a game trace.");
+  sub_command_record.add_argument("--config")
+      .help("xtool config toml file path to take game profiles and "
+            "signatures from, the built-in profiles without it.");
+  sub_command_record.add_argument("--out")
+      .help("Trace file path to write.")
+      .default_value(std::string("./xtool.trace"));
+  sub_command_record.add_argument("--interval")
+      .scan<'u', std::uint32_t>()
+      .default_value(std::uint32_t{10})
+      .help("Poll interval in ms, at least 1.");
+  sub_command_record.add_argument("--duration")
+      .scan<'u', std::uint32_t>()
+      .default_value(std::uint32_t{0})
+      .help("Recording length in seconds, 0 = until killed.");
+  sub_command_record.add_argument("--watch")
+      .nargs(argparse::nargs_pattern::at_least_one)
+      .help("Extra addresses to record, <console address>:<size>.");
+
+  argparse::ArgumentParser sub_command_diff("diff");
+  sub_command_diff.add_description(
+      "Find addresses by comparing RAM snapshots. Without --steps, commands "
+      "are read from stdin.");
+  sub_command_diff.add_argument("--width")
+      .scan<'u', std::uint32_t>()
+      .default_value(std::uint32_t{1})
+      .help("Element size in bytes(1, 2 or 4), compared as big endian.");
+  sub_command_diff.add_argument("--steps")
+      .nargs(argparse::nargs_pattern::at_least_one)
+      .help("changed, unchanged, increased or decreased, one snapshot per "
+            "step.");
+  sub_command_diff.add_argument("--interval")
+      .scan<'u', std::uint32_t>()
+      .default_value(std::uint32_t{1000})
+      .help("Time between --steps snapshots in ms.");
+  sub_command_diff.add_argument("--out").help(
+      "Write the remaining ranges to this file.");
+  sub_command_diff.add_argument("--limit")
+      .scan<'u', std::size_t>()
+      .default_value(std::size_t{20})
+      .help("Ranges to print after every step.");
+
+  argparse::ArgumentParser sub_command_scan("scan");
+  sub_command_scan.add_description(
+      "Find addresses by value with first scan / next scan, commands are "
+      "read from stdin.");
+  sub_command_scan.add_argument("--type")
+      .default_value(std::string("word"))
+      .help("byte, halfword, word, float, double, string or bytearray.");
+  sub_command_scan.add_argument("--length")
+      .scan<'u', std::size_t>()
+      .default_value(std::size_t{1})
+      .help("Size in bytes of string and bytearray values.");
+  sub_command_scan.add_argument("--signed")
+      .help("Compare integers as signed.")
+      .flag();
+  sub_command_scan.add_argument("--unaligned")
+      .help("Scan every byte instead of multiples of the type alignment.")
+      .flag();
+  sub_command_scan.add_argument("--hex")
+      .help("Values are hexadecimal.")
+      .flag();
+  sub_command_scan.add_argument("--threads")
+      .scan<'u', unsigned>()
+      .default_value(0u)
+      .help("Scan threads, 0 = one per core.");
+  sub_command_scan.add_argument("--limit")
+      .scan<'u', std::size_t>()
+      .default_value(std::size_t{20})
+      .help("Results to print after every scan.");
 
   // play
   argparse::ArgumentParser sub_command_play("play");
@@ -332,13 +1110,31 @@ int main(int argc, char **argv) {
   program.add_subparser(sub_command_inspect_config);
   program.add_subparser(sub_command_inspect_musics);
   program.add_subparser(sub_command_seedtest);
+  program.add_subparser(sub_command_seedanalyze);
+  program.add_subparser(sub_command_netplaysim);
   program.add_subparser(sub_command_play);
+  program.add_subparser(sub_command_bench);
+  program.add_subparser(sub_command_record);
+  program.add_subparser(sub_command_diff);
+  program.add_subparser(sub_command_scan);
 
+  // declared outside try so the catch below can still log
+  LoggerShutdownGuard logger_shutdown_guard;
   try {
     program.parse_args(argc, argv);
 
-    auto logger = spdlog::stdout_color_mt("xtool-logger");
-    spdlog::set_default_logger(logger);
+    LoggerConfig logger_config;
+    logger_config.synchronous = program.get<bool>("--sync-log");
+    logger_config.queue_size = program.get<std::size_t>("--log-queue-size");
+    auto const overflow_policy =
+        parse_log_overflow_policy(program.get<std::string>("--log-overflow"));
+    if (!overflow_policy.has_value()) {
+      throw std::invalid_argument(
+          fmt::format("Unknown log overflow policy {}.",
+                      program.get<std::string>("--log-overflow")));
+    }
+    logger_config.overflow_policy = overflow_policy.value();
+    setup_logger(logger_config);
 #ifdef XTOOL_DEBUG
     spdlog::set_level(spdlog::level::debug);
 #endif
@@ -350,6 +1146,15 @@ int main(int argc, char **argv) {
     }
     spdlog::info("xtool launched");
 
+    auto const memory_backend =
+        parse_memory_backend(program.get<std::string>("--memory-backend"));
+    if (!memory_backend.has_value()) {
+      throw std::invalid_argument(
+          fmt::format("Unknown memory backend {}.",
+                      program.get<std::string>("--memory-backend")));
+    }
+    set_default_memory_backend(memory_backend.value());
+
     if (program.is_subcommand_used(sub_command_inspect_config)) {
       auto const config_path =
           sub_command_inspect_config.get<std::string>("--config");
@@ -372,7 +1177,144 @@ int main(int argc, char **argv) {
       auto const end = sub_command_seedtest.get<std::uint32_t>(
           "random distribution range end");
       auto const count = sub_command_seedtest.get<std::uint32_t>("count");
-      test_seed(start, end, count);
+      auto const selector_version = parse_selector_version_arg(
+          sub_command_seedtest.get<std::string>("--selector"));
+      test_seed(start, end, count, selector_version);
+      return EXIT_SUCCESS;
+    }
+
+    if (program.is_subcommand_used(sub_command_seedanalyze)) {
+      std::optional<std::string> config_path = std::nullopt;
+      if (sub_command_seedanalyze.is_used("--config")) {
+        config_path = sub_command_seedanalyze.get<std::string>("--config");
+      }
+      std::vector<std::size_t> sizes;
+      if (sub_command_seedanalyze.is_used("--sizes")) {
+        sizes =
+            sub_command_seedanalyze.get<std::vector<std::size_t>>("--sizes");
+      }
+      auto const selector_version = parse_selector_version_arg(
+          sub_command_seedanalyze.get<std::string>("--selector"));
+      analyze_seed_distribution(
+          config_path, sizes, sub_command_seedanalyze.get<bool>("--full"),
+          sub_command_seedanalyze.get<std::uint64_t>("--samples"),
+          sub_command_seedanalyze.get<std::size_t>("--print-buckets"),
+          selector_version);
+      return EXIT_SUCCESS;
+    }
+
+    if (program.is_subcommand_used(sub_command_netplaysim)) {
+      NetplaySimConfig config;
+      config.clients = sub_command_netplaysim.get<std::size_t>("--clients");
+      config.trials = sub_command_netplaysim.get<std::uint32_t>("--trials");
+      if (sub_command_netplaysim.is_used("--player-interval")) {
+        config.player_interval_ms =
+            sub_command_netplaysim.get<double>("--player-interval");
+      }
+      config.poll_jitter_ms = sub_command_netplaysim.get<double>("--jitter");
+      config.emu_offset_ms = sub_command_netplaysim.get<double>("--emu-offset");
+      config.seed_interval_ms =
+          sub_command_netplaysim.get<double>("--seed-interval");
+      if (sub_command_netplaysim.is_used("--timeline")) {
+        config.timeline_path =
+            sub_command_netplaysim.get<std::string>("--timeline");
+      }
+      config.playlist_size =
+          sub_command_netplaysim.get<std::size_t>("--playlist-size");
+      config.sim_seed = sub_command_netplaysim.get<std::uint64_t>("--sim-seed");
+      config.selector_version = parse_selector_version_arg(
+          sub_command_netplaysim.get<std::string>("--selector"));
+
+      std::vector<double> reader_intervals;
+      if (sub_command_netplaysim.is_used("--reader-intervals")) {
+        reader_intervals = sub_command_netplaysim.get<std::vector<double>>(
+            "--reader-intervals");
+      }
+      netplay_sim(config, reader_intervals);
+      return EXIT_SUCCESS;
+    }
+
+    if (program.is_subcommand_used(sub_command_bench)) {
+      BenchOptions options;
+      options.iterations = sub_command_bench.get<std::uint32_t>("--iterations");
+      if (auto const audio_dir = sub_command_bench.present("--audio-dir")) {
+        options.audio_dir = *audio_dir;
+      }
+      auto const results = run_benchmarks(options);
+      if (auto const json_path = sub_command_bench.present("--json")) {
+        std::ofstream file(*json_path, std::ios::trunc);
+        write_bench_json(file, results);
+        if (!file) {
+          throw std::runtime_error(
+              fmt::format("Failed to write {}.", *json_path));
+        }
+      }
+      return EXIT_SUCCESS;
+    }
+
+    if (program.is_subcommand_used(sub_command_record)) {
+      std::vector<WatchedAddress> extra_addresses;
+      if (sub_command_record.is_used("--watch")) {
+        for (auto const &arg :
+             sub_command_record.get<std::vector<std::string>>("--watch")) {
+          extra_addresses.push_back(parse_watched_address(arg));
+        }
+      }
+      auto xtool_config =
+          sub_command_record.is_used("--config")
+              ? load_xtool_config(
+                    sub_command_record.get<std::string>("--config"))
+              : XtoolConfig{};
+      record_game_trace(sub_command_record.get<std::string>("--out"),
+                        GameAddressResolver(std::move(xtool_config.profiles),
+                                            std::move(xtool_config.signature)),
+                        extra_addresses,
+                        sub_command_record.get<std::uint32_t>("--interval"),
+                        sub_command_record.get<std::uint32_t>("--duration"));
+      return EXIT_SUCCESS;
+    }
+
+    if (program.is_subcommand_used(sub_command_diff)) {
+      MemoryDiffConfig config;
+      config.width = sub_command_diff.get<std::uint32_t>("--width");
+      config.interval_ms = sub_command_diff.get<std::uint32_t>("--interval");
+      config.print_limit = sub_command_diff.get<std::size_t>("--limit");
+      if (sub_command_diff.is_used("--steps")) {
+        for (auto const &step :
+             sub_command_diff.get<std::vector<std::string>>("--steps")) {
+          auto const predicate = parse_diff_predicate(step);
+          if (!predicate.has_value()) {
+            throw std::invalid_argument(
+                fmt::format("Unknown diff step {}.", step));
+          }
+          config.predicates.push_back(predicate.value());
+        }
+      }
+      if (auto const out = sub_command_diff.present("--out")) {
+        config.out_path = *out;
+      }
+      memory_diff(config);
+      return EXIT_SUCCESS;
+    }
+
+    if (program.is_subcommand_used(sub_command_scan)) {
+      MemoryScanConfig config;
+      auto const type_name = sub_command_scan.get<std::string>("--type");
+      auto const type = parse_mem_type(type_name);
+      if (!type.has_value()) {
+        throw std::invalid_argument(
+            fmt::format("Unknown scan type {}.", type_name));
+      }
+      config.options.type = type.value();
+      config.options.length = sub_command_scan.get<std::size_t>("--length");
+      config.options.is_unsigned = !sub_command_scan.get<bool>("--signed");
+      config.options.aligned = !sub_command_scan.get<bool>("--unaligned");
+      if (sub_command_scan.get<bool>("--hex")) {
+        config.options.base = Common::MemBase::base_hexadecimal;
+      }
+      config.options.threads = sub_command_scan.get<unsigned>("--threads");
+      config.print_limit = sub_command_scan.get<std::size_t>("--limit");
+      memory_scan(config);
       return EXIT_SUCCESS;
     }
 
@@ -404,9 +1346,44 @@ int main(int argc, char **argv) {
     }
 
     auto const config_file_path = program.get<std::string>("--config");
-    auto const is_use_std_random_device =
+    PlayMusicOptions options;
+    options.is_use_std_random_device =
         program.get<bool>("--use-random-device");
-    xtool_play_music_main(config_file_path, is_use_std_random_device);
+    options.selector_version =
+        parse_selector_version_arg(program.get<std::string>("--selector"));
+    options.validation = program.get<bool>("--lazy-validation")
+                             ? PlaylistValidation::lazy
+                             : PlaylistValidation::eager;
+    options.frames_per_sample = program.get<std::uint32_t>("--poll-frames");
+    if (options.frames_per_sample == 0) {
+      throw std::invalid_argument("--poll-frames must be at least 1.");
+    }
+    options.all_instances = program.get<bool>("--all-instances");
+    options.audio_cache_bytes =
+        program.get<std::size_t>("--audio-cache-size") << 20;
+    if (program.is_used("--replay")) {
+      if (options.all_instances) {
+        throw std::invalid_argument(
+            "--replay and --all-instances both supplied.");
+      }
+      auto const replay_path = program.get<std::string>("--replay");
+      spdlog::info("Replay game trace '{}'.", replay_path);
+      auto trace = load_game_trace(replay_path);
+      options.replay_addresses = recorded_game_addresses(trace);
+      if (!options.replay_addresses.has_value()) {
+        throw std::invalid_argument(fmt::format(
+            "Game trace {} has no music id or g_mtRand.seed.", replay_path));
+      }
+      options.replay = std::make_unique<DolphinComm::ReplayDolphinProcess>(
+          std::move(trace), program.get<double>("--replay-speed"));
+    }
+    if (program.is_used("--trace")) {
+      xtool::trace::enable(program.get<std::size_t>("--trace-capacity"));
+    }
+    xtool_play_music_main(config_file_path, std::move(options));
+    if (program.is_used("--trace")) {
+      xtool::trace::write_json(program.get<std::string>("--trace"));
+    }
 
     // try to find dolphin process
 
@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <dme/Common/CommonUtils.h>
+#include <dme/DolphinProcess/DolphinAccessor.h>
+#include <dolphin_manager.hpp>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <memory_diff.hpp>
+#include <optional>
+#include <span>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr char const *DIFF_HELP =
+    "commands: c(hanged) | u(nchanged) | +(increased) | -(decreased) take a "
+    "snapshot and keep the addresses that match since the previous one, "
+    "l(ist) [n], s(ave) <file>, r(eset), q(uit)";
+
+// Splits the candidates at the changed ranges(ascending RAM cache indices),
+// unchanged pieces are shrunk to whole elements.
+void split_candidates(DiffRanges const &candidates,
+                      std::vector<DolphinComm::RAMCacheRange> const &changed,
+                      std::uint32_t const width, DiffRanges &changed_pieces,
+                      DiffRanges &unchanged_pieces) {
+  auto const add_unchanged = [&](std::size_t const begin,
+                                 std::size_t const end) {
+    auto const first = (begin + width - 1) / width * width;
+    auto const last = end / width * width;
+    if (first < last) {
+      unchanged_pieces.push_back({static_cast<std::uint32_t>(first),
+                                  static_cast<std::uint32_t>(last - first)});
+    }
+  };
+  auto next = changed.begin();
+  for (auto const &candidate : candidates) {
+    std::size_t const end = std::size_t{candidate.offset} + candidate.size;
+    while (next != changed.end() && next->end <= candidate.offset) {
+      ++next;
+    }
+    std::size_t position = candidate.offset;
+    for (auto it = next; it != changed.end() && it->begin < end; ++it) {
+      auto const begin = std::max<std::size_t>(it->begin, position);
+      auto const piece_end = std::min<std::size_t>(it->end, end);
+      add_unchanged(position, begin);
+      changed_pieces.push_back({static_cast<std::uint32_t>(begin),
+                                static_cast<std::uint32_t>(piece_end - begin)});
+      position = piece_end;
+    }
+    add_unchanged(position, end);
+  }
+}
+
+// Joins adjacent ranges(ascending) of the same candidate.
+DiffRanges merge_within_candidates(DiffRanges const &ranges,
+                                   DiffRanges const &candidates) {
+  DiffRanges merged;
+  auto candidate = candidates.begin();
+  for (auto const &r : ranges) {
+    while (candidate->offset + candidate->size <= r.offset) {
+      ++candidate;
+    }
+    if (!merged.empty() &&
+        merged.back().offset + merged.back().size == r.offset &&
+        merged.back().offset >= candidate->offset) {
+      merged.back().size += r.size;
+    } else {
+      merged.push_back(r);
+    }
+  }
+  return merged;
+}
+
+// diff_snapshots when before and after can only differ in changed, only those
+// parts of the candidates are compared.
+DiffRanges
+diff_changed_ranges(std::span<char const> const before,
+                    std::span<char const> const after,
+                    DiffPredicate const predicate, std::uint32_t const width,
+                    DiffBackend const backend, DiffRanges const &candidates,
+                    std::vector<DolphinComm::RAMCacheRange> const &changed) {
+  DiffRanges changed_pieces;
+  DiffRanges unchanged_pieces;
+  split_candidates(candidates, changed, width, changed_pieces,
+                   unchanged_pieces);
+  auto result = diff_snapshots(before, after, predicate, width, backend,
+                               changed_pieces);
+  if (predicate != DiffPredicate::unchanged) {
+    return result;
+  }
+  result.insert(result.end(), unchanged_pieces.begin(),
+                unchanged_pieces.end());
+  std::sort(result.begin(), result.end(),
+            [](DiffRange const &a, DiffRange const &b) {
+              return a.offset < b.offset;
+            });
+  return merge_within_candidates(result, candidates);
+}
+
+std::string hex_bytes(char const *p, std::size_t const size) {
+  std::string s;
+  for (std::size_t i = 0; i < size; ++i) {
+    s += fmt::format("{:02x}", static_cast<std::uint8_t>(p[i]));
+  }
+  return s;
+}
+
+class DiffSession {
+public:
+  explicit DiffSession(MemoryDiffConfig const &config)
+      : m_config(config), m_backend(best_diff_backend()) {
+    if (m_dm.dolphin().getStatus() != DolphinComm::DolphinStatus::hooked) {
+      throw std::runtime_error("Dolphin is not running.");
+    }
+    m_aram = m_dm.dolphin().isARAMAccessible();
+    spdlog::info("Diff {} bytes of RAM, width {}, {} backend.",
+                 m_dm.dolphin().getRAMCacheSize(), m_config.width,
+                 diff_backend_name(m_backend));
+    this->reset();
+  }
+
+  // new base snapshot, every address is a candidate again
+  void reset() {
+    this->update_latest();
+    // m_previous is not the snapshot before m_latest anymore
+    m_changed.reset();
+    auto const size = static_cast<std::uint32_t>(m_latest.size());
+    // the cache is ARAM|MEM1 or MEM1|MEM2, don't merge over the boundary
+    auto const split = m_aram ? Common::ARAM_SIZE : Common::MEM1_SIZE;
+    m_candidates.clear();
+    m_candidates.push_back({0, std::min(split, size)});
+    if (size > split) {
+      m_candidates.push_back({split, size - split});
+    }
+  }
+
+  void step(DiffPredicate const predicate) {
+    // m_previous = m_latest, only what differs between them is copied
+    if (m_changed.has_value() && m_previous.size() == m_latest.size()) {
+      for (auto const &r : m_changed.value()) {
+        std::memcpy(m_previous.data() + r.begin, m_latest.data() + r.begin,
+                    r.end - r.begin);
+      }
+    } else {
+      m_previous = m_latest;
+    }
+    this->update_latest();
+    m_changed = m_refreshed;
+
+    auto const begin = std::chrono::steady_clock::now();
+    m_candidates =
+        diff_changed_ranges(m_previous, m_latest, predicate, m_config.width,
+                            m_backend, m_candidates, m_changed.value());
+    auto const end = std::chrono::steady_clock::now();
+    std::size_t written = 0;
+    for (auto const &r : m_refreshed) {
+      written += r.end - r.begin;
+    }
+    spdlog::info(
+        "{}: {} ranges, {} bytes left ({:.2f} ms, {} bytes written by the "
+        "game).",
+        diff_predicate_name(predicate), m_candidates.size(),
+        diff_ranges_bytes(m_candidates),
+        std::chrono::duration<double, std::milli>(end - begin).count(),
+        written);
+  }
+
+  void list(std::size_t const limit) const {
+    auto const count = std::min(limit, m_candidates.size());
+    for (std::size_t i = 0; i < count; ++i) {
+      auto const &r = m_candidates[i];
+      auto const shown = std::min<std::size_t>(r.size, 8);
+      auto const value = hex_bytes(m_latest.data() + r.offset, shown);
+      if (m_previous.empty()) {
+        spdlog::info("{:#010x} +{:#x} {}",
+                     Common::cacheIndexToDolphinAddr(r.offset, m_aram), r.size,
+                     value);
+      } else {
+        spdlog::info("{:#010x} +{:#x} {} -> {}",
+                     Common::cacheIndexToDolphinAddr(r.offset, m_aram), r.size,
+                     hex_bytes(m_previous.data() + r.offset, shown), value);
+      }
+    }
+    if (count < m_candidates.size()) {
+      spdlog::info("... {} more ranges.", m_candidates.size() - count);
+    }
+  }
+
+  void save(std::filesystem::path const &path) const {
+    std::ofstream file(path, std::ios::trunc);
+    write_diff_ranges(file, m_candidates, m_aram);
+    if (!file) {
+      throw std::runtime_error(
+          fmt::format("Failed to write {}.", path.string()));
+    }
+    spdlog::info("Wrote {} ranges to {}.", m_candidates.size(),
+                 path.string());
+  }
+
+private:
+  // m_latest = the game memory now. When dolphin's writes can be tracked only
+  // the pages written since the last snapshot are read and copied, see
+  // DolphinAccessor::updateRAMCacheDirtyPages. m_refreshed gets the ranges
+  // that may have changed.
+  void update_latest() {
+    auto &dolphin = m_dm.dolphin();
+    if (dolphin.updateRAMCacheDirtyPages(m_refreshed) !=
+        Common::MemOperationReturnCode::OK) {
+      // m_latest missed the pages written meanwhile, the next step compares
+      // everything(the next refresh reads the whole cache too)
+      m_changed.reset();
+      throw std::runtime_error("Failed to read the game memory.");
+    }
+    auto const *cache = dolphin.getRAMCache();
+    if (m_latest.size() != dolphin.getRAMCacheSize()) {
+      m_latest.assign(cache, cache + dolphin.getRAMCacheSize());
+      m_refreshed = {{0, m_latest.size()}};
+      return;
+    }
+    for (auto const &r : m_refreshed) {
+      std::memcpy(m_latest.data() + r.begin, cache + r.begin, r.end - r.begin);
+    }
+  }
+
+private:
+  MemoryDiffConfig const &m_config;
+  DiffBackend m_backend;
+  DolphinManager m_dm;
+  bool m_aram = false;
+  std::vector<char> m_previous;
+  std::vector<char> m_latest;
+  // where m_latest may differ from m_previous, nullopt = anywhere
+  std::optional<std::vector<DolphinComm::RAMCacheRange>> m_changed;
+  std::vector<DolphinComm::RAMCacheRange> m_refreshed;
+  DiffRanges m_candidates;
+};
+
+std::optional<DiffPredicate> parse_step_command(std::string_view const cmd) {
+  if (cmd == "c") {
+    return DiffPredicate::changed;
+  }
+  if (cmd == "u") {
+    return DiffPredicate::unchanged;
+  }
+  if (cmd == "+") {
+    return DiffPredicate::increased;
+  }
+  if (cmd == "-") {
+    return DiffPredicate::decreased;
+  }
+  return parse_diff_predicate(cmd);
+}
+
+void run_interactive(DiffSession &session, MemoryDiffConfig const &config) {
+  spdlog::info("{}", DIFF_HELP);
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    std::istringstream ss(line);
+    std::string cmd;
+    if (!(ss >> cmd)) {
+      continue;
+    }
+    try {
+      if (auto const predicate = parse_step_command(cmd)) {
+        session.step(*predicate);
+        session.list(config.print_limit);
+      } else if (cmd == "l" || cmd == "list") {
+        std::size_t limit = config.print_limit;
+        ss >> limit;
+        session.list(limit);
+      } else if (cmd == "s" || cmd == "save") {
+        std::string path;
+        if (!(ss >> path)) {
+          spdlog::warn("save needs a file path.");
+          continue;
+        }
+        session.save(path);
+      } else if (cmd == "r" || cmd == "reset") {
+        session.reset();
+        spdlog::info("Reset, every address is a candidate again.");
+      } else if (cmd == "q" || cmd == "quit") {
+        break;
+      } else {
+        spdlog::info("{}", DIFF_HELP);
+      }
+    } catch (std::runtime_error const &e) {
+      // keep the session, dolphin may be paused or restarting
+      spdlog::error("{}", e.what());
+    }
+  }
+}
+} // namespace
+
+void write_diff_ranges(std::ostream &os, DiffRanges const &ranges,
+                       bool const aram) {
+  for (auto const &r : ranges) {
+    os << fmt::format("{:#010x} {:#x}\n",
+                      Common::cacheIndexToDolphinAddr(r.offset, aram), r.size);
+  }
+}
+
+void memory_diff(MemoryDiffConfig const &config) {
+  if (config.width != 1 && config.width != 2 && config.width != 4) {
+    throw std::invalid_argument(
+        fmt::format("Diff width must be 1, 2 or 4, got {}.", config.width));
+  }
+  DiffSession session(config);
+  if (config.predicates.empty()) {
+    run_interactive(session, config);
+  } else {
+    for (auto const predicate : config.predicates) {
+      std::this_thread::sleep_for(
+          std::chrono::milliseconds(config.interval_ms));
+      session.step(predicate);
+    }
+    session.list(config.print_limit);
+  }
+  if (config.out_path.has_value()) {
+    session.save(config.out_path.value());
+  }
+}
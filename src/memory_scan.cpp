@@ -0,0 +1,130 @@
+#include <dme/Common/CommonUtils.h>
+#include <dme/DolphinProcess/DolphinAccessor.h>
+#include <dolphin_manager.hpp>
+#include <fmt/format.h>
+#include <iostream>
+#include <memory_scan.hpp>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+constexpr char const *SCAN_HELP =
+    "commands: e(xact) <value> | r(ange) <min> <max> | c(hanged) | "
+    "u(nchanged) | +(increased) | -(decreased) | unknown scan the current "
+    "memory, l(ist) [n], reset, q(uit)";
+
+class ScanSession {
+public:
+  explicit ScanSession(ScanOptions const &options) : m_scanner(options) {
+    if (m_dm.dolphin().getStatus() != DolphinComm::DolphinStatus::hooked) {
+      throw std::runtime_error("Dolphin is not running.");
+    }
+    m_aram = m_dm.dolphin().isARAMAccessible();
+    spdlog::info("Scan {} bytes of RAM, {} byte values, {} backend.",
+                 m_dm.dolphin().getRAMCacheSize(), m_scanner.value_size(),
+                 diff_backend_name(options.backend));
+  }
+
+  void scan(ScanFilter const filter, std::string_view const value,
+            std::string_view const max_value) {
+    auto &dolphin = m_dm.dolphin();
+    if (dolphin.updateRAMCache() != Common::MemOperationReturnCode::OK) {
+      throw std::runtime_error("Failed to read the game memory.");
+    }
+    auto const stats = m_scanner.scan(
+        {dolphin.getRAMCache(), dolphin.getRAMCacheSize()}, filter, value,
+        max_value);
+    spdlog::info("{}: {} results ({:.2f} ms, {} threads, {} bytes of "
+                 "candidates).",
+                 scan_filter_name(filter), stats.candidates,
+                 static_cast<double>(stats.nanoseconds) / 1e6, stats.threads,
+                 stats.memory_bytes);
+  }
+
+  void list(std::size_t const limit) const {
+    auto const indices = m_scanner.results(limit);
+    for (auto const index : indices) {
+      spdlog::info("{:#010x} {}",
+                   Common::cacheIndexToDolphinAddr(index, m_aram),
+                   m_scanner.previous_value(index));
+    }
+    auto const count = m_scanner.candidates().count();
+    if (indices.size() < count) {
+      spdlog::info("... {} more results.", count - indices.size());
+    }
+  }
+
+  void reset() { m_scanner.reset(); }
+
+private:
+  ValueScanner m_scanner;
+  DolphinManager m_dm;
+  bool m_aram = false;
+};
+
+std::optional<ScanFilter> parse_scan_command(std::string_view const cmd) {
+  if (cmd == "e" || cmd == "=") {
+    return ScanFilter::exact;
+  }
+  if (cmd == "r") {
+    return ScanFilter::range;
+  }
+  if (cmd == "c") {
+    return ScanFilter::changed;
+  }
+  if (cmd == "u") {
+    return ScanFilter::unchanged;
+  }
+  if (cmd == "+") {
+    return ScanFilter::increased;
+  }
+  if (cmd == "-") {
+    return ScanFilter::decreased;
+  }
+  return parse_scan_filter(cmd);
+}
+} // namespace
+
+void memory_scan(MemoryScanConfig const &config) {
+  ScanSession session(config.options);
+  spdlog::info("{}", SCAN_HELP);
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    std::istringstream ss(line);
+    std::string cmd;
+    if (!(ss >> cmd)) {
+      continue;
+    }
+    try {
+      if (auto const filter = parse_scan_command(cmd)) {
+        std::string value;
+        std::string max_value;
+        if (*filter == ScanFilter::exact) {
+          // strings may contain spaces
+          std::getline(ss >> std::ws, value);
+        } else if (*filter == ScanFilter::range) {
+          ss >> value >> max_value;
+        }
+        session.scan(*filter, value, max_value);
+        session.list(config.print_limit);
+      } else if (cmd == "l" || cmd == "list") {
+        std::size_t limit = config.print_limit;
+        ss >> limit;
+        session.list(limit);
+      } else if (cmd == "reset") {
+        session.reset();
+        spdlog::info("Reset, the next scan is a first scan.");
+      } else if (cmd == "q" || cmd == "quit") {
+        break;
+      } else {
+        spdlog::info("{}", SCAN_HELP);
+      }
+    } catch (std::exception const &e) {
+      // bad value or dolphin paused / restarting, keep the session
+      spdlog::error("{}", e.what());
+    }
+  }
+}
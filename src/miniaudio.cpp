@@ -0,0 +1,4 @@
+// The miniaudio implementation, linked into every target that links
+// xtool_common_sources.
+#define MINIAUDIO_IMPLEMENTATION
+#include <miniaudio.h>
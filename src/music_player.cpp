@@ -1,65 +1,152 @@
 #include "playlist.hpp"
+#include <latency_stats.hpp>
 #include <music_player.hpp>
+#include <trace_events.hpp>
 
 void data_callback(ma_device *pDevice, void *pOutput, const void *pInput,
                    ma_uint32 frameCount) {
-  ma_decoder *pDecoder = (ma_decoder *)pDevice->pUserData;
-  if (pDecoder == NULL) {
+  auto *state = (MusicPlayer::CallbackState *)pDevice->pUserData;
+  if (state == NULL || state->source == NULL) {
     return;
   }
+  ma_data_source *pSource = state->source;
+  auto const begin_ns = steady_now_ns();
+  XTOOL_TRACE_SCOPE("data_callback");
+  if (xtool::trace::is_enabled()) {
+    xtool::trace::set_thread_name("audio");
+  }
+  XTOOL_TRACE_COUNTER("callback frames", frameCount);
+
+  if (state->first_callback_ns.load(std::memory_order_relaxed) == 0) {
+    state->first_callback_ns.store(begin_ns, std::memory_order_release);
+  }
 
   /* Reading PCM frames will loop based on what we specified when called
    * ma_data_source_set_looping(). */
-  ma_data_source_read_pcm_frames(pDecoder, pOutput, frameCount, NULL);
+  ma_uint64 frames_read = 0;
+  auto const result = ma_data_source_read_pcm_frames(pSource, pOutput,
+                                                     frameCount, &frames_read);
+
+  if (frames_read < frameCount) {
+    // the output buffer is not pre silenced(noPreSilencedOutputBuffer)
+    auto const bytes_per_frame = ma_get_bytes_per_frame(
+        pDevice->playback.format, pDevice->playback.channels);
+    ma_silence_pcm_frames((char *)pOutput + frames_read * bytes_per_frame,
+                          frameCount - frames_read, pDevice->playback.format,
+                          pDevice->playback.channels);
+  }
+
+  state->metrics.on_callback(begin_ns, steady_now_ns(), frameCount,
+                             frames_read,
+                             result != MA_SUCCESS && result != MA_AT_END,
+                             pDevice->sampleRate);
 
   (void)pInput;
 }
 
-MusicPlayer::MusicPlayer() {}
+MusicPlayer::MusicPlayer(DecodedAudioCache *audio_cache)
+    : m_audio_cache(audio_cache) {}
 
 MusicPlayer::~MusicPlayer() { [[maybe_unused]] auto ignore_ = this->stop(); }
 
-bool MusicPlayer::play(MusicEntry const &music_entry) {
+PlayResult MusicPlayer::play(MusicEntry const &music_entry) {
+  XTOOL_TRACE_SCOPE("play");
+  m_play_timestamps = {};
   if (!this->stop()) {
-    return false;
+    spdlog::error("Failed to stop the previous music.");
+    return PlayResult::device_error;
   }
 
-  if (ma_decoder_init_file(music_entry.music_file_path.string().c_str(), NULL,
-                           &m_ma_decoder) != MA_SUCCESS) {
-    return false;
+  std::shared_ptr<DecodedAudio const> decoded_audio;
+  if (m_audio_cache != nullptr) {
+    decoded_audio = m_audio_cache->find(music_entry.music_file_path);
+  }
+  ma_data_source *source = nullptr;
+  if (decoded_audio != nullptr) {
+    XTOOL_TRACE_SCOPE("ma_audio_buffer_ref_init");
+    if (ma_audio_buffer_ref_init(decoded_audio->format, decoded_audio->channels,
+                                 decoded_audio->frames.get(),
+                                 decoded_audio->frame_count,
+                                 &m_ma_audio_buffer) != MA_SUCCESS) {
+      spdlog::error("Failed to initialize the cached music buffer.");
+      return PlayResult::source_error;
+    }
+    m_ma_audio_buffer.sampleRate = decoded_audio->sample_rate;
+    m_decoded_audio = std::move(decoded_audio);
+    source = &m_ma_audio_buffer;
+  } else {
+    XTOOL_TRACE_SCOPE("ma_decoder_init_file");
+    if (ma_decoder_init_file(music_entry.music_file_path.string().c_str(),
+                             NULL, &m_ma_decoder) != MA_SUCCESS) {
+      spdlog::error("Failed to initialize the music decoder.");
+      return PlayResult::source_error;
+    }
+    source = &m_ma_decoder;
+  }
+  m_play_timestamps.decoder_ready_ns = steady_now_ns();
+
+  // a failed play() is retried, so it must not keep the source or the device
+  bool is_device_initialized = false;
+  auto const fail = [&]() {
+    if (is_device_initialized) {
+      ma_device_uninit(&m_ma_device);
+    }
+    if (m_decoded_audio != nullptr) {
+      ma_audio_buffer_ref_uninit(&m_ma_audio_buffer);
+      m_decoded_audio.reset();
+    } else {
+      ma_decoder_uninit(&m_ma_decoder);
+    }
+    return PlayResult::device_error;
+  };
+
+  ma_format format{};
+  ma_uint32 channels{};
+  ma_uint32 sample_rate{};
+  if (ma_data_source_get_data_format(source, &format, &channels, &sample_rate,
+                                     NULL, 0) != MA_SUCCESS) {
+    spdlog::error("Failed to get the music format.");
+    return fail();
   }
 
   ma_device_config config = ma_device_config_init(ma_device_type_playback);
 
-  config.pUserData = &m_ma_decoder;
-  config.sampleRate = m_ma_decoder.outputSampleRate;
-  config.playback.channels = m_ma_decoder.outputChannels;
-  config.playback.format = m_ma_decoder.outputFormat;
+  m_callback_state.source = source;
+  m_callback_state.first_callback_ns.store(0);
+  m_callback_state.metrics.begin_stream();
+  config.pUserData = &m_callback_state;
+  config.sampleRate = sample_rate;
+  config.playback.channels = channels;
+  config.playback.format = format;
   config.dataCallback = data_callback;
   config.noPreSilencedOutputBuffer = MA_TRUE; // optimize
-  if (ma_device_init(NULL, &config, &m_ma_device) != MA_SUCCESS) {
-    spdlog::error("Failed to initialize miniaudio device.");
-    return false;
+  {
+    XTOOL_TRACE_SCOPE("ma_device_init");
+    if (ma_device_init(NULL, &config, &m_ma_device) != MA_SUCCESS) {
+      spdlog::error("Failed to initialize miniaudio device.");
+      return fail();
+    }
   }
+  is_device_initialized = true;
 
   // get length information before ma_device_start( cause glitchy sounds and
   // invalid memory location read on MSVC (Release) with mp3. not sure why but
   // avoid.)
   float music_length_in_sec{};
   auto result =
-      ma_data_source_get_length_in_seconds(&m_ma_decoder, &music_length_in_sec);
+      ma_data_source_get_length_in_seconds(source, &music_length_in_sec);
   ma_uint64 music_length_in_pcm_frames{};
   auto result2 = ma_data_source_get_length_in_pcm_frames(
-      &m_ma_decoder, &music_length_in_pcm_frames);
+      source, &music_length_in_pcm_frames);
   if (result != MA_SUCCESS || result2 != MA_SUCCESS) {
     spdlog::error("Failed to get music length.");
-    return false;
+    return fail();
   }
 
   // set looping flag
-  if (ma_data_source_set_looping(&m_ma_decoder, true) != MA_SUCCESS) {
+  if (ma_data_source_set_looping(source, true) != MA_SUCCESS) {
     spdlog::error("Failed to set looping flag.");
-    return false;
+    return fail();
   }
 
   // set loop points if available
@@ -67,14 +154,10 @@ bool MusicPlayer::play(MusicEntry const &music_entry) {
   if (music_entry.loop_start_end_offsets.has_value()) {
     auto const loop_points = *music_entry.loop_start_end_offsets;
 
-    spdlog::info("Loop information: start={}, end={}.", loop_points.first,
-                 loop_points.second);
-
     if (ma_data_source_set_loop_point_in_pcm_frames(
-            &m_ma_decoder, loop_points.first, loop_points.second) !=
-        MA_SUCCESS) {
+            source, loop_points.first, loop_points.second) != MA_SUCCESS) {
       spdlog::error("Failed to set loop points to data source.");
-      return false;
+      return fail();
     }
     // ma_sound_set_stop_time_in_pcm_frames(&sound, loop_points.second);
   }
@@ -97,22 +180,32 @@ bool MusicPlayer::play(MusicEntry const &music_entry) {
     spdlog::error("Invalid music start & end offsets(end offset <= start "
                   "offset) for music entry id {:#x}.",
                   music_entry.unique_music_id);
-    return false;
+    return fail();
   }
 
-  spdlog::info("PCM frame range: start={}, end={}.", play_start_offset,
-               play_end_offset);
-
-  if (ma_data_source_set_range_in_pcm_frames(&m_ma_decoder, play_start_offset,
+  if (ma_data_source_set_range_in_pcm_frames(source, play_start_offset,
                                              play_end_offset) != MA_SUCCESS) {
     spdlog::error("Failed to set pcm frame range to data source.");
-    return false;
+    return fail();
   }
 
-  if (ma_device_start(&m_ma_device) != MA_SUCCESS) {
-    spdlog::error("Failed to start device.");
-    return false;
+  {
+    XTOOL_TRACE_SCOPE("ma_device_start");
+    if (ma_device_start(&m_ma_device) != MA_SUCCESS) {
+      spdlog::error("Failed to start device.");
+      return fail();
+    }
   }
+  m_play_timestamps.device_started_ns = steady_now_ns();
+
+  // logged after the device started, off the switch latency path
+  if (music_entry.loop_start_end_offsets.has_value()) {
+    spdlog::info("Loop information: start={}, end={}.",
+                 music_entry.loop_start_end_offsets->first,
+                 music_entry.loop_start_end_offsets->second);
+  }
+  spdlog::info("PCM frame range: start={}, end={}.", play_start_offset,
+               play_end_offset);
 
 #ifdef __linux__
   spdlog::info(
@@ -122,7 +215,7 @@ bool MusicPlayer::play(MusicEntry const &music_entry) {
       music_entry.music_file_path.string().c_str(), music_length_in_sec,
       music_length_in_pcm_frames, config.sampleRate, config.playback.channels,
       [&]() {
-        if (ma_data_source_is_looping(&m_ma_decoder) == MA_TRUE) {
+        if (ma_data_source_is_looping(source) == MA_TRUE) {
           return "yes";
         }
         return "no";
@@ -135,7 +228,7 @@ bool MusicPlayer::play(MusicEntry const &music_entry) {
       music_entry.music_file_path.string().c_str(), music_length_in_sec,
       music_length_in_pcm_frames, config.sampleRate, config.playback.channels,
       [&]() {
-        if (ma_data_source_is_looping(&m_ma_decoder) == MA_TRUE) {
+        if (ma_data_source_is_looping(source) == MA_TRUE) {
           return "yes";
         }
         return "no";
@@ -144,7 +237,20 @@ bool MusicPlayer::play(MusicEntry const &music_entry) {
 #endif
 
   m_is_playing = true;
-  return true;
+  return PlayResult::ok;
+}
+
+MusicPlayer::PlayTimestamps const &
+MusicPlayer::last_play_timestamps() const noexcept {
+  return m_play_timestamps;
+}
+
+AudioCallbackMetrics const &MusicPlayer::callback_metrics() const noexcept {
+  return m_callback_state.metrics;
+}
+
+std::int64_t MusicPlayer::first_callback_ns() const noexcept {
+  return m_callback_state.first_callback_ns.load(std::memory_order_acquire);
 }
 
 bool MusicPlayer::stop() {
@@ -153,7 +259,12 @@ bool MusicPlayer::stop() {
       return false;
     }
 
-    ma_decoder_uninit(&m_ma_decoder);
+    if (m_decoded_audio != nullptr) {
+      ma_audio_buffer_ref_uninit(&m_ma_audio_buffer);
+      m_decoded_audio.reset();
+    } else {
+      ma_decoder_uninit(&m_ma_decoder);
+    }
     ma_device_uninit(&m_ma_device);
 
     m_is_playing = false;
@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <music_scanner.hpp>
+#include <mutex>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+namespace {
+constexpr std::string_view CACHE_HEADER = "xtool-scan-cache 1";
+
+MusicScanner::DirListing list_directory(std::filesystem::path const &dir,
+                                        std::int64_t const mtime) {
+  MusicScanner::DirListing listing;
+  listing.mtime = mtime;
+
+  std::error_code ec;
+  auto it = std::filesystem::directory_iterator(dir, ec);
+  if (ec) {
+    spdlog::warn("Failed to list directory {}: {}", dir.string(),
+                 ec.message());
+    return listing;
+  }
+  for (auto const &entry : it) {
+    auto name = entry.path().filename().string();
+    // the cache file is line based
+    if (name.find('\n') != std::string::npos) {
+      continue;
+    }
+    // We don't support symlink.
+    if (entry.is_symlink(ec)) {
+      continue;
+    }
+    if (entry.is_directory(ec)) {
+      listing.subdirs.push_back(std::move(name));
+    } else if (entry.is_regular_file(ec)) {
+      listing.files.push_back(std::move(name));
+    }
+  }
+  return listing;
+}
+
+std::vector<std::string_view> split_path(std::string_view s) {
+  std::vector<std::string_view> components;
+  while (!s.empty()) {
+    auto const pos = s.find('/');
+    auto const component = s.substr(0, pos);
+    if (!component.empty() && component != ".") {
+      components.push_back(component);
+    }
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    s.remove_prefix(pos + 1);
+  }
+  return components;
+}
+
+// "*" and "?" inside one path component
+bool match_component(std::string_view const pattern,
+                     std::string_view const s) {
+  std::size_t p = 0;
+  std::size_t i = 0;
+  std::size_t star = std::string_view::npos;
+  std::size_t star_i = 0;
+  while (i < s.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == s[i])) {
+      ++p;
+      ++i;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      star_i = i;
+    } else if (star != std::string_view::npos) {
+      p = star + 1;
+      i = ++star_i;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') {
+    ++p;
+  }
+  return p == pattern.size();
+}
+
+bool match_components(std::vector<std::string_view> const &pattern,
+                      std::size_t const p,
+                      std::vector<std::string_view> const &path,
+                      std::size_t const i) {
+  if (p == pattern.size()) {
+    return i == path.size();
+  }
+  if (pattern[p] == "**") {
+    for (auto j = i; j <= path.size(); ++j) {
+      if (match_components(pattern, p + 1, path, j)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  if (i == path.size() || !match_component(pattern[p], path[i])) {
+    return false;
+  }
+  return match_components(pattern, p + 1, path, i + 1);
+}
+
+bool has_wildcard(std::string_view const s) {
+  return s.find_first_of("*?") != std::string_view::npos;
+}
+} // namespace
+
+MusicScanner::MusicScanner(std::filesystem::path cache_file_path)
+    : m_cache_file_path(std::move(cache_file_path)) {
+  this->load();
+}
+
+void MusicScanner::load() {
+  std::ifstream file(m_cache_file_path);
+  if (!file) {
+    return;
+  }
+
+  std::string line;
+  if (!std::getline(file, line) || line != CACHE_HEADER) {
+    spdlog::warn("Ignore unknown scan cache file {}.",
+                 m_cache_file_path.string());
+    return;
+  }
+
+  DirListing *current = nullptr;
+  while (std::getline(file, line)) {
+    if (line.size() < 2 || line[1] != ' ') {
+      continue;
+    }
+    auto const value = line.substr(2);
+    switch (line[0]) {
+    case 'D': {
+      // "D <mtime> <dir>"
+      auto const space = value.find(' ');
+      if (space == std::string::npos) {
+        current = nullptr;
+        break;
+      }
+      try {
+        auto &listing = m_listings[value.substr(space + 1)];
+        listing.mtime = std::stoll(value.substr(0, space));
+        current = &listing;
+      } catch (std::exception const &) {
+        current = nullptr;
+      }
+      break;
+    }
+    case 'F':
+      if (current) {
+        current->files.push_back(value);
+      }
+      break;
+    case 'S':
+      if (current) {
+        current->subdirs.push_back(value);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  spdlog::debug("Loaded {} cached directory listings from {}.",
+                m_listings.size(), m_cache_file_path.string());
+}
+
+void MusicScanner::save() const {
+  if (!m_dirty) {
+    return;
+  }
+
+  auto tmp_path = m_cache_file_path;
+  tmp_path += ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    if (!file) {
+      spdlog::warn("Failed to write scan cache {}.", tmp_path.string());
+      return;
+    }
+    file << CACHE_HEADER << '\n';
+    for (auto const &[dir, listing] : m_listings) {
+      file << "D " << listing.mtime << ' ' << dir << '\n';
+      for (auto const &f : listing.files) {
+        file << "F " << f << '\n';
+      }
+      for (auto const &d : listing.subdirs) {
+        file << "S " << d << '\n';
+      }
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, m_cache_file_path, ec);
+  if (ec) {
+    spdlog::warn("Failed to write scan cache {}: {}",
+                 m_cache_file_path.string(), ec.message());
+  }
+}
+
+std::vector<std::filesystem::path>
+MusicScanner::scan(std::filesystem::path const &root,
+                   std::optional<std::size_t> const max_depth) {
+  if (!std::filesystem::is_directory(root)) {
+    throw std::runtime_error(
+        fmt::format("{} is not a directory!", root.string()));
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  // directory and its depth below root
+  std::deque<std::pair<std::filesystem::path, std::size_t>> queue{{root, 0}};
+  std::size_t active = 0;
+  std::vector<std::filesystem::path> files;
+  std::unordered_set<std::string> visited;
+
+  auto const worker = [&]() {
+    std::unique_lock lock(mutex);
+    while (true) {
+      cv.wait(lock, [&]() { return !queue.empty() || active == 0; });
+      if (queue.empty()) {
+        return;
+      }
+      auto const [dir, depth] = std::move(queue.front());
+      queue.pop_front();
+      ++active;
+      auto const key = dir.generic_string();
+      // Only the worker owning dir writes m_listings[key], but other workers
+      // may rehash m_listings while we are unlocked, so copy the mtime only.
+      std::optional<std::int64_t> cached_mtime;
+      if (auto const it = m_listings.find(key); it != m_listings.end()) {
+        cached_mtime = it->second.mtime;
+      }
+      lock.unlock();
+
+      std::error_code ec;
+      auto const write_time = std::filesystem::last_write_time(dir, ec);
+      auto const mtime =
+          static_cast<std::int64_t>(write_time.time_since_epoch().count());
+      auto const is_cache_hit = !ec && cached_mtime == mtime;
+      DirListing listing;
+      if (!is_cache_hit) {
+        listing = list_directory(dir, mtime);
+      }
+
+      lock.lock();
+      auto const &result = is_cache_hit ? m_listings.at(key) : listing;
+      if (!max_depth.has_value() || depth < *max_depth) {
+        for (auto const &name : result.subdirs) {
+          queue.emplace_back(dir / name, depth + 1);
+        }
+      }
+      for (auto const &name : result.files) {
+        files.push_back(dir / name);
+      }
+      visited.insert(key);
+      if (is_cache_hit) {
+        ++m_stats.cached_dirs;
+      } else {
+        ++m_stats.listed_dirs;
+        // m_listings is only read while holding the lock
+        m_listings[key] = std::move(listing);
+        m_dirty = true;
+      }
+      --active;
+      cv.notify_all();
+    }
+  };
+
+  auto const thread_count =
+      std::max(1u, std::min(std::thread::hardware_concurrency(), 16u));
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count);
+  for (unsigned i = 0; i < thread_count; ++i) {
+    threads.emplace_back(worker);
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  // forget directories which were removed below root, deeper ones than
+  // max_depth were not looked at
+  auto const prefix = root.generic_string() + "/";
+  std::erase_if(m_listings, [&](auto const &kv) {
+    auto const is_below_depth = [&]() {
+      if (!max_depth.has_value()) {
+        return true;
+      }
+      auto const relative = std::string_view(kv.first).substr(prefix.size());
+      return static_cast<std::size_t>(std::count(relative.begin(),
+                                                 relative.end(), '/')) <
+             *max_depth;
+    };
+    if (kv.first.starts_with(prefix) && !visited.contains(kv.first) &&
+        is_below_depth()) {
+      m_dirty = true;
+      return true;
+    }
+    return false;
+  });
+
+  std::sort(files.begin(), files.end(), [](auto const &a, auto const &b) {
+    return a.generic_string() < b.generic_string();
+  });
+  return files;
+}
+
+std::vector<std::filesystem::path>
+MusicScanner::expand(std::string const &source) {
+  auto const source_path = std::filesystem::path(source);
+  auto const generic = source_path.generic_string();
+
+  if (!has_wildcard(generic)) {
+    if (std::filesystem::is_regular_file(source_path)) {
+      return {source_path};
+    }
+    auto files = this->scan(source_path);
+    std::erase_if(files,
+                  [](auto const &f) { return !is_audio_file_path(f); });
+    return files;
+  }
+
+  // split into a base directory without wildcards and the pattern below it
+  auto const components = split_path(generic);
+  std::filesystem::path base = generic.starts_with('/') ? "/" : ".";
+  std::size_t first_wildcard = 0;
+  for (; first_wildcard < components.size(); ++first_wildcard) {
+    if (has_wildcard(components[first_wildcard])) {
+      break;
+    }
+    base /= std::string(components[first_wildcard]);
+  }
+  base = base.lexically_normal();
+
+  std::vector<std::string_view> const pattern(
+      components.begin() + first_wildcard, components.end());
+
+  // without "**" a match is exactly pattern.size() components below base,
+  // deeper directories can't hold one
+  auto const is_recursive =
+      std::find(pattern.begin(), pattern.end(), "**") != pattern.end();
+  auto files = this->scan(base, is_recursive ? std::nullopt
+                                             : std::optional(pattern.size() - 1));
+  std::erase_if(files, [&](auto const &f) {
+    auto const relative = f.lexically_relative(base).generic_string();
+    return !is_audio_file_path(f) ||
+           !match_components(pattern, 0, split_path(relative), 0);
+  });
+  for (auto &f : files) {
+    f = f.lexically_normal();
+  }
+  return files;
+}
+
+MusicScanner::Stats const &MusicScanner::stats() const noexcept {
+  return m_stats;
+}
+
+bool is_audio_file_path(std::filesystem::path const &path) {
+  auto ext = path.extension().string();
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return ext == ".mp3" || ext == ".flac" || ext == ".wav";
+}
+
+bool glob_match(std::string_view const pattern, std::string_view const path) {
+  return match_components(split_path(pattern), 0, split_path(path), 0);
+}
+
+std::uint64_t stable_music_id_for_path(std::filesystem::path const &path) {
+  std::uint64_t hash = 0xcbf29ce484222325;
+  for (auto const c : path.lexically_normal().generic_string()) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3;
+  }
+  return hash | (std::uint64_t{1} << 63);
+}
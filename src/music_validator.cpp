@@ -0,0 +1,146 @@
+#include <chrono>
+#include <music_validator.hpp>
+#include <playlist.hpp>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+void lower_current_thread_priority() {
+#ifdef _WIN32
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+  // On Linux nice values are per thread.
+  setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+}
+} // namespace
+
+MusicValidator::MusicValidator(
+    std::vector<std::pair<std::uint64_t, std::filesystem::path>> const
+        &musics)
+    : m_items(musics.size()) {
+  m_index.reserve(musics.size());
+  for (std::size_t i = 0; i < musics.size(); ++i) {
+    m_items[i].unique_music_id = musics[i].first;
+    m_items[i].path = musics[i].second;
+    m_index.emplace(musics[i].first, i);
+  }
+}
+
+void MusicValidator::start_background_validation() {
+  if (m_thread.joinable()) {
+    return;
+  }
+  m_thread = std::jthread([this](std::stop_token stop_token) {
+    lower_current_thread_priority();
+    auto const begin = std::chrono::steady_clock::now();
+    for (auto &item : m_items) {
+      if (stop_token.stop_requested()) {
+        return;
+      }
+      if (item.state.load() == State::unchecked) {
+        [[maybe_unused]] auto const ignore_ = this->validate(item);
+      }
+    }
+    auto const end = std::chrono::steady_clock::now();
+    spdlog::info(
+        "Background validation finished: {} musics, {} quarantined, {} ms.",
+        m_items.size(), m_quarantined_count.load(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(end - begin)
+            .count());
+  });
+}
+
+bool MusicValidator::validate(Item &item) {
+  auto next = State::valid;
+  try {
+    validate_music_file_path(item.path);
+  } catch (std::exception const &e) {
+    spdlog::warn("Quarantine music id {}: {}", item.unique_music_id,
+                 e.what());
+    next = State::quarantined;
+  }
+
+  // the background thread and a just in time check may race, count once
+  auto expected = State::unchecked;
+  if (item.state.compare_exchange_strong(expected, next)) {
+    ++m_checked_count;
+    if (next == State::quarantined) {
+      ++m_quarantined_count;
+    }
+    return next == State::valid;
+  }
+  return expected == State::valid;
+}
+
+bool MusicValidator::ensure_valid(std::uint64_t const unique_music_id) {
+  auto const it = m_index.find(unique_music_id);
+  if (it == m_index.end()) {
+    return false;
+  }
+  auto &item = m_items[it->second];
+  switch (item.state.load()) {
+  case State::valid:
+    return true;
+  case State::quarantined:
+    return false;
+  case State::unchecked:
+    break;
+  }
+  return this->validate(item);
+}
+
+void MusicValidator::quarantine(std::uint64_t const unique_music_id) {
+  auto const it = m_index.find(unique_music_id);
+  if (it == m_index.end()) {
+    return;
+  }
+  auto &item = m_items[it->second];
+  auto const previous = item.state.exchange(State::quarantined);
+  if (previous == State::quarantined) {
+    return;
+  }
+  if (previous == State::unchecked) {
+    ++m_checked_count;
+  }
+  ++m_quarantined_count;
+  spdlog::warn("Quarantine music id {}.", unique_music_id);
+}
+
+void MusicValidator::mark_valid(std::uint64_t const unique_music_id) {
+  auto const it = m_index.find(unique_music_id);
+  if (it == m_index.end()) {
+    return;
+  }
+  auto expected = State::unchecked;
+  if (m_items[it->second].state.compare_exchange_strong(expected,
+                                                        State::valid)) {
+    ++m_checked_count;
+  }
+}
+
+MusicValidator::State
+MusicValidator::state(std::uint64_t const unique_music_id) const {
+  auto const it = m_index.find(unique_music_id);
+  if (it == m_index.end()) {
+    return State::quarantined;
+  }
+  return m_items[it->second].state.load();
+}
+
+std::size_t MusicValidator::checked_count() const noexcept {
+  return m_checked_count.load();
+}
+
+std::size_t MusicValidator::quarantined_count() const noexcept {
+  return m_quarantined_count.load();
+}
+
+std::size_t MusicValidator::size() const noexcept { return m_items.size(); }
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <game_trace.hpp>
+#include <netplay_sim.hpp>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+std::uint32_t seed_at(SeedTimeline const &timeline, double const time_ms) {
+  auto const it = std::upper_bound(
+      timeline.begin(), timeline.end(), time_ms,
+      [](double const t, auto const &entry) { return t < entry.first; });
+  if (it == timeline.begin()) {
+    return timeline.front().second;
+  }
+  return std::prev(it)->second;
+}
+
+struct ClientOutcome {
+  std::uint32_t seed;
+  double detection_latency_ms;
+};
+
+// Same structure as xtool_play_music_main / music_player_thread_main:
+// the reader loop stores the music id and the seed. The player wakes up when
+// the reader published a changed music id and uses the stored seed, or with
+// player_interval_ms compares the stored music id every interval like older
+// clients.
+ClientOutcome run_client(SeedTimeline const &timeline, double const change_ms,
+                         NetplaySimConfig const &config,
+                         std::mt19937_64 &rng) {
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  auto const jitter = [&]() { return config.poll_jitter_ms * unit(rng); };
+
+  auto const emu_offset = config.emu_offset_ms * unit(rng);
+  // the loops have been running for a while with random phases
+  auto next_reader = change_ms - 2.0 * config.reader_interval_ms +
+                     config.reader_interval_ms * unit(rng);
+
+  if (!config.player_interval_ms.has_value()) {
+    while (true) {
+      auto const game_time = next_reader - emu_offset;
+      if (game_time >= change_ms) {
+        // the wakeup overshoots like a sleep, the reader does not sample
+        // again in between
+        return {seed_at(timeline, game_time),
+                next_reader + jitter() - (change_ms + emu_offset)};
+      }
+      next_reader += config.reader_interval_ms + jitter();
+    }
+  }
+
+  auto const player_interval_ms = config.player_interval_ms.value();
+  auto next_player = change_ms - 2.0 * player_interval_ms +
+                     player_interval_ms * unit(rng);
+
+  bool stored_changed = false;
+  std::uint32_t stored_seed = 0;
+  while (true) {
+    if (next_reader <= next_player) {
+      auto const game_time = next_reader - emu_offset;
+      stored_changed = game_time >= change_ms;
+      stored_seed = seed_at(timeline, game_time);
+      next_reader += config.reader_interval_ms + jitter();
+    } else {
+      if (stored_changed) {
+        return {stored_seed, next_player - (change_ms + emu_offset)};
+      }
+      next_player += player_interval_ms + jitter();
+    }
+  }
+}
+
+SeedTimeline synthetic_timeline(double const begin_ms, double const end_ms,
+                                double const mean_interval_ms,
+                                std::mt19937_64 &rng) {
+  std::exponential_distribution<double> interval(1.0 / mean_interval_ms);
+  SeedTimeline timeline;
+  for (auto t = begin_ms; t < end_ms; t += interval(rng)) {
+    timeline.emplace_back(t, static_cast<std::uint32_t>(rng()));
+  }
+  return timeline;
+}
+
+// 95% Wilson score interval
+std::pair<double, double> wilson_interval(std::uint32_t const successes,
+                                          std::uint32_t const trials) {
+  if (trials == 0) {
+    return {0.0, 0.0};
+  }
+  constexpr double z = 1.96;
+  auto const n = static_cast<double>(trials);
+  auto const p = successes / n;
+  auto const denominator = 1.0 + z * z / n;
+  auto const center = (p + z * z / (2.0 * n)) / denominator;
+  auto const margin =
+      z * std::sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * n)) / denominator;
+  return {std::max(0.0, center - margin), std::min(1.0, center + margin)};
+}
+} // namespace
+
+SeedTimeline load_seed_timeline(std::filesystem::path const &path) {
+  if (is_game_trace_file(path)) {
+    return load_seed_timeline_from_game_trace(path);
+  }
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error(
+        fmt::format("Failed to open seed timeline {}.", path.string()));
+  }
+  SeedTimeline timeline;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    std::istringstream ss(line);
+    double time_ms = 0.0;
+    std::string seed_str;
+    if (!(ss >> time_ms >> seed_str)) {
+      throw std::runtime_error(
+          fmt::format("Invalid seed timeline line: {}", line));
+    }
+    timeline.emplace_back(
+        time_ms, static_cast<std::uint32_t>(std::stoul(seed_str, nullptr, 0)));
+  }
+  std::stable_sort(
+      timeline.begin(), timeline.end(),
+      [](auto const &a, auto const &b) { return a.first < b.first; });
+  return timeline;
+}
+
+SeedTimeline
+load_seed_timeline_from_game_trace(std::filesystem::path const &path) {
+  auto const trace = load_game_trace(path);
+  auto const found =
+      find_trace_address(trace, TraceAddressKind::g_mtrand_seed);
+  if (!found.has_value() ||
+      trace.addresses[*found].size != sizeof(std::uint32_t)) {
+    throw std::runtime_error(fmt::format(
+        "Game trace {} does not contain g_mtRand.seed.", path.string()));
+  }
+  auto const index = found.value();
+
+  SeedTimeline timeline;
+  std::uint32_t previous = 0;
+  for (auto const &frame : trace.frames) {
+    // same raw value CURRENT_G_MTRAND_SEED holds
+    char bytes[sizeof(std::uint32_t)];
+    unpack_trace_value(frame.values[index], bytes, sizeof(bytes));
+    std::uint32_t seed = 0;
+    std::memcpy(&seed, bytes, sizeof(seed));
+    if (timeline.empty() || seed != previous) {
+      timeline.emplace_back(static_cast<double>(frame.time_us) / 1000.0, seed);
+      previous = seed;
+    }
+  }
+  return timeline;
+}
+
+NetplaySimResult simulate_netplay(NetplaySimConfig const &config) {
+  if (config.clients < 2) {
+    throw std::invalid_argument("Need at least 2 clients.");
+  }
+  if (config.playlist_size == 0) {
+    throw std::invalid_argument("Playlist size must be greater than 0.");
+  }
+  // a zero interval never advances the simulated clocks
+  if (!(config.reader_interval_ms > 0.0)) {
+    throw std::invalid_argument(
+        fmt::format("Reader interval must be greater than 0 ms, got {}.",
+                    config.reader_interval_ms));
+  }
+  if (config.player_interval_ms.has_value() &&
+      !(*config.player_interval_ms > 0.0)) {
+    throw std::invalid_argument(
+        fmt::format("Player interval must be greater than 0 ms, got {}.",
+                    *config.player_interval_ms));
+  }
+  if (!(config.poll_jitter_ms >= 0.0) || !(config.emu_offset_ms >= 0.0)) {
+    throw std::invalid_argument(
+        "Jitter and emulation offset must not be negative.");
+  }
+  if (!config.timeline_path.has_value() && !(config.seed_interval_ms > 0.0)) {
+    throw std::invalid_argument(
+        fmt::format("Seed interval must be greater than 0 ms, got {}.",
+                    config.seed_interval_ms));
+  }
+
+  std::mt19937_64 rng(config.sim_seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  // every client detects the change within this window
+  auto const window_ms = 2.0 * (config.reader_interval_ms +
+                                config.player_interval_ms.value_or(0.0) +
+                                2.0 * config.poll_jitter_ms +
+                                config.emu_offset_ms) +
+                         1000.0;
+
+  SeedTimeline recorded;
+  if (config.timeline_path.has_value()) {
+    recorded = load_seed_timeline(config.timeline_path.value());
+    if (recorded.size() < 2 ||
+        recorded.back().first - recorded.front().first < 2.0 * window_ms) {
+      throw std::runtime_error(
+          fmt::format("Seed timeline is too short, need more than {} ms.",
+                      2.0 * window_ms));
+    }
+  }
+
+  NetplaySimResult result;
+  result.trials = config.trials;
+  double latency_sum = 0.0;
+
+  for (std::uint32_t trial = 0; trial < config.trials; ++trial) {
+    double change_ms = 0.0;
+    SeedTimeline synthetic;
+    if (config.timeline_path.has_value()) {
+      auto const first = recorded.front().first + window_ms;
+      auto const last = recorded.back().first - window_ms;
+      change_ms = first + (last - first) * unit(rng);
+    } else {
+      synthetic = synthetic_timeline(-window_ms, window_ms,
+                                     config.seed_interval_ms, rng);
+    }
+    auto const &timeline =
+        config.timeline_path.has_value() ? recorded : synthetic;
+
+    std::optional<std::uint32_t> first_seed;
+    std::optional<std::size_t> first_pick;
+    bool seed_mismatch = false;
+    bool pick_mismatch = false;
+    for (std::size_t c = 0; c < config.clients; ++c) {
+      auto const outcome = run_client(timeline, change_ms, config, rng);
+      auto const pick = seed_rand(0, config.playlist_size - 1, outcome.seed,
+                                  config.selector_version);
+
+      latency_sum += outcome.detection_latency_ms;
+      result.max_detection_latency_ms =
+          std::max(result.max_detection_latency_ms,
+                   outcome.detection_latency_ms);
+
+      if (!first_seed.has_value()) {
+        first_seed = outcome.seed;
+        first_pick = pick;
+        continue;
+      }
+      seed_mismatch |= outcome.seed != first_seed.value();
+      pick_mismatch |= pick != first_pick.value();
+    }
+
+    result.seed_mismatches += seed_mismatch;
+    result.pick_mismatches += pick_mismatch;
+  }
+
+  if (config.trials > 0) {
+    result.mean_detection_latency_ms =
+        latency_sum / (static_cast<double>(config.trials) * config.clients);
+  }
+  return result;
+}
+
+void netplay_sim(NetplaySimConfig const &config,
+                 std::vector<double> const &reader_intervals_ms) {
+  spdlog::info("Netplay simulation: {} clients, {} trials, player {}, jitter "
+               "{} ms, emulation offset {} ms, playlist size {}, selector {}, "
+               "timeline {}.",
+               config.clients, config.trials,
+               config.player_interval_ms.has_value()
+                   ? fmt::format("polling every {} ms",
+                                 *config.player_interval_ms)
+                   : std::string("woken by the reader"),
+               config.poll_jitter_ms, config.emu_offset_ms,
+               config.playlist_size,
+               seed_selector_version_name(config.selector_version),
+               config.timeline_path.has_value()
+                   ? config.timeline_path->string()
+                   : fmt::format("synthetic(mean seed interval {} ms)",
+                                 config.seed_interval_ms));
+
+  auto intervals = reader_intervals_ms;
+  if (intervals.empty()) {
+    intervals.push_back(config.reader_interval_ms);
+  }
+
+  for (auto const reader_interval : intervals) {
+    auto c = config;
+    c.reader_interval_ms = reader_interval;
+    auto const result = simulate_netplay(c);
+    auto const [low, high] =
+        wilson_interval(result.pick_mismatches, result.trials);
+    spdlog::info("reader interval {} ms: pick mismatch {:.3f}% (95% CI "
+                 "{:.3f}%-{:.3f}%), seed mismatch {:.3f}%, detection latency "
+                 "mean {:.1f} ms, max {:.1f} ms",
+                 reader_interval,
+                 100.0 * result.pick_mismatches / std::max(1u, result.trials),
+                 100.0 * low, 100.0 * high,
+                 100.0 * result.seed_mismatches / std::max(1u, result.trials),
+                 result.mean_detection_latency_ms,
+                 result.max_detection_latency_ms);
+  }
+}
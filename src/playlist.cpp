@@ -3,12 +3,14 @@
 #include <cstddef>
 #include <cstdint>
 #include <exception>
+#include <music_scanner.hpp>
 #include <playlist.hpp>
 #include <random>
 #include <stdexcept>
 #include <string>
 #include <toml++/impl/array.hpp>
 #include <unordered_map>
+#include <unordered_set>
 
 template <typename T, typename U>
 auto fmt::formatter<std::pair<T, U>>::format(std::pair<T, U> const &pair,
@@ -37,8 +39,48 @@ auto fmt::formatter<MusicEntry>::format(MusicEntry const &me,
       end_offset_msg, me.loop_start_end_offsets);
 }
 
-Playlist::Playlist(
-    std::filesystem::path const &playlist_config_toml_file_path) {
+// Throws if the music file can not be used.
+void validate_music_file_path(std::filesystem::path const &music_file_path) {
+  // Detect some characters that cause problems on windows
+  // Incomplete but helps.
+  for (auto const c : music_file_path.string()) {
+    static std::unordered_set<char> ALLOW_CHARS{'.', ' ', '/'};
+    if (ALLOW_CHARS.contains(c)) {
+      continue;
+    }
+    if (!std::isgraph(static_cast<unsigned char>(c))) {
+      throw std::runtime_error(
+          fmt::format("Invalid character \"{}\" found in {}", c,
+                      music_file_path.string().c_str()));
+    }
+
+    if (std::iscntrl(static_cast<unsigned char>(c))) {
+      throw std::runtime_error(
+          fmt::format("Invalid control character {} found in {}", c,
+                      music_file_path.string().c_str()));
+    }
+  }
+
+  if (std::filesystem::is_symlink(music_file_path)) {
+    throw std::runtime_error(
+        fmt::format("{} is symlink! (We don't support symlink.)",
+                    music_file_path.string()));
+  }
+
+  if (!std::filesystem::exists(music_file_path)) {
+    throw std::runtime_error(
+        fmt::format("{} does not exist!", music_file_path.string()));
+  }
+
+  if (!std::filesystem::is_regular_file(music_file_path)) {
+    throw std::runtime_error(
+        fmt::format("{} is not a regular file!", music_file_path.string()));
+  }
+}
+
+Playlist::Playlist(std::filesystem::path const &playlist_config_toml_file_path,
+                   PlaylistValidation const validation) {
+  auto const is_lazy = validation == PlaylistValidation::lazy;
   toml::parse_result result =
       toml::parse_file(playlist_config_toml_file_path.string());
   if (!result.is_table()) {
@@ -51,7 +93,12 @@ Playlist::Playlist(
 
   auto musics = table["musics"]["musics"];
 
+  // musics.musics may be omitted when every playlist uses folders
+  toml::array empty_musics_array{};
   auto musics_array = musics.as_array();
+  if (!musics_array) {
+    musics_array = &empty_musics_array;
+  }
   musics_array->for_each([&](auto &elm) {
     if (!elm.is_array()) {
       throw std::runtime_error("Expected an array in musics.musics table.");
@@ -106,40 +153,8 @@ Playlist::Playlist(
     auto const music_file_path_value =
         std::filesystem::path(music_file_path->as_string()->get());
 
-    // Detect some characters that cause problems on windows
-    // Incomplete but helps.
-    for (auto const c : music_file_path_value.string()) {
-      static std::unordered_set<char> ALLOW_CHARS{'.', ' ', '/'};
-      if (ALLOW_CHARS.contains(c)) {
-        continue;
-      }
-      if (!std::isgraph(static_cast<unsigned char>(c))) {
-        throw std::runtime_error(
-            fmt::format("Invalid character \"{}\" found in {}", c,
-                        music_file_path_value.string().c_str()));
-      }
-
-      if (std::iscntrl(static_cast<unsigned char>(c))) {
-        throw std::runtime_error(
-            fmt::format("Invalid control character {} found in {}", c,
-                        music_file_path_value.string().c_str()));
-      }
-    }
-
-    if (std::filesystem::is_symlink(music_file_path_value)) {
-      throw std::runtime_error(
-          fmt::format("{} is symlink! (We don't support symlink.)",
-                      music_file_path_value.string()));
-    }
-
-    if (!std::filesystem::exists(music_file_path_value)) {
-      throw std::runtime_error(
-          fmt::format("{} does not exist!", music_file_path_value.string()));
-    }
-
-    if (!std::filesystem::is_regular_file(music_file_path_value)) {
-      throw std::runtime_error(fmt::format("{} is not a regular file!",
-                                           music_file_path_value.string()));
+    if (!is_lazy) {
+      validate_music_file_path(music_file_path_value);
     }
 
     auto const music_start_offset_value =
@@ -203,9 +218,16 @@ Playlist::Playlist(
 
   std::vector<std::shared_ptr<PlaylistEntry>> playlist_entries;
 
+  // created on the first playlist with folders
+  std::unique_ptr<MusicScanner> scanner;
+  // scanned files that failed the eager check, kept in the playlists so both
+  // validation modes select from the same musics
+  std::unordered_set<UniqueMusicID> invalid_music_ids;
+
   // read other tables
   for (auto const &entry : table) {
-    if (entry.first.str() == "musics") {
+    // [xtool] holds xtool settings, see load_xtool_config
+    if (entry.first.str() == "musics" || entry.first.str() == "xtool") {
       continue;
     }
     spdlog::info("Found playlist: {}", entry.first.str());
@@ -222,29 +244,88 @@ Playlist::Playlist(
 
     // playlist musics
     auto const musics = playlist_table->get("musics");
-    if (!musics) {
+    auto const folders = playlist_table->get("folders");
+    if (!musics && !folders) {
       throw std::runtime_error(fmt::format(
           "Playlist {}, a musics table not found.", entry.first.str()));
     }
-    if (!musics->is_array()) {
-      throw std::runtime_error(fmt::format(
-          "Playlist {}, expected an array for musics.", entry.first.str()));
-    }
-    auto const music_array = musics->as_array();
-    assert(music_array);
 
     auto unique_music_ids = std::vector<std::uint64_t>{};
     unique_music_ids.reserve(512);
 
-    music_array->for_each([&](auto &elm) {
-      if (!elm.is_integer()) {
-        throw std::runtime_error(
-            fmt::format("Playlist {}, expected an integer for music id.",
-                        entry.first.str()));
+    if (musics) {
+      if (!musics->is_array()) {
+        throw std::runtime_error(fmt::format(
+            "Playlist {}, expected an array for musics.", entry.first.str()));
       }
-      auto const unique_music_id = elm.as_integer()->get();
-      unique_music_ids.push_back(unique_music_id);
-    });
+      auto const music_array = musics->as_array();
+      assert(music_array);
+
+      music_array->for_each([&](auto &elm) {
+        if (!elm.is_integer()) {
+          throw std::runtime_error(
+              fmt::format("Playlist {}, expected an integer for music id.",
+                          entry.first.str()));
+        }
+        auto const unique_music_id = elm.as_integer()->get();
+        unique_music_ids.push_back(unique_music_id);
+      });
+    }
+    auto const listed_music_count = unique_music_ids.size();
+
+    // folders: directories or glob patterns, scanned recursively
+    if (folders) {
+      if (!folders->is_array()) {
+        throw std::runtime_error(fmt::format(
+            "Playlist {}, expected an array for folders.", entry.first.str()));
+      }
+      if (!scanner) {
+        auto cache_file_path = playlist_config_toml_file_path;
+        cache_file_path += ".scan_cache";
+        scanner = std::make_unique<MusicScanner>(cache_file_path);
+      }
+
+      folders->as_array()->for_each([&](auto &elm) {
+        if (!elm.is_string()) {
+          throw std::runtime_error(
+              fmt::format("Playlist {}, expected a string for folder.",
+                          entry.first.str()));
+        }
+        auto const source = std::string(elm.as_string()->get());
+        auto const files = scanner->expand(source);
+        spdlog::info("Found {} musics in {}", files.size(), source);
+
+        for (auto const &file : files) {
+          auto const id = stable_music_id_for_path(file);
+          if (!is_lazy) {
+            try {
+              validate_music_file_path(file);
+            } catch (std::exception const &e) {
+              spdlog::warn("Skip {}: {}", file.string(), e.what());
+              invalid_music_ids.insert(id);
+            }
+          }
+
+          if (auto const it = m_music_map.find(id); it != m_music_map.end()) {
+            if (it->second.music_file_path.lexically_normal() !=
+                file.lexically_normal()) {
+              throw std::runtime_error(
+                  fmt::format("Music id collision {:#x}: {} and {}", id,
+                              it->second.music_file_path.string(),
+                              file.string()));
+            }
+          } else {
+            m_music_map[id] = MusicEntry{
+                id,
+                file,
+                std::make_pair(static_cast<std::uint64_t>(-1),
+                               static_cast<std::uint64_t>(-1)),
+                std::nullopt};
+          }
+          unique_music_ids.push_back(id);
+        }
+      });
+    }
 
     spdlog::info("Found {} musics for table: {}", unique_music_ids.size(),
                  entry.first.str());
@@ -284,11 +365,75 @@ Playlist::Playlist(
       ids.push_back(target_id);
     });
 
-    auto playlist_entry = std::make_shared<PlaylistEntry>(PlaylistEntry{
-        entry.first.str().data(),
-        ids,
-        unique_music_ids,
-    });
+    // optional weights
+    std::vector<double> weights;
+    if (auto const weights_node = playlist_table->get("weights");
+        weights_node) {
+      if (!weights_node->is_array()) {
+        throw std::runtime_error(fmt::format(
+            "Playlist {}, expected an array for weights.", entry.first.str()));
+      }
+      weights.reserve(unique_music_ids.size());
+      weights_node->as_array()->for_each([&](auto &elm) {
+        if (elm.is_integer()) {
+          weights.push_back(static_cast<double>(elm.as_integer()->get()));
+        } else if (elm.is_floating_point()) {
+          weights.push_back(elm.as_floating_point()->get());
+        } else {
+          throw std::runtime_error(
+              fmt::format("Playlist {}, expected a number for weight.",
+                          entry.first.str()));
+        }
+      });
+      if (weights.size() != listed_music_count) {
+        throw std::runtime_error(fmt::format(
+            "Playlist {}, {} weights for {} musics.", entry.first.str(),
+            weights.size(), listed_music_count));
+      }
+      // musics found in folders get the default weight
+      weights.resize(unique_music_ids.size(), 1.0);
+    }
+
+    // optional no repeat count
+    std::size_t no_repeat = 0;
+    if (auto const no_repeat_node = playlist_table->get("no_repeat");
+        no_repeat_node) {
+      if (!no_repeat_node->is_integer() ||
+          no_repeat_node->as_integer()->get() < 0) {
+        throw std::runtime_error(
+            fmt::format("Playlist {}, expected a non negative integer for "
+                        "no_repeat.",
+                        entry.first.str()));
+      }
+      no_repeat = no_repeat_node->as_integer()->get();
+
+      // at least one music must stay selectable
+      auto const distinct_musics =
+          std::unordered_set<UniqueMusicID>(unique_music_ids.begin(),
+                                            unique_music_ids.end())
+              .size();
+      if (distinct_musics > 0 && no_repeat >= distinct_musics) {
+        spdlog::warn("Playlist {}, no_repeat {} >= {} distinct musics, use {}.",
+                     entry.first.str(), no_repeat, distinct_musics,
+                     distinct_musics - 1);
+        no_repeat = distinct_musics - 1;
+      }
+    }
+
+    auto playlist_entry = std::make_shared<PlaylistEntry>();
+    playlist_entry->name = entry.first.str().data();
+    playlist_entry->target_music_ids = ids;
+    playlist_entry->music_entries = unique_music_ids;
+    if (!weights.empty()) {
+      try {
+        playlist_entry->alias_table = AliasTable(weights);
+      } catch (std::exception const &e) {
+        throw std::runtime_error(fmt::format("Playlist {}, {}",
+                                             entry.first.str(), e.what()));
+      }
+    }
+    playlist_entry->weights = std::move(weights);
+    playlist_entry->history.capacity = no_repeat;
 
     playlist_entries.push_back(playlist_entry);
 
@@ -302,6 +447,35 @@ Playlist::Playlist(
 
   m_playlist_entries = playlist_entries;
 
+  if (scanner) {
+    spdlog::info("Folder scan: {} directories listed, {} from cache.",
+                 scanner->stats().listed_dirs, scanner->stats().cached_dirs);
+    scanner->save();
+  }
+
+  // Invalid musics stay in the playlists in both modes and are skipped at
+  // selection(usable_music_index), so a seed picks the same music whether a
+  // client validates eagerly or lazily.
+  std::vector<std::pair<UniqueMusicID, std::filesystem::path>> music_files;
+  music_files.reserve(m_music_map.size());
+  for (auto const &[id, music] : m_music_map) {
+    music_files.emplace_back(id, music.music_file_path);
+  }
+  m_validator = std::make_shared<MusicValidator>(music_files);
+  if (is_lazy) {
+    spdlog::info("Lazy validation, {} music files will be checked later.",
+                 music_files.size());
+  } else {
+    // every music was checked above
+    for (auto const &[id, path] : music_files) {
+      if (invalid_music_ids.contains(id)) {
+        m_validator->quarantine(id);
+      } else {
+        m_validator->mark_valid(id);
+      }
+    }
+  }
+
   // for debugging
   /*
   for (auto [k, v] : m_brawl_music_id_to_unique_ids_map) {
@@ -314,8 +488,9 @@ Playlist::Playlist(
 }
 
 std::optional<MusicEntry>
-Playlist::random_music_for_with_g_mtRand_seed(BrawlMusicID const music_id,
-                                              std::uint32_t const seed) const {
+Playlist::random_music_for_with_g_mtRand_seed(
+    BrawlMusicID const music_id, std::uint32_t const seed,
+    SeedSelectorVersion const version) {
   if (!m_brawl_music_id_to_playlist_entry_map.contains(music_id)) {
     return std::nullopt;
   }
@@ -328,24 +503,31 @@ Playlist::random_music_for_with_g_mtRand_seed(BrawlMusicID const music_id,
   }
   // choose one randomly
 
-  spdlog::info("Using seed {:#x}", seed);
+  spdlog::info("Using seed {:#x}, selector {}", seed,
+               seed_selector_version_name(version));
   spdlog::info("Found PlaylistEntry {}, {} musics for brawl music id {:#x}.",
                playlist_entry->name, playlist_entry->music_entries.size(),
                music_id);
-  auto const random_index =
-      seed_rand(0, playlist_entry->music_entries.size() - 1, seed);
-  auto const unique_music_id = playlist_entry->music_entries[random_index];
+  auto const random_index = usable_music_index(
+      *playlist_entry, select_music_index(*playlist_entry, seed, version));
+  if (!random_index.has_value()) {
+    spdlog::warn("Every music of PlaylistEntry {} is quarantined.",
+                 playlist_entry->name);
+    return std::nullopt;
+  }
+  auto const unique_music_id = playlist_entry->music_entries[*random_index];
 
   if (!m_music_map.contains(unique_music_id)) {
     return std::nullopt;
   }
+  playlist_entry->history.push(unique_music_id);
 
   auto entry = m_music_map.at(unique_music_id);
   return entry;
 }
 
 std::optional<MusicEntry> Playlist::random_music_for_with_std_random_device(
-    BrawlMusicID const music_id) const {
+    BrawlMusicID const music_id) {
   if (!m_brawl_music_id_to_playlist_entry_map.contains(music_id)) {
     return std::nullopt;
   }
@@ -364,21 +546,84 @@ std::optional<MusicEntry> Playlist::random_music_for_with_std_random_device(
                music_id);
 
   std::random_device rd;
-  std::mt19937 rng(rd());
-
-  std::uniform_int_distribution<std::size_t> dist(
-      0, playlist_entry->music_entries.size() - 1);
-  std::size_t random_index = dist(rng);
-  auto const unique_music_id = playlist_entry->music_entries[random_index];
+  std::size_t random_index = 0;
+  if (playlist_entry->weights.empty() &&
+      playlist_entry->history.capacity == 0) {
+    std::mt19937 rng(rd());
+
+    std::uniform_int_distribution<std::size_t> dist(
+        0, playlist_entry->music_entries.size() - 1);
+    random_index = dist(rng);
+  } else {
+    random_index = select_music_index(*playlist_entry, rd(),
+                                      SeedSelectorVersion::v2);
+  }
+  auto const usable_index = usable_music_index(*playlist_entry, random_index);
+  if (!usable_index.has_value()) {
+    spdlog::warn("Every music of PlaylistEntry {} is quarantined.",
+                 playlist_entry->name);
+    return std::nullopt;
+  }
+  auto const unique_music_id = playlist_entry->music_entries[*usable_index];
 
   if (!m_music_map.contains(unique_music_id)) {
     return std::nullopt;
   }
+  playlist_entry->history.push(unique_music_id);
 
   auto entry = m_music_map.at(unique_music_id);
   return entry;
 }
 
+void Playlist::start_background_validation() {
+  if (m_validator && m_validator->checked_count() < m_validator->size()) {
+    m_validator->start_background_validation();
+  }
+}
+
+Playlist Playlist::fork() const {
+  Playlist copy;
+  copy.m_music_map = m_music_map;
+  copy.m_validator = m_validator;
+  std::unordered_map<PlaylistEntry const *, std::shared_ptr<PlaylistEntry>>
+      copies;
+  for (auto const &entry : m_playlist_entries) {
+    auto entry_copy = std::make_shared<PlaylistEntry>(*entry);
+    entry_copy->history = MusicHistory{entry->history.capacity, {}, {}};
+    copies.emplace(entry.get(), entry_copy);
+    copy.m_playlist_entries.push_back(std::move(entry_copy));
+  }
+  for (auto const &[brawl_music_id, entry] :
+       m_brawl_music_id_to_playlist_entry_map) {
+    copy.m_brawl_music_id_to_playlist_entry_map.emplace(
+        brawl_music_id, copies.at(entry.get()));
+  }
+  return copy;
+}
+
+void Playlist::quarantine(UniqueMusicID const unique_music_id) {
+  if (m_validator) {
+    m_validator->quarantine(unique_music_id);
+  }
+}
+
+std::optional<std::size_t>
+Playlist::usable_music_index(PlaylistEntry const &playlist_entry,
+                             std::size_t const index) const {
+  if (!m_validator) {
+    return index;
+  }
+  // Probe in a fixed order so clients with the same files still agree.
+  auto const size = playlist_entry.music_entries.size();
+  for (std::size_t i = 0; i < size; ++i) {
+    auto const probe = (index + i) % size;
+    if (m_validator->ensure_valid(playlist_entry.music_entries[probe])) {
+      return probe;
+    }
+  }
+  return std::nullopt;
+}
+
 std::unordered_map<UniqueMusicID, MusicEntry> const &
 Playlist::music_map() const noexcept {
   return m_music_map;
@@ -394,34 +639,83 @@ Playlist::brawl_music_id_to_playlist_entry_map() const noexcept {
   return m_brawl_music_id_to_playlist_entry_map;
 }
 
-// メモ:
-// ネットプレイで途中からツールを起動した人(クライアント)も同期できるように、毎回現在時刻でシードを生成して乱数を一度だけ生成してシードやdistributionは使い回さない
-// 現在の実装ではadditional_seedにゲーム内のseedを拝借して利用している
-// ゲーム内のseedが更新されるタイミングを観察した限り、ギリクライアント間で同期したまま使えそうな感じがした
-std::size_t seed_rand(std::size_t const l, std::size_t const r,
-                      std::uint32_t const additional_seed) {
-  assert(l <= r);
-  // seed
-  /*
-  Old time based seed code
-  bad rand quality
-    std::time_t now = std::time(nullptr);
+bool MusicHistory::contains(UniqueMusicID const id) const noexcept {
+  return counts.contains(id);
+}
 
-    auto const tm = std::gmtime(&now);
-    if (!tm) {
-      throw std::runtime_error("Failed to convert std::time_t to UTC");
+void MusicHistory::push(UniqueMusicID const id) {
+  if (capacity == 0) {
+    return;
+  }
+  ids.push_back(id);
+  ++counts[id];
+  while (ids.size() > capacity) {
+    auto const oldest = ids.front();
+    ids.pop_front();
+    if (--counts[oldest] == 0) {
+      counts.erase(oldest);
     }
+  }
+}
 
-    int minutes_since_epoch = (now / 60);
+std::size_t select_music_index(PlaylistEntry const &playlist_entry,
+                               std::uint32_t const seed,
+                               SeedSelectorVersion const version) {
+  auto const size = playlist_entry.music_entries.size();
+  assert(size > 0);
 
-    std::uint32_t const seed = minutes_since_epoch ^ additional_seed;
+  // keep the old behaviour for plain playlists
+  if (playlist_entry.alias_table.empty() &&
+      playlist_entry.history.capacity == 0) {
+    return seed_rand(0, size - 1, seed, version);
+  }
 
-    spdlog::info("seed {:#x} = minutes_since_epoch({:#x}) ^ {:#x}", seed,
-                 minutes_since_epoch, constant);
-  */
-  // generate
-  std::mt19937 rng(additional_seed);
-  std::uniform_int_distribution<std::size_t> dist(l, r);
-  std::size_t v = dist(rng);
-  return v;
-}
\ No newline at end of file
+  SeedSequenceV2 seq{seed};
+  auto const draw = [&]() -> std::size_t {
+    if (!playlist_entry.alias_table.empty()) {
+      return playlist_entry.alias_table.sample(seq);
+    }
+    return seq.bounded(size);
+  };
+
+  auto const first = draw();
+  if (!playlist_entry.history.contains(playlist_entry.music_entries[first])) {
+    return first;
+  }
+
+  // Redraw from the same sequence. Bounded so a playlist whose weight is
+  // almost all on recent musics can not stall the player thread.
+  constexpr auto MAX_REDRAWS = 64;
+  for (auto i = 0; i < MAX_REDRAWS; ++i) {
+    auto const index = draw();
+    if (!playlist_entry.history.contains(
+            playlist_entry.music_entries[index])) {
+      return index;
+    }
+  }
+
+  // Out of redraws(e.g. no_repeat close to the music count), pick uniformly
+  // from the musics that are allowed, still from the same sequence.
+  auto const is_allowed = [&](std::size_t const index) {
+    return !playlist_entry.history.contains(
+               playlist_entry.music_entries[index]) &&
+           (playlist_entry.weights.empty() ||
+            playlist_entry.weights[index] > 0.0);
+  };
+  std::size_t allowed_count = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    allowed_count += is_allowed(i) ? 1 : 0;
+  }
+  if (allowed_count == 0) {
+    // only recent musics have weight
+    return first;
+  }
+  auto nth = seq.bounded(allowed_count);
+  for (std::size_t i = 0; i < size; ++i) {
+    if (is_allowed(i) && nth-- == 0) {
+      return i;
+    }
+  }
+  assert(false);
+  return first;
+}
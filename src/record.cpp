@@ -0,0 +1,122 @@
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <dme/Common/CommonUtils.h>
+#include <dolphin_manager.hpp>
+#include <fmt/format.h>
+#include <optional>
+#include <record.hpp>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <thread>
+
+WatchedAddress parse_watched_address(std::string_view const arg) {
+  auto const colon = arg.find(':');
+  if (colon == std::string_view::npos) {
+    throw std::invalid_argument(fmt::format(
+        "Invalid watched address {}, expected <address>:<size>.", arg));
+  }
+  auto address_str = arg.substr(0, colon);
+  if (address_str.starts_with("0x") || address_str.starts_with("0X")) {
+    address_str.remove_prefix(2);
+  }
+  auto const size_str = arg.substr(colon + 1);
+
+  std::uint32_t address = 0;
+  std::uint32_t size = 0;
+  auto const [p1, ec1] = std::from_chars(
+      address_str.data(), address_str.data() + address_str.size(), address,
+      16);
+  auto const [p2, ec2] = std::from_chars(
+      size_str.data(), size_str.data() + size_str.size(), size);
+  if (ec1 != std::errc{} || p1 != address_str.data() + address_str.size() ||
+      ec2 != std::errc{} || p2 != size_str.data() + size_str.size()) {
+    throw std::invalid_argument(
+        fmt::format("Invalid watched address {}.", arg));
+  }
+  if (size == 0 || size > 8) {
+    throw std::invalid_argument(
+        fmt::format("Watched address size must be 1 to 8, got {}.", size));
+  }
+  if (address >= Common::MEM1_START) {
+    address = Common::dolphinAddrToOffset(address, false);
+  }
+  return {address, size};
+}
+
+void record_game_trace(std::filesystem::path const &out_path,
+                       GameAddressResolver resolver,
+                       std::vector<WatchedAddress> const &extra_addresses,
+                       std::uint32_t const interval_ms,
+                       std::uint32_t const duration_s) {
+  if (interval_ms == 0) {
+    // the fixed rate loop would never sleep
+    throw std::invalid_argument("The record interval must be at least 1 ms.");
+  }
+  // created for the first known game, the replay polls what is watched here
+  std::optional<GameTraceWriter> writer;
+  std::vector<WatchedAddress> addresses;
+  DolphinManager dm;
+
+  auto const begin = std::chrono::steady_clock::now();
+  auto next = begin;
+  std::vector<std::uint64_t> values;
+  std::uint64_t failed_reads = 0;
+  while (duration_s == 0 ||
+         std::chrono::steady_clock::now() - begin <
+             std::chrono::seconds(duration_s)) {
+    // fixed rate, a slow read does not shift the following samples
+    next += std::chrono::milliseconds(interval_ms);
+
+    auto const *game = resolver.addresses(dm.dolphin());
+    bool ok = game != nullptr;
+    if (ok) {
+      auto watched = game_trace_addresses(*game, extra_addresses);
+      if (!writer.has_value()) {
+        addresses = std::move(watched);
+        values.assign(addresses.size(), 0);
+        writer.emplace(out_path, addresses);
+        spdlog::info("Recording {} addresses every {} ms to {}.",
+                     addresses.size(), interval_ms, out_path.string());
+      } else if (watched != addresses) {
+        spdlog::error("The game changed to one with other addresses, stop "
+                      "recording.");
+        break;
+      }
+    }
+
+    for (std::size_t i = 0; i < addresses.size() && ok; ++i) {
+      std::array<char, 8> buffer{};
+      ok = dm.dolphin().readFromRAM(addresses[i].offset, buffer.data(),
+                                    addresses[i].size, false);
+      values[i] = pack_trace_value(buffer.data(), addresses[i].size);
+    }
+
+    if (ok) {
+      auto const time_us =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - begin)
+              .count();
+      auto const frames = writer->written_frames();
+      writer->write(static_cast<std::uint64_t>(time_us), values);
+      if (writer->written_frames() != frames) {
+        spdlog::debug("Frame {} at {} us.", frames, time_us);
+      }
+    } else {
+      if (game != nullptr) {
+        // the game may have been stopped, read its id again
+        resolver.invalidate();
+      }
+      if (failed_reads++ == 0) {
+        spdlog::error("Failed to read the game memory, waiting for dolphin "
+                      "and a known game.");
+      }
+    }
+
+    std::this_thread::sleep_until(next);
+  }
+
+  spdlog::info("Recorded {} frames, {} failed reads.",
+               writer.has_value() ? writer->written_frames() : 0,
+               failed_reads);
+}
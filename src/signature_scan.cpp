@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <cctype>
+#include <dme/Common/CommonUtils.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <functional>
+#include <signature_scan.hpp>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+// 2: entries carry the hash of the signature definition
+constexpr std::string_view CACHE_HEADER = "xtool-signature-cache 2";
+
+// longest run of bytes without wildcard, searched first
+struct Anchor {
+  std::size_t offset = 0;
+  std::size_t size = 0;
+};
+
+Anchor longest_literal_run(BytePattern const &pattern) {
+  Anchor best;
+  std::size_t begin = 0;
+  for (std::size_t i = 0; i <= pattern.mask.size(); ++i) {
+    if (i == pattern.mask.size() || pattern.mask[i] == 0) {
+      if (i - begin > best.size) {
+        best = {begin, i - begin};
+      }
+      begin = i + 1;
+    }
+  }
+  return best;
+}
+
+bool matches_at(char const *p, BytePattern const &pattern) {
+  for (std::size_t i = 0; i < pattern.bytes.size(); ++i) {
+    if ((static_cast<std::uint8_t>(p[i]) & pattern.mask[i]) !=
+        pattern.bytes[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::uint32_t read_be32(char const *p) {
+  return static_cast<std::uint32_t>(static_cast<std::uint8_t>(p[0])) << 24 |
+         static_cast<std::uint32_t>(static_cast<std::uint8_t>(p[1])) << 16 |
+         static_cast<std::uint32_t>(static_cast<std::uint8_t>(p[2])) << 8 |
+         static_cast<std::uint32_t>(static_cast<std::uint8_t>(p[3]));
+}
+
+// (hi << 16) + lo of a lis / D-form pair, e.g.
+//   lis r3, 0x805a        3c 60 80 5a
+//   lwz r3, 0xbc(r3)      80 63 00 bc
+std::optional<std::uint32_t> decode_hi_lo(std::uint32_t const hi_instruction,
+                                          std::uint32_t const lo_instruction) {
+  // addis rD, 0, SIMM
+  auto const hi_opcode = hi_instruction >> 26;
+  auto const hi_ra = (hi_instruction >> 16) & 0x1f;
+  if (hi_opcode != 15 || hi_ra != 0) {
+    return std::nullopt;
+  }
+  auto const hi = hi_instruction << 16;
+  auto const lo = lo_instruction & 0xffff;
+  auto const lo_opcode = lo_instruction >> 26;
+  // ori takes @l unsigned with @h
+  if (lo_opcode == 24) {
+    return hi | lo;
+  }
+  // addi and the loads / stores take @l signed with @ha
+  if (lo_opcode == 14 || (lo_opcode >= 32 && lo_opcode <= 55)) {
+    return hi + static_cast<std::uint32_t>(
+                    static_cast<std::int32_t>(static_cast<std::int16_t>(lo)));
+  }
+  return std::nullopt;
+}
+
+std::string cache_key(std::string_view const game_id,
+                      std::uint64_t const code_hash) {
+  return fmt::format("{} {:016x}", game_id, code_hash);
+}
+} // namespace
+
+BytePattern parse_byte_pattern(std::string_view const text) {
+  BytePattern pattern;
+  std::istringstream ss{std::string(text)};
+  std::string token;
+  while (ss >> token) {
+    if (token == "?" || token == "??") {
+      pattern.bytes.push_back(0);
+      pattern.mask.push_back(0);
+      continue;
+    }
+    auto const is_hex = token.size() == 2 &&
+                        std::all_of(token.begin(), token.end(), [](char c) {
+                          return std::isxdigit(static_cast<unsigned char>(c));
+                        });
+    if (!is_hex) {
+      throw std::invalid_argument(
+          fmt::format("Invalid byte '{}' in pattern \"{}\".", token, text));
+    }
+    pattern.bytes.push_back(
+        static_cast<std::uint8_t>(std::stoul(token, nullptr, 16)));
+    pattern.mask.push_back(0xff);
+  }
+  if (longest_literal_run(pattern).size == 0) {
+    throw std::invalid_argument(
+        fmt::format("Pattern \"{}\" has no literal byte.", text));
+  }
+  return pattern;
+}
+
+std::vector<std::size_t> find_pattern(std::span<char const> const memory,
+                                      BytePattern const &pattern,
+                                      std::size_t const limit) {
+  std::vector<std::size_t> matches;
+  auto const size = pattern.bytes.size();
+  if (size == 0 || memory.size() < size) {
+    return matches;
+  }
+  auto const anchor = longest_literal_run(pattern);
+  auto const *anchor_begin =
+      reinterpret_cast<char const *>(pattern.bytes.data()) + anchor.offset;
+  std::boyer_moore_horspool_searcher const searcher(
+      anchor_begin, anchor_begin + anchor.size);
+
+  // the anchor can only be where the whole pattern fits
+  auto const first =
+      memory.begin() + static_cast<std::ptrdiff_t>(anchor.offset);
+  auto const last =
+      memory.end() -
+      static_cast<std::ptrdiff_t>(size - anchor.offset - anchor.size);
+  for (auto it = std::search(first, last, searcher);
+       it != last && matches.size() < limit;
+       it = std::search(it + 1, last, searcher)) {
+    auto const offset =
+        static_cast<std::size_t>(it - memory.begin()) - anchor.offset;
+    if (matches_at(memory.data() + offset, pattern)) {
+      matches.push_back(offset);
+    }
+  }
+  return matches;
+}
+
+std::optional<SignatureTarget>
+parse_signature_target(std::string_view const name) {
+  if (name == "match") {
+    return SignatureTarget::match;
+  }
+  if (name == "hi_lo") {
+    return SignatureTarget::hi_lo;
+  }
+  return std::nullopt;
+}
+
+std::optional<std::uint32_t> resolve_signature(std::span<char const> const ram,
+                                               bool const aram,
+                                               Signature const &signature) {
+  auto const matches = find_pattern(ram, signature.pattern, 2);
+  if (matches.size() != 1) {
+    spdlog::warn("Signature {} found {} times, expected once.",
+                 signature.name, matches.size() == 2 ? "2+" : "0");
+    return std::nullopt;
+  }
+  auto const match = static_cast<std::int64_t>(matches.front());
+  auto const at = [&](std::int32_t const offset) -> char const * {
+    auto const index = match + offset;
+    if (index < 0 || static_cast<std::size_t>(index) + 4 > ram.size()) {
+      return nullptr;
+    }
+    return ram.data() + index;
+  };
+
+  switch (signature.target) {
+  case SignatureTarget::match: {
+    auto const index = match + signature.offset;
+    if (index < 0 || static_cast<std::size_t>(index) >= ram.size()) {
+      return std::nullopt;
+    }
+    return Common::cacheIndexToDolphinAddr(static_cast<std::uint32_t>(index),
+                                           aram) +
+           static_cast<std::uint32_t>(signature.addend);
+  }
+  case SignatureTarget::hi_lo: {
+    auto const *hi = at(signature.offset);
+    auto const *lo = at(signature.lo_offset);
+    if (hi == nullptr || lo == nullptr) {
+      return std::nullopt;
+    }
+    auto const address = decode_hi_lo(read_be32(hi), read_be32(lo));
+    if (!address.has_value()) {
+      spdlog::warn("Signature {} does not point at a lis / @l pair.",
+                   signature.name);
+      return std::nullopt;
+    }
+    return address.value() + static_cast<std::uint32_t>(signature.addend);
+  }
+  }
+  return std::nullopt;
+}
+
+std::uint64_t hash_memory(std::span<char const> const memory) {
+  std::uint64_t hash = 0xcbf29ce484222325;
+  for (auto const c : memory) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+std::uint64_t hash_signature(Signature const &signature) {
+  std::vector<char> definition;
+  auto const append = [&](auto const value) {
+    auto const *bytes = reinterpret_cast<char const *>(&value);
+    definition.insert(definition.end(), bytes, bytes + sizeof(value));
+  };
+  definition.insert(definition.end(), signature.pattern.bytes.begin(),
+                    signature.pattern.bytes.end());
+  definition.insert(definition.end(), signature.pattern.mask.begin(),
+                    signature.pattern.mask.end());
+  append(static_cast<std::uint8_t>(signature.target));
+  append(signature.offset);
+  append(signature.lo_offset);
+  append(signature.addend);
+  return hash_memory(definition);
+}
+
+SignatureCache::SignatureCache(std::filesystem::path cache_file_path)
+    : m_cache_file_path(std::move(cache_file_path)) {
+  this->load();
+}
+
+std::optional<std::uint32_t>
+SignatureCache::find(std::string_view const game_id,
+                     std::uint64_t const code_hash,
+                     Signature const &signature) const {
+  std::lock_guard lock(m_mutex);
+  auto const game = m_entries.find(cache_key(game_id, code_hash));
+  if (game == m_entries.end()) {
+    return std::nullopt;
+  }
+  auto const it = game->second.find(signature.name);
+  if (it == game->second.end()) {
+    return std::nullopt;
+  }
+  if (it->second.signature_hash != hash_signature(signature)) {
+    spdlog::info("Signature {} changed since it was cached, search again.",
+                 signature.name);
+    return std::nullopt;
+  }
+  return it->second.address;
+}
+
+void SignatureCache::store(std::string_view const game_id,
+                           std::uint64_t const code_hash,
+                           Signature const &signature,
+                           std::uint32_t const address) {
+  std::lock_guard lock(m_mutex);
+  m_entries[cache_key(game_id, code_hash)][signature.name] = {
+      address, hash_signature(signature)};
+  m_dirty = true;
+}
+
+void SignatureCache::load() {
+  std::ifstream file(m_cache_file_path);
+  if (!file) {
+    return;
+  }
+
+  std::string line;
+  if (!std::getline(file, line) || line != CACHE_HEADER) {
+    spdlog::warn("Ignore unknown signature cache file {}.",
+                 m_cache_file_path.string());
+    return;
+  }
+
+  std::map<std::string, Entry> *current = nullptr;
+  while (std::getline(file, line)) {
+    std::istringstream ss(line);
+    std::string kind;
+    ss >> kind;
+    if (kind == "G") {
+      // "G <game id> <code hash>"
+      std::string game_id;
+      std::string hash;
+      current = ss >> game_id >> hash
+                    ? &m_entries[fmt::format("{} {}", game_id, hash)]
+                    : nullptr;
+    } else if (kind == "A" && current != nullptr) {
+      // "A <name> <console address> <signature hash>"
+      std::string name;
+      Entry entry;
+      if (ss >> name >> std::hex >> entry.address >> entry.signature_hash) {
+        (*current)[name] = entry;
+      }
+    }
+  }
+  spdlog::debug("Loaded {} cached games from {}.", m_entries.size(),
+                m_cache_file_path.string());
+}
+
+void SignatureCache::save() {
+  std::lock_guard lock(m_mutex);
+  if (!m_dirty) {
+    return;
+  }
+
+  auto tmp_path = m_cache_file_path;
+  tmp_path += ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    if (!file) {
+      spdlog::warn("Failed to write signature cache {}.", tmp_path.string());
+      return;
+    }
+    file << CACHE_HEADER << '\n';
+    for (auto const &[key, addresses] : m_entries) {
+      file << "G " << key << '\n';
+      for (auto const &[name, entry] : addresses) {
+        file << fmt::format("A {} {:#010x} {:016x}\n", name, entry.address,
+                            entry.signature_hash);
+      }
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, m_cache_file_path, ec);
+  if (ec) {
+    spdlog::warn("Failed to write signature cache {}: {}",
+                 m_cache_file_path.string(), ec.message());
+    return;
+  }
+  m_dirty = false;
+}
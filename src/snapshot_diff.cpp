@@ -0,0 +1,402 @@
+#include <algorithm>
+#include <bit>
+#include <cpu_features.hpp>
+#include <cstring>
+#include <fmt/format.h>
+#include <snapshot_diff.hpp>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define XTOOL_DIFF_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define XTOOL_DIFF_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+constexpr std::uint32_t BLOCK_SIZE = 64;
+
+// bit i set when a[i] != b[i], 64 bytes
+using NeqMaskFunction = std::uint64_t (*)(char const *, char const *);
+
+std::uint64_t neq_mask_tail(char const *a, char const *b,
+                            std::uint32_t const size) {
+  std::uint64_t mask = 0;
+  for (std::uint32_t i = 0; i < size; ++i) {
+    mask |= static_cast<std::uint64_t>(a[i] != b[i]) << i;
+  }
+  return mask;
+}
+
+std::uint64_t neq_mask64_scalar(char const *a, char const *b) {
+  constexpr std::uint64_t low7 = 0x7f7f7f7f7f7f7f7full;
+  std::uint64_t mask = 0;
+  for (std::uint32_t i = 0; i < BLOCK_SIZE / 8; ++i) {
+    std::uint64_t wa = 0;
+    std::uint64_t wb = 0;
+    std::memcpy(&wa, a + 8 * i, 8);
+    std::memcpy(&wb, b + 8 * i, 8);
+    auto const x = wa ^ wb;
+    // high bit of every non zero byte
+    auto const nonzero = (((x & low7) + low7) | x) & ~low7;
+    // gather the 8 high bits, byte j -> bit j on little endian hosts
+    auto byte_mask = (nonzero >> 7) * 0x0102040810204080ull >> 56;
+    if constexpr (std::endian::native == std::endian::big) {
+      byte_mask = neq_mask_tail(a + 8 * i, b + 8 * i, 8);
+    }
+    mask |= byte_mask << (8 * i);
+  }
+  return mask;
+}
+
+#ifdef XTOOL_DIFF_X86
+std::uint64_t neq_mask64_sse2(char const *a, char const *b) {
+  std::uint64_t eq = 0;
+  for (std::uint32_t i = 0; i < BLOCK_SIZE / 16; ++i) {
+    auto const va =
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(a + 16 * i));
+    auto const vb =
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(b + 16 * i));
+    auto const bits = static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)));
+    eq |= static_cast<std::uint64_t>(bits) << (16 * i);
+  }
+  return ~eq;
+}
+
+XTOOL_TARGET_AVX2 std::uint64_t neq_mask64_avx2(char const *a,
+                                                char const *b) {
+  auto const a0 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(a));
+  auto const b0 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(b));
+  auto const a1 =
+      _mm256_loadu_si256(reinterpret_cast<__m256i const *>(a + 32));
+  auto const b1 =
+      _mm256_loadu_si256(reinterpret_cast<__m256i const *>(b + 32));
+  auto const low = static_cast<std::uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(a0, b0)));
+  auto const high = static_cast<std::uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(a1, b1)));
+  return ~(static_cast<std::uint64_t>(high) << 32 | low);
+}
+#endif
+
+#ifdef XTOOL_DIFF_NEON
+std::uint64_t neq_mask64_neon(char const *a, char const *b) {
+  // weight every lane by its bit, then add the 8 lanes of each half
+  static constexpr std::uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                               1, 2, 4, 8, 16, 32, 64, 128};
+  auto const w = vld1q_u8(weights);
+  auto const *pa = reinterpret_cast<std::uint8_t const *>(a);
+  auto const *pb = reinterpret_cast<std::uint8_t const *>(b);
+  std::uint64_t mask = 0;
+  for (std::uint32_t i = 0; i < BLOCK_SIZE / 16; ++i) {
+    auto const va = vld1q_u8(pa + 16 * i);
+    auto const vb = vld1q_u8(pb + 16 * i);
+    auto const neq = vandq_u8(vmvnq_u8(vceqq_u8(va, vb)), w);
+    auto const low = static_cast<std::uint64_t>(vaddv_u8(vget_low_u8(neq)));
+    auto const high = static_cast<std::uint64_t>(vaddv_u8(vget_high_u8(neq)));
+    mask |= (low | high << 8) << (16 * i);
+  }
+  return mask;
+}
+#endif
+
+NeqMaskFunction neq_mask_function(DiffBackend const backend) {
+  switch (backend) {
+#ifdef XTOOL_DIFF_X86
+  case DiffBackend::sse2:
+    return neq_mask64_sse2;
+  case DiffBackend::avx2:
+    return neq_mask64_avx2;
+#endif
+#ifdef XTOOL_DIFF_NEON
+  case DiffBackend::neon:
+    return neq_mask64_neon;
+#endif
+  default:
+    return neq_mask64_scalar;
+  }
+}
+
+// bit i set when byte i starts an element
+constexpr std::uint64_t element_starts(std::uint32_t const width) {
+  switch (width) {
+  case 2:
+    return 0x5555555555555555ull;
+  case 4:
+    return 0x1111111111111111ull;
+  default:
+    return ~std::uint64_t{0};
+  }
+}
+
+// byte mask -> bit at the start of every element with a set byte
+std::uint64_t fold_to_elements(std::uint64_t mask, std::uint32_t const width) {
+  if (width >= 2) {
+    mask |= mask >> 1;
+  }
+  if (width >= 4) {
+    mask |= mask >> 2;
+  }
+  return mask & element_starts(width);
+}
+
+// element start bits -> every byte of the elements
+std::uint64_t expand_elements(std::uint64_t const starts,
+                              std::uint32_t const width) {
+  // starts are width bits apart, the products don't overlap
+  return starts * ((std::uint64_t{1} << width) - 1);
+}
+
+// element start bits -> one bit per element, e.g. bits 0, 2, 4 -> 0, 1, 2
+std::uint64_t compress_elements(std::uint64_t mask,
+                                std::uint32_t const width) {
+  if (width == 2) {
+    mask &= 0x5555555555555555ull;
+    mask = (mask | mask >> 1) & 0x3333333333333333ull;
+    mask = (mask | mask >> 2) & 0x0f0f0f0f0f0f0f0full;
+    mask = (mask | mask >> 4) & 0x00ff00ff00ff00ffull;
+    mask = (mask | mask >> 8) & 0x0000ffff0000ffffull;
+    mask = (mask | mask >> 16) & 0x00000000ffffffffull;
+  } else if (width == 4) {
+    mask &= 0x1111111111111111ull;
+    mask = (mask | mask >> 3) & 0x0303030303030303ull;
+    mask = (mask | mask >> 6) & 0x000f000f000f000full;
+    mask = (mask | mask >> 12) & 0x000000ff000000ffull;
+    mask = (mask | mask >> 24) & 0x000000000000ffffull;
+  }
+  return mask;
+}
+
+std::uint32_t read_be(char const *p, std::uint32_t const width) {
+  std::uint32_t value = 0;
+  for (std::uint32_t i = 0; i < width; ++i) {
+    value = (value << 8) | static_cast<std::uint8_t>(p[i]);
+  }
+  return value;
+}
+
+class RangeBuilder {
+public:
+  explicit RangeBuilder(DiffRanges &ranges) : m_ranges(ranges) {}
+
+  // a new candidate starts, never merge over its boundary
+  void begin_candidate() { m_can_merge = false; }
+
+  void add(std::uint32_t const offset, std::uint32_t const size) {
+    if (m_can_merge && !m_ranges.empty() &&
+        m_ranges.back().offset + m_ranges.back().size == offset) {
+      m_ranges.back().size += size;
+    } else {
+      m_ranges.push_back({offset, size});
+    }
+    m_can_merge = true;
+  }
+
+  void add_mask(std::uint32_t const offset, std::uint64_t mask) {
+    if (mask == ~std::uint64_t{0}) {
+      this->add(offset, BLOCK_SIZE);
+      return;
+    }
+    while (mask != 0) {
+      auto const begin = static_cast<std::uint32_t>(std::countr_zero(mask));
+      auto const size =
+          static_cast<std::uint32_t>(std::countr_one(mask >> begin));
+      this->add(offset + begin, size);
+      if (begin + size == BLOCK_SIZE) {
+        break;
+      }
+      mask &= ~std::uint64_t{0} << (begin + size);
+    }
+  }
+
+private:
+  DiffRanges &m_ranges;
+  bool m_can_merge = false;
+};
+
+void validate_width(std::uint32_t const width) {
+  if (width != 1 && width != 2 && width != 4) {
+    throw std::invalid_argument(
+        fmt::format("Diff width must be 1, 2 or 4, got {}.", width));
+  }
+}
+} // namespace
+
+std::optional<DiffPredicate> parse_diff_predicate(std::string_view const name) {
+  for (auto const p : {DiffPredicate::changed, DiffPredicate::unchanged,
+                       DiffPredicate::increased, DiffPredicate::decreased}) {
+    if (name == diff_predicate_name(p)) {
+      return p;
+    }
+  }
+  return std::nullopt;
+}
+
+std::string_view diff_predicate_name(DiffPredicate const p) {
+  switch (p) {
+  case DiffPredicate::changed:
+    return "changed";
+  case DiffPredicate::unchanged:
+    return "unchanged";
+  case DiffPredicate::increased:
+    return "increased";
+  case DiffPredicate::decreased:
+    return "decreased";
+  }
+  return "unknown";
+}
+
+std::string_view diff_backend_name(DiffBackend const backend) {
+  switch (backend) {
+  case DiffBackend::scalar:
+    return "scalar";
+  case DiffBackend::sse2:
+    return "sse2";
+  case DiffBackend::avx2:
+    return "avx2";
+  case DiffBackend::neon:
+    return "neon";
+  }
+  return "unknown";
+}
+
+bool is_diff_backend_supported(DiffBackend const backend) {
+  switch (backend) {
+  case DiffBackend::scalar:
+    return true;
+#ifdef XTOOL_DIFF_X86
+  case DiffBackend::sse2:
+    return true;
+  case DiffBackend::avx2:
+    return cpu_has_avx2();
+#endif
+#ifdef XTOOL_DIFF_NEON
+  case DiffBackend::neon:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+DiffBackend best_diff_backend() {
+  static DiffBackend const best = []() {
+    for (auto const backend :
+         {DiffBackend::avx2, DiffBackend::neon, DiffBackend::sse2}) {
+      if (is_diff_backend_supported(backend)) {
+        return backend;
+      }
+    }
+    return DiffBackend::scalar;
+  }();
+  return best;
+}
+
+DiffRanges diff_snapshots(std::span<char const> const before,
+                          std::span<char const> const after,
+                          DiffPredicate const predicate,
+                          std::uint32_t const width,
+                          DiffBackend const backend) {
+  if (before.size() > UINT32_MAX) {
+    throw std::invalid_argument("Snapshots larger than 4 GiB.");
+  }
+  return diff_snapshots(before, after, predicate, width, backend,
+                        {{0, static_cast<std::uint32_t>(before.size())}});
+}
+
+DiffRanges diff_snapshots(std::span<char const> const before,
+                          std::span<char const> const after,
+                          DiffPredicate const predicate,
+                          std::uint32_t const width,
+                          DiffBackend const backend,
+                          DiffRanges const &candidates) {
+  validate_width(width);
+  if (before.size() != after.size()) {
+    throw std::invalid_argument(
+        fmt::format("Snapshot sizes differ, {} and {} bytes.", before.size(),
+                    after.size()));
+  }
+  if (!is_diff_backend_supported(backend)) {
+    throw std::invalid_argument(fmt::format(
+        "Diff backend {} is not supported by this CPU.",
+        diff_backend_name(backend)));
+  }
+  auto const neq_mask64 = neq_mask_function(backend);
+
+  DiffRanges ranges;
+  RangeBuilder builder(ranges);
+  for (auto const &candidate : candidates) {
+    if (static_cast<std::size_t>(candidate.offset) + candidate.size >
+        before.size()) {
+      throw std::invalid_argument(fmt::format(
+          "Diff candidate {:#x}+{:#x} is out of the snapshot.",
+          candidate.offset, candidate.size));
+    }
+    // whole elements only
+    auto const begin = (candidate.offset + width - 1) / width * width;
+    auto const end = (candidate.offset + candidate.size) / width * width;
+    builder.begin_candidate();
+
+    for (auto offset = begin; offset < end; offset += BLOCK_SIZE) {
+      auto const size = std::min(BLOCK_SIZE, end - offset);
+      auto const *a = before.data() + offset;
+      auto const *b = after.data() + offset;
+      auto const valid = size == BLOCK_SIZE
+                             ? ~std::uint64_t{0}
+                             : (std::uint64_t{1} << size) - 1;
+      auto const neq = size == BLOCK_SIZE ? neq_mask64(a, b)
+                                          : neq_mask_tail(a, b, size);
+      auto const changed = fold_to_elements(neq, width);
+
+      std::uint64_t selected = 0;
+      switch (predicate) {
+      case DiffPredicate::changed:
+        selected = changed;
+        break;
+      case DiffPredicate::unchanged:
+        selected = ~changed & element_starts(width) & valid;
+        break;
+      case DiffPredicate::increased:
+      case DiffPredicate::decreased:
+        // memory mostly stays the same, only compare the changed elements
+        for (auto bits = changed; bits != 0; bits &= bits - 1) {
+          auto const i = static_cast<std::uint32_t>(std::countr_zero(bits));
+          auto const x = read_be(a + i, width);
+          auto const y = read_be(b + i, width);
+          if (predicate == DiffPredicate::increased ? y > x : y < x) {
+            selected |= std::uint64_t{1} << i;
+          }
+        }
+        break;
+      }
+      builder.add_mask(offset, expand_elements(selected, width));
+    }
+  }
+  return ranges;
+}
+
+std::uint64_t diff_elements64(char const *a, char const *b,
+                              std::uint32_t const width,
+                              DiffBackend const backend) {
+  auto const neq_mask64 = neq_mask_function(backend);
+  auto const elements_per_block = BLOCK_SIZE / width;
+  std::uint64_t mask = 0;
+  for (std::uint32_t i = 0; i < width; ++i) {
+    auto const neq = neq_mask64(a + i * BLOCK_SIZE, b + i * BLOCK_SIZE);
+    mask |= compress_elements(fold_to_elements(neq, width), width)
+            << (i * elements_per_block);
+  }
+  return mask;
+}
+
+std::size_t diff_ranges_bytes(DiffRanges const &ranges) {
+  std::size_t bytes = 0;
+  for (auto const &r : ranges) {
+    bytes += r.size;
+  }
+  return bytes;
+}
@@ -1,16 +1,21 @@
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <constants.hpp>
 #include <cstdint>
 #include <dolphin_manager.hpp>
+#include <map>
 #include <playlist.hpp>
 #include <spdlog/spdlog.h>
 #include <test_seed.hpp>
 #include <thread>
 
 void test_seed(std::uint32_t const dist_l, std::uint32_t const dist_r,
-               std::uint32_t const try_count) {
+               std::uint32_t const try_count,
+               SeedSelectorVersion const selector_version) {
   DolphinManager dm;
-  spdlog::info("start test_seed");
+  spdlog::info("start test_seed, selector {}",
+               seed_selector_version_name(selector_version));
 
   std::map<std::size_t, std::uint32_t> occurences;
 
@@ -31,7 +36,7 @@ void test_seed(std::uint32_t const dist_l, std::uint32_t const dist_r,
       continue;
     }
     prev_seed = seed;
-    auto const rand = seed_rand(dist_l, dist_r, seed);
+    auto const rand = seed_rand(dist_l, dist_r, seed, selector_version);
     spdlog::info("rand={}, remain={}", rand, count);
     if (auto [ignore_, inserted] = occurences.insert(std::make_pair(rand, 1));
         !inserted) {
@@ -48,4 +53,114 @@ void test_seed(std::uint32_t const dist_l, std::uint32_t const dist_r,
   }
   spdlog::info("Total {} unique rand", occurences.size());
   spdlog::info("test_seed end");
-}
\ No newline at end of file
+}
+
+namespace {
+constexpr std::uint64_t SEED_SPACE_SIZE = std::uint64_t{1} << 32;
+
+// k-th seed of the sample: one seed from each of `samples` equal strata of
+// the seed space, jittered inside the stratum.
+std::uint32_t sample_seed(std::uint64_t const k, std::uint64_t const samples,
+                          bool const full) {
+  if (full) {
+    return static_cast<std::uint32_t>(k);
+  }
+  auto const stride = SEED_SPACE_SIZE / samples;
+  auto const jitter = stride > 1 ? SeedSequenceV2::mix64(k) % stride : 0;
+  return static_cast<std::uint32_t>(k * stride + jitter);
+}
+} // namespace
+
+void analyze_seed_distribution(std::optional<std::string> const &config_path,
+                               std::vector<std::size_t> const &extra_sizes,
+                               bool const full, std::uint64_t const samples,
+                               std::size_t const print_bucket_limit,
+                               SeedSelectorVersion const selector_version) {
+  std::vector<std::size_t> sizes = extra_sizes;
+  if (config_path.has_value()) {
+    // file checks are not needed to know playlist sizes
+    Playlist pl(config_path.value(), PlaylistValidation::lazy);
+    for (auto const &pe : pl.playlist_entries()) {
+      sizes.push_back(pe->music_entries.size());
+    }
+  }
+  std::erase_if(sizes, [](auto const size) { return size < 2; });
+  std::sort(sizes.begin(), sizes.end());
+  sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+  if (sizes.empty()) {
+    throw std::invalid_argument("No playlist size(>= 2) to analyze.");
+  }
+
+  auto const seed_count =
+      full ? SEED_SPACE_SIZE
+           : std::clamp<std::uint64_t>(samples, 1, SEED_SPACE_SIZE);
+  auto const thread_count = std::max(1u, std::thread::hardware_concurrency());
+  spdlog::info("Analyze selector {}, {} seeds({}), {} sizes, {} threads.",
+               seed_selector_version_name(selector_version), seed_count,
+               full ? "full" : "stratified", sizes.size(), thread_count);
+
+  auto const begin = std::chrono::steady_clock::now();
+
+  // counts[thread][size index][bucket], merged after join
+  std::vector<std::vector<std::vector<std::uint64_t>>> counts(thread_count);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&, t]() {
+      auto &local = counts[t];
+      for (auto const size : sizes) {
+        local.emplace_back(size, 0);
+      }
+      auto const first = seed_count * t / thread_count;
+      auto const last = seed_count * (t + 1) / thread_count;
+      for (auto k = first; k < last; ++k) {
+        auto const seed = sample_seed(k, seed_count, full);
+        for (std::size_t i = 0; i < sizes.size(); ++i) {
+          ++local[i][seed_rand(0, sizes[i] - 1, seed, selector_version)];
+        }
+      }
+    });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+
+  auto const end = std::chrono::steady_clock::now();
+  auto const elapsed =
+      std::chrono::duration_cast<std::chrono::milliseconds>(end - begin);
+  spdlog::info("Evaluated in {} ms.", elapsed.count());
+
+  for (std::size_t i = 0; i < sizes.size(); ++i) {
+    auto const size = sizes[i];
+    std::vector<std::uint64_t> buckets(size, 0);
+    for (auto const &local : counts) {
+      for (std::size_t b = 0; b < size; ++b) {
+        buckets[b] += local[i][b];
+      }
+    }
+
+    auto const expected =
+        static_cast<double>(seed_count) / static_cast<double>(size);
+    double chi_square = 0.0;
+    double worst_bias = 0.0;
+    for (auto const count : buckets) {
+      auto const diff = static_cast<double>(count) - expected;
+      chi_square += diff * diff / expected;
+      worst_bias = std::max(worst_bias, std::abs(diff) / expected);
+    }
+    // chi-square with k degrees of freedom ~ N(k, 2k) for large k
+    auto const dof = static_cast<double>(size - 1);
+    auto const z = (chi_square - dof) / std::sqrt(2.0 * dof);
+    auto const [min_it, max_it] =
+        std::minmax_element(buckets.begin(), buckets.end());
+
+    spdlog::info("size={}, chi-square={:.3f}(dof={}, z={:.3f}), worst-case "
+                 "bias={:.6f}%, min bucket={}, max bucket={}",
+                 size, chi_square, size - 1, z, worst_bias * 100.0, *min_it,
+                 *max_it);
+    if (size <= print_bucket_limit) {
+      for (std::size_t b = 0; b < size; ++b) {
+        spdlog::info("\tvalue={}, count={}", b, buckets[b]);
+      }
+    }
+  }
+}
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <fmt/format.h>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string_view>
+#include <trace_events.hpp>
+#include <vector>
+
+namespace xtool::trace {
+namespace {
+// A seqlock: sequence is 0 while a writer changes the fields, write_json
+// copies a slot and keeps the copy if sequence was the same before and
+// after. Fields are relaxed atomics so the copy is not a data race.
+struct Slot {
+  // index + 1 of the event written last, 0 = never written or being written
+  std::atomic_uint64_t sequence = 0;
+  std::atomic<char const *> name = nullptr;
+  std::atomic_int64_t ts_ns = 0;
+  std::atomic_int64_t dur_ns = 0;
+  std::atomic<double> value = 0.0;
+  std::atomic_uint32_t tid = 0;
+  std::atomic_char phase = 'X';
+};
+
+// consistent copy of a Slot
+struct Event {
+  std::uint64_t sequence = 0;
+  char const *name = nullptr;
+  std::int64_t ts_ns = 0;
+  std::int64_t dur_ns = 0;
+  double value = 0.0;
+  std::uint32_t tid = 0;
+  char phase = 'X';
+};
+
+constexpr std::size_t MAX_NAMED_THREADS = 64;
+
+std::unique_ptr<Slot[]> SLOTS;
+std::size_t SLOT_MASK = 0;
+std::atomic_uint64_t HEAD = 0;
+std::atomic_uint32_t NEXT_TID = 1;
+std::array<std::atomic<char const *>, MAX_NAMED_THREADS> THREAD_NAMES{};
+std::int64_t ORIGIN_NS = 0;
+
+std::uint32_t current_tid() noexcept {
+  thread_local std::uint32_t const tid = NEXT_TID.fetch_add(1);
+  return tid;
+}
+
+void record(char const *name, char const phase, std::int64_t const ts_ns,
+            std::int64_t const dur_ns, double const value) noexcept {
+  auto const index = HEAD.fetch_add(1, std::memory_order_relaxed);
+  auto &slot = SLOTS[index & SLOT_MASK];
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.ts_ns.store(ts_ns, std::memory_order_relaxed);
+  slot.dur_ns.store(dur_ns, std::memory_order_relaxed);
+  slot.value.store(value, std::memory_order_relaxed);
+  slot.tid.store(current_tid(), std::memory_order_relaxed);
+  slot.phase.store(phase, std::memory_order_relaxed);
+  slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+// nullopt for a slot never written or written during the copy
+std::optional<Event> read_slot(Slot const &slot) noexcept {
+  auto const sequence = slot.sequence.load(std::memory_order_acquire);
+  if (sequence == 0) {
+    return std::nullopt;
+  }
+  Event const event{sequence,
+                    slot.name.load(std::memory_order_relaxed),
+                    slot.ts_ns.load(std::memory_order_relaxed),
+                    slot.dur_ns.load(std::memory_order_relaxed),
+                    slot.value.load(std::memory_order_relaxed),
+                    slot.tid.load(std::memory_order_relaxed),
+                    slot.phase.load(std::memory_order_relaxed)};
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+    return std::nullopt;
+  }
+  return event;
+}
+
+void write_escaped(std::ostream &os, std::string_view const s) {
+  for (auto const c : s) {
+    if (c == '"' || c == '\\') {
+      os.put('\\');
+    }
+    os.put(c);
+  }
+}
+} // namespace
+
+void enable(std::size_t const capacity) {
+  if (is_enabled()) {
+    return;
+  }
+  auto const size = std::bit_ceil(std::max<std::size_t>(capacity, 1024));
+  SLOTS = std::make_unique<Slot[]>(size);
+  SLOT_MASK = size - 1;
+  ORIGIN_NS = steady_now_ns();
+  detail::enabled.store(true);
+}
+
+void record_complete(char const *name, std::int64_t const begin_ns,
+                     std::int64_t const end_ns) noexcept {
+  if (!is_enabled()) {
+    return;
+  }
+  record(name, 'X', begin_ns, end_ns - begin_ns, 0.0);
+}
+
+void record_counter(char const *name, double const value) noexcept {
+  if (!is_enabled()) {
+    return;
+  }
+  record(name, 'C', steady_now_ns(), 0, value);
+}
+
+void set_thread_name(char const *name) noexcept {
+  auto const tid = current_tid();
+  if (tid < MAX_NAMED_THREADS) {
+    THREAD_NAMES[tid].store(name, std::memory_order_relaxed);
+  }
+}
+
+void write_json(std::filesystem::path const &path) {
+  if (!is_enabled()) {
+    return;
+  }
+  std::vector<Event> events;
+  events.reserve(SLOT_MASK + 1);
+  for (std::size_t i = 0; i <= SLOT_MASK; ++i) {
+    if (auto const event = read_slot(SLOTS[i])) {
+      events.push_back(*event);
+    }
+  }
+  std::sort(events.begin(), events.end(), [](auto const &a, auto const &b) {
+    return a.sequence < b.sequence;
+  });
+
+  std::ofstream file(path);
+  if (!file) {
+    throw std::runtime_error(
+        fmt::format("Failed to open {} for writing.", path.string()));
+  }
+  auto const us = [](std::int64_t const ns) {
+    return static_cast<double>(ns) / 1000.0;
+  };
+
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  file << R"({"name":"process_name","ph":"M","pid":1,"tid":0,)"
+       << R"("args":{"name":"xtool"}})";
+  for (std::size_t tid = 0; tid < THREAD_NAMES.size(); ++tid) {
+    if (auto const *name = THREAD_NAMES[tid].load()) {
+      file << fmt::format(
+          ",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},"
+          "\"args\":{{\"name\":\"",
+          tid);
+      write_escaped(file, name);
+      file << "\"}}";
+    }
+  }
+  for (auto const &e : events) {
+    file << ",\n{\"name\":\"";
+    write_escaped(file, e.name);
+    if (e.phase == 'X') {
+      file << fmt::format(
+          "\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+          e.tid, us(e.ts_ns - ORIGIN_NS), us(e.dur_ns));
+    } else {
+      file << fmt::format("\",\"ph\":\"C\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},"
+                          "\"args\":{{\"value\":{}}}}}",
+                          e.tid, us(e.ts_ns - ORIGIN_NS), e.value);
+    }
+  }
+  file << "\n]}\n";
+
+  auto const recorded = HEAD.load();
+  spdlog::info("Wrote {} trace events to {}({} overwritten).", events.size(),
+               path.string(), recorded - events.size());
+}
+} // namespace xtool::trace
@@ -0,0 +1,610 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <dme/Common/MemoryCommon.h>
+#include <fmt/format.h>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <value_scanner.hpp>
+
+namespace {
+using Chunk = CandidateSet::Chunk;
+using Kind = CandidateSet::Chunk::Kind;
+
+struct ScanContext;
+// bit i set when position first + i matches, n <= 64
+using OrderedBlockFunction = std::uint64_t (*)(ScanContext const &,
+                                               std::uint32_t const,
+                                               std::uint32_t const);
+
+struct ScanContext {
+  char const *ram = nullptr;
+  // ram at the previous scan, null on the first scan
+  char const *previous = nullptr;
+  std::uint32_t stride = 1;
+  std::uint32_t size = 1;
+  ScanFilter filter = ScanFilter::unknown;
+  DiffBackend backend = DiffBackend::scalar;
+  // 64 elements are contiguous 1, 2 or 4 byte values, compared with SIMD
+  bool simd = false;
+  // exact value in console byte order, repeated 64 times for the SIMD path
+  std::vector<char> pattern;
+  // range bounds in host byte order
+  std::array<char, 8> low{};
+  std::array<char, 8> high{};
+  OrderedBlockFunction ordered = nullptr;
+};
+
+constexpr std::uint64_t low_bits(std::uint32_t const n) {
+  return n >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+}
+
+template <typename T> T load_host(char const *p) {
+  T value;
+  std::memcpy(&value, p, sizeof(T));
+  return value;
+}
+
+// big endian console value
+template <typename T> T load_console(char const *p) {
+  using U = std::conditional_t<
+      sizeof(T) == 1, std::uint8_t,
+      std::conditional_t<sizeof(T) == 2, std::uint16_t,
+                         std::conditional_t<sizeof(T) == 4, std::uint32_t,
+                                            std::uint64_t>>>;
+  U raw;
+  std::memcpy(&raw, p, sizeof(U));
+  if constexpr (std::endian::native == std::endian::little && sizeof(U) > 1) {
+    raw = std::byteswap(raw);
+  }
+  return std::bit_cast<T>(raw);
+}
+
+// Results go to one flag byte per position first so the loops stay simple
+// enough for the compiler to vectorize, then are packed with a SIMD compare.
+template <typename T>
+std::uint64_t ordered_block(ScanContext const &c, std::uint32_t const first,
+                            std::uint32_t const n) {
+  alignas(64) static constexpr std::array<char, 64> zeros{};
+  alignas(64) std::array<char, 64> flags{};
+  auto const *cur = c.ram + static_cast<std::size_t>(first) * c.stride;
+  switch (c.filter) {
+  case ScanFilter::range: {
+    auto const low = load_host<T>(c.low.data());
+    auto const high = load_host<T>(c.high.data());
+    for (std::uint32_t i = 0; i < n; ++i) {
+      auto const v = load_console<T>(cur + i * c.stride);
+      flags[i] = low <= v && v <= high;
+    }
+    break;
+  }
+  case ScanFilter::increased:
+  case ScanFilter::decreased: {
+    auto const *prev = c.previous + static_cast<std::size_t>(first) * c.stride;
+    auto const increased = c.filter == ScanFilter::increased;
+    for (std::uint32_t i = 0; i < n; ++i) {
+      auto const v = load_console<T>(cur + i * c.stride);
+      auto const p = load_console<T>(prev + i * c.stride);
+      flags[i] = increased ? v > p : v < p;
+    }
+    break;
+  }
+  default:
+    break;
+  }
+  return diff_elements64(flags.data(), zeros.data(), 1, c.backend);
+}
+
+OrderedBlockFunction ordered_block_function(Common::MemType const type,
+                                            bool const is_unsigned) {
+  switch (type) {
+  case Common::MemType::type_byte:
+    return is_unsigned ? ordered_block<std::uint8_t>
+                       : ordered_block<std::int8_t>;
+  case Common::MemType::type_halfword:
+    return is_unsigned ? ordered_block<std::uint16_t>
+                       : ordered_block<std::int16_t>;
+  case Common::MemType::type_word:
+    return is_unsigned ? ordered_block<std::uint32_t>
+                       : ordered_block<std::int32_t>;
+  case Common::MemType::type_float:
+    return ordered_block<float>;
+  case Common::MemType::type_double:
+    return ordered_block<double>;
+  default:
+    return nullptr;
+  }
+}
+
+std::uint64_t evaluate(ScanContext const &c, std::uint32_t const first,
+                       std::uint32_t const n) {
+  auto const *cur = c.ram + static_cast<std::size_t>(first) * c.stride;
+  switch (c.filter) {
+  case ScanFilter::unknown:
+    return low_bits(n);
+  case ScanFilter::exact:
+  case ScanFilter::changed:
+  case ScanFilter::unchanged: {
+    auto const exact = c.filter == ScanFilter::exact;
+    auto const *other =
+        exact ? c.pattern.data()
+              : c.previous + static_cast<std::size_t>(first) * c.stride;
+    if (c.simd && n == 64) {
+      auto const neq = diff_elements64(cur, other, c.size, c.backend);
+      return c.filter == ScanFilter::changed ? neq : ~neq;
+    }
+    std::uint64_t mask = 0;
+    for (std::uint32_t i = 0; i < n; ++i) {
+      auto const *b = exact ? other : other + i * c.stride;
+      auto const equal = std::memcmp(cur + i * c.stride, b, c.size) == 0;
+      mask |= static_cast<std::uint64_t>(
+                  c.filter == ScanFilter::changed ? !equal : equal)
+              << i;
+    }
+    return mask;
+  }
+  case ScanFilter::range:
+  case ScanFilter::increased:
+  case ScanFilter::decreased:
+    return c.ordered(c, first, n);
+  }
+  return 0;
+}
+
+Chunk scan_chunk(Chunk const &in, std::uint32_t const begin,
+                 std::uint32_t const size, ScanContext const &c) {
+  switch (in.kind) {
+  case Kind::empty:
+    return {};
+  case Kind::array: {
+    // few survivors, check them one by one
+    Chunk out;
+    for (auto const p : in.array) {
+      if (evaluate(c, begin + p, 1) & 1) {
+        out.array.push_back(p);
+      }
+    }
+    out.count = static_cast<std::uint32_t>(out.array.size());
+    out.kind = out.count == 0 ? Kind::empty : Kind::array;
+    return out;
+  }
+  case Kind::full:
+  case Kind::bitmap:
+    break;
+  }
+
+  std::vector<std::uint64_t> words(CandidateSet::CHUNK_WORDS, 0);
+  auto const word_count = (size + 63) / 64;
+  for (std::uint32_t w = 0; w < word_count; ++w) {
+    auto const n = std::min<std::uint32_t>(64, size - w * 64);
+    if (in.kind == Kind::full) {
+      words[w] = evaluate(c, begin + w * 64, n);
+    } else if (in.bitmap[w] != 0) {
+      words[w] = evaluate(c, begin + w * 64, n) & in.bitmap[w];
+    }
+  }
+  return Chunk::from_bitmap(std::move(words), size);
+}
+
+// Runs f(i) for i in [0, count) on up to threads threads.
+template <typename F>
+unsigned parallel_for(std::size_t const count, unsigned threads, F &&f) {
+  threads = static_cast<unsigned>(
+      std::clamp<std::size_t>(count, 1, std::max(threads, 1u)));
+  std::atomic_size_t next = 0;
+  auto const worker = [&]() {
+    for (auto i = next++; i < count; i = next++) {
+      f(i);
+    }
+  };
+  {
+    std::vector<std::jthread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+      workers.emplace_back(worker);
+    }
+    worker();
+  }
+  return threads;
+}
+
+std::uint32_t alignment_for(ScanOptions const &options) {
+  return options.aligned ? static_cast<std::uint32_t>(
+                               Common::getNbrBytesAlignementForType(
+                                   options.type))
+                         : 1;
+}
+
+bool is_numeric(Common::MemType const type) {
+  return type != Common::MemType::type_string &&
+         type != Common::MemType::type_byteArray;
+}
+
+// value in host byte order for numbers, raw bytes otherwise
+std::vector<char> parse_scan_value(ScanOptions const &options,
+                                   std::size_t const size,
+                                   std::string_view const value) {
+  if (options.type == Common::MemType::type_string) {
+    if (value.size() != size) {
+      throw std::invalid_argument(fmt::format(
+          "String value must be {} characters, got {}.", size, value.size()));
+    }
+    return {value.begin(), value.end()};
+  }
+
+  auto code = Common::MemOperationReturnCode::OK;
+  std::size_t actual_length = 0;
+  std::unique_ptr<char[]> const buffer(Common::formatStringToMemory(
+      code, actual_length, std::string(value), options.base, options.type,
+      size));
+  if (code != Common::MemOperationReturnCode::OK || buffer == nullptr) {
+    throw std::invalid_argument(
+        fmt::format("Invalid scan value \"{}\".", value));
+  }
+  if (actual_length != size) {
+    throw std::invalid_argument(fmt::format(
+        "Scan value \"{}\" is {} bytes, expected {}.", value, actual_length,
+        size));
+  }
+  return {buffer.get(), buffer.get() + size};
+}
+} // namespace
+
+std::optional<ScanFilter> parse_scan_filter(std::string_view const name) {
+  for (auto const filter :
+       {ScanFilter::unknown, ScanFilter::exact, ScanFilter::range,
+        ScanFilter::changed, ScanFilter::unchanged, ScanFilter::increased,
+        ScanFilter::decreased}) {
+    if (name == scan_filter_name(filter)) {
+      return filter;
+    }
+  }
+  return std::nullopt;
+}
+
+std::string_view scan_filter_name(ScanFilter const filter) {
+  switch (filter) {
+  case ScanFilter::unknown:
+    return "unknown";
+  case ScanFilter::exact:
+    return "exact";
+  case ScanFilter::range:
+    return "range";
+  case ScanFilter::changed:
+    return "changed";
+  case ScanFilter::unchanged:
+    return "unchanged";
+  case ScanFilter::increased:
+    return "increased";
+  case ScanFilter::decreased:
+    return "decreased";
+  }
+  return "unknown";
+}
+
+std::optional<Common::MemType> parse_mem_type(std::string_view const name) {
+  if (name == "byte") {
+    return Common::MemType::type_byte;
+  }
+  if (name == "halfword") {
+    return Common::MemType::type_halfword;
+  }
+  if (name == "word") {
+    return Common::MemType::type_word;
+  }
+  if (name == "float") {
+    return Common::MemType::type_float;
+  }
+  if (name == "double") {
+    return Common::MemType::type_double;
+  }
+  if (name == "string") {
+    return Common::MemType::type_string;
+  }
+  if (name == "bytearray") {
+    return Common::MemType::type_byteArray;
+  }
+  return std::nullopt;
+}
+
+CandidateSet::Chunk
+CandidateSet::Chunk::from_bitmap(std::vector<std::uint64_t> bitmap,
+                                 std::uint32_t const size) {
+  Chunk chunk;
+  for (auto const word : bitmap) {
+    chunk.count += static_cast<std::uint32_t>(std::popcount(word));
+  }
+  if (chunk.count == 0) {
+    return chunk;
+  }
+  if (chunk.count == size) {
+    chunk.kind = Kind::full;
+  } else if (chunk.count <= ARRAY_MAX) {
+    chunk.kind = Kind::array;
+    chunk.array.reserve(chunk.count);
+    for (std::uint32_t w = 0; w < bitmap.size(); ++w) {
+      for (auto bits = bitmap[w]; bits != 0; bits &= bits - 1) {
+        chunk.array.push_back(
+            static_cast<std::uint16_t>(w * 64 + std::countr_zero(bits)));
+      }
+    }
+  } else {
+    chunk.kind = Kind::bitmap;
+    chunk.bitmap = std::move(bitmap);
+  }
+  return chunk;
+}
+
+CandidateSet CandidateSet::all(std::uint32_t const positions) {
+  CandidateSet set;
+  set.m_positions = positions;
+  set.m_chunks.resize((static_cast<std::size_t>(positions) +
+                       CHUNK_POSITIONS - 1) /
+                      CHUNK_POSITIONS);
+  for (std::size_t i = 0; i < set.m_chunks.size(); ++i) {
+    set.m_chunks[i].kind = Kind::full;
+    set.m_chunks[i].count = set.chunk_size(i);
+  }
+  return set;
+}
+
+std::uint32_t CandidateSet::positions() const noexcept { return m_positions; }
+
+std::size_t CandidateSet::count() const noexcept {
+  std::size_t count = 0;
+  for (auto const &chunk : m_chunks) {
+    count += chunk.count;
+  }
+  return count;
+}
+
+std::size_t CandidateSet::memory_bytes() const noexcept {
+  auto bytes = m_chunks.capacity() * sizeof(Chunk);
+  for (auto const &chunk : m_chunks) {
+    bytes += chunk.array.capacity() * sizeof(std::uint16_t) +
+             chunk.bitmap.capacity() * sizeof(std::uint64_t);
+  }
+  return bytes;
+}
+
+bool CandidateSet::contains(std::uint32_t const position) const {
+  if (position >= m_positions) {
+    return false;
+  }
+  auto const &chunk = m_chunks[position / CHUNK_POSITIONS];
+  auto const offset = position % CHUNK_POSITIONS;
+  switch (chunk.kind) {
+  case Kind::empty:
+    return false;
+  case Kind::full:
+    return true;
+  case Kind::array:
+    return std::binary_search(chunk.array.begin(), chunk.array.end(),
+                              static_cast<std::uint16_t>(offset));
+  case Kind::bitmap:
+    return (chunk.bitmap[offset / 64] >> (offset % 64)) & 1;
+  }
+  return false;
+}
+
+std::vector<std::uint32_t>
+CandidateSet::first(std::size_t const limit) const {
+  std::vector<std::uint32_t> positions;
+  for (std::size_t i = 0; i < m_chunks.size() && positions.size() < limit;
+       ++i) {
+    auto const &chunk = m_chunks[i];
+    auto const begin = static_cast<std::uint32_t>(i * CHUNK_POSITIONS);
+    auto const add = [&](std::uint32_t const offset) {
+      if (positions.size() < limit) {
+        positions.push_back(begin + offset);
+      }
+    };
+    switch (chunk.kind) {
+    case Kind::empty:
+      break;
+    case Kind::full:
+      for (std::uint32_t p = 0; p < chunk_size(i); ++p) {
+        add(p);
+      }
+      break;
+    case Kind::array:
+      for (auto const p : chunk.array) {
+        add(p);
+      }
+      break;
+    case Kind::bitmap:
+      for (std::uint32_t w = 0; w < CHUNK_WORDS; ++w) {
+        for (auto bits = chunk.bitmap[w]; bits != 0; bits &= bits - 1) {
+          add(w * 64 + static_cast<std::uint32_t>(std::countr_zero(bits)));
+        }
+      }
+      break;
+    }
+  }
+  return positions;
+}
+
+std::vector<CandidateSet::Chunk> const &CandidateSet::chunks() const noexcept {
+  return m_chunks;
+}
+
+std::vector<CandidateSet::Chunk> &CandidateSet::chunks() noexcept {
+  return m_chunks;
+}
+
+std::uint32_t CandidateSet::chunk_size(std::size_t const index) const noexcept {
+  auto const begin = index * CHUNK_POSITIONS;
+  return static_cast<std::uint32_t>(
+      std::min<std::size_t>(CHUNK_POSITIONS, m_positions - begin));
+}
+
+ValueScanner::ValueScanner(ScanOptions const &options)
+    : m_options(options),
+      m_size(Common::getSizeForType(options.type, options.length)),
+      m_stride(alignment_for(options)) {
+  if (m_size == 0) {
+    throw std::invalid_argument("Scan value size must not be 0.");
+  }
+  if (!is_diff_backend_supported(m_options.backend)) {
+    throw std::invalid_argument(
+        fmt::format("Scan backend {} is not supported by this CPU.",
+                    diff_backend_name(m_options.backend)));
+  }
+}
+
+ScanStats ValueScanner::scan(std::span<char const> const ram,
+                             ScanFilter const filter,
+                             std::string_view const value,
+                             std::string_view const max_value) {
+  auto const begin_time = std::chrono::steady_clock::now();
+  auto const compares_previous =
+      filter == ScanFilter::changed || filter == ScanFilter::unchanged ||
+      filter == ScanFilter::increased || filter == ScanFilter::decreased;
+  if (compares_previous && !m_scanned) {
+    throw std::invalid_argument(
+        fmt::format("The first scan can not be {}.", scan_filter_name(filter)));
+  }
+  if ((filter == ScanFilter::range || filter == ScanFilter::increased ||
+       filter == ScanFilter::decreased) &&
+      !is_numeric(m_options.type)) {
+    throw std::invalid_argument(
+        fmt::format("{} scans need a numeric type.", scan_filter_name(filter)));
+  }
+  if (ram.size() > UINT32_MAX) {
+    throw std::invalid_argument("RAM larger than 4 GiB.");
+  }
+  if (m_scanned && ram.size() != m_previous_size) {
+    throw std::invalid_argument(
+        "RAM size changed since the previous scan, reset the scan.");
+  }
+
+  ScanContext c;
+  c.ram = ram.data();
+  c.previous = m_scanned ? m_previous.get() : nullptr;
+  c.stride = m_stride;
+  c.size = static_cast<std::uint32_t>(m_size);
+  c.filter = filter;
+  c.backend = m_options.backend;
+  c.simd = c.stride == c.size && (c.size == 1 || c.size == 2 || c.size == 4);
+  c.ordered = ordered_block_function(m_options.type, m_options.is_unsigned);
+
+  if (filter == ScanFilter::exact) {
+    auto bytes = parse_scan_value(m_options, m_size, value);
+    if (Common::shouldBeBSwappedForType(m_options.type)) {
+      std::reverse(bytes.begin(), bytes.end());
+    }
+    for (std::uint32_t i = 0; i < 64; ++i) {
+      c.pattern.insert(c.pattern.end(), bytes.begin(), bytes.end());
+    }
+  } else if (filter == ScanFilter::range) {
+    auto const low = parse_scan_value(m_options, m_size, value);
+    auto const high = parse_scan_value(m_options, m_size, max_value);
+    std::copy(low.begin(), low.end(), c.low.begin());
+    std::copy(high.begin(), high.end(), c.high.begin());
+  }
+
+  if (!m_scanned) {
+    auto const positions =
+        ram.size() < m_size ? 0 : (ram.size() - m_size) / m_stride + 1;
+    m_candidates = CandidateSet::all(static_cast<std::uint32_t>(positions));
+    // not zeroed, only bytes of candidates are ever read
+    if (m_previous_size != ram.size()) {
+      m_previous = std::make_unique_for_overwrite<char[]>(ram.size());
+      m_previous_size = ram.size();
+    }
+  }
+
+  auto &chunks = m_candidates.chunks();
+  auto const threads = m_options.threads != 0
+                           ? m_options.threads
+                           : std::max(1u, std::thread::hardware_concurrency());
+  ScanStats stats;
+  if (filter != ScanFilter::unknown || !m_scanned) {
+    stats.threads = parallel_for(chunks.size(), threads, [&](std::size_t i) {
+      auto const begin =
+          static_cast<std::uint32_t>(i * CandidateSet::CHUNK_POSITIONS);
+      chunks[i] =
+          scan_chunk(chunks[i], begin, m_candidates.chunk_size(i), c);
+    });
+  }
+
+  // Keep the values of the survivors for the next changed / unchanged scan:
+  // whole chunks when dense, one value per candidate when sparse. Each chunk
+  // writes only its own bytes, the values crossing into the next chunk are
+  // finished afterwards.
+  auto const chunk_bytes =
+      static_cast<std::size_t>(CandidateSet::CHUNK_POSITIONS) * m_stride;
+  auto const keep = [&](std::size_t const begin, std::size_t const end) {
+    std::memcpy(m_previous.get() + begin, ram.data() + begin, end - begin);
+  };
+  parallel_for(chunks.size(), threads, [&](std::size_t i) {
+    auto const begin = i * chunk_bytes;
+    auto const end = std::min(ram.size(), begin + chunk_bytes);
+    switch (chunks[i].kind) {
+    case Kind::empty:
+      break;
+    case Kind::array:
+      for (auto const p : chunks[i].array) {
+        auto const index = begin + static_cast<std::size_t>(p) * m_stride;
+        keep(index, std::min(end, index + m_size));
+      }
+      break;
+    case Kind::full:
+    case Kind::bitmap:
+      keep(begin, end);
+      break;
+    }
+  });
+  for (std::size_t i = 0; i + 1 < chunks.size(); ++i) {
+    if (chunks[i].kind != Kind::empty) {
+      auto const end = (i + 1) * chunk_bytes;
+      keep(end, std::min(ram.size(), end + m_size - 1));
+    }
+  }
+
+  m_scanned = true;
+  stats.candidates = m_candidates.count();
+  stats.memory_bytes = m_candidates.memory_bytes();
+  stats.nanoseconds = static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - begin_time)
+          .count());
+  return stats;
+}
+
+void ValueScanner::reset() {
+  m_scanned = false;
+  m_candidates = {};
+}
+
+bool ValueScanner::has_scanned() const noexcept { return m_scanned; }
+
+ScanOptions const &ValueScanner::options() const noexcept { return m_options; }
+
+CandidateSet const &ValueScanner::candidates() const noexcept {
+  return m_candidates;
+}
+
+std::size_t ValueScanner::value_size() const noexcept { return m_size; }
+
+std::vector<std::uint32_t>
+ValueScanner::results(std::size_t const limit) const {
+  auto indices = m_candidates.first(limit);
+  for (auto &index : indices) {
+    index *= m_stride;
+  }
+  return indices;
+}
+
+std::string
+ValueScanner::previous_value(std::uint32_t const cache_index) const {
+  if (cache_index % m_stride != 0 ||
+      !m_candidates.contains(cache_index / m_stride)) {
+    return {};
+  }
+  return Common::formatMemoryToString(m_previous.get() + cache_index,
+                                      m_options.type, m_size, m_options.base,
+                                      m_options.is_unsigned, true);
+}
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include <worker_pool.hpp>
+
+WorkerPool::WorkerPool(unsigned const threads) {
+  auto const count = threads != 0
+                         ? threads
+                         : std::max(1u, std::thread::hardware_concurrency());
+  m_threads.reserve(count);
+  for (unsigned i = 0; i < count; ++i) {
+    m_threads.emplace_back(
+        [this](std::stop_token stop_token) { this->run(stop_token); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  // drop what has not started, e.g. decodes queued right before exit
+  std::deque<Task> dropped;
+  {
+    std::lock_guard lock(m_mutex);
+    dropped.swap(m_tasks);
+  }
+  for (auto &thread : m_threads) {
+    thread.request_stop();
+  }
+}
+
+void WorkerPool::submit(Task task) {
+  {
+    std::lock_guard lock(m_mutex);
+    m_tasks.push_back(std::move(task));
+  }
+  m_cv.notify_one();
+}
+
+unsigned WorkerPool::size() const noexcept {
+  return static_cast<unsigned>(m_threads.size());
+}
+
+std::size_t WorkerPool::queued() const {
+  std::lock_guard lock(m_mutex);
+  return m_tasks.size();
+}
+
+void WorkerPool::run(std::stop_token const stop_token) {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock lock(m_mutex);
+      if (!m_cv.wait(lock, stop_token, [&]() { return !m_tasks.empty(); }) ||
+          stop_token.stop_requested()) {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    try {
+      task();
+    } catch (std::exception const &e) {
+      spdlog::error("Worker task failed: {}", e.what());
+    }
+  }
+}
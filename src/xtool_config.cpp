@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cstdint>
+#include <dme/Common/CommonUtils.h>
+#include <fmt/format.h>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <toml++/toml.hpp>
+#include <xtool_config.hpp>
+
+namespace {
+std::uint32_t to_console_address(std::int64_t const value,
+                                 std::string_view const what) {
+  if (value < 0 || value > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::runtime_error(
+        fmt::format("xtool.{}, invalid address {:#x}.", what, value));
+  }
+  return static_cast<std::uint32_t>(value);
+}
+
+std::int32_t to_offset(std::optional<std::int64_t> const value,
+                       std::int32_t const default_value,
+                       std::string_view const what) {
+  if (!value.has_value()) {
+    return default_value;
+  }
+  if (*value < std::numeric_limits<std::int32_t>::min() ||
+      *value > std::numeric_limits<std::int32_t>::max()) {
+    throw std::runtime_error(
+        fmt::format("xtool.signatures {}, out of range.", what));
+  }
+  return static_cast<std::int32_t>(*value);
+}
+
+ConfiguredGameProfile parse_profile(toml::table const &table) {
+  auto const game_id = table["game_id"].value<std::string>();
+  if (!game_id.has_value() || game_id->size() != 6) {
+    throw std::runtime_error(
+        "xtool.profiles, every profile needs a 6 character game_id.");
+  }
+  ConfiguredGameProfile profile;
+  profile.game_id = *game_id;
+  if (auto const revision = table["revision"].value<std::int64_t>()) {
+    if (*revision < 0 || *revision > 0xff) {
+      throw std::runtime_error(fmt::format(
+          "xtool.profiles {}, invalid revision {}.", *game_id, *revision));
+    }
+    profile.revision = static_cast<std::uint8_t>(*revision);
+  }
+
+  // missing addresses come from the built in profile of the same game
+  auto const builtin = std::find_if(
+      GAME_PROFILES.begin(), GAME_PROFILES.end(),
+      [&](GameProfile const &p) { return p.game_id == *game_id; });
+  if (builtin != GAME_PROFILES.end()) {
+    profile.addresses = builtin->addresses;
+  }
+  auto const ram_offset = [&](char const *name, std::int64_t const address) {
+    auto const is_mem1 =
+        address >= Common::MEM1_START && address < Common::MEM1_END;
+    auto const is_mem2 =
+        address >= Common::MEM2_START && address < Common::MEM2_END;
+    if (!is_mem1 && !is_mem2) {
+      throw std::runtime_error(
+          fmt::format("xtool.profiles {}, {} {:#x} is not in MEM1 or MEM2.",
+                      *game_id, name, address));
+    }
+    return Common::dolphinAddrToOffset(static_cast<std::uint32_t>(address),
+                                       false);
+  };
+  for (auto const name : {"current_music_id", "g_mtrand_seed"}) {
+    if (auto const address = table[name].value<std::int64_t>()) {
+      *game_address_field(profile.addresses, name) = ram_offset(name, *address);
+    } else if (builtin == GAME_PROFILES.end()) {
+      throw std::runtime_error(fmt::format(
+          "xtool.profiles {}, {} is missing.", *game_id, name));
+    }
+  }
+  if (auto const address = table["frame_counter"].value<std::int64_t>()) {
+    profile.addresses.frame_counter = ram_offset("frame_counter", *address);
+  }
+  if (auto const frame_rate = table["frame_rate"].value<double>()) {
+    if (!(*frame_rate > 0.0)) {
+      throw std::runtime_error(fmt::format(
+          "xtool.profiles {}, invalid frame_rate {}.", *game_id, *frame_rate));
+    }
+    profile.addresses.frame_rate = *frame_rate;
+  }
+  return profile;
+}
+
+Signature parse_signature(toml::table const &table) {
+  Signature signature;
+  auto const name = table["name"].value<std::string>();
+  auto const pattern = table["pattern"].value<std::string>();
+  if (!name.has_value() || !pattern.has_value()) {
+    throw std::runtime_error(
+        "xtool.signatures, every signature needs a name and a pattern.");
+  }
+  if (!is_game_address_name(*name)) {
+    throw std::runtime_error(
+        fmt::format("xtool.signatures, unknown address name {}.", *name));
+  }
+  signature.name = *name;
+  try {
+    signature.pattern = parse_byte_pattern(*pattern);
+  } catch (std::invalid_argument const &e) {
+    throw std::runtime_error(
+        fmt::format("xtool.signatures {}: {}", *name, e.what()));
+  }
+
+  auto const target = table["target"].value_or(std::string("match"));
+  auto const parsed_target = parse_signature_target(target);
+  if (!parsed_target.has_value()) {
+    throw std::runtime_error(fmt::format(
+        "xtool.signatures {}, unknown target {}.", *name, target));
+  }
+  signature.target = parsed_target.value();
+  signature.offset =
+      to_offset(table["offset"].value<std::int64_t>(), 0, "offset");
+  signature.lo_offset =
+      to_offset(table["lo_offset"].value<std::int64_t>(), 4, "lo_offset");
+  signature.addend =
+      to_offset(table["addend"].value<std::int64_t>(), 0, "addend");
+  return signature;
+}
+} // namespace
+
+XtoolConfig
+load_xtool_config(std::filesystem::path const &config_toml_file_path) {
+  toml::parse_result result =
+      toml::parse_file(config_toml_file_path.string());
+  if (!result.is_table()) {
+    throw std::runtime_error("Invalid toml file, expected table element.");
+  }
+  auto table = (toml::table)(result);
+
+  XtoolConfig config;
+  auto cache_path = config_toml_file_path;
+  cache_path += ".signature_cache";
+  config.signature.cache_path = cache_path;
+
+  auto const xtool = table["xtool"];
+  if (!xtool) {
+    return config;
+  }
+  if (!xtool.is_table()) {
+    throw std::runtime_error("Expected a table for xtool.");
+  }
+
+  if (auto const region = xtool["code_region"]) {
+    auto const begin = region[0].value<std::int64_t>();
+    auto const end = region[1].value<std::int64_t>();
+    if (!region.is_array() || !begin.has_value() || !end.has_value()) {
+      throw std::runtime_error(
+          "xtool.code_region, expected [begin, end] console addresses.");
+    }
+    config.signature.code_begin = to_console_address(*begin, "code_region");
+    config.signature.code_end = to_console_address(*end, "code_region");
+    if (config.signature.code_end <= config.signature.code_begin) {
+      throw std::runtime_error("xtool.code_region, end must be after begin.");
+    }
+  }
+
+  if (auto const profiles = xtool["profiles"]) {
+    if (!profiles.is_array()) {
+      throw std::runtime_error("xtool.profiles, expected an array.");
+    }
+    profiles.as_array()->for_each([&](auto &elm) {
+      if (!elm.is_table()) {
+        throw std::runtime_error(
+            "xtool.profiles, expected a table per profile.");
+      }
+      config.profiles.push_back(parse_profile(*elm.as_table()));
+    });
+  }
+
+  if (auto const signatures = xtool["signatures"]) {
+    if (!signatures.is_array()) {
+      throw std::runtime_error("xtool.signatures, expected an array.");
+    }
+    signatures.as_array()->for_each([&](auto &elm) {
+      if (!elm.is_table()) {
+        throw std::runtime_error(
+            "xtool.signatures, expected a table per signature.");
+      }
+      config.signature.signatures.push_back(parse_signature(*elm.as_table()));
+    });
+  }
+  return config;
+}
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <array>
+#include <byte_swap.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr std::array<SwapBackend, 4> BACKENDS{
+    SwapBackend::scalar, SwapBackend::ssse3, SwapBackend::avx2,
+    SwapBackend::neon};
+
+// reverses every element of count elements at data
+void swap_elements_reference(char *data, std::size_t const count,
+                             std::uint32_t const width) {
+  for (std::size_t i = 0; i < count; ++i) {
+    std::reverse(data + i * width, data + (i + 1) * width);
+  }
+}
+} // namespace
+
+TEST(ByteSwap, SwapElementsMatchesReference) {
+  std::mt19937 rng(42);
+  // guard bytes around the swapped range catch writes past either end
+  constexpr std::size_t GUARD = 16;
+  for (auto const backend : BACKENDS) {
+    if (!is_swap_backend_supported(backend)) {
+      continue;
+    }
+    SCOPED_TRACE(std::string(swap_backend_name(backend)));
+    for (std::uint32_t const width : {2u, 4u, 8u}) {
+      SCOPED_TRACE(width);
+      // odd counts and the tails the SIMD loops leave to scalar code
+      for (std::size_t count = 0; count <= 67; ++count) {
+        SCOPED_TRACE(count);
+        // pointers not aligned to the element or the vector width
+        for (std::size_t misalign = 0; misalign < 8; ++misalign) {
+          std::vector<char> buffer(GUARD + misalign + count * width + GUARD);
+          for (auto &c : buffer) {
+            c = static_cast<char>(rng());
+          }
+          auto expected = buffer;
+          swap_elements_reference(expected.data() + GUARD + misalign, count,
+                                  width);
+          swap_elements(buffer.data() + GUARD + misalign, count, width,
+                        backend);
+          EXPECT_EQ(buffer, expected);
+        }
+      }
+    }
+  }
+}
+
+TEST(ByteSwap, SwapElementsMatchesScalarOnLargeArrays) {
+  std::mt19937 rng(7);
+  std::vector<char> input(4096 * 8 + 3);
+  for (auto &c : input) {
+    c = static_cast<char>(rng());
+  }
+  for (auto const backend : BACKENDS) {
+    if (!is_swap_backend_supported(backend)) {
+      continue;
+    }
+    SCOPED_TRACE(std::string(swap_backend_name(backend)));
+    for (std::uint32_t const width : {2u, 4u, 8u}) {
+      SCOPED_TRACE(width);
+      auto const count = (input.size() - 1) / width;
+      auto expected = input;
+      swap_elements(expected.data() + 1, count, width, SwapBackend::scalar);
+      auto actual = input;
+      swap_elements(actual.data() + 1, count, width, backend);
+      EXPECT_EQ(actual, expected);
+    }
+  }
+}
+
+TEST(ByteSwap, SwapElementsRejectsInvalidWidth) {
+  std::array<char, 16> buffer{};
+  EXPECT_THROW(swap_elements(buffer.data(), 2, 3, SwapBackend::scalar),
+               std::invalid_argument);
+  // width 1 is a no-op
+  buffer[0] = 1;
+  swap_elements(buffer.data(), buffer.size(), 1, SwapBackend::scalar);
+  EXPECT_EQ(buffer[0], 1);
+}
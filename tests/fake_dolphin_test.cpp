@@ -0,0 +1,368 @@
+// Hooks tools/fake_dolphin like a real Dolphin and checks what it serves.
+// meson test passes the fake_dolphin path in FAKE_DOLPHIN.
+#include <array>
+#include <chrono>
+#include <console_address.hpp>
+#include <constants.hpp>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <dme/Common/CommonUtils.h>
+#include <dme/Common/MemoryCommon.h>
+#include <dme/DolphinProcess/DolphinAccessor.h>
+#include <dme/DolphinProcess/Linux/LinuxDolphinProcess.h>
+#include <gtest/gtest.h>
+#include <optional>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+constexpr std::uint32_t MEM2_VALUE_ADDRESS = 0x90000010;
+
+// fake_dolphin reading commands from a pipe
+class FakeDolphin {
+public:
+  FakeDolphin() {
+    auto const *path = std::getenv("FAKE_DOLPHIN");
+    if (path == nullptr) {
+      return;
+    }
+    int in[2];
+    int out[2];
+    if (pipe(in) != 0 || pipe(out) != 0) {
+      return;
+    }
+    m_pid = fork();
+    if (m_pid == 0) {
+      dup2(in[0], STDIN_FILENO);
+      dup2(out[1], STDOUT_FILENO);
+      close(in[1]);
+      close(out[0]);
+      execl(path, path, static_cast<char *>(nullptr));
+      _exit(EXIT_FAILURE);
+    }
+    close(in[0]);
+    close(out[1]);
+    m_commands = fdopen(in[1], "w");
+    m_output = fdopen(out[0], "r");
+    // the memory is mapped once it prints its pid
+    char line[128];
+    if (m_output == nullptr ||
+        std::fgets(line, sizeof(line), m_output) == nullptr) {
+      this->stop();
+    }
+  }
+
+  ~FakeDolphin() {
+    this->stop();
+    if (m_commands != nullptr) {
+      std::fclose(m_commands);
+    }
+    if (m_output != nullptr) {
+      std::fclose(m_output);
+    }
+  }
+
+  FakeDolphin(FakeDolphin const &) = delete;
+  FakeDolphin &operator=(FakeDolphin const &) = delete;
+
+  [[nodiscard]] int pid() const noexcept { return m_pid; }
+
+  void send(std::string const &command) {
+    std::fprintf(m_commands, "%s\n", command.c_str());
+    std::fflush(m_commands);
+  }
+
+  // SIGTERM removes the shared memory file
+  void stop() {
+    if (m_pid > 0) {
+      kill(m_pid, SIGTERM);
+      waitpid(m_pid, nullptr, 0);
+      m_pid = -1;
+    }
+  }
+
+private:
+  int m_pid = -1;
+  std::FILE *m_commands = nullptr;
+  std::FILE *m_output = nullptr;
+};
+
+// Commands run asynchronously, read until the value shows up.
+template <typename T, typename Read>
+std::optional<T> read_until(Read const &read, T const expected) {
+  auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  std::optional<T> value;
+  do {
+    value = read();
+    if (value == expected) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  } while (std::chrono::steady_clock::now() < deadline);
+  return value;
+}
+
+template <typename T>
+std::optional<T> read_value(DolphinComm::IDolphinProcess &process,
+                            std::uint32_t const offset) {
+  T value{};
+  if (!process.readFromRAM(offset, reinterpret_cast<char *>(&value),
+                           sizeof(T), true)) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+template <typename T>
+std::optional<T> read_value(DolphinComm::DolphinAccessor &dolphin,
+                            std::uint32_t const offset) {
+  T value{};
+  if (!dolphin.readFromRAM(offset, reinterpret_cast<char *>(&value),
+                           sizeof(T), true)) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+bool write_pointer(DolphinComm::DolphinAccessor &dolphin,
+                   std::uint32_t const address, std::uint32_t const value) {
+  return write_console(dolphin, Common::dolphinAddrToOffset(address, false),
+                       value);
+}
+
+class FakeDolphinTest : public testing::Test {
+protected:
+  void SetUp() override {
+    if (std::getenv("FAKE_DOLPHIN") == nullptr) {
+      GTEST_SKIP() << "FAKE_DOLPHIN is not set.";
+    }
+    m_fake.emplace();
+    ASSERT_GT(m_fake->pid(), 0) << "Failed to start fake_dolphin.";
+  }
+
+  std::optional<FakeDolphin> m_fake;
+};
+
+// [[0x80400000] + 0x10] + 0x2c
+class PointerPathTest : public FakeDolphinTest {
+protected:
+  static constexpr std::uint32_t BASE = 0x80400000;
+  static constexpr std::uint32_t OBJECT = 0x80410000;
+  static constexpr std::uint32_t FIELDS = 0x80420000;
+
+  void SetUp() override {
+    FakeDolphinTest::SetUp();
+    if (this->IsSkipped() || this->HasFatalFailure()) {
+      return;
+    }
+    m_dolphin.setTargetPID(m_fake->pid());
+    m_dolphin.init();
+    m_dolphin.hook();
+    ASSERT_EQ(m_dolphin.getStatus(), DolphinComm::DolphinStatus::hooked);
+    ASSERT_TRUE(write_pointer(m_dolphin, BASE, OBJECT));
+    ASSERT_TRUE(write_pointer(m_dolphin, OBJECT + 0x10, FIELDS));
+    ASSERT_TRUE(write_pointer(m_dolphin, FIELDS + 0x2c, 0xcafef00d));
+  }
+
+  DolphinComm::DolphinAccessor m_dolphin;
+};
+} // namespace
+
+TEST_F(FakeDolphinTest, FindsAndReadsProcess) {
+  m_fake->send("music 0x1234");
+  m_fake->send("seed 0xdeadbeef");
+  m_fake->send("write 0x90000010 4 0xcafef00d");
+
+  DolphinComm::LinuxDolphinProcess process;
+  process.setTargetPID(m_fake->pid());
+  ASSERT_TRUE(process.findPID());
+  EXPECT_EQ(process.getPID(), m_fake->pid());
+  ASSERT_TRUE(process.obtainEmuRAMInformations());
+  EXPECT_TRUE(process.isMEM2Present());
+
+  auto const music_id = read_until(
+      [&]() {
+        return read_value<std::uint16_t>(
+            process, xtool::constants::CURRENT_MUSIC_ID_ADDRESS);
+      },
+      std::uint16_t{0x1234});
+  EXPECT_EQ(music_id, std::uint16_t{0x1234});
+  auto const seed = read_until(
+      [&]() {
+        return read_value<std::uint32_t>(
+            process, xtool::constants::G_MTRAND_SEED_ADDRESS);
+      },
+      std::uint32_t{0xdeadbeef});
+  EXPECT_EQ(seed, std::uint32_t{0xdeadbeef});
+  auto const mem2 = read_until(
+      [&]() {
+        return read_value<std::uint32_t>(
+            process, Common::dolphinAddrToOffset(MEM2_VALUE_ADDRESS, false));
+      },
+      std::uint32_t{0xcafef00d});
+  EXPECT_EQ(mem2, std::uint32_t{0xcafef00d});
+}
+
+TEST_F(FakeDolphinTest, HooksThroughAccessor) {
+  m_fake->send("music 0x2a");
+
+  DolphinComm::DolphinAccessor dolphin;
+  dolphin.setTargetPID(m_fake->pid());
+  dolphin.init();
+  dolphin.hook();
+  ASSERT_EQ(dolphin.getStatus(), DolphinComm::DolphinStatus::hooked);
+  EXPECT_EQ(dolphin.getPID(), m_fake->pid());
+
+  auto const music_id = read_until(
+      [&]() {
+        return read_value<std::uint16_t>(
+            dolphin, xtool::constants::CURRENT_MUSIC_ID_ADDRESS);
+      },
+      std::uint16_t{0x2a});
+  EXPECT_EQ(music_id, std::uint16_t{0x2a});
+
+  // written big endian, read back through the fake's memory
+  std::uint32_t const written = 0x01020304;
+  ASSERT_TRUE(dolphin.writeToRAM(xtool::constants::G_MTRAND_SEED_ADDRESS,
+                                 reinterpret_cast<char const *>(&written),
+                                 sizeof(written), true));
+  EXPECT_EQ(read_value<std::uint32_t>(dolphin,
+                                      xtool::constants::G_MTRAND_SEED_ADDRESS),
+            written);
+
+  // gone, reads fail instead of returning stale memory
+  m_fake->stop();
+  EXPECT_EQ(read_value<std::uint32_t>(dolphin,
+                                      xtool::constants::G_MTRAND_SEED_ADDRESS),
+            std::nullopt);
+}
+
+TEST_F(FakeDolphinTest, WritesBatchInConsoleByteOrder) {
+  DolphinComm::DolphinAccessor dolphin;
+  dolphin.setTargetPID(m_fake->pid());
+  dolphin.init();
+  dolphin.hook();
+  ASSERT_EQ(dolphin.getStatus(), DolphinComm::DolphinStatus::hooked);
+
+  // MEM1 and MEM2 in one plan
+  auto const mem2_offset =
+      Common::dolphinAddrToOffset(MEM2_VALUE_ADDRESS, false);
+  ConsoleWritePlan<4> plan;
+  plan.add(xtool::constants::G_MTRAND_SEED_ADDRESS,
+           std::uint32_t{0x11223344});
+  plan.add(mem2_offset, std::uint16_t{0xa1b2});
+  plan.add(mem2_offset + 2, std::uint8_t{0xc3});
+  plan.add(mem2_offset + 4, 1.5f);
+  ASSERT_TRUE(plan.submit(dolphin));
+
+  // big endian in the game memory
+  std::array<unsigned char, 4> seed_bytes{};
+  ASSERT_TRUE(dolphin.readFromRAM(xtool::constants::G_MTRAND_SEED_ADDRESS,
+                                  reinterpret_cast<char *>(seed_bytes.data()),
+                                  seed_bytes.size(), false));
+  EXPECT_EQ(seed_bytes, (std::array<unsigned char, 4>{0x11, 0x22, 0x33, 0x44}));
+  std::array<unsigned char, 8> mem2_bytes{};
+  ASSERT_TRUE(dolphin.readFromRAM(mem2_offset,
+                                  reinterpret_cast<char *>(mem2_bytes.data()),
+                                  mem2_bytes.size(), false));
+  // 1.5f = 0x3fc00000
+  EXPECT_EQ(mem2_bytes, (std::array<unsigned char, 8>{0xa1, 0xb2, 0xc3, 0x00,
+                                                      0x3f, 0xc0, 0x00, 0x00}));
+
+  // and back to host order
+  EXPECT_EQ(read_value<std::uint16_t>(dolphin, mem2_offset),
+            std::uint16_t{0xa1b2});
+  EXPECT_TRUE(
+      write_console(dolphin, mem2_offset, std::uint32_t{0xcafef00d}));
+  EXPECT_EQ(read_value<std::uint32_t>(dolphin, mem2_offset),
+            std::uint32_t{0xcafef00d});
+
+  // more ranges than one process_vm_writev takes
+  ConsoleWritePlan<100> big_plan;
+  for (std::uint32_t i = 0; i < 100; ++i) {
+    big_plan.add(mem2_offset + 0x100 + 4 * i, i * 0x01010101u);
+  }
+  ASSERT_TRUE(big_plan.submit(dolphin));
+  for (std::uint32_t i = 0; i < 100; ++i) {
+    ASSERT_EQ(read_value<std::uint32_t>(dolphin, mem2_offset + 0x100 + 4 * i),
+              i * 0x01010101u);
+  }
+  EXPECT_THROW(big_plan.add(mem2_offset, std::uint8_t{0}), std::length_error);
+}
+
+TEST_F(PointerPathTest, SteadyReadsKeepThePointers) {
+  DolphinComm::PointerPath path(BASE, {0x10, 0x2c});
+  EXPECT_EQ(read_console<std::uint32_t>(m_dolphin, path),
+            std::uint32_t{0xcafef00d});
+  EXPECT_EQ(path.getWalkCount(), 1u);
+  EXPECT_EQ(path.getHitCount(), 0u);
+
+  // the value changes, the pointers don't
+  ASSERT_TRUE(write_pointer(m_dolphin, FIELDS + 0x2c, 0x01020304));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(read_console<std::uint32_t>(m_dolphin, path),
+              std::uint32_t{0x01020304});
+  }
+  EXPECT_EQ(path.getWalkCount(), 1u);
+  EXPECT_EQ(path.getHitCount(), 3u);
+  EXPECT_EQ(m_dolphin.resolvePointerPath(path), FIELDS + 0x2c);
+}
+
+TEST_F(PointerPathTest, ChangedPointerWalksAgain) {
+  DolphinComm::PointerPath path(BASE, {0x10, 0x2c}, 2);
+  ASSERT_EQ(read_console<std::uint32_t>(m_dolphin, path),
+            std::uint32_t{0xcafef00d});
+
+  // watched second level moved to another structure
+  std::uint32_t const moved = 0x80430000;
+  ASSERT_TRUE(write_pointer(m_dolphin, moved + 0x2c, 0x11111111));
+  ASSERT_TRUE(write_pointer(m_dolphin, OBJECT + 0x10, moved));
+  EXPECT_EQ(read_console<std::uint32_t>(m_dolphin, path),
+            std::uint32_t{0x11111111});
+  EXPECT_EQ(path.getWalkCount(), 2u);
+  EXPECT_EQ(m_dolphin.resolvePointerPath(path), moved + 0x2c);
+
+  // and the first one
+  std::uint32_t const object = 0x80440000;
+  ASSERT_TRUE(write_pointer(m_dolphin, object + 0x10, FIELDS));
+  ASSERT_TRUE(write_pointer(m_dolphin, BASE, object));
+  EXPECT_EQ(read_console<std::uint32_t>(m_dolphin, path),
+            std::uint32_t{0xcafef00d});
+  EXPECT_EQ(path.getWalkCount(), 3u);
+  EXPECT_EQ(path.getHitCount(), 1u);
+}
+
+TEST_F(PointerPathTest, NullPointerFailsTheRead) {
+  DolphinComm::PointerPath path(BASE, {0x10, 0x2c});
+  ASSERT_EQ(read_console<std::uint32_t>(m_dolphin, path),
+            std::uint32_t{0xcafef00d});
+
+  // e.g. while the game loads
+  ASSERT_TRUE(write_pointer(m_dolphin, BASE, 0));
+  EXPECT_EQ(read_console<std::uint32_t>(m_dolphin, path), std::nullopt);
+  EXPECT_EQ(m_dolphin.resolvePointerPath(path), 0u);
+
+  ASSERT_TRUE(write_pointer(m_dolphin, BASE, OBJECT));
+  EXPECT_EQ(read_console<std::uint32_t>(m_dolphin, path),
+            std::uint32_t{0xcafef00d});
+}
+
+TEST_F(PointerPathTest, RehookWalksAgain) {
+  DolphinComm::PointerPath path(BASE, {0x10, 0x2c});
+  ASSERT_EQ(read_console<std::uint32_t>(m_dolphin, path),
+            std::uint32_t{0xcafef00d});
+  ASSERT_EQ(path.getWalkCount(), 1u);
+
+  m_dolphin.unHook();
+  EXPECT_EQ(read_console<std::uint32_t>(m_dolphin, path), std::nullopt);
+  m_dolphin.hook();
+  ASSERT_EQ(m_dolphin.getStatus(), DolphinComm::DolphinStatus::hooked);
+  EXPECT_EQ(read_console<std::uint32_t>(m_dolphin, path),
+            std::uint32_t{0xcafef00d});
+  EXPECT_EQ(path.getWalkCount(), 2u);
+  EXPECT_EQ(path.getHitCount(), 0u);
+}
@@ -0,0 +1,122 @@
+#include <chrono>
+#include <frame_sampler.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+namespace {
+using std::chrono::milliseconds;
+
+constexpr std::int64_t MS = 1'000'000;
+// 60 fps
+constexpr std::int64_t FRAME_NS = 1'000'000'000 / 60;
+constexpr milliseconds CLOCK_INTERVAL{200};
+constexpr milliseconds MAX_DELAY{1000};
+} // namespace
+
+TEST(FrameSampler, RejectsZeroFramesPerSample) {
+  EXPECT_THROW(FrameSampler(0, CLOCK_INTERVAL), std::invalid_argument);
+}
+
+TEST(FrameSampler, DueEveryFramesPerSample) {
+  FrameSampler sampler(12, CLOCK_INTERVAL);
+  EXPECT_TRUE(sampler.on_frame(100, 0));
+  EXPECT_FALSE(sampler.on_frame(106, 6 * FRAME_NS));
+  EXPECT_FALSE(sampler.on_frame(111, 11 * FRAME_NS));
+  EXPECT_TRUE(sampler.on_frame(112, 12 * FRAME_NS));
+  // counted from the due sample, not from the frame it was due at
+  EXPECT_FALSE(sampler.on_frame(120, 20 * FRAME_NS));
+  EXPECT_TRUE(sampler.on_frame(130, 30 * FRAME_NS));
+
+  auto const stats = sampler.stats();
+  EXPECT_EQ(stats.samples, 3u);
+  EXPECT_EQ(stats.early, 3u);
+  ASSERT_TRUE(sampler.frames_per_second().has_value());
+  EXPECT_NEAR(*sampler.frames_per_second(), 60.0, 0.01);
+}
+
+TEST(FrameSampler, CounterGoingBackIsDue) {
+  FrameSampler sampler(12, CLOCK_INTERVAL);
+  EXPECT_TRUE(sampler.on_frame(1000, 0));
+  EXPECT_FALSE(sampler.on_frame(1006, 6 * FRAME_NS));
+  // game reset, the old rate says nothing
+  EXPECT_TRUE(sampler.on_frame(3, 7 * FRAME_NS));
+  EXPECT_EQ(sampler.frames_per_second(), std::nullopt);
+}
+
+TEST(FrameSampler, ResetForgetsTheCounter) {
+  FrameSampler sampler(12, CLOCK_INTERVAL);
+  EXPECT_TRUE(sampler.on_frame(100, 0));
+  EXPECT_FALSE(sampler.on_frame(106, 6 * FRAME_NS));
+  sampler.reset();
+  EXPECT_EQ(sampler.frames_per_second(), std::nullopt);
+  // another game, due right away even though the counter moved forward
+  EXPECT_TRUE(sampler.on_frame(107, 7 * FRAME_NS));
+  EXPECT_EQ(sampler.frames_per_second(), std::nullopt);
+}
+
+TEST(FrameSampler, DelayFollowsTheFrameRate) {
+  FrameSampler sampler(12, CLOCK_INTERVAL);
+  EXPECT_TRUE(sampler.on_frame(0, 0));
+  // one reading, no rate yet
+  EXPECT_EQ(sampler.next_delay(0, MAX_DELAY), CLOCK_INTERVAL);
+
+  // full speed, 6.5 frames left at 60 fps
+  EXPECT_FALSE(sampler.on_frame(6, 6 * FRAME_NS));
+  EXPECT_EQ(sampler.next_delay(6 * FRAME_NS, MAX_DELAY), milliseconds(109));
+
+  // half speed
+  FrameSampler half(12, CLOCK_INTERVAL);
+  EXPECT_TRUE(half.on_frame(0, 0));
+  EXPECT_FALSE(half.on_frame(6, 12 * FRAME_NS));
+  // 6.5 frames at 30 fps
+  EXPECT_EQ(half.next_delay(12 * FRAME_NS, MAX_DELAY), milliseconds(217));
+  // time since the last reading counts
+  EXPECT_EQ(half.next_delay(12 * FRAME_NS + 100 * MS, MAX_DELAY),
+            milliseconds(117));
+  // late, at least 1 ms
+  EXPECT_EQ(half.next_delay(12 * FRAME_NS + 500 * MS, MAX_DELAY),
+            milliseconds(1));
+}
+
+TEST(FrameSampler, PausedWaitsTheMaxDelay) {
+  FrameSampler sampler(12, CLOCK_INTERVAL);
+  EXPECT_TRUE(sampler.on_frame(0, 0));
+  EXPECT_TRUE(sampler.on_frame(12, 12 * FRAME_NS));
+
+  // read again within a frame, not a pause
+  EXPECT_FALSE(sampler.on_frame(12, 12 * FRAME_NS + 5 * MS));
+  ASSERT_TRUE(sampler.frames_per_second().has_value());
+  EXPECT_NEAR(*sampler.frames_per_second(), 60.0, 0.01);
+  EXPECT_LT(sampler.next_delay(12 * FRAME_NS + 5 * MS, MAX_DELAY), MAX_DELAY);
+
+  // the counter didn't move for 200 ms
+  std::int64_t const paused_ns = 12 * FRAME_NS + 200 * MS;
+  EXPECT_FALSE(sampler.on_frame(12, paused_ns));
+  EXPECT_EQ(sampler.frames_per_second(), 0.0);
+  EXPECT_EQ(sampler.next_delay(paused_ns, MAX_DELAY), MAX_DELAY);
+  EXPECT_EQ(sampler.next_delay(paused_ns, milliseconds(500)),
+            milliseconds(500));
+
+  // resumed, the rate is measured again without the pause
+  EXPECT_TRUE(sampler.on_frame(24, paused_ns + 12 * FRAME_NS));
+  EXPECT_EQ(sampler.frames_per_second(), std::nullopt);
+  EXPECT_EQ(sampler.next_delay(paused_ns + 12 * FRAME_NS, MAX_DELAY),
+            CLOCK_INTERVAL);
+  EXPECT_FALSE(sampler.on_frame(30, paused_ns + 18 * FRAME_NS));
+  ASSERT_TRUE(sampler.frames_per_second().has_value());
+  EXPECT_NEAR(*sampler.frames_per_second(), 60.0, 0.01);
+}
+
+TEST(FrameSampler, ClockWithoutFrameCounter) {
+  FrameSampler sampler(12, CLOCK_INTERVAL);
+  EXPECT_TRUE(sampler.on_clock(0));
+  EXPECT_FALSE(sampler.on_clock(100 * MS));
+  EXPECT_EQ(sampler.next_delay(100 * MS, MAX_DELAY), milliseconds(100));
+  // a timer firing a little early still counts
+  EXPECT_TRUE(sampler.on_clock(199 * MS + MS / 2));
+  EXPECT_EQ(sampler.next_delay(199 * MS + MS / 2, MAX_DELAY), CLOCK_INTERVAL);
+
+  auto const stats = sampler.stats();
+  EXPECT_EQ(stats.samples, 2u);
+  EXPECT_EQ(stats.early, 1u);
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <numeric>
+#include <playlist.hpp>
+
+namespace {
+// music_count musics with ids 0..music_count-1, every one but allowed_id in
+// the no repeat history.
+PlaylistEntry make_full_history_entry(std::size_t const music_count,
+                                      UniqueMusicID const allowed_id) {
+  PlaylistEntry entry;
+  entry.music_entries.resize(music_count);
+  std::iota(entry.music_entries.begin(), entry.music_entries.end(),
+            UniqueMusicID{0});
+  entry.history.capacity = music_count - 1;
+  for (auto const id : entry.music_entries) {
+    if (id != allowed_id) {
+      entry.history.push(id);
+    }
+  }
+  return entry;
+}
+} // namespace
+
+TEST(SelectMusicIndex, NoRepeatNeverPicksRecentMusic) {
+  // no_repeat = distinct musics - 1, only one music is allowed
+  auto const entry = make_full_history_entry(1000, 123);
+  for (std::uint32_t seed = 0; seed < 2000; ++seed) {
+    auto const index =
+        select_music_index(entry, seed, SeedSelectorVersion::v2);
+    ASSERT_EQ(entry.music_entries[index], 123) << "seed " << seed;
+  }
+}
+
+TEST(SelectMusicIndex, WeightedNoRepeatNeverPicksRecentMusic) {
+  auto entry = make_full_history_entry(1000, 123);
+  // nearly all the weight on recent musics
+  entry.weights.assign(1000, 1000.0);
+  entry.weights[123] = 1.0;
+  entry.alias_table = AliasTable(entry.weights);
+  for (std::uint32_t seed = 0; seed < 2000; ++seed) {
+    auto const index =
+        select_music_index(entry, seed, SeedSelectorVersion::v2);
+    ASSERT_EQ(entry.music_entries[index], 123) << "seed " << seed;
+  }
+}
+
+TEST(SelectMusicIndex, NoRepeatSkipsZeroWeightMusic) {
+  PlaylistEntry entry;
+  entry.music_entries = {10, 11, 12, 13};
+  entry.weights = {1.0, 0.0, 1.0, 1.0};
+  entry.alias_table = AliasTable(entry.weights);
+  entry.history.capacity = 2;
+  entry.history.push(10);
+  entry.history.push(13);
+  for (std::uint32_t seed = 0; seed < 2000; ++seed) {
+    auto const index =
+        select_music_index(entry, seed, SeedSelectorVersion::v2);
+    ASSERT_EQ(entry.music_entries[index], 12) << "seed " << seed;
+  }
+}
+
+TEST(SelectMusicIndex, SameSeedSameIndex) {
+  auto const entry = make_full_history_entry(1000, 999);
+  auto copy = entry;
+  for (std::uint32_t seed = 0; seed < 100; ++seed) {
+    EXPECT_EQ(select_music_index(entry, seed, SeedSelectorVersion::v2),
+              select_music_index(copy, seed, SeedSelectorVersion::v2));
+  }
+}
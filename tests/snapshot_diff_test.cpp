@@ -0,0 +1,73 @@
+#include <array>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <random>
+#include <snapshot_diff.hpp>
+#include <string>
+
+namespace {
+constexpr std::array<DiffBackend, 4> BACKENDS{
+    DiffBackend::scalar, DiffBackend::sse2, DiffBackend::avx2,
+    DiffBackend::neon};
+
+// bit i set when element i differs
+std::uint64_t diff_elements64_reference(char const *a, char const *b,
+                                        std::uint32_t const width) {
+  std::uint64_t mask = 0;
+  for (std::uint32_t i = 0; i < 64; ++i) {
+    if (std::memcmp(a + i * width, b + i * width, width) != 0) {
+      mask |= std::uint64_t{1} << i;
+    }
+  }
+  return mask;
+}
+} // namespace
+
+TEST(SnapshotDiff, DiffElements64MatchesScalarLoop) {
+  std::mt19937 rng(42);
+  std::array<char, 64 * 4> a{};
+  std::array<char, 64 * 4> b{};
+  for (auto const backend : BACKENDS) {
+    if (!is_diff_backend_supported(backend)) {
+      continue;
+    }
+    SCOPED_TRACE(std::string(diff_backend_name(backend)));
+    for (std::uint32_t const width : {1u, 2u, 4u}) {
+      SCOPED_TRACE(width);
+      for (int round = 0; round < 200; ++round) {
+        for (auto &c : a) {
+          c = static_cast<char>(rng());
+        }
+        b = a;
+        // from no change to every byte changed, single bytes inside an
+        // element included
+        auto const changes = static_cast<int>(rng() % (b.size() + 1));
+        for (int i = 0; i < changes; ++i) {
+          b[rng() % b.size()] ^= static_cast<char>(1 + rng() % 255);
+        }
+        EXPECT_EQ(diff_elements64(a.data(), b.data(), width, backend),
+                  diff_elements64_reference(a.data(), b.data(), width));
+      }
+    }
+  }
+}
+
+TEST(SnapshotDiff, DiffElements64EdgeElements) {
+  std::array<char, 64 * 4> a{};
+  for (auto const backend : BACKENDS) {
+    if (!is_diff_backend_supported(backend)) {
+      continue;
+    }
+    SCOPED_TRACE(std::string(diff_backend_name(backend)));
+    for (std::uint32_t const width : {1u, 2u, 4u}) {
+      SCOPED_TRACE(width);
+      auto b = a;
+      EXPECT_EQ(diff_elements64(a.data(), b.data(), width, backend), 0u);
+      // last byte of the first element, first byte of the last one
+      b[width - 1] = 1;
+      b[63 * width] = 1;
+      EXPECT_EQ(diff_elements64(a.data(), b.data(), width, backend),
+                std::uint64_t{1} | std::uint64_t{1} << 63);
+    }
+  }
+}
@@ -0,0 +1,309 @@
+#include <array>
+#include <cstdint>
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <value_scanner.hpp>
+#include <vector>
+
+namespace {
+constexpr std::array<DiffBackend, 4> BACKENDS{
+    DiffBackend::scalar, DiffBackend::sse2, DiffBackend::avx2,
+    DiffBackend::neon};
+
+using Kind = CandidateSet::Chunk::Kind;
+
+struct Layout {
+  Common::MemType type;
+  bool aligned;
+};
+
+// aligned byte / halfword / word go through the SIMD path, unaligned ones
+// (stride 1 with a wider value) through the scalar one
+constexpr std::array<Layout, 5> LAYOUTS{{
+    {Common::MemType::type_byte, true},
+    {Common::MemType::type_halfword, true},
+    {Common::MemType::type_halfword, false},
+    {Common::MemType::type_word, true},
+    {Common::MemType::type_word, false},
+}};
+
+std::uint64_t read_be(std::vector<char> const &ram, std::size_t const index,
+                      std::size_t const size) {
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    value = value << 8 | static_cast<std::uint8_t>(ram[index + i]);
+  }
+  return value;
+}
+
+void write_be(std::vector<char> &ram, std::size_t const index,
+              std::size_t const size, std::uint64_t const value) {
+  for (std::size_t i = 0; i < size; ++i) {
+    ram[index + i] = static_cast<char>(value >> (8 * (size - 1 - i)));
+  }
+}
+
+// Candidates and previous values kept one position at a time
+class ReferenceScanner {
+public:
+  ReferenceScanner(std::size_t const size, std::uint32_t const stride)
+      : m_size(size), m_stride(stride) {}
+
+  template <class Keep>
+  void first(std::vector<char> const &ram, Keep const keep) {
+    m_alive.assign((ram.size() - m_size) / m_stride + 1, false);
+    for (std::size_t p = 0; p < m_alive.size(); ++p) {
+      m_alive[p] = keep(read_be(ram, p * m_stride, m_size), 0);
+    }
+    m_previous = ram;
+  }
+
+  template <class Keep>
+  void next(std::vector<char> const &ram, Keep const keep) {
+    for (std::size_t p = 0; p < m_alive.size(); ++p) {
+      if (m_alive[p]) {
+        m_alive[p] = keep(read_be(ram, p * m_stride, m_size),
+                          read_be(m_previous, p * m_stride, m_size));
+      }
+    }
+    m_previous = ram;
+  }
+
+  [[nodiscard]] std::vector<std::uint32_t> results() const {
+    std::vector<std::uint32_t> indices;
+    for (std::size_t p = 0; p < m_alive.size(); ++p) {
+      if (m_alive[p]) {
+        indices.push_back(static_cast<std::uint32_t>(p * m_stride));
+      }
+    }
+    return indices;
+  }
+
+private:
+  std::size_t m_size;
+  std::uint32_t m_stride;
+  std::vector<bool> m_alive;
+  std::vector<char> m_previous;
+};
+
+void expect_same(ValueScanner const &scanner,
+                 ReferenceScanner const &reference) {
+  auto const expected = reference.results();
+  EXPECT_EQ(scanner.candidates().count(), expected.size());
+  EXPECT_EQ(scanner.results(expected.size() + 1), expected);
+}
+
+bool has_kind(ValueScanner const &scanner, Kind const kind) {
+  for (auto const &chunk : scanner.candidates().chunks()) {
+    if (chunk.kind == kind) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// random bytes over [begin, end) of ram
+void scramble(std::vector<char> &ram, std::mt19937 &rng,
+              std::size_t const begin, std::size_t const end) {
+  for (std::size_t i = begin; i < end && i < ram.size(); ++i) {
+    ram[i] = static_cast<char>(rng());
+  }
+}
+} // namespace
+
+// unknown -> changed -> unchanged -> changed -> increased / decreased ->
+// range -> exact, with changes picked so the chunks go full -> bitmap ->
+// array -> empty and candidates sit on the chunk boundaries
+TEST(ValueScanner, NextScansMatchReference) {
+  for (auto const backend : BACKENDS) {
+    if (!is_diff_backend_supported(backend)) {
+      continue;
+    }
+    SCOPED_TRACE(std::string(diff_backend_name(backend)));
+    for (auto const layout : LAYOUTS) {
+      ScanOptions options;
+      options.type = layout.type;
+      options.aligned = layout.aligned;
+      options.threads = 2;
+      options.backend = backend;
+      ValueScanner scanner(options);
+      auto const size = scanner.value_size();
+      auto const stride = static_cast<std::uint32_t>(
+          layout.aligned ? Common::getNbrBytesAlignementForType(layout.type)
+                         : 1);
+      SCOPED_TRACE(fmt::format("size {} stride {}", size, stride));
+      ReferenceScanner reference(size, stride);
+
+      // two and a half chunks with an odd tail
+      std::size_t const chunk_bytes =
+          std::size_t{CandidateSet::CHUNK_POSITIONS} * stride;
+      std::mt19937 rng(42);
+      std::vector<char> ram(chunk_bytes * 5 / 2 + 3);
+      scramble(ram, rng, 0, ram.size());
+
+      scanner.scan(ram, ScanFilter::unknown);
+      reference.first(ram, [](auto, auto) { return true; });
+      expect_same(scanner, reference);
+      EXPECT_TRUE(has_kind(scanner, Kind::full));
+
+      // dense changes in chunk 0, sparse ones in chunk 1, none after
+      for (std::size_t i = 0; i < chunk_bytes; i += 5) {
+        ram[i] = static_cast<char>(ram[i] + 1);
+      }
+      for (int i = 0; i < 100; ++i) {
+        auto const index = chunk_bytes + rng() % chunk_bytes;
+        ram[index] = static_cast<char>(ram[index] + 1);
+      }
+      scramble(ram, rng, chunk_bytes - 8, chunk_bytes + 8);
+      auto const changed = [](auto value, auto previous) {
+        return value != previous;
+      };
+      scanner.scan(ram, ScanFilter::changed);
+      reference.next(ram, changed);
+      expect_same(scanner, reference);
+      EXPECT_TRUE(has_kind(scanner, Kind::bitmap));
+      EXPECT_TRUE(has_kind(scanner, Kind::array));
+      EXPECT_TRUE(has_kind(scanner, Kind::empty));
+
+      // only the values whose bytes are in the next chunk's range change,
+      // so the previous values of the tail of chunk 0 have to be stitched
+      scramble(ram, rng, chunk_bytes, chunk_bytes + 4);
+      scanner.scan(ram, ScanFilter::unchanged);
+      reference.next(ram, [](auto value, auto previous) {
+        return value == previous;
+      });
+      expect_same(scanner, reference);
+
+      scramble(ram, rng, chunk_bytes - 4, chunk_bytes + 4);
+      for (std::size_t i = 0; i < chunk_bytes; i += 7) {
+        ram[i] = static_cast<char>(ram[i] + 1);
+      }
+      scanner.scan(ram, ScanFilter::changed);
+      reference.next(ram, changed);
+      expect_same(scanner, reference);
+
+      scramble(ram, rng, 0, chunk_bytes * 2);
+      scanner.scan(ram, ScanFilter::increased);
+      reference.next(ram, [](auto value, auto previous) {
+        return value > previous;
+      });
+      expect_same(scanner, reference);
+
+      scramble(ram, rng, 0, chunk_bytes * 2);
+      scanner.scan(ram, ScanFilter::decreased);
+      reference.next(ram, [](auto value, auto previous) {
+        return value < previous;
+      });
+      expect_same(scanner, reference);
+
+      auto const half = std::uint64_t{1} << (8 * size - 1);
+      scanner.scan(ram, ScanFilter::range, "0", fmt::format("{}", half));
+      reference.next(ram, [half](auto value, auto) { return value <= half; });
+      expect_same(scanner, reference);
+
+      // no value of the RAM, every chunk ends up empty
+      for (std::size_t i = 0; i + size <= ram.size(); ++i) {
+        if (read_be(ram, i, size) == 0) {
+          ram[i + size - 1] = 1;
+        }
+      }
+      scanner.scan(ram, ScanFilter::exact, "0");
+      reference.next(ram, [](auto value, auto) { return value == 0; });
+      expect_same(scanner, reference);
+      for (auto const &chunk : scanner.candidates().chunks()) {
+        EXPECT_EQ(chunk.kind, Kind::empty);
+      }
+    }
+  }
+}
+
+TEST(ValueScanner, FirstScanExactMatchesReference) {
+  for (auto const backend : BACKENDS) {
+    if (!is_diff_backend_supported(backend)) {
+      continue;
+    }
+    SCOPED_TRACE(std::string(diff_backend_name(backend)));
+    for (auto const layout : LAYOUTS) {
+      ScanOptions options;
+      options.type = layout.type;
+      options.aligned = layout.aligned;
+      options.backend = backend;
+      ValueScanner scanner(options);
+      auto const size = scanner.value_size();
+      auto const stride = static_cast<std::uint32_t>(
+          layout.aligned ? Common::getNbrBytesAlignementForType(layout.type)
+                         : 1);
+      SCOPED_TRACE(fmt::format("size {} stride {}", size, stride));
+      ReferenceScanner reference(size, stride);
+
+      std::size_t const chunk_bytes =
+          std::size_t{CandidateSet::CHUNK_POSITIONS} * stride;
+      std::mt19937 rng(7);
+      std::vector<char> ram(chunk_bytes * 2 + 5);
+      scramble(ram, rng, 0, ram.size());
+
+      // planted at the start, on both sides of the chunk boundary and at
+      // the last position
+      std::uint64_t const value =
+          0x12345678u & ((std::uint64_t{1} << (8 * size)) - 1);
+      for (std::size_t const index :
+           {std::size_t{0}, chunk_bytes - stride, chunk_bytes,
+            chunk_bytes + 64 * stride + stride,
+            (ram.size() - size) / stride * stride}) {
+        write_be(ram, index, size, value);
+      }
+      auto const text = fmt::format("{}", value);
+      scanner.scan(ram, ScanFilter::exact, text);
+      reference.first(ram, [value](auto v, auto) { return v == value; });
+      expect_same(scanner, reference);
+
+      // a next exact scan on the array chunks after one of them moved
+      write_be(ram, chunk_bytes, size, value + 1);
+      scanner.scan(ram, ScanFilter::exact, text);
+      reference.next(ram, [value](auto v, auto) { return v == value; });
+      expect_same(scanner, reference);
+    }
+  }
+}
+
+// The last positions of a chunk read bytes of the next one. Here they
+// survive an increased scan while the next chunk drops the positions over
+// those bytes, so their previous values only come from the stitching.
+TEST(ValueScanner, KeepsPreviousValuesAcrossChunkBoundaries) {
+  for (auto const type :
+       {Common::MemType::type_halfword, Common::MemType::type_word}) {
+    ScanOptions options;
+    options.type = type;
+    options.aligned = false;
+    options.threads = 2;
+    ValueScanner scanner(options);
+    auto const size = scanner.value_size();
+    SCOPED_TRACE(size);
+    ReferenceScanner reference(size, 1);
+
+    std::size_t const end = CandidateSet::CHUNK_POSITIONS;
+    std::vector<char> ram(end * 2);
+    ram[end] = 0x20;
+    scanner.scan(ram, ScanFilter::unknown);
+    reference.first(ram, [](auto, auto) { return true; });
+
+    // up for the positions over end - 1, down for the one at end
+    ram[end - 1] = 0x01;
+    ram[end] = 0x10;
+    scanner.scan(ram, ScanFilter::increased);
+    reference.next(ram, [](auto value, auto previous) {
+      return value > previous;
+    });
+    expect_same(scanner, reference);
+    ASSERT_EQ(scanner.candidates().count(), size);
+    EXPECT_EQ(scanner.candidates().chunks()[1].kind, Kind::empty);
+
+    scanner.scan(ram, ScanFilter::unchanged);
+    reference.next(ram, [](auto value, auto previous) {
+      return value == previous;
+    });
+    expect_same(scanner, reference);
+  }
+}
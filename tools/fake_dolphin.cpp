@@ -0,0 +1,175 @@
+// Pretends to be a running Dolphin for LinuxDolphinProcess, so hooking and
+// memory reads can be tested without the emulator.
+//
+// It names itself dolphin-emu, creates /dev/shm/dolphin-emu.<pid> and maps
+// MEM1(0x2000000 bytes at file offset 0) and MEM2(0x4000000 bytes at file
+// offset 0x2040000) like Dolphin does for a Wii game.
+//
+// Commands are read line by line from the script file given as the first
+// argument, or from stdin. Values are stored big endian like the console.
+//   music <id>                      current music id
+//   seed <value>                    g_mtRand.seed
+//   write <address> <size> <value>  console address, size 1, 2, 4 or 8
+//   sleep <ms>
+//   wait                            keep running until killed
+//   quit
+// Lines starting with # are ignored.
+#ifndef __linux__
+#error "fake_dolphin only runs on Linux."
+#endif
+
+#include <chrono>
+#include <constants.hpp>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <dme/Common/MemoryCommon.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+constexpr std::size_t MEM1_MAPPING_SIZE = 0x2000000;
+constexpr std::size_t MEM2_MAPPING_SIZE = 0x4000000;
+constexpr off_t MEM2_FILE_OFFSET = 0x2040000;
+
+char SHM_NAME[64];
+char *MEM1 = nullptr;
+char *MEM2 = nullptr;
+
+void remove_shm_and_exit(int) {
+  shm_unlink(SHM_NAME);
+  _exit(EXIT_SUCCESS);
+}
+
+void write_be(std::uint32_t const address, std::size_t const size,
+              std::uint64_t const value) {
+  char *base = nullptr;
+  std::uint32_t offset = 0;
+  std::size_t limit = 0;
+  if (address >= Common::MEM1_START && address < Common::MEM1_END) {
+    base = MEM1;
+    offset = address - Common::MEM1_START;
+    limit = Common::MEM1_SIZE;
+  } else if (address >= Common::MEM2_START && address < Common::MEM2_END) {
+    base = MEM2;
+    offset = address - Common::MEM2_START;
+    limit = Common::MEM2_SIZE;
+  }
+  if (base == nullptr || offset + size > limit) {
+    throw std::invalid_argument("Address out of MEM1/MEM2.");
+  }
+  for (std::size_t i = 0; i < size; ++i) {
+    base[offset + i] =
+        static_cast<char>((value >> (8 * (size - 1 - i))) & 0xff);
+  }
+}
+
+void run_command(std::string const &line) {
+  std::istringstream ss(line);
+  std::string command;
+  if (!(ss >> command) || command.front() == '#') {
+    return;
+  }
+  auto const next_number = [&]() {
+    std::string s;
+    if (!(ss >> s)) {
+      throw std::invalid_argument("Missing argument.");
+    }
+    return std::stoull(s, nullptr, 0);
+  };
+
+  if (command == "music") {
+    // CURRENT_MUSIC_ID_ADDRESS and friends are offsets from MEM1_START
+    write_be(Common::MEM1_START + xtool::constants::CURRENT_MUSIC_ID_ADDRESS,
+             2, next_number());
+  } else if (command == "seed") {
+    write_be(Common::MEM1_START + xtool::constants::G_MTRAND_SEED_ADDRESS, 4,
+             next_number());
+  } else if (command == "write") {
+    auto const address = static_cast<std::uint32_t>(next_number());
+    auto const size = next_number();
+    if (size != 1 && size != 2 && size != 4 && size != 8) {
+      throw std::invalid_argument("Size must be 1, 2, 4 or 8.");
+    }
+    write_be(address, size, next_number());
+  } else if (command == "sleep") {
+    std::this_thread::sleep_for(std::chrono::milliseconds(next_number()));
+  } else if (command == "wait") {
+    while (true) {
+      pause();
+    }
+  } else if (command == "quit") {
+    remove_shm_and_exit(0);
+  } else {
+    throw std::invalid_argument("Unknown command " + command + ".");
+  }
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  // LinuxDolphinProcess::findPID compares /proc/<pid>/comm
+  prctl(PR_SET_NAME, "dolphin-emu", 0, 0, 0);
+
+  std::snprintf(SHM_NAME, sizeof(SHM_NAME), "/dolphin-emu.%d", getpid());
+  auto const fd = shm_open(SHM_NAME, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    std::cerr << "shm_open failed: " << std::strerror(errno) << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::signal(SIGINT, remove_shm_and_exit);
+  std::signal(SIGTERM, remove_shm_and_exit);
+
+  // MEM1 and MEM2 are not adjacent in the file, so the kernel keeps them as
+  // two mappings with the offsets obtainEmuRAMInformations looks for.
+  if (ftruncate(fd, MEM2_FILE_OFFSET + MEM2_MAPPING_SIZE) != 0) {
+    std::cerr << "ftruncate failed: " << std::strerror(errno) << std::endl;
+    remove_shm_and_exit(0);
+  }
+  auto *mem1 = mmap(nullptr, MEM1_MAPPING_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  auto *mem2 = mmap(nullptr, MEM2_MAPPING_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, MEM2_FILE_OFFSET);
+  close(fd);
+  if (mem1 == MAP_FAILED || mem2 == MAP_FAILED) {
+    std::cerr << "mmap failed: " << std::strerror(errno) << std::endl;
+    remove_shm_and_exit(0);
+  }
+  MEM1 = static_cast<char *>(mem1);
+  MEM2 = static_cast<char *>(mem2);
+
+  // scripts wait for this line before starting xtool
+  std::cout << "fake dolphin ready, pid " << getpid() << std::endl;
+
+  std::ifstream script;
+  if (argc > 1) {
+    script.open(argv[1]);
+    if (!script) {
+      std::cerr << "Failed to open " << argv[1] << std::endl;
+      remove_shm_and_exit(0);
+    }
+  }
+  std::istream &in = argc > 1 ? script : std::cin;
+
+  std::string line;
+  while (std::getline(in, line)) {
+    try {
+      run_command(line);
+    } catch (std::exception const &e) {
+      std::cerr << "Invalid command '" << line << "': " << e.what()
+                << std::endl;
+    }
+  }
+
+  // end of script, keep the memory readable until killed
+  while (true) {
+    pause();
+  }
+}
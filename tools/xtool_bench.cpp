@@ -0,0 +1,64 @@
+// Standalone benchmark runner, prints the results as JSON so runs of
+// different builds can be compared:
+//   xtool-bench --iterations 100000 --audio-dir ./samples > before.json
+#include <argparse/argparse.hpp>
+#include <bench.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+int main(int argc, char *argv[]) {
+  argparse::ArgumentParser program("xtool-bench");
+  program.add_description("Run xtool micro benchmarks, results as JSON.");
+  program.add_argument("--iterations")
+      .scan<'u', std::uint32_t>()
+      .default_value(std::uint32_t{100000})
+      .help("Iterations per benchmark case.");
+  program.add_argument("--json").help(
+      "JSON file to write, stdout if omitted.");
+  program.add_argument("--audio-dir")
+      .help("Directory with mp3/flac files for the decoder benchmark.");
+  program.add_argument("--no-dolphin")
+      .default_value(false)
+      .implicit_value(true)
+      .help("Skip the dolphin read benchmark.");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (std::exception const &e) {
+    std::cerr << e.what() << std::endl << program;
+    return EXIT_FAILURE;
+  }
+
+  // stdout is for the JSON
+  spdlog::set_default_logger(spdlog::stderr_color_mt("xtool-bench"));
+
+  try {
+    BenchOptions options;
+    options.iterations = program.get<std::uint32_t>("--iterations");
+    if (auto const audio_dir = program.present("--audio-dir")) {
+      options.audio_dir = *audio_dir;
+    }
+    options.dolphin = !program.get<bool>("--no-dolphin");
+
+    auto const results = run_benchmarks(options);
+    if (auto const json_path = program.present("--json")) {
+      std::ofstream file(*json_path, std::ios::trunc);
+      write_bench_json(file, results);
+      if (!file) {
+        spdlog::error("Failed to write {}.", *json_path);
+        return EXIT_FAILURE;
+      }
+      spdlog::info("Wrote {} results to {}.", results.size(), *json_path);
+    } else {
+      write_bench_json(std::cout, results);
+    }
+  } catch (std::exception const &e) {
+    spdlog::error("{}", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}